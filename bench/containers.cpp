@@ -0,0 +1,106 @@
+#include <benchmark/benchmark.h>
+
+extern "C"
+{
+#include "definitions.h"
+#include "dynamic_array.h"
+#include "dynamic_buffer.h"
+#include "file_data.h"
+}
+
+// The same line-lookup loops the editor runs on every frame and search, once through the
+// void*/unit_size DynamicArray and once through the generated LineArray
+
+static const size_t line_count = 100000;
+
+static void fill_lines(FileData *file_data, DynamicArray *darr)
+{
+	fdata_init(file_data, 80);
+	for (size_t i = 0; i < line_count; i++)
+	{
+		DynamicBuffer *line = dbuf_create(MEM_LINES);
+		for (size_t j = 0; j < i % 50; j++)
+		{
+			dbuf_addc(line, 'a' + j % 26);
+		}
+		fdata_add_line(file_data, line);
+		darr_add_single(darr, &line);
+	}
+}
+
+static void BM_line_scan_dynamic_array(benchmark::State &state)
+{
+	FileData file_data;
+	DynamicArray *darr = darr_create(sizeof(DynamicBuffer*), MEM_OTHER);
+	fill_lines(&file_data, darr);
+	for (auto _ : state)
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < darr_get_size(darr); i++)
+		{
+			total += dbuf_get_size(*(DynamicBuffer* const*)darr_getc(darr, i));
+		}
+		benchmark::DoNotOptimize(total);
+	}
+	state.SetItemsProcessed(state.iterations() * line_count);
+	darr_destroy(darr);
+	fdata_destroy(&file_data);
+}
+BENCHMARK(BM_line_scan_dynamic_array);
+
+static void BM_line_scan_typed_array(benchmark::State &state)
+{
+	FileData file_data;
+	DynamicArray *darr = darr_create(sizeof(DynamicBuffer*), MEM_OTHER);
+	fill_lines(&file_data, darr);
+	for (auto _ : state)
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < fdata_get_line_count(&file_data); i++)
+		{
+			total += dbuf_get_size(fdata_get_line(&file_data, i));
+		}
+		benchmark::DoNotOptimize(total);
+	}
+	state.SetItemsProcessed(state.iterations() * line_count);
+	darr_destroy(darr);
+	fdata_destroy(&file_data);
+}
+BENCHMARK(BM_line_scan_typed_array);
+
+static void BM_match_collect_dynamic_array(benchmark::State &state)
+{
+	DynamicArray *matches = darr_create(sizeof(vec2), MEM_OTHER);
+	for (auto _ : state)
+	{
+		darr_clear(matches);
+		for (int i = 0; i < (int)line_count; i++)
+		{
+			vec2 match = {.x = i % 80, .y = i};
+			darr_add_single(matches, &match);
+		}
+		benchmark::DoNotOptimize(darr_getc(matches, 0));
+	}
+	state.SetItemsProcessed(state.iterations() * line_count);
+	darr_destroy(matches);
+}
+BENCHMARK(BM_match_collect_dynamic_array);
+
+DEFINE_TYPED_ARRAY(BenchMatchArray, bmarr, vec2)
+
+static void BM_match_collect_typed_array(benchmark::State &state)
+{
+	BenchMatchArray *matches = bmarr_create(MEM_OTHER);
+	for (auto _ : state)
+	{
+		bmarr_clear(matches);
+		for (int i = 0; i < (int)line_count; i++)
+		{
+			bmarr_add(matches, (vec2) {.x = i % 80, .y = i});
+		}
+		benchmark::DoNotOptimize(bmarr_getc(matches, 0));
+	}
+	state.SetItemsProcessed(state.iterations() * line_count);
+	bmarr_destroy(matches);
+}
+BENCHMARK(BM_match_collect_typed_array);
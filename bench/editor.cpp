@@ -0,0 +1,746 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+extern "C"
+{
+#include "definitions.h"
+#include "editor.h"
+#include "allocator.h"
+#include "cold_store.h"
+#include "file_data.h"
+#include "headless_io.h"
+#include "line_cache.h"
+#include "pipeline.h"
+#include "viewer.h"
+}
+
+static const vec2 window_size = {80, 25};
+
+// Writes a file with `line_count` lines of varying length, some of them longer than the window
+static std::string generate_file(size_t line_count)
+{
+	char path[] = "/tmp/text-editor-bench-XXXXXX";
+	int fd = mkstemp(path);
+	FILE *fp = fdopen(fd, "w");
+	for (size_t i = 0; i < line_count; i++)
+	{
+		size_t length = (i * 7919) % 160;
+		for (size_t j = 0; j < length; j++)
+		{
+			fputc(j % 11 == 10 ? ' ' : 'a' + (i + j) % 26, fp);
+		}
+		fputc('\n', fp);
+	}
+	fclose(fp);
+	return path;
+}
+
+// Writes a log with `line_count` lines, which repeat a lot between them like real logs do
+static std::string generate_log_file(size_t line_count)
+{
+	char path[] = "/tmp/text-editor-bench-XXXXXX";
+	int fd = mkstemp(path);
+	FILE *fp = fdopen(fd, "w");
+	const char *levels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN"};
+	for (size_t i = 0; i < line_count; i++)
+	{
+		fprintf(fp, "2026-10-19T%02zu:%02zu:%02zu.%06zu %s worker-%02zu handled request %zu in %zums\n", i / 360000 % 24, i / 6000 % 60,
+				i / 100 % 60, i * 7919 % 1000000, levels[i * 31 % 5], i * 13 % 16, i, i * 7919 % 937);
+	}
+	fclose(fp);
+	return path;
+}
+
+static size_t get_resident_size()
+{
+	size_t pages = 0, resident = 0;
+	FILE *fp = fopen("/proc/self/statm", "r");
+	if (fscanf(fp, "%zu %zu", &pages, &resident) != 2)
+	{
+		resident = 0;
+	}
+	fclose(fp);
+	return resident * sysconf(_SC_PAGESIZE);
+}
+
+class EditorWorkload
+{
+public:
+	EditorWorkload(size_t line_count, bool follow = false) : EditorWorkload(generate_file(line_count), follow)
+	{
+	}
+
+	// Takes a generated file, which is removed with the workload
+	explicit EditorWorkload(const std::string &file, bool follow = false)
+	{
+		path = file;
+		editor = editor_create(window_size, headless_io_recording_interface());
+		headless_io_reset();
+		if (follow)
+		{
+			editor_enable_follow(editor);
+		}
+		editor_read_file(editor, path.c_str());
+	}
+
+	~EditorWorkload()
+	{
+		editor_destroy(editor);
+		// Big files leave a line cache next to them
+		char cache_path[PATH_MAX];
+		lcache_get_path(path.c_str(), cache_path, sizeof(cache_path));
+		unlink(cache_path);
+		unlink(path.c_str());
+	}
+
+	// One tick and one frame for each key, like the main loop
+	void press(int key, bool timed = true)
+	{
+		auto start = std::chrono::steady_clock::now();
+		headless_io_feed_keys(1, &key);
+		editor_process_tick(editor);
+		editor_render_screen(editor);
+		auto end = std::chrono::steady_clock::now();
+		if (!timed)
+		{
+			return;
+		}
+		frame_times.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+	}
+
+	Editor *get_editor()
+	{
+		return editor;
+	}
+
+	const std::string &get_path()
+	{
+		return path;
+	}
+
+	// Drops the timings of the setup keys
+	void reset_timings()
+	{
+		frame_times.clear();
+	}
+
+	void report(benchmark::State &state)
+	{
+		std::sort(frame_times.begin(), frame_times.end());
+		state.SetItemsProcessed(frame_times.size());
+		state.counters["ticks/s"] = benchmark::Counter(frame_times.size(), benchmark::Counter::kIsRate);
+		state.counters["p50_us"] = percentile(0.50);
+		state.counters["p90_us"] = percentile(0.90);
+		state.counters["p99_us"] = percentile(0.99);
+		state.counters["max_us"] = frame_times.empty() ? 0 : frame_times.back();
+		state.counters["bytes/frame"] = (double)headless_io_get_total_output_size() / std::max<size_t>(1, headless_io_get_frame_count());
+	}
+
+private:
+	double percentile(double p)
+	{
+		if (frame_times.empty())
+		{
+			return 0;
+		}
+		return frame_times[(size_t)(p * (frame_times.size() - 1))];
+	}
+
+	std::string path;
+	Editor *editor;
+	std::vector<double> frame_times;
+};
+
+static void BM_typing(benchmark::State &state)
+{
+	EditorWorkload workload(state.range(0));
+	workload.press(ARROW_DOWN);
+	size_t typed = 0;
+	for (auto _ : state)
+	{
+		// Typing a word and erasing it again keeps the line length bounded
+		size_t step = typed++ % 64;
+		workload.press(step < 32 ? 'a' + step % 26 : BACKSPACE);
+	}
+	workload.report(state);
+}
+BENCHMARK(BM_typing)->Arg(1000)->Arg(100000);
+
+// Views are split side by side first, then every half is split again, so pairs of views share a width
+static void BM_split_typing(benchmark::State &state)
+{
+	EditorWorkload workload(100000);
+	int splits[] = {SPLIT_VERTICAL_KEY, SPLIT_HORIZONTAL_KEY, NEXT_VIEW_KEY, NEXT_VIEW_KEY, SPLIT_HORIZONTAL_KEY};
+	for (int i = 0; i + 1 < state.range(0) && i < 5; i++)
+	{
+		workload.press(splits[i], false);
+	}
+	workload.press(ARROW_DOWN);
+	workload.reset_timings();
+	size_t typed = 0;
+	for (auto _ : state)
+	{
+		size_t step = typed++ % 64;
+		workload.press(step < 32 ? 'a' + step % 26 : BACKSPACE);
+	}
+	workload.report(state);
+}
+BENCHMARK(BM_split_typing)->Arg(1)->Arg(2)->Arg(6);
+
+static void BM_multi_cursor_typing(benchmark::State &state)
+{
+	EditorWorkload workload(100000);
+	for (int64_t i = 1; i < state.range(0); i++)
+	{
+		workload.press(ADD_CURSOR_KEY);
+	}
+	workload.reset_timings();
+	size_t typed = 0;
+	for (auto _ : state)
+	{
+		// Every key is applied at all the cursors at once
+		size_t step = typed++ % 64;
+		workload.press(step < 32 ? 'a' + step % 26 : BACKSPACE);
+	}
+	workload.report(state);
+}
+BENCHMARK(BM_multi_cursor_typing)->Arg(100)->Arg(10000);
+
+static void BM_move_lines(benchmark::State &state)
+{
+	EditorWorkload workload(200000);
+	for (int64_t i = 1; i < state.range(0); i++)
+	{
+		workload.press(ADD_CURSOR_KEY);
+	}
+	workload.reset_timings();
+	size_t step = 0;
+	for (auto _ : state)
+	{
+		// The block goes down and back up, only the line next to it is displaced each time
+		workload.press(step++ % 2 == 0 ? MOVE_LINES_DOWN_KEY : MOVE_LINES_UP_KEY);
+	}
+	workload.report(state);
+}
+BENCHMARK(BM_move_lines)->Arg(1)->Arg(100000);
+
+static void BM_copy_paste(benchmark::State &state)
+{
+	EditorWorkload workload(state.range(0));
+	size_t line_bytes = mem_get_current(MEM_LINES);
+	for (auto _ : state)
+	{
+		// Selecting the first half of the file, copying it and pasting it at the top, only the two keys are timed
+		for (int key : std::vector<int> {MARK_KEY, GOTO_KEY, '5', '0', '%', CARRIAGE_RETURN})
+		{
+			workload.press(key, false);
+		}
+		workload.press(COPY_KEY);
+		for (int key : std::vector<int> {GOTO_KEY, '1', CARRIAGE_RETURN})
+		{
+			workload.press(key, false);
+		}
+		workload.press(PASTE_KEY);
+		state.PauseTiming();
+		workload.press(UNDO_KEY, false);
+		state.ResumeTiming();
+	}
+	state.counters["line_bytes_growth"] = (double)mem_get_current(MEM_LINES) - (double)line_bytes;
+	workload.report(state);
+}
+BENCHMARK(BM_copy_paste)->Arg(1000)->Arg(100000);
+
+static void BM_macro_replay(benchmark::State &state)
+{
+	EditorWorkload workload(200000);
+	// Commenting out a line and going to the next one
+	std::vector<int> macro = {MACRO_RECORD_KEY, '/', '*', ' ', 'o', 'k', ' ', '*', '/', ' '};
+	macro.insert(macro.end(), 9, ARROW_LEFT);
+	macro.push_back(ARROW_DOWN);
+	macro.push_back(MACRO_RECORD_KEY);
+	for (int key : macro)
+	{
+		workload.press(key, false);
+	}
+	std::string count = std::to_string(state.range(0));
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		for (int key : std::vector<int> {GOTO_KEY, '1', CARRIAGE_RETURN, MACRO_REPLAY_KEY})
+		{
+			workload.press(key, false);
+		}
+		for (char digit : count)
+		{
+			workload.press(digit, false);
+		}
+		state.ResumeTiming();
+		// The whole replay runs in this one tick and frame
+		workload.press(CARRIAGE_RETURN);
+	}
+	state.counters["keys/s"] = benchmark::Counter((double)state.iterations() * state.range(0) * (macro.size() - 2), benchmark::Counter::kIsRate);
+	workload.report(state);
+}
+// Every replay makes the lines longer, a few iterations keep them shorter than the window
+BENCHMARK(BM_macro_replay)->Arg(1000)->Arg(100000)->Iterations(5)->Unit(benchmark::kMillisecond);
+
+static void BM_scrolling(benchmark::State &state)
+{
+	EditorWorkload workload(state.range(0));
+	size_t line_count = state.range(0);
+	size_t step = 0;
+	for (auto _ : state)
+	{
+		// Going all the way down and back up
+		workload.press((step++ / line_count) % 2 == 0 ? ARROW_DOWN : ARROW_UP);
+	}
+	workload.report(state);
+}
+BENCHMARK(BM_scrolling)->Arg(1000)->Arg(100000);
+
+static void BM_paging(benchmark::State &state)
+{
+	EditorWorkload workload(state.range(0));
+	size_t pages = state.range(0) / (window_size.y - 1);
+	size_t step = 0;
+	for (auto _ : state)
+	{
+		workload.press((step++ / pages) % 2 == 0 ? PAGE_DOWN : PAGE_UP);
+	}
+	workload.report(state);
+}
+BENCHMARK(BM_paging)->Arg(1000)->Arg(100000);
+
+static void BM_search(benchmark::State &state)
+{
+	EditorWorkload workload(state.range(0));
+	workload.press(CTRL('f'));
+	workload.press('a');
+	workload.press('b');
+	for (auto _ : state)
+	{
+		workload.press(CARRIAGE_RETURN);
+		workload.press(ARROW_DOWN);
+	}
+	workload.report(state);
+}
+BENCHMARK(BM_search)->Arg(1000)->Arg(100000);
+
+static void BM_split_join(benchmark::State &state)
+{
+	EditorWorkload workload(state.range(0));
+	workload.press(ARROW_DOWN);
+	workload.press(ARROW_RIGHT);
+	workload.press(ARROW_RIGHT);
+	for (auto _ : state)
+	{
+		workload.press(CARRIAGE_RETURN);
+		workload.press(BACKSPACE);
+	}
+	workload.report(state);
+}
+BENCHMARK(BM_split_join)->Arg(1000)->Arg(100000);
+
+static void BM_journal_recovery(benchmark::State &state)
+{
+	// Typing with some backspaces and line breaks, every key is one journal record
+	std::vector<int> keys;
+	for (int64_t i = 0; i < state.range(0); i++)
+	{
+		size_t step = i % 50;
+		keys.push_back(step < 32 ? 'a' + step % 26 : step < 49 ? BACKSPACE : CARRIAGE_RETURN);
+	}
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		std::string path = generate_file(1000);
+		Editor *crashed = editor_create(window_size, headless_io_null_interface());
+		editor_read_file(crashed, path.c_str());
+		editor_enable_journal(crashed);
+		editor_apply_keys(crashed, keys.size(), keys.data());
+		// Destroying without closing the journal leaves it behind like a crash would
+		editor_destroy(crashed);
+		state.ResumeTiming();
+		Editor *editor = editor_create(window_size, headless_io_null_interface());
+		editor_read_file(editor, path.c_str());
+		size_t recovered = editor_enable_journal(editor);
+		state.PauseTiming();
+		if (recovered != keys.size())
+		{
+			state.SkipWithError("not every edit was recovered");
+		}
+		editor_save_all(editor);
+		editor_destroy(editor);
+		unlink(path.c_str());
+		state.ResumeTiming();
+	}
+	state.counters["records/s"] = benchmark::Counter((double)state.iterations() * state.range(0), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_journal_recovery)->Arg(1000000)->Iterations(3)->Unit(benchmark::kMillisecond);
+
+static void BM_buffer_switching(benchmark::State &state)
+{
+	// Cycling through more buffers than are kept loaded makes every switch read a file again
+	std::vector<std::string> paths;
+	Editor *editor = editor_create(window_size, headless_io_recording_interface());
+	headless_io_reset();
+	for (int64_t i = 0; i < state.range(0); i++)
+	{
+		paths.push_back(generate_file(20000));
+		editor_open_file(editor, paths.back().c_str());
+	}
+	state.counters["lines_bytes_after_open"] = mem_get_current(MEM_LINES);
+	int key = NEXT_BUFFER_KEY;
+	for (auto _ : state)
+	{
+		headless_io_feed_keys(1, &key);
+		editor_process_tick(editor);
+		editor_render_screen(editor);
+	}
+	state.counters["lines_bytes"] = mem_get_current(MEM_LINES);
+	editor_destroy(editor);
+	for (const std::string &path : paths)
+	{
+		unlink(path.c_str());
+	}
+}
+BENCHMARK(BM_buffer_switching)->Arg(4)->Arg(50)->Unit(benchmark::kMicrosecond);
+
+static void BM_external_change(benchmark::State &state)
+{
+	// Another program rewrites the file with 10 lines changed, only those lines are put in again
+	size_t line_count = state.range(0);
+	EditorWorkload workload(line_count);
+	editor_enable_file_watch(workload.get_editor());
+	std::vector<std::string> lines;
+	FILE *fp = fopen(workload.get_path().c_str(), "r");
+	char *line = NULL;
+	size_t size;
+	ssize_t length;
+	while ((length = getline(&line, &size, fp)) != -1)
+	{
+		lines.push_back(std::string(line, length));
+	}
+	free(line);
+	fclose(fp);
+	size_t version = 0;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		std::vector<std::string> changed = lines;
+		version++;
+		for (size_t i = 0; i < 10; i++)
+		{
+			changed[(i * 7919 + version) % line_count] = "changed " + std::to_string(version) + "\n";
+		}
+		fp = fopen(workload.get_path().c_str(), "w");
+		for (const std::string &text : changed)
+		{
+			fputs(text.c_str(), fp);
+		}
+		fclose(fp);
+		state.ResumeTiming();
+		workload.press(NUL);
+	}
+	workload.report(state);
+	// What reading the whole file again would cost
+	auto start = std::chrono::steady_clock::now();
+	Editor *editor = editor_create(window_size, headless_io_null_interface());
+	editor_read_file(editor, workload.get_path().c_str());
+	auto end = std::chrono::steady_clock::now();
+	editor_destroy(editor);
+	state.counters["full_read_us"] = std::chrono::duration<double, std::micro>(end - start).count();
+}
+BENCHMARK(BM_external_change)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+static void BM_follow_log(benchmark::State &state)
+{
+	// A log growing by 100K lines a second, taken in every 100ms with the view following its end
+	EditorWorkload workload(0, true);
+	size_t batch_lines = state.range(0);
+	size_t line = 0;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		FILE *fp = fopen(workload.get_path().c_str(), "a");
+		for (size_t i = 0; i < batch_lines; i++, line++)
+		{
+			fprintf(fp, "2026-10-19T12:00:00.%06zu INFO worker-%02zu handled request %zu\n", line % 1000000, line % 16, line);
+		}
+		fclose(fp);
+		usleep(100000);
+		state.ResumeTiming();
+		workload.press(NUL);
+	}
+	workload.report(state);
+}
+BENCHMARK(BM_follow_log)->Arg(10000)->Iterations(50)->Unit(benchmark::kMicrosecond);
+
+static void BM_view_open(benchmark::State &state)
+{
+	// Opening in view mode and showing the first screen, which doesn't depend on the file size
+	std::string path = generate_file(state.range(0));
+	for (auto _ : state)
+	{
+		Viewer *viewer = viewer_create(path.c_str(), window_size, headless_io_null_interface());
+		viewer_render_screen(viewer);
+		viewer_destroy(viewer);
+	}
+	// Going to a line builds the index up to it once
+	Viewer *viewer = viewer_create(path.c_str(), window_size, headless_io_recording_interface());
+	headless_io_reset();
+	std::string keys = "\x07" + std::to_string(state.range(0) / 2) + "\r";
+	auto start = std::chrono::steady_clock::now();
+	for (char key : keys)
+	{
+		int c = key;
+		headless_io_feed_keys(1, &c);
+		viewer_process_tick(viewer);
+	}
+	viewer_render_screen(viewer);
+	auto end = std::chrono::steady_clock::now();
+	viewer_destroy(viewer);
+	state.counters["goto_middle_us"] = std::chrono::duration<double, std::micro>(end - start).count();
+	unlink(path.c_str());
+}
+BENCHMARK(BM_view_open)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+static void BM_cold_lines(benchmark::State &state)
+{
+	// A log that is only looked at in a few places has its other lines compressed while no keys come in
+	EditorWorkload workload(generate_log_file(state.range(0)));
+	std::vector<int> search_keys = {CTRL('f')};
+	for (char c : std::string("request 77777"))
+	{
+		search_keys.push_back(c);
+	}
+	search_keys.push_back(CARRIAGE_RETURN);
+	search_keys.push_back(CTRL('x'));
+	auto search = [&]()
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (int key : search_keys)
+		{
+			workload.press(key, false);
+		}
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	};
+	state.counters["search_hot_ms"] = search();
+	workload.press(GOTO_KEY, false);
+	workload.press('1', false);
+	workload.press(CARRIAGE_RETURN, false);
+	size_t hot_size = get_resident_size();
+	auto start = std::chrono::steady_clock::now();
+	size_t ticks = 0;
+	size_t cold_size;
+	do
+	{
+		cold_size = mem_get_current(MEM_COLD);
+		// Every buffer gets a tick in turn, the unnamed one included
+		workload.press(NUL, false);
+		workload.press(NUL, false);
+		ticks += 2;
+	} while (mem_get_current(MEM_COLD) != cold_size);
+	// The round of ticks that had nothing left to compress gave the freed lines back
+	auto end = std::chrono::steady_clock::now();
+	state.counters["rss_hot_mb"] = hot_size / 1048576.0;
+	state.counters["rss_cold_mb"] = get_resident_size() / 1048576.0;
+	state.counters["cold_mb"] = mem_get_current(MEM_COLD) / 1048576.0;
+	state.counters["compress_ms_per_tick"] = std::chrono::duration<double, std::milli>(end - start).count() / ticks;
+	state.counters["search_cold_ms"] = search();
+	// Going to lines that were compressed, every one in another block
+	size_t step = 0;
+	for (auto _ : state)
+	{
+		std::string line = std::to_string((step++ * 7919 * COLD_BLOCK_LINES) % state.range(0) + 1);
+		workload.press(GOTO_KEY, false);
+		for (char c : line)
+		{
+			workload.press(c, false);
+		}
+		workload.press(CARRIAGE_RETURN);
+	}
+	workload.report(state);
+}
+BENCHMARK(BM_cold_lines)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+static void BM_reopen(benchmark::State &state)
+{
+	// The first open reads the file and leaves its line cache, every open after it maps the file
+	std::string path = generate_log_file(state.range(0));
+	auto open = [&]()
+	{
+		Editor *editor = editor_create(window_size, headless_io_null_interface());
+		editor_read_file(editor, path.c_str());
+		editor_render_screen(editor);
+		return editor;
+	};
+	auto start = std::chrono::steady_clock::now();
+	editor_destroy(open());
+	auto end = std::chrono::steady_clock::now();
+	state.counters["first_open_ms"] = std::chrono::duration<double, std::milli>(end - start).count();
+	for (auto _ : state)
+	{
+		editor_destroy(open());
+	}
+	Editor *editor = open();
+	state.counters["lines_mb_after_reopen"] = mem_get_current(MEM_LINES) / 1048576.0;
+	editor_destroy(editor);
+	char cache_path[PATH_MAX];
+	lcache_get_path(path.c_str(), cache_path, sizeof(cache_path));
+	unlink(cache_path);
+	unlink(path.c_str());
+}
+BENCHMARK(BM_reopen)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static IO_Interface laggy_output;
+
+// A terminal over a slow link, every flush takes a millisecond to get out
+static void laggy_flush_output()
+{
+	usleep(1000);
+	laggy_output.flush_output();
+}
+
+static void BM_laggy_terminal(benchmark::State &state)
+{
+	// Typing into a terminal that flushes slowly, on one thread (0) or with the input and the rendering on their own (1)
+	bool threaded = state.range(0) == 1;
+	std::string path = generate_file(1000);
+	std::vector<int> keys;
+	for (int i = 0; i < 1000; i++)
+	{
+		keys.push_back('a' + i % 26);
+	}
+	keys.push_back(QUIT_KEY);
+	laggy_output = headless_io_recording_interface();
+	IO_Interface output = laggy_output;
+	output.flush_output = laggy_flush_output;
+	for (auto _ : state)
+	{
+		headless_io_reset();
+		headless_io_feed_keys(keys.size(), keys.data());
+		if (threaded)
+		{
+			pline_start((vec2) {window_size.x, window_size.y + 1}, output);
+		}
+		Editor *editor = editor_create(window_size, threaded ? pline_get_interface() : output);
+		editor_read_file(editor, path.c_str());
+		while (editor_process_tick(editor) == TEXT_EDITOR_SUCCESSFUL_READ)
+		{
+			editor_render_screen(editor);
+		}
+		if (threaded)
+		{
+			pline_stop();
+			state.counters["drawn_frames"] = pline_get_drawn_frame_count();
+		}
+		editor_destroy(editor);
+	}
+	state.counters["keys/s"] = benchmark::Counter((double)state.iterations() * keys.size(), benchmark::Counter::kIsRate);
+	unlink(path.c_str());
+}
+BENCHMARK(BM_laggy_terminal)->Arg(0)->Arg(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_background_search(benchmark::State &state)
+{
+	// Searching a big file with the key applied in one go, which waits for the search (0), or with ticks that run a slice of it each (1)
+	bool background = state.range(0) == 1;
+	EditorWorkload workload(state.range(1));
+	Editor *editor = workload.get_editor();
+	std::vector<int> setup = {CTRL('f'), 'q', 'r', 's'};
+	editor_apply_keys(editor, setup.size(), setup.data());
+	int search_key = CARRIAGE_RETURN;
+	double longest_tick = 0;
+	size_t tick_count = 0;
+	for (auto _ : state)
+	{
+		if (background)
+		{
+			headless_io_feed_keys(1, &search_key);
+		}
+		do
+		{
+			auto start = std::chrono::steady_clock::now();
+			if (background)
+			{
+				editor_process_tick(editor);
+			}
+			else
+			{
+				editor_apply_keys(editor, 1, &search_key);
+			}
+			editor_render_screen(editor);
+			longest_tick = std::max(longest_tick, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			tick_count++;
+		}
+		// The search is done once the bar stops saying it's searching
+		while (strstr(headless_io_get_last_frame(), "Searching: ") != NULL);
+	}
+	state.counters["longest_tick_ms"] = longest_tick;
+	state.counters["ticks"] = benchmark::Counter(tick_count, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_background_search)->Args({0, 1000000})->Args({1, 1000000})->Unit(benchmark::kMillisecond);
+
+static void BM_snapshot_edits(benchmark::State &state)
+{
+	// Typing on lines all over a big file, without snapshots (0) or with one held over every edit (1), like a search job holds it
+	bool snapshots = state.range(0) == 1;
+	std::string text;
+	for (long i = 0; i < state.range(1); i++)
+	{
+		text += "line " + std::to_string(i * 7919 % 1000003) + " of the file\n";
+	}
+	FileData file_data;
+	fdata_init(&file_data, 80);
+	bool line_open = true;
+	fdata_append_lines(&file_data, text.size(), text.c_str(), &line_open);
+	if (snapshots)
+	{
+		auto start = std::chrono::steady_clock::now();
+		snap_destroy(fdata_take_snapshot(&file_data));
+		state.counters["first_snapshot_ms"] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < 1000; i++)
+		{
+			snap_destroy(fdata_take_snapshot(&file_data));
+		}
+		state.counters["snapshot_ns"] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / 1000;
+	}
+	size_t row = 0;
+	for (auto _ : state)
+	{
+		Snapshot *snapshot = snapshots ? fdata_take_snapshot(&file_data) : NULL;
+		row = (row + 7919) % fdata_get_line_count(&file_data);
+		fdata_insert_text(&file_data, (vec2) {.x = 0, .y = (int)row}, 1, "x");
+		if (snapshot != NULL)
+		{
+			snap_destroy(snapshot);
+		}
+	}
+	state.counters["snapshot_mb"] = mem_get_current(MEM_SNAPSHOT) / 1048576.0;
+	fdata_destroy(&file_data);
+}
+BENCHMARK(BM_snapshot_edits)->Args({0, 1000000})->Args({1, 1000000})->Args({1, 10000000})->Unit(benchmark::kMicrosecond);
+
+static void BM_resize_storm(benchmark::State &state)
+{
+	// A window dragged over a big file, every tick is a new size. Only the shown lines are laid out while it goes on
+	EditorWorkload workload(state.range(0));
+	size_t step = 0;
+	for (auto _ : state)
+	{
+		int width = 60 + step++ % 40;
+		workload.press(MAKE_RESIZE_KEY(width, window_size.y));
+	}
+	workload.report(state);
+}
+BENCHMARK(BM_resize_storm)->Arg(100000)->Arg(1000000);
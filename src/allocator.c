@@ -0,0 +1,148 @@
+/* Includes */
+#include <stdatomic.h>
+#include "error_handling.h"
+#include "allocator.h"
+
+/* Global Data */
+static const char *category_names[MEM_CATEGORY_COUNT] = { "lines", "layout", "search", "render", "terminal", "undo", "other", "cold", "snapshot" };
+static atomic_size_t current_bytes[MEM_CATEGORY_COUNT];
+static atomic_size_t peak_bytes[MEM_CATEGORY_COUNT];
+static atomic_size_t used_bytes[MEM_CATEGORY_COUNT];
+
+/* Private Function Declarations */
+void mem_add_current(int category, long long change);
+double mem_get_slack_ratio(int category);
+void mem_format_size(char *buf, size_t size, size_t bytes);
+
+void *mem_alloc(int category, size_t size)
+{
+	void *ptr = malloc(size);
+	tassert(ptr != NULL || size == 0, "mem_alloc: out of memory");
+	mem_add_current(category, size);
+	return ptr;
+}
+
+void *mem_calloc(int category, size_t count, size_t size)
+{
+	void *ptr = calloc(count, size);
+	tassert(ptr != NULL || count * size == 0, "mem_calloc: out of memory");
+	mem_add_current(category, count * size);
+	return ptr;
+}
+
+void *mem_realloc(int category, void *ptr, size_t old_size, size_t new_size)
+{
+	ptr = realloc(ptr, new_size);
+	tassert(ptr != NULL || new_size == 0, "mem_realloc: out of memory");
+	mem_add_current(category, (long long)new_size - (long long)old_size);
+	return ptr;
+}
+
+void mem_free(int category, void *ptr, size_t size)
+{
+	free(ptr);
+	mem_add_current(category, -(long long)size);
+}
+
+void mem_add_used(int category, long long change)
+{
+	tassert(0 <= category && category < MEM_CATEGORY_COUNT, "mem_add_used: category is out of range");
+
+	atomic_fetch_add_explicit(&used_bytes[category], change, memory_order_relaxed);
+}
+
+size_t mem_get_current(int category)
+{
+	return atomic_load_explicit(&current_bytes[category], memory_order_relaxed);
+}
+
+size_t mem_get_peak(int category)
+{
+	return atomic_load_explicit(&peak_bytes[category], memory_order_relaxed);
+}
+
+size_t mem_get_used(int category)
+{
+	return atomic_load_explicit(&used_bytes[category], memory_order_relaxed);
+}
+
+const char *mem_get_category_name(int category)
+{
+	return category_names[category];
+}
+
+void mem_format_report(char *buf, size_t size)
+{
+	size_t used = 0;
+	size_t total = 0;
+	for (int category = 0; category < MEM_CATEGORY_COUNT; category++)
+	{
+		total += mem_get_current(category);
+	}
+	char total_text[16];
+	mem_format_size(total_text, sizeof(total_text), total);
+	used += snprintf(buf, size, "mem %s:", total_text);
+	for (int category = 0; category < MEM_CATEGORY_COUNT && used < size; category++)
+	{
+		if (mem_get_peak(category) == 0)
+		{
+			continue;
+		}
+		char current_text[16];
+		mem_format_size(current_text, sizeof(current_text), mem_get_current(category));
+		used += snprintf(buf + used, size - used, " %s %s (%d%% slack)", category_names[category], current_text, (int)(mem_get_slack_ratio(category) * 100));
+	}
+}
+
+void mem_print_summary(FILE *fp)
+{
+	fprintf(fp, "%-10s %12s %12s %12s %7s\n", "category", "current", "peak", "used", "slack");
+	for (int category = 0; category < MEM_CATEGORY_COUNT; category++)
+	{
+		fprintf(fp, "%-10s %12zu %12zu %12zu %6.1f%%\n", category_names[category], mem_get_current(category),
+				mem_get_peak(category), mem_get_used(category), mem_get_slack_ratio(category) * 100);
+	}
+}
+
+void mem_add_current(int category, long long change)
+{
+	tassert(0 <= category && category < MEM_CATEGORY_COUNT, "mem_add_current: category is out of range");
+
+	size_t current = atomic_fetch_add_explicit(&current_bytes[category], change, memory_order_relaxed) + change;
+	size_t peak = atomic_load_explicit(&peak_bytes[category], memory_order_relaxed);
+	// A failed exchange reloads peak, so this stops once peak is at least current
+	while (current > peak && !atomic_compare_exchange_weak_explicit(&peak_bytes[category], &peak, current, memory_order_relaxed, memory_order_relaxed))
+	{
+	}
+}
+
+double mem_get_slack_ratio(int category)
+{
+	size_t current = mem_get_current(category);
+	size_t used = mem_get_used(category);
+	if (current == 0 || used >= current)
+	{
+		return 0;
+	}
+	return 1 - (double)used / current;
+}
+
+void mem_format_size(char *buf, size_t size, size_t bytes)
+{
+	if (bytes >= (1 << 30))
+	{
+		snprintf(buf, size, "%.1fG", bytes / (double)(1 << 30));
+	}
+	else if (bytes >= (1 << 20))
+	{
+		snprintf(buf, size, "%.1fM", bytes / (double)(1 << 20));
+	}
+	else if (bytes >= (1 << 10))
+	{
+		snprintf(buf, size, "%.1fK", bytes / (double)(1 << 10));
+	}
+	else
+	{
+		snprintf(buf, size, "%zuB", bytes);
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Every container allocation is counted under one of these */
+#define MEM_LINES          0
+#define MEM_LAYOUT         1
+#define MEM_SEARCH         2
+#define MEM_RENDER         3
+#define MEM_TERMINAL       4
+#define MEM_UNDO           5
+#define MEM_OTHER          6
+#define MEM_COLD           7
+#define MEM_SNAPSHOT       8
+#define MEM_CATEGORY_COUNT 9
+
+void *mem_alloc(int category, size_t size);
+void *mem_calloc(int category, size_t count, size_t size);
+void *mem_realloc(int category, void *ptr, size_t old_size, size_t new_size);
+void mem_free(int category, void *ptr, size_t size);
+void mem_add_used(int category, long long change);
+
+size_t mem_get_current(int category);
+size_t mem_get_peak(int category);
+size_t mem_get_used(int category);
+const char *mem_get_category_name(int category);
+
+void mem_format_report(char *buf, size_t size);
+void mem_print_summary(FILE *fp);
@@ -0,0 +1,142 @@
+/* Includes */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "allocator.h"
+#include "batch.h"
+#include "definitions.h"
+#include "dynamic_array.h"
+#include "editor.h"
+#include "error_handling.h"
+#include "headless_io.h"
+#include "key_trace.h"
+
+/* Definitions */
+typedef struct
+{
+	vec2 window_size;
+	const int *keys;
+	size_t key_count;
+	char *const *filenames;
+	size_t file_count;
+	IO_Interface io_interface;
+	atomic_size_t next_file;  // Workers take the files in order, so big files don't pile up on one thread
+	atomic_size_t byte_count;
+	atomic_size_t failed_count;
+} BatchJob;
+
+/* Private Function Declarations */
+void *batch_worker(void *arg);
+bool batch_edit_file(BatchJob *job, const char *filename);
+double batch_get_time();
+
+bool batch_run(const char *script_filename, size_t file_count, char *const *filenames, size_t thread_count, BatchReport *report)
+{
+	tassert(thread_count > 0, "batch_run: thread_count is 0");
+
+	KeyTrace *script = ktrace_load(script_filename);
+	if (script == NULL)
+	{
+		return false;
+	}
+	DynamicArray *keys = darr_create(sizeof(int), MEM_OTHER);
+	for (size_t i = 0; i < darr_get_size(script->events); i++)
+	{
+		darr_add_single(keys, &((const KeyTraceEvent *)darr_getc(script->events, i))->key);
+	}
+	if (thread_count > file_count)
+	{
+		thread_count = file_count > 0 ? file_count : 1;
+	}
+	// Workers share the backend, so it's one that keeps no state. The keys are fed to the editors directly
+	BatchJob job = {
+		.window_size = script->window_size,
+		.keys = darr_get_size(keys) > 0 ? darr_getc(keys, 0) : NULL,
+		.key_count = darr_get_size(keys),
+		.filenames = filenames,
+		.file_count = file_count,
+		.io_interface = headless_io_stateless_interface(),
+	};
+	atomic_init(&job.next_file, 0);
+	atomic_init(&job.byte_count, 0);
+	atomic_init(&job.failed_count, 0);
+	double start = batch_get_time();
+	pthread_t *threads = mem_alloc(MEM_OTHER, thread_count * sizeof(pthread_t));
+	for (size_t i = 0; i < thread_count; i++)
+	{
+		if (pthread_create(&threads[i], NULL, batch_worker, &job) != 0)
+		{
+			throw_up("batch_run: couldn't start a worker");
+		}
+	}
+	for (size_t i = 0; i < thread_count; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	mem_free(MEM_OTHER, threads, thread_count * sizeof(pthread_t));
+	report->file_count = file_count;
+	report->failed_count = atomic_load(&job.failed_count);
+	report->byte_count = atomic_load(&job.byte_count);
+	report->thread_count = thread_count;
+	report->seconds = batch_get_time() - start;
+	darr_destroy(keys);
+	ktrace_destroy(script);
+	return true;
+}
+
+size_t batch_get_default_thread_count()
+{
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? count : 1;
+}
+
+void batch_print_report(const BatchReport *report, FILE *fp)
+{
+	double seconds = report->seconds > 0 ? report->seconds : 1e-9;
+	fprintf(fp, "files:   %zu on %zu threads in %.3f s\n", report->file_count, report->thread_count, report->seconds);
+	fprintf(fp, "failed:  %zu\n", report->failed_count);
+	fprintf(fp, "files/s: %.1f\n", report->file_count / seconds);
+	fprintf(fp, "MB/s:    %.1f\n", report->byte_count / seconds / (1 << 20));
+}
+
+void *batch_worker(void *arg)
+{
+	BatchJob *job = arg;
+	for (size_t i = atomic_fetch_add(&job->next_file, 1); i < job->file_count; i = atomic_fetch_add(&job->next_file, 1))
+	{
+		if (!batch_edit_file(job, job->filenames[i]))
+		{
+			atomic_fetch_add(&job->failed_count, 1);
+		}
+	}
+	return NULL;
+}
+
+// Reads, edits and saves the file like an interactive session that never renders. False when the file couldn't be read,
+// it isn't edited then, or when the edits couldn't be written
+bool batch_edit_file(BatchJob *job, const char *filename)
+{
+	struct stat st;
+	if (stat(filename, &st) == 0)
+	{
+		atomic_fetch_add(&job->byte_count, st.st_size);
+	}
+	Editor *editor = editor_create(job->window_size, job->io_interface);
+	bool edited = editor_read_file(editor, filename);
+	if (edited)
+	{
+		editor_apply_keys(editor, job->key_count, job->keys);
+		edited = editor_write_file(editor, filename);
+	}
+	editor_destroy(editor);
+	return edited;
+}
+
+double batch_get_time()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
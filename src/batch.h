@@ -0,0 +1,23 @@
+#pragma once
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Applies a key script to many files without a terminal. Scripts are key
+ * traces, so a session recorded with --record-trace can be run on other
+ * files. Every file gets its own Editor and the files are shared out to a
+ * pool of worker threads.
+ */
+typedef struct
+{
+	size_t file_count;
+	size_t failed_count; // Files that couldn't be read or written, the others are still edited
+	size_t byte_count;   // Sizes of the files before they were edited
+	size_t thread_count;
+	double seconds;
+} BatchReport;
+
+bool batch_run(const char *script_filename, size_t file_count, char *const *filenames, size_t thread_count, BatchReport *report);
+size_t batch_get_default_thread_count();
+void batch_print_report(const BatchReport *report, FILE *fp);
@@ -0,0 +1,530 @@
+/* Includes */
+#include <string.h>
+#include "allocator.h"
+#include "cold_store.h"
+#include "error_handling.h"
+#include "lz.h"
+
+/* Private Function Declarations */
+DynamicBuffer *cold_make_slot(size_t id, size_t index);
+size_t cold_add_block(ColdStore *obj, ColdBlock *block);
+size_t cold_get_slot_block(const DynamicBuffer *slot);
+void cold_reserve_stream(ColdStore *obj, size_t size);
+void cold_stream(ColdStore *obj, size_t id);
+void cold_make_hot(ColdStore *obj, size_t id);
+void cold_drop_hot_lines(ColdStore *obj, size_t id, bool destroy_lines);
+void cold_free_block(ColdStore *obj, size_t id);
+void cold_adopt_block(ColdStore *obj, ColdBlock *block);
+void cold_free_unpinned(ColdStore *obj);
+void cold_unmap_block(ColdStore *obj);
+
+ColdStore *cold_create(void)
+{
+	ColdStore *obj = mem_alloc(MEM_COLD, sizeof(ColdStore));
+	mem_add_used(MEM_COLD, sizeof(ColdStore));
+	obj->blocks = cbarr_create(MEM_COLD);
+	obj->free_ids = biarr_create(MEM_COLD);
+	for (size_t i = 0; i < COLD_HOT_BLOCKS; i++)
+	{
+		obj->hot[i] = SIZE_MAX;
+	}
+	obj->stream_block = SIZE_MAX;
+	obj->stream = NULL;
+	obj->stream_text = NULL;
+	obj->stream_capacity = 0;
+	obj->map = NULL;
+	obj->map_size = 0;
+	obj->mapped_blocks = 0;
+	obj->adopt_id = 0;
+	obj->thawed_ids = biarr_create(MEM_COLD);
+	pthread_mutex_init(&obj->lock, NULL);
+	return obj;
+}
+
+void cold_destroy(ColdStore *obj)
+{
+	tassert(obj, "cold_destroy: obj is NULL");
+
+	for (size_t id = 0; id < cbarr_get_size(obj->blocks); id++)
+	{
+		if (cbarr_get(obj->blocks, id) != NULL)
+		{
+			tassert(cbarr_get(obj->blocks, id)->pin_count == 0, "cold_destroy: a snapshot still holds a block");
+			cold_free_block(obj, id);
+		}
+	}
+	cbarr_destroy(obj->blocks);
+	biarr_destroy(obj->free_ids);
+	biarr_destroy(obj->thawed_ids);
+	pthread_mutex_destroy(&obj->lock);
+	mem_add_used(MEM_COLD, -(long long)obj->stream_capacity);
+	mem_free(MEM_COLD, obj->stream_text, obj->stream_capacity);
+	mem_add_used(MEM_COLD, -(long long)sizeof(ColdStore));
+	mem_free(MEM_COLD, obj, sizeof(ColdStore));
+}
+
+// Takes the lines and puts their slots in their place. False when compressing doesn't make them smaller, they are kept then
+bool cold_freeze(ColdStore *obj, size_t count, DynamicBuffer **lines)
+{
+	tassert(0 < count && count <= COLD_BLOCK_LINES, "cold_freeze: count is out of range");
+
+	size_t text_size = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (dbuf_get_size(lines[i]) > UINT32_MAX)
+		{
+			return false;
+		}
+		text_size += dbuf_get_size(lines[i]);
+	}
+	// The lines are joined in the stream buffer, which then no longer holds a block
+	cold_reserve_stream(obj, text_size);
+	obj->stream_block = SIZE_MAX;
+	size_t offset = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		memcpy(obj->stream_text + offset, dbuf_get_with_nulc(lines[i], 0), dbuf_get_size(lines[i]));
+		offset += dbuf_get_size(lines[i]);
+	}
+	size_t max_size = lz_get_max_compressed_size(text_size);
+	char *data = mem_alloc(MEM_COLD, max_size);
+	size_t size = lz_compress(text_size, obj->stream_text, data);
+	if (size > text_size)
+	{
+		mem_free(MEM_COLD, data, max_size);
+		return false;
+	}
+	ColdBlock *block = mem_alloc(MEM_COLD, sizeof(ColdBlock));
+	block->data = mem_realloc(MEM_COLD, data, max_size, size);
+	block->size = size;
+	block->mapped = false;
+	block->text_size = text_size;
+	block->line_count = count;
+	block->line_sizes = mem_alloc(MEM_COLD, count * sizeof(uint32_t));
+	block->hot_lines = NULL;
+	block->pin_count = 0;
+	block->thawed = false;
+	mem_add_used(MEM_COLD, sizeof(ColdBlock) + size + count * sizeof(uint32_t));
+	for (size_t i = 0; i < count; i++)
+	{
+		block->line_sizes[i] = dbuf_get_size(lines[i]);
+	}
+	size_t id = cold_add_block(obj, block);
+	for (size_t i = 0; i < count; i++)
+	{
+		dbuf_destroy(lines[i]);
+		lines[i] = cold_make_slot(id, i);
+	}
+	return true;
+}
+
+// Puts the lines of the slot's block back in the slots around it, returns how many of them are from slot on
+size_t cold_thaw(ColdStore *obj, DynamicBuffer **slot)
+{
+	tassert(cold_is_slot(*slot), "cold_thaw: not a slot");
+
+	cold_free_unpinned(obj);
+	size_t id = cold_get_slot_block(*slot);
+	size_t index = cold_get_slot_index(*slot);
+	ColdBlock *block = cbarr_get(obj->blocks, id);
+	DynamicBuffer **lines = slot - index;
+	size_t line_count = block->line_count;
+	for (size_t i = 0; i < line_count; i++)
+	{
+		lines[i] = (DynamicBuffer *)cold_get_line(obj, cold_make_slot(id, i));
+	}
+	// The hot lines went to the slots, they aren't the block's to destroy anymore
+	cold_drop_hot_lines(obj, id, false);
+	pthread_mutex_lock(&obj->lock);
+	bool pinned = block->pin_count > 0;
+	block->thawed = pinned;
+	pthread_mutex_unlock(&obj->lock);
+	if (pinned)
+	{
+		biarr_add(obj->thawed_ids, id);
+	}
+	else
+	{
+		cold_free_block(obj, id);
+	}
+	return line_count - index;
+}
+
+// Takes the text of a file, allocated with mem_alloc(MEM_COLD, size). Its lines are added with cold_map_lines, it's freed
+// once all of them are adopted or thawed
+void cold_map_file(ColdStore *obj, char *map, size_t size)
+{
+	tassert(obj->map == NULL, "cold_map_file: a file is already mapped");
+
+	obj->map = map;
+	obj->map_size = size;
+	mem_add_used(MEM_COLD, size);
+}
+
+// Puts slots for the count lines that start at text in the file's text, each followed by a line break but the last
+// line of the file. Returns how many bytes of the file the lines and their line breaks take
+size_t cold_map_lines(ColdStore *obj, size_t count, const char *text, const uint32_t *line_sizes, DynamicBuffer **slots)
+{
+	tassert(0 < count && count <= COLD_BLOCK_LINES, "cold_map_lines: count is out of range");
+	tassert(obj->map <= text && text < obj->map + obj->map_size, "cold_map_lines: text isn't in the file's text");
+
+	ColdBlock *block = mem_alloc(MEM_COLD, sizeof(ColdBlock));
+	block->text_size = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		block->text_size += line_sizes[i];
+	}
+	size_t end = text - obj->map + block->text_size + count;
+	block->data = (char *)text;
+	block->size = (end > obj->map_size ? obj->map_size : end) - (text - obj->map);
+	block->mapped = true;
+	block->line_count = count;
+	block->line_sizes = mem_alloc(MEM_COLD, count * sizeof(uint32_t));
+	memcpy(block->line_sizes, line_sizes, count * sizeof(uint32_t));
+	block->hot_lines = NULL;
+	block->pin_count = 0;
+	block->thawed = false;
+	mem_add_used(MEM_COLD, sizeof(ColdBlock) + count * sizeof(uint32_t));
+	obj->mapped_blocks++;
+	size_t id = cold_add_block(obj, block);
+	for (size_t i = 0; i < count; i++)
+	{
+		slots[i] = cold_make_slot(id, i);
+	}
+	return block->size;
+}
+
+// Compresses up to budget mapped blocks into memory of their own, their slots stay as they are. True when some were
+// adopted. A block is adopted even when compressing doesn't make it smaller, the file's text has to go
+bool cold_adopt_mapped(ColdStore *obj, size_t budget)
+{
+	cold_free_unpinned(obj);
+	size_t adopted = 0;
+	for (; adopted < budget && obj->mapped_blocks > 0; obj->adopt_id++)
+	{
+		if (obj->adopt_id >= cbarr_get_size(obj->blocks))
+		{
+			obj->adopt_id = 0;
+		}
+		ColdBlock *block = cbarr_get(obj->blocks, obj->adopt_id);
+		if (block == NULL || !block->mapped)
+		{
+			continue;
+		}
+		cold_adopt_block(obj, block);
+		adopted++;
+	}
+	return adopted > 0;
+}
+
+// Only valid until COLD_HOT_BLOCKS other blocks are read or the block is thawed, the line is never shared
+const DynamicBuffer *cold_get_line(ColdStore *obj, const DynamicBuffer *slot)
+{
+	size_t id = cold_get_slot_block(slot);
+	cold_make_hot(obj, id);
+	return cbarr_get(obj->blocks, id)->hot_lines[cold_get_slot_index(slot)];
+}
+
+// Only valid until the next call, reading lines in order decompresses every block once
+const char *cold_get_line_text(ColdStore *obj, const DynamicBuffer *slot, size_t *size)
+{
+	size_t id = cold_get_slot_block(slot);
+	size_t index = cold_get_slot_index(slot);
+	const ColdBlock *block = cbarr_get(obj->blocks, id);
+	if (block->hot_lines != NULL)
+	{
+		*size = dbuf_get_size(block->hot_lines[index]);
+		return dbuf_get_with_nulc(block->hot_lines[index], 0);
+	}
+	cold_stream(obj, id);
+	*size = block->line_sizes[index];
+	return obj->stream + obj->stream_starts[index];
+}
+
+size_t cold_get_line_size(const ColdStore *obj, const DynamicBuffer *slot)
+{
+	return cbarr_get(obj->blocks, cold_get_slot_block(slot))->line_sizes[cold_get_slot_index(slot)];
+}
+
+size_t cold_get_block_line_count(const ColdStore *obj, const DynamicBuffer *slot)
+{
+	return cbarr_get(obj->blocks, cold_get_slot_block(slot))->line_count;
+}
+
+// Keeps the slot's block for a snapshot. A mapped block is adopted first, the file's text may go before the snapshot does
+void cold_pin(ColdStore *obj, const DynamicBuffer *slot)
+{
+	ColdBlock *block = cbarr_get(obj->blocks, cold_get_slot_block(slot));
+	if (block->mapped)
+	{
+		cold_adopt_block(obj, block);
+	}
+	pthread_mutex_lock(&obj->lock);
+	block->pin_count++;
+	pthread_mutex_unlock(&obj->lock);
+}
+
+// On any thread, a thawed block is freed by the owner once it's unpinned
+void cold_unpin(ColdStore *obj, const DynamicBuffer *slot)
+{
+	pthread_mutex_lock(&obj->lock);
+	ColdBlock *block = cbarr_get(obj->blocks, cold_get_slot_block(slot));
+	tassert(block->pin_count > 0, "cold_unpin: the block isn't pinned");
+	block->pin_count--;
+	pthread_mutex_unlock(&obj->lock);
+}
+
+void cold_init_reader(ColdReader *reader)
+{
+	reader->block = SIZE_MAX;
+	reader->text = NULL;
+	reader->capacity = 0;
+}
+
+void cold_destroy_reader(ColdReader *reader)
+{
+	mem_free(MEM_COLD, reader->text, reader->capacity);
+}
+
+// Only valid until the reader reads a line of another block. The slot must be held by a snapshot, its block is
+// still there then
+const char *cold_read_line_text(ColdStore *obj, const DynamicBuffer *slot, ColdReader *reader, size_t *size)
+{
+	size_t id = cold_get_slot_block(slot);
+	size_t index = cold_get_slot_index(slot);
+	if (reader->block != id)
+	{
+		pthread_mutex_lock(&obj->lock);
+		const ColdBlock *block = cbarr_get(obj->blocks, id);
+		if (block->text_size > reader->capacity)
+		{
+			reader->text = mem_realloc(MEM_COLD, reader->text, reader->capacity, block->text_size);
+			reader->capacity = block->text_size;
+		}
+		// Mapped lines are copied without their line breaks, the file's text may go once the lock is let go of
+		const char *text = block->data;
+		size_t offset = 0;
+		for (size_t i = 0; i < block->line_count; i++)
+		{
+			reader->starts[i] = offset;
+			if (block->mapped)
+			{
+				memcpy(reader->text + offset, text, block->line_sizes[i]);
+				text += block->line_sizes[i] + 1;
+			}
+			offset += block->line_sizes[i];
+		}
+		reader->starts[block->line_count] = offset;
+		if (!block->mapped)
+		{
+			lz_decompress(block->size, block->data, reader->text);
+		}
+		pthread_mutex_unlock(&obj->lock);
+		reader->block = id;
+	}
+	*size = reader->starts[index + 1] - reader->starts[index];
+	return reader->text + reader->starts[index];
+}
+
+DynamicBuffer *cold_make_slot(size_t id, size_t index)
+{
+	return (DynamicBuffer *)((id << 9) | (index << 1) | 1);
+}
+
+size_t cold_add_block(ColdStore *obj, ColdBlock *block)
+{
+	size_t id;
+	pthread_mutex_lock(&obj->lock);
+	if (biarr_get_size(obj->free_ids) > 0)
+	{
+		id = biarr_get(obj->free_ids, biarr_get_size(obj->free_ids) - 1);
+		biarr_pop(obj->free_ids);
+		cbarr_set(obj->blocks, id, block);
+	}
+	else
+	{
+		cbarr_add(obj->blocks, block);
+		id = cbarr_get_size(obj->blocks) - 1;
+	}
+	pthread_mutex_unlock(&obj->lock);
+	return id;
+}
+
+size_t cold_get_slot_block(const DynamicBuffer *slot)
+{
+	return (uintptr_t)slot >> 9;
+}
+
+void cold_reserve_stream(ColdStore *obj, size_t size)
+{
+	if (size <= obj->stream_capacity)
+	{
+		return;
+	}
+	obj->stream_text = mem_realloc(MEM_COLD, obj->stream_text, obj->stream_capacity, size);
+	mem_add_used(MEM_COLD, size - obj->stream_capacity);
+	obj->stream_capacity = size;
+}
+
+void cold_stream(ColdStore *obj, size_t id)
+{
+	if (obj->stream_block == id)
+	{
+		return;
+	}
+	const ColdBlock *block = cbarr_get(obj->blocks, id);
+	// Mapped lines are read where they are, past their line breaks
+	if (block->mapped)
+	{
+		obj->stream = block->data;
+	}
+	else
+	{
+		cold_reserve_stream(obj, block->text_size);
+		lz_decompress(block->size, block->data, obj->stream_text);
+		obj->stream = obj->stream_text;
+	}
+	size_t offset = 0;
+	for (size_t i = 0; i < block->line_count; i++)
+	{
+		obj->stream_starts[i] = offset;
+		offset += block->line_sizes[i] + block->mapped;
+	}
+	obj->stream_block = id;
+}
+
+void cold_make_hot(ColdStore *obj, size_t id)
+{
+	ColdBlock *block = cbarr_get(obj->blocks, id);
+	if (block->hot_lines != NULL)
+	{
+		size_t place = 0;
+		while (obj->hot[place] != id)
+		{
+			place++;
+		}
+		memmove(obj->hot + 1, obj->hot, place * sizeof(size_t));
+		obj->hot[0] = id;
+		return;
+	}
+	if (obj->hot[COLD_HOT_BLOCKS - 1] != SIZE_MAX)
+	{
+		cold_drop_hot_lines(obj, obj->hot[COLD_HOT_BLOCKS - 1], true);
+	}
+	memmove(obj->hot + 1, obj->hot, (COLD_HOT_BLOCKS - 1) * sizeof(size_t));
+	obj->hot[0] = id;
+	cold_stream(obj, id);
+	block->hot_lines = mem_alloc(MEM_COLD, block->line_count * sizeof(DynamicBuffer *));
+	mem_add_used(MEM_COLD, block->line_count * sizeof(DynamicBuffer *));
+	for (size_t i = 0; i < block->line_count; i++)
+	{
+		block->hot_lines[i] = dbuf_create(MEM_LINES);
+		dbuf_adds(block->hot_lines[i], block->line_sizes[i], obj->stream + obj->stream_starts[i]);
+	}
+}
+
+void cold_drop_hot_lines(ColdStore *obj, size_t id, bool destroy_lines)
+{
+	ColdBlock *block = cbarr_get(obj->blocks, id);
+	if (block->hot_lines == NULL)
+	{
+		return;
+	}
+	for (size_t i = 0; i < block->line_count && destroy_lines; i++)
+	{
+		dbuf_destroy(block->hot_lines[i]);
+	}
+	mem_add_used(MEM_COLD, -(long long)(block->line_count * sizeof(DynamicBuffer *)));
+	mem_free(MEM_COLD, block->hot_lines, block->line_count * sizeof(DynamicBuffer *));
+	block->hot_lines = NULL;
+	size_t place = 0;
+	while (obj->hot[place] != id)
+	{
+		place++;
+	}
+	memmove(obj->hot + place, obj->hot + place + 1, (COLD_HOT_BLOCKS - 1 - place) * sizeof(size_t));
+	obj->hot[COLD_HOT_BLOCKS - 1] = SIZE_MAX;
+}
+
+void cold_free_block(ColdStore *obj, size_t id)
+{
+	ColdBlock *block = cbarr_get(obj->blocks, id);
+	cold_drop_hot_lines(obj, id, true);
+	if (obj->stream_block == id)
+	{
+		obj->stream_block = SIZE_MAX;
+	}
+	pthread_mutex_lock(&obj->lock);
+	cbarr_set(obj->blocks, id, NULL);
+	pthread_mutex_unlock(&obj->lock);
+	if (block->mapped)
+	{
+		cold_unmap_block(obj);
+	}
+	else
+	{
+		mem_add_used(MEM_COLD, -(long long)block->size);
+		mem_free(MEM_COLD, block->data, block->size);
+	}
+	mem_add_used(MEM_COLD, -(long long)(sizeof(ColdBlock) + block->line_count * sizeof(uint32_t)));
+	mem_free(MEM_COLD, block->line_sizes, block->line_count * sizeof(uint32_t));
+	mem_free(MEM_COLD, block, sizeof(ColdBlock));
+	biarr_add(obj->free_ids, id);
+}
+
+// Compresses the lines of a mapped block into memory of its own, its slots stay as they are
+void cold_adopt_block(ColdStore *obj, ColdBlock *block)
+{
+	// The stream buffer is where the lines are joined, so it no longer holds a block
+	cold_reserve_stream(obj, block->text_size);
+	obj->stream_block = SIZE_MAX;
+	// The lines are joined without their line breaks, like the lines of a frozen block
+	const char *text = block->data;
+	size_t offset = 0;
+	for (size_t i = 0; i < block->line_count; i++)
+	{
+		memcpy(obj->stream_text + offset, text, block->line_sizes[i]);
+		text += block->line_sizes[i] + 1;
+		offset += block->line_sizes[i];
+	}
+	size_t max_size = lz_get_max_compressed_size(block->text_size);
+	char *data = mem_alloc(MEM_COLD, max_size);
+	size_t size = lz_compress(block->text_size, obj->stream_text, data);
+	data = mem_realloc(MEM_COLD, data, max_size, size);
+	pthread_mutex_lock(&obj->lock);
+	block->data = data;
+	block->size = size;
+	block->mapped = false;
+	cold_unmap_block(obj);
+	pthread_mutex_unlock(&obj->lock);
+	mem_add_used(MEM_COLD, block->size);
+}
+
+// Frees the thawed blocks that no snapshot holds anymore
+void cold_free_unpinned(ColdStore *obj)
+{
+	for (size_t i = biarr_get_size(obj->thawed_ids); i-- > 0;)
+	{
+		size_t id = biarr_get(obj->thawed_ids, i);
+		pthread_mutex_lock(&obj->lock);
+		bool pinned = cbarr_get(obj->blocks, id)->pin_count > 0;
+		pthread_mutex_unlock(&obj->lock);
+		if (!pinned)
+		{
+			cold_free_block(obj, id);
+			biarr_remove(obj->thawed_ids, i);
+		}
+	}
+}
+
+// Called for every block that leaves the file's text
+void cold_unmap_block(ColdStore *obj)
+{
+	if (--obj->mapped_blocks == 0)
+	{
+		mem_add_used(MEM_COLD, -(long long)obj->map_size);
+		mem_free(MEM_COLD, obj->map, obj->map_size);
+		obj->map = NULL;
+		obj->map_size = 0;
+	}
+}
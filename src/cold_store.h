@@ -0,0 +1,104 @@
+#pragma once
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "definitions.h"
+#include "dynamic_buffer.h"
+#include "typed_array.h"
+
+#define COLD_BLOCK_LINES 256 // Lines compressed together, a slot keeps the index of its line in 8 bits
+#define COLD_HOT_BLOCKS  8   // Blocks kept as lines for render and edits, the least recently used is dropped first
+
+typedef struct
+{
+	char *data;                // The lines back to back without line breaks, compressed. Mapped lines keep their line breaks
+	size_t size;
+	bool mapped;               // The lines are still in the file's text, data isn't the block's
+	size_t text_size;
+	size_t line_count;
+	uint32_t *line_sizes;
+	DynamicBuffer **hot_lines; // The lines while the block is hot, NULL otherwise
+	size_t pin_count;          // Snapshots holding slots of the block, it isn't freed while they do
+	bool thawed;               // The lines are back in the file, the block is only kept for the snapshots
+} ColdBlock;
+
+DEFINE_TYPED_ARRAY(ColdBlockArray, cbarr, ColdBlock*)
+DEFINE_TYPED_ARRAY(BlockIdArray, biarr, size_t)
+
+/*
+ * Lines that nobody looked at or changed for a while, compressed in blocks of up to
+ * COLD_BLOCK_LINES lines. A compressed line is a slot in place of its DynamicBuffer handle:
+ *
+ *   slot: <block id> <8 bit index of the line in the block> 1
+ *
+ * Handles are never odd, so the low bit tells slots apart. Reading a line makes its block
+ * hot, reading only the text goes through the stream block, which is decompressed once for
+ * all of its lines and keeps no handles. Lines are only changed after they are thawed.
+ * Blocks can also be lines of a file's text the store was given, which are only compressed when
+ * they are adopted. The text is freed once no block is left in it.
+ *
+ * Snapshots read blocks from other threads through a ColdReader. They take the lock, which the
+ * owner only takes where blocks are added, changed or freed. A pinned block is never mapped
+ * and stays after it's thawed, until the last snapshot unpins it.
+ */
+typedef struct
+{
+	ColdBlockArray *blocks;       // By id, NULL for the ids in free_ids
+	BlockIdArray *free_ids;
+	size_t hot[COLD_HOT_BLOCKS];  // Most recently used first, SIZE_MAX for an empty place
+	size_t stream_block;          // Block in stream, SIZE_MAX when there is none
+	const char *stream;           // stream_text, or the lines of the block in map
+	char *stream_text;
+	size_t stream_capacity;
+	size_t stream_starts[COLD_BLOCK_LINES];
+	char *map;                    // The text of a file, which the store owns and frees
+	size_t map_size;
+	size_t mapped_blocks;         // Blocks still in map
+	size_t adopt_id;              // Where cold_adopt_mapped goes on from
+	BlockIdArray *thawed_ids;     // Thawed blocks that were still pinned
+	pthread_mutex_t lock;
+} ColdStore;
+
+/* Reads the lines of blocks on any thread, with a copy of the text of the last block it read */
+typedef struct
+{
+	size_t block; // SIZE_MAX when there is none
+	char *text;
+	size_t capacity;
+	size_t starts[COLD_BLOCK_LINES + 1];
+} ColdReader;
+
+ColdStore *cold_create(void);
+void cold_destroy(ColdStore *obj);
+
+bool cold_freeze(ColdStore *obj, size_t count, DynamicBuffer **lines);
+size_t cold_thaw(ColdStore *obj, DynamicBuffer **slot);
+void cold_map_file(ColdStore *obj, char *map, size_t size);
+size_t cold_map_lines(ColdStore *obj, size_t count, const char *text, const uint32_t *line_sizes, DynamicBuffer **slots);
+bool cold_adopt_mapped(ColdStore *obj, size_t budget);
+const DynamicBuffer *cold_get_line(ColdStore *obj, const DynamicBuffer *slot);
+const char *cold_get_line_text(ColdStore *obj, const DynamicBuffer *slot, size_t *size);
+size_t cold_get_line_size(const ColdStore *obj, const DynamicBuffer *slot);
+size_t cold_get_block_line_count(const ColdStore *obj, const DynamicBuffer *slot);
+void cold_pin(ColdStore *obj, const DynamicBuffer *slot);
+void cold_unpin(ColdStore *obj, const DynamicBuffer *slot);
+
+void cold_init_reader(ColdReader *reader);
+void cold_destroy_reader(ColdReader *reader);
+const char *cold_read_line_text(ColdStore *obj, const DynamicBuffer *slot, ColdReader *reader, size_t *size);
+
+static FORCE_INLINE bool cold_is_empty(const ColdStore *obj)
+{
+	return cbarr_get_size(obj->blocks) == biarr_get_size(obj->free_ids);
+}
+
+static FORCE_INLINE bool cold_is_slot(const DynamicBuffer *line)
+{
+	return (uintptr_t)line & 1;
+}
+
+static FORCE_INLINE size_t cold_get_slot_index(const DynamicBuffer *slot)
+{
+	return ((uintptr_t)slot >> 1) & (COLD_BLOCK_LINES - 1);
+}
@@ -4,6 +4,12 @@
 
 #define EDITOR_WRITE_STATE  0
 #define EDITOR_SEARCH_STATE 1
+#define EDITOR_GOTO_STATE   2
+#define EDITOR_MACRO_STATE  3
+
+#define OVERLAY_NONE     0
+#define OVERLAY_PROFILER 1
+#define OVERLAY_MEMORY   2
 
 
 #define QUIT_KEY        CTRL('q')
@@ -11,6 +17,44 @@
 #define ARROW_DOWN      1001
 #define ARROW_LEFT      1002
 #define ARROW_RIGHT     1003
+#define PAGE_UP         1004
+#define PAGE_DOWN       1005
+#define ALT_ARROW_UP    1006
+#define ALT_ARROW_DOWN  1007
+#define SHIFT_ARROW_UP    1008
+#define SHIFT_ARROW_DOWN  1009
+#define SHIFT_ARROW_LEFT  1010
+#define SHIFT_ARROW_RIGHT 1011
+// The window was resized, the new size is packed into the key so that it stays in order with the keys around it
+#define RESIZE_KEY              0x40000000
+#define MAKE_RESIZE_KEY(x, y)   (RESIZE_KEY | ((x) & 0x7fff) << 15 | ((y) & 0x7fff))
+#define IS_RESIZE_KEY(c)        ((c) > 0 && ((c) & RESIZE_KEY) != 0)
+#define GET_RESIZE_KEY_SIZE(c)  ((vec2) {.x = ((c) >> 15) & 0x7fff, .y = (c) & 0x7fff})
+#define GOTO_KEY        CTRL('g')
+#define PROFILER_KEY    CTRL('p')
+#define MEMORY_KEY      CTRL('t')
+#define UNDO_KEY        CTRL('z')
+#define REDO_KEY        CTRL('y')
+#define ADD_CURSOR_KEY  CTRL('e')
+#define ADD_CURSORS_KEY CTRL('a')
+#define ESCAPE_KEY      '\x1b'
+#define CUT_LINES_KEY       CTRL('k')
+#define PASTE_LINES_KEY     CTRL('u')
+#define DUPLICATE_LINES_KEY CTRL('d')
+#define DELETE_LINES_KEY    CTRL('l')
+#define MOVE_LINES_UP_KEY   ALT_ARROW_UP
+#define MOVE_LINES_DOWN_KEY ALT_ARROW_DOWN
+#define MARK_KEY            CTRL('b')
+#define COPY_KEY            CTRL('c')
+#define CUT_KEY             CTRL('w')
+#define PASTE_KEY           CTRL('v')
+#define MACRO_RECORD_KEY    CTRL('r')
+#define MACRO_REPLAY_KEY    CTRL('o')
+#define NEXT_BUFFER_KEY     CTRL('n')
+#define SPLIT_HORIZONTAL_KEY CTRL('_') // The new view goes below
+#define SPLIT_VERTICAL_KEY   CTRL('\\') // The new view goes to the right
+#define NEXT_VIEW_KEY        CTRL(']')
+#define CLOSE_VIEW_KEY       CTRL('^')
 #define CARRIAGE_RETURN '\r'
 #define BACKSPACE        127
 
@@ -24,6 +68,8 @@
 #define TEXT_EDITOR_EOF                    1
 #define TEXT_EDITOR_SWITCH_TO_SEARCH_STATE 2
 #define TEXT_EDITOR_SWITCH_TO_WRITE_STATE  3
+#define TEXT_EDITOR_SWITCH_TO_GOTO_STATE   4
+#define TEXT_EDITOR_SWITCH_TO_MACRO_STATE  5
 
 typedef struct
 {
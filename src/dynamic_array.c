@@ -1,4 +1,5 @@
 #include <string.h>
+#include "allocator.h"
 #include "error_handling.h"
 #include "dynamic_array.h"
 
@@ -6,18 +7,20 @@
 #define INITIAL_RESERVED 64
 
 /* Private Functions */
-void darr_realloc(DynamicArray *obj);
+void darr_realloc(DynamicArray *obj, size_t old_reserved_length);
 void *darr_get_byte(DynamicArray *obj, size_t byte_index);
 const void *darr_get_bytec(const DynamicArray *obj, size_t byte_index);
 size_t darr_get_byte_index(const DynamicArray *obj, size_t index);
 
-DynamicArray *darr_create(size_t unit_size)
+DynamicArray *darr_create(size_t unit_size, int mem_category)
 {
-	DynamicArray *obj = malloc(sizeof(DynamicArray));
+	DynamicArray *obj = mem_alloc(mem_category, sizeof(DynamicArray));
+	mem_add_used(mem_category, sizeof(DynamicArray));
+	obj->mem_category = mem_category;
 	obj->unit_size = unit_size;
 	obj->length = 0;
 	obj->reserved_length = 64;
-	obj->arr = malloc(obj->unit_size * obj->reserved_length);
+	obj->arr = mem_alloc(mem_category, obj->unit_size * obj->reserved_length);
 	return obj;
 }
 
@@ -25,8 +28,9 @@ void darr_destroy(DynamicArray *obj)
 {
 	tassert(obj, "darr_destroy: obj is NULL");
 
-	free(obj->arr);
-	free(obj);
+	mem_add_used(obj->mem_category, -(long long)(obj->length * obj->unit_size + sizeof(DynamicArray)));
+	mem_free(obj->mem_category, obj->arr, obj->reserved_length * obj->unit_size);
+	mem_free(obj->mem_category, obj, sizeof(DynamicArray));
 }
 
 const void *darr_getc(const DynamicArray *obj, size_t i)
@@ -60,14 +64,19 @@ void darr_add_multiple(DynamicArray *obj, size_t count, const void *vals)
 	tassert(obj, "darr_add_multiple: obj is NULL");
 	tassert(vals, "darr_add_single: vals is NULL");
 
-	while (obj->length + count > obj->reserved_length)
+	if (obj->length + count > obj->reserved_length)
 	{
-		obj->reserved_length <<= 1;
+		size_t old_reserved_length = obj->reserved_length;
+		while (obj->length + count > obj->reserved_length)
+		{
+			obj->reserved_length <<= 1;
+		}
+		darr_realloc(obj, old_reserved_length);
 	}
-	darr_realloc(obj);
 	size_t dest_byte_index = darr_get_byte_index(obj, obj->length);
 	memcpy(darr_get_byte(obj, dest_byte_index), vals, count * obj->unit_size);
 	obj->length += count;
+	mem_add_used(obj->mem_category, count * obj->unit_size);
 }
 
 void darr_pop(DynamicArray *obj)
@@ -76,12 +85,14 @@ void darr_pop(DynamicArray *obj)
 	tassert(obj->length > 0, "darr_pop: length is empty");
 
 	obj->length--;
+	mem_add_used(obj->mem_category, -(long long)obj->unit_size);
 }
 
 void darr_clear(DynamicArray *obj)
 {
 	tassert(obj, "darr_clear: obj is NULL");
 
+	mem_add_used(obj->mem_category, -(long long)(obj->length * obj->unit_size));
 	obj->length = 0;
 }
 
@@ -92,12 +103,12 @@ size_t darr_get_byte_index(const DynamicArray *obj, size_t index)
 	return index * obj->unit_size;
 }
 
-void darr_realloc(DynamicArray *obj)
+void darr_realloc(DynamicArray *obj, size_t old_reserved_length)
 {
 	tassert(obj, "darr_realloc: obj is NULL");
 	tassert(obj->length <= obj->reserved_length, "darr_realloc: reserved_length smaller than data length");
 
-	obj->arr = realloc(obj->arr, obj->reserved_length * obj->unit_size);
+	obj->arr = mem_realloc(obj->mem_category, obj->arr, old_reserved_length * obj->unit_size, obj->reserved_length * obj->unit_size);
 }
 
 size_t darr_get_size(const DynamicArray *obj)
@@ -126,11 +137,15 @@ void darr_shift_right(DynamicArray *obj, size_t pos)
 {
 	tassert(obj, "darr_shift_right: obj is NULL");
 	tassert(0 <= pos && pos < darr_get_size(obj), "darr_shfit_right: position out of range");
-	darr_add_single(obj, darr_getc(obj, darr_get_size(obj) - 1));
-	for (size_t i = obj->length - 1; i > pos; i--)
+	// Growing before touching the elements, the last element can't be passed to darr_add_single since it might be reallocated
+	if (obj->length + 1 > obj->reserved_length)
 	{
-		memcpy(darr_get(obj, i), darr_getc(obj, i-1), obj->unit_size);
+		obj->reserved_length <<= 1;
+		darr_realloc(obj, obj->reserved_length >> 1);
 	}
+	obj->length++;
+	mem_add_used(obj->mem_category, obj->unit_size);
+	memmove(darr_get(obj, pos + 1), darr_getc(obj, pos), (obj->length - 1 - pos) * obj->unit_size);
 }
 
 void darr_shift_left(DynamicArray *obj, size_t start_pos)
@@ -3,13 +3,14 @@
 
 typedef struct
 {
+	int mem_category;
 	size_t unit_size;
 	size_t length;
 	size_t reserved_length;
 	void *arr;
 } DynamicArray;
 
-DynamicArray *darr_create(size_t unit_size);
+DynamicArray *darr_create(size_t unit_size, int mem_category);
 void darr_destroy(DynamicArray *obj);
 
 const void *darr_getc(const DynamicArray *obj, size_t i);
@@ -1,5 +1,6 @@
 #include <string.h>
 #include <stdbool.h>
+#include "allocator.h"
 #include "definitions.h"
 #include "error_handling.h"
 #include "dynamic_buffer.h"
@@ -7,11 +8,13 @@
 
 /* Private functions */
 
-DynamicBuffer *dbuf_create()
+DynamicBuffer *dbuf_create(int mem_category)
 {
-	DynamicBuffer *obj = malloc(sizeof(DynamicBuffer));
-	obj->darr = darr_create(sizeof(char));
-	darr_add_single(obj->darr, "\0");
+	DynamicBuffer *obj = mem_alloc(mem_category, sizeof(DynamicBuffer));
+	mem_add_used(mem_category, sizeof(DynamicBuffer));
+	obj->chars = carr_create(mem_category);
+	obj->ref_count = 1;
+	carr_add(obj->chars, NUL);
 	return obj;
 }
 
@@ -19,37 +22,59 @@ void dbuf_destroy(DynamicBuffer *obj)
 {
 	tassert(obj, "dbuf_destroy: obj is NULL");
 
-	darr_destroy(obj->darr);
-	free(obj);
+	// Snapshots let go of their lines on any thread
+	if (__atomic_sub_fetch(&obj->ref_count, 1, __ATOMIC_ACQ_REL) > 0)
+	{
+		return;
+	}
+
+	int mem_category = obj->chars->mem_category;
+	carr_destroy(obj->chars);
+	mem_add_used(mem_category, -(long long)sizeof(DynamicBuffer));
+	mem_free(mem_category, obj, sizeof(DynamicBuffer));
+}
+
+// Shared buffers must not be changed, owners call dbuf_clone before writing to one
+DynamicBuffer *dbuf_share(DynamicBuffer *obj)
+{
+	tassert(obj, "dbuf_share: obj is NULL");
+
+	__atomic_add_fetch(&obj->ref_count, 1, __ATOMIC_RELAXED);
+	return obj;
+}
+
+DynamicBuffer *dbuf_clone(const DynamicBuffer *obj)
+{
+	tassert(obj, "dbuf_clone: obj is NULL");
+
+	DynamicBuffer *clone = dbuf_create(obj->chars->mem_category);
+	dbuf_adds(clone, dbuf_get_size(obj), dbuf_get_with_nulc(obj, 0));
+	return clone;
+}
+
+bool dbuf_is_shared(const DynamicBuffer *obj)
+{
+	return __atomic_load_n(&obj->ref_count, __ATOMIC_ACQUIRE) > 1;
 }
 
 void dbuf_addi(DynamicBuffer *obj, int i)
 {
 	tassert(obj, "dbuf_addi: obj is NULL");
 
-	if (i == 0)
+	// Digits are written backwards into a local buffer and added at once
+	char digits[12];
+	size_t start = sizeof(digits);
+	unsigned int value = i < 0 ? -(unsigned int)i : (unsigned int)i;
+	do
 	{
-		dbuf_addc(obj, '0');
-		return;
-	}
+		digits[--start] = (value % 10) + '0';
+		value /= 10;
+	} while (value > 0);
 	if (i < 0)
 	{
-		dbuf_addc(obj, '-');
-		i = -i;
-	}
-	int prev_size = dbuf_get_size(obj);
-	while (i > 0)
-	{
-		dbuf_addc(obj, (i % 10) + '0');
-		i /= 10;
-	}
-	for (int i = prev_size; i < (dbuf_get_size(obj) + prev_size) / 2; i++)
-	{
-		int j = dbuf_get_size(obj) - 1 - i + prev_size;
-		char tmp = *(char *)darr_getc(obj->darr, i);
-		*(char *)darr_get(obj->darr, i) = *(char *)darr_get(obj->darr, j);
-		*(char *)darr_get(obj->darr, j) = tmp;
+		digits[--start] = '-';
 	}
+	dbuf_adds(obj, sizeof(digits) - start, digits + start);
 }
 
 void dbuf_addc(DynamicBuffer *obj, char c)
@@ -57,17 +82,24 @@ void dbuf_addc(DynamicBuffer *obj, char c)
 	tassert(obj, "dbuf_addc: obj is NULL");
 	tassert(c != NUL, "dbuf_addc: Trying to add NUL character");
 
-	*(char *)darr_get(obj->darr, dbuf_get_size(obj)) = c;
-	darr_add_single(obj->darr, "\0");
+	carr_set(obj->chars, dbuf_get_size(obj), c);
+	carr_add(obj->chars, NUL);
 }
 
 void dbuf_adds(DynamicBuffer *obj, size_t size, const char *s)
 {
 	tassert(obj, "dbuf_adds: obj is NULL");
 
-	darr_pop(obj->darr);
-	darr_add_multiple(obj->darr, size, s);
-	darr_add_single(obj->darr, "\0");
+	if (size == 0)
+	{
+		return;
+	}
+	// The text is added after the NUL and moved over it, which is one add instead of a pop and two adds
+	size_t end = dbuf_get_size(obj);
+	carr_add_multiple(obj->chars, size, s);
+	char *moved = carr_get_ptr(obj->chars, end);
+	memmove(moved, moved + 1, size);
+	moved[size] = NUL;
 }
 
 void dbuf_insertc_to(DynamicBuffer *obj, size_t pos, char c)
@@ -76,7 +108,31 @@ void dbuf_insertc_to(DynamicBuffer *obj, size_t pos, char c)
 	tassert(0 <= pos && pos <= dbuf_get_size(obj), "dbuf_shift_right: not in range");
 	tassert(c != NUL, "dbuf_insert_to: c is NUL");
 
-	darr_insert_to(obj->darr, pos, &c);
+	carr_insert_to(obj->chars, pos, c);
+}
+
+void dbuf_inserts_to(DynamicBuffer *obj, size_t pos, size_t size, const char *s)
+{
+	tassert(obj, "dbuf_inserts_to: obj is NULL");
+	tassert(pos <= dbuf_get_size(obj), "dbuf_inserts_to: pos is out of range");
+
+	carr_insert_multiple(obj->chars, pos, size, s);
+}
+
+void dbuf_removes(DynamicBuffer *obj, size_t pos, size_t count)
+{
+	tassert(obj, "dbuf_removes: obj is NULL");
+	tassert(pos + count <= dbuf_get_size(obj), "dbuf_removes: range is out of range");
+
+	carr_remove_multiple(obj->chars, pos, count);
+}
+
+void dbuf_truncate(DynamicBuffer *obj, size_t size)
+{
+	tassert(obj, "dbuf_truncate: obj is NULL");
+	tassert(size <= dbuf_get_size(obj), "dbuf_truncate: size is bigger than the buffer");
+
+	carr_remove_multiple(obj->chars, size, dbuf_get_size(obj) - size);
 }
 
 void dbuf_shift_right(DynamicBuffer *obj, size_t pos)
@@ -84,7 +140,7 @@ void dbuf_shift_right(DynamicBuffer *obj, size_t pos)
 	tassert(obj, "dbuf_shift_right: obj is NULL");
 	tassert(0 <= pos && pos < dbuf_get_size(obj), "dbuf_shift_right: not in range");
 
-	darr_shift_right(obj->darr, pos);
+	carr_insert_to(obj->chars, pos, carr_get(obj->chars, pos));
 }
 
 void dbuf_shift_left(DynamicBuffer *obj, size_t start_pos)
@@ -92,7 +148,7 @@ void dbuf_shift_left(DynamicBuffer *obj, size_t start_pos)
 	tassert(obj, "dbuf_shift_left: obj is NULL");
 	tassert(0 <= start_pos && start_pos < dbuf_get_size(obj), "dbuf_shift_left: start_pos is out of range");
 	
-	darr_shift_left(obj->darr, start_pos);
+	carr_remove(obj->chars, start_pos);
 }
 
 void dbuf_popc(DynamicBuffer *obj)
@@ -100,8 +156,8 @@ void dbuf_popc(DynamicBuffer *obj)
 	tassert(obj, "dbuf_popc: obj is NULL");
 	tassert(dbuf_get_size(obj) > 0 , "dbuf_popc: buffer is empty");
 	
-	darr_pop(obj->darr);
-	*(char *)darr_get(obj->darr, dbuf_get_size(obj)) = '\0';
+	carr_pop(obj->chars);
+	carr_set(obj->chars, dbuf_get_size(obj), NUL);
 }
 
 void dbuf_popm(DynamicBuffer *obj, size_t count)
@@ -117,7 +173,7 @@ char *dbuf_get(DynamicBuffer *obj, size_t index)
 	tassert(obj, "dbuf_get: obj is NULL");
 	tassert(index < dbuf_get_size(obj), "dbuf_get: index out of range");
 
-	return darr_get(obj->darr, index);
+	return carr_get_ptr(obj->chars, index);
 }
 
 const char *dbuf_getc(const DynamicBuffer *obj, size_t index)
@@ -125,7 +181,7 @@ const char *dbuf_getc(const DynamicBuffer *obj, size_t index)
 	tassert(obj, "dbuf_getc: obj is NULL");
 	tassert(index < dbuf_get_size(obj), "dbuf_getc: index out of range");
 
-	return darr_getc(obj->darr, index);
+	return carr_getc(obj->chars, index);
 }
 
 
@@ -134,7 +190,7 @@ char *dbuf_get_with_nul(DynamicBuffer *obj, size_t index)
 	tassert(obj, "dbuf_getc: obj is NULL");
 	tassert(index < dbuf_get_size(obj) + 1, "dbuf_get_with_nul: index out of range");
 	
-	return darr_get(obj->darr, index);
+	return carr_get_ptr(obj->chars, index);
 }
 
 const char *dbuf_get_with_nulc(const DynamicBuffer *obj, size_t index)
@@ -142,20 +198,20 @@ const char *dbuf_get_with_nulc(const DynamicBuffer *obj, size_t index)
 	tassert(obj, "dbuf_getc: obj is NULL");
 	tassert(index < dbuf_get_size(obj) + 1, "dbuf_get_with_nulc: index out of range");
 
-	return darr_getc(obj->darr, index);
+	return carr_getc(obj->chars, index);
 }
 
 void dbuf_clear(DynamicBuffer *obj)
 {
 	tassert(obj, "dbuf_clear: obj is NULL");
 
-	darr_clear(obj->darr);
-	darr_add_single(obj->darr, "\0");
+	carr_clear(obj->chars);
+	carr_add(obj->chars, NUL);
 }
 
 size_t dbuf_get_size(const DynamicBuffer *obj)
 {
 	tassert(obj, "dbuf_get_size: obj is NULL");
-	tassert(darr_get_size(obj->darr) > 0, "dbuf_get_size: No NUL character in buffer");
-	return darr_get_size(obj->darr) - 1; // Not including the NULL character 
+	tassert(carr_get_size(obj->chars) > 0, "dbuf_get_size: No NUL character in buffer");
+	return carr_get_size(obj->chars) - 1; // Not including the NULL character 
 }
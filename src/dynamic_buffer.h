@@ -1,14 +1,23 @@
 #pragma once
+#include <stdbool.h>
 #include <stdlib.h>
-#include "dynamic_array.h"
+#include "typed_array.h"
+
+DEFINE_TYPED_ARRAY(CharArray, carr, char)
 
 typedef struct
 {
-	DynamicArray *darr;
+	CharArray *chars;       // Always ends with a NUL character that isn't counted in the size
+	unsigned int ref_count; // Handles to this buffer, it's freed when the last one is destroyed. Changed atomically
 } DynamicBuffer;
 
-DynamicBuffer *dbuf_create();
+DEFINE_TYPED_ARRAY(LineArray, larr, DynamicBuffer*)
+
+DynamicBuffer *dbuf_create(int mem_category);
 void dbuf_destroy(DynamicBuffer *obj);
+DynamicBuffer *dbuf_share(DynamicBuffer *obj);
+DynamicBuffer *dbuf_clone(const DynamicBuffer *obj);
+bool dbuf_is_shared(const DynamicBuffer *obj);
 
 void dbuf_addc(DynamicBuffer *obj, char c);
 void dbuf_adds(DynamicBuffer *obj, size_t size, const char *s);
@@ -18,6 +27,9 @@ void dbuf_clear(DynamicBuffer *obj);
 void dbuf_shift_right(DynamicBuffer *obj, size_t pos);
 void dbuf_shift_left(DynamicBuffer *obj, size_t start_pos);
 void dbuf_insertc_to(DynamicBuffer *obj, size_t pos, char c);
+void dbuf_inserts_to(DynamicBuffer *obj, size_t pos, size_t size, const char *s);
+void dbuf_removes(DynamicBuffer *obj, size_t pos, size_t count);
+void dbuf_truncate(DynamicBuffer *obj, size_t size);
 
 void dbuf_popc(DynamicBuffer *obj);
 void dbuf_popm(DynamicBuffer *obj, size_t count);
@@ -1,11 +1,21 @@
 /* Includes */
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <malloc.h>
 #include <stdbool.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "allocator.h"
 #include "definitions.h" 
 #include "error_handling.h"
+#include "hashing.h"
 #include "dynamic_buffer.h"
+#include "line_cache.h"
+#include "sidecar.h"
 #include "terminal.h"
+#include "profiler.h"
 #include "editor.h"
 #include "editor_private.h" /* Global data */
 
@@ -13,326 +23,2698 @@
 /* Function definitions */
 Editor *editor_create(vec2 window_size, IO_Interface _io_interface)
 {
-	Editor *obj = malloc(sizeof(*obj));
-	obj->screen_data.cursor_pos = (vec2){ .x = 0, .y = 0};
-	obj->screen_data.top_file_row = 0;
-	obj->screen_data.window_size = window_size;
-	obj->screen_data.window_size.y--;
-	obj->file_data.darr = darr_create(sizeof(DynamicBuffer*));
+	Editor *obj = mem_alloc(MEM_OTHER, sizeof(*obj));
+	mem_add_used(MEM_OTHER, sizeof(*obj));
+	obj->window_size = window_size;
+	obj->window_size.y--;
+	ScreenData screen_data = {.cursor_pos = {.x = 0, .y = 0}, .selection_mode = SELECTION_NONE, .top_file_row = 0};
+	obj->views = varr_create(MEM_OTHER);
+	varr_add(obj->views, editor_create_view(&screen_data));
+	obj->root_split = editor_create_split(NULL, varr_get(obj->views, 0));
+	obj->separators = separr_create(MEM_RENDER);
+	obj->bar_shown = false;
+	obj->status_size = 0;
+	editor_switch_view(obj, 0);
+	editor_place_views(obj);
+	obj->buffers = barr_create(MEM_OTHER);
+	obj->switch_count = 0;
+	obj->journaling = false;
+	obj->file_watch = NULL;
+	obj->following = false;
+	obj->follow_backlog = false;
+	obj->followed_at = (struct timespec) {0};
+	obj->compressed_buffer = 0;
+	obj->trim_pending = false;
+	obj->quiet_ticks = 0;
+	obj->undo_budget = UNDO_DEFAULT_BUDGET;
+	// An unnamed empty buffer until a file is opened
+	editor_add_buffer(obj, "");
+	obj->current_buffer = 0;
+	editor_load_buffer(obj, barr_get(obj->buffers, 0));
+	obj->file_data = &barr_get(obj->buffers, 0)->file_data;
 	obj->io_interface = _io_interface;
-	obj->print_text_data.col_count = obj->screen_data.window_size.y;
-	obj->print_text_data.data = calloc(obj->print_text_data.col_count, sizeof(PrintRowData));
 	obj->state = EDITOR_WRITE_STATE;
+	obj->overlay = OVERLAY_NONE;
 	obj->search_data.searched_text_index = 0;
 	obj->search_data.match_index = 0;
 	obj->search_data.searched_text[0] = NUL;
-	obj->search_data.matches = darr_create(sizeof(vec2));
+	obj->search_data.matches = parr_create(MEM_SEARCH);
+	obj->search_data.matched_size = 0;
+	obj->search_data.change_count = 0;
+	obj->search_data.line_count = 0;
+	obj->search_data.job = JOB_NONE;
+	obj->jobs = jsched_create();
+	obj->layout_job = JOB_NONE;
+	obj->resized_at = (struct timespec) {0};
+	obj->goto_data.text_index = 0;
+	obj->row_buffer = dbuf_create(MEM_RENDER);
+	obj->clipboard.pieces = larr_create(MEM_LINES);
+	obj->clipboard.whole_lines = false;
+	obj->macro_data.keys = karr_create(MEM_OTHER);
+	obj->macro_data.typed_keys = karr_create(MEM_OTHER);
+	obj->macro_data.recording = false;
+	obj->macro_data.count_index = 0;
 	return obj;
 }
 
 void editor_destroy(Editor *obj)
 {
-	for (size_t i = 0; i < obj->file_data.darr->length; i++)
+	// Jobs may point into the buffers
+	jsched_destroy(obj->jobs);
+	for (size_t i = 0; i < barr_get_size(obj->buffers); i++)
 	{
-		dbuf_destroy(*(DynamicBuffer**)darr_get(obj->file_data.darr, i));
+		Buffer *buffer = barr_get(obj->buffers, i);
+		// Without a clean close the journal stays, the edits that weren't saved can still be recovered
+		if (buffer->loaded && buffer->file_data.journal != NULL)
+		{
+			jrnl_close(buffer->file_data.journal);
+		}
+		editor_close_follow(buffer);
+		if (buffer->loaded)
+		{
+			fdata_destroy(&buffer->file_data);
+		}
+		mem_add_used(MEM_OTHER, -(long long)sizeof(Buffer));
+		mem_free(MEM_OTHER, buffer, sizeof(Buffer));
+	}
+	barr_destroy(obj->buffers);
+	if (obj->file_watch != NULL)
+	{
+		fwatch_destroy(obj->file_watch);
+	}
+	for (size_t i = 0; i < varr_get_size(obj->views); i++)
+	{
+		editor_destroy_view(varr_get(obj->views, i));
 	}
-	darr_destroy(obj->file_data.darr);
-	free(obj->print_text_data.data);
-	free(obj->search_data.matches);
-	free(obj);
+	varr_destroy(obj->views);
+	editor_destroy_split(obj->root_split);
+	separr_destroy(obj->separators);
+	parr_destroy(obj->search_data.matches);
+	dbuf_destroy(obj->row_buffer);
+	editor_clear_clipboard(&obj->clipboard);
+	larr_destroy(obj->clipboard.pieces);
+	karr_destroy(obj->macro_data.keys);
+	karr_destroy(obj->macro_data.typed_keys);
+	mem_add_used(MEM_OTHER, -(long long)sizeof(*obj));
+	mem_free(MEM_OTHER, obj, sizeof(*obj));
 }
 
-void editor_read_file(Editor *obj, const char *filename)
+// Opens the file in a new buffer and shows it. False when the file couldn't be read, the buffer is empty then like the
+// buffer of a new file
+bool editor_read_file(Editor *obj, const char *filename)
 {
 	tassert(filename, "editor_read_file: filename is NULL");
+
+	bool read = editor_open_file(obj, filename);
+	size_t index = barr_get_size(obj->buffers) - 1;
+	read = editor_load_buffer(obj, barr_get(obj->buffers, index)) && read;
+	editor_switch_buffer(obj, index);
+	return read;
+}
+
+// Adds a buffer for the file, which is only read when it's first shown. False when it was read right away and couldn't be
+bool editor_open_file(Editor *obj, const char *filename)
+{
+	tassert(filename, "editor_open_file: filename is NULL");
+
+	// The first file takes the place of the unnamed buffer as long as nothing was typed into it
+	Buffer *first = barr_get(obj->buffers, 0);
+	if (barr_get_size(obj->buffers) == 1 && first->filename[0] == NUL && !first->file_data.modified)
+	{
+		snprintf(first->filename, sizeof(first->filename), "%s", filename);
+		editor_unload_buffer(obj, first);
+		return editor_load_buffer(obj, first);
+	}
+	editor_add_buffer(obj, filename);
+	return true;
+}
+
+// False when the file couldn't be written, it's left as it was then
+bool editor_write_file(Editor *obj, const char *filename)
+{
+	return editor_write_lines(obj->file_data, filename);
+}
+
+// Buffers opened later also journal their edits, from when they are loaded
+size_t editor_enable_journal(Editor *obj)
+{
+	obj->journaling = true;
+	return editor_open_journal(obj, barr_get(obj->buffers, obj->current_buffer));
+}
+
+// Buffers loaded from now on are watched too
+void editor_enable_file_watch(Editor *obj)
+{
+	obj->file_watch = fwatch_create();
+	for (size_t i = 0; i < barr_get_size(obj->buffers); i++)
+	{
+		editor_watch_buffer(obj, barr_get(obj->buffers, i));
+	}
+}
+
+// Files opened from now on are followed as they grow, and read again from their start when they are truncated or replaced
+void editor_enable_follow(Editor *obj)
+{
+	obj->following = true;
+}
+
+// Saves every buffer that was changed, which makes their journals useless
+// False when a file couldn't be written. It's left as it was and its journal is kept, so its edits are recovered when
+// it's opened again. A buffer whose edits conflict with changes made on disk isn't saved over them either, it's saved
+// next to the file
+bool editor_save_all(Editor *obj)
+{
+	bool saved = true;
+	for (size_t i = 0; i < barr_get_size(obj->buffers); i++)
+	{
+		Buffer *buffer = barr_get(obj->buffers, i);
+		if (!buffer->loaded || buffer->filename[0] == NUL)
+		{
+			continue;
+		}
+		if (buffer->file_data.modified && buffer->disk_conflict)
+		{
+			char conflict_path[PATH_MAX + sizeof(CONFLICT_SUFFIX)];
+			snprintf(conflict_path, sizeof(conflict_path), "%s%s", buffer->filename, CONFLICT_SUFFIX);
+			if (editor_write_lines(&buffer->file_data, conflict_path))
+			{
+				editor_close_journal(buffer);
+			}
+			saved = false;
+			continue;
+		}
+		if (buffer->file_data.modified)
+		{
+			if (!editor_write_lines(&buffer->file_data, buffer->filename))
+			{
+				saved = false;
+				continue;
+			}
+			buffer->file_data.modified = false;
+			editor_note_disk_state(buffer);
+			size_t file_size;
+			uint64_t file_hash = hash_file_state(buffer->filename, &file_size);
+			editor_write_line_cache(&buffer->file_data, buffer->filename, file_hash, file_size);
+			// Everything in the file now came from the buffer, the file is a new one under the same name
+			if (buffer->follow_fd != -1)
+			{
+				editor_close_follow(buffer);
+				editor_open_follow(buffer);
+				buffer->follow_offset = buffer->disk_state.st_size;
+				buffer->follow_line_open = false;
+			}
+		}
+		editor_close_journal(buffer);
+	}
+	return saved;
+}
+
+void editor_add_buffer(Editor *obj, const char *filename)
+{
+	Buffer *buffer = mem_alloc(MEM_OTHER, sizeof(Buffer));
+	mem_add_used(MEM_OTHER, sizeof(Buffer));
+	snprintf(buffer->filename, sizeof(buffer->filename), "%s", filename);
+	buffer->loaded = false;
+	buffer->cursor_pos = (vec2) {.x = 0, .y = 0};
+	buffer->top_file_row = 0;
+	buffer->last_shown = 0;
+	buffer->watch = -1;
+	buffer->changed_on_disk = false;
+	buffer->disk_conflict = false;
+	buffer->follow_fd = -1;
+	buffer->follow_offset = 0;
+	buffer->follow_line_open = false;
+	barr_add(obj->buffers, buffer);
+}
+
+// False when the file couldn't be read, the buffer is loaded empty then
+bool editor_load_buffer(Editor *obj, Buffer *buffer)
+{
+	if (buffer->loaded)
+	{
+		return true;
+	}
+	bool read = true;
+	fdata_init(&buffer->file_data, obj->screen_data->window_size.x);
+	ulog_set_budget(buffer->file_data.undo_log, obj->undo_budget);
+	if (buffer->filename[0] == NUL)
+	{
+		fdata_add_line(&buffer->file_data, dbuf_create(MEM_LINES));
+	}
+	else if (obj->following)
+	{
+		// The empty line is where the file's first line is taken in
+		fdata_add_line(&buffer->file_data, dbuf_create(MEM_LINES));
+		editor_open_follow(buffer);
+		while (editor_read_appended(buffer, FOLLOW_BATCH_SIZE));
+	}
+	else
+	{
+		// Taken before reading, so a change made while the file is read is seen as a change
+		editor_note_disk_state(buffer);
+		size_t file_size;
+		uint64_t file_hash = hash_file_state(buffer->filename, &file_size);
+		if (!editor_read_cached_lines(&buffer->file_data, buffer->filename, file_hash, file_size))
+		{
+			read = editor_read_lines(&buffer->file_data, buffer->filename);
+			editor_write_line_cache(&buffer->file_data, buffer->filename, file_hash, file_size);
+		}
+	}
+	buffer->loaded = true;
+	editor_watch_buffer(obj, buffer);
+	editor_sync_layouts(obj, &buffer->file_data);
+	if (obj->journaling)
+	{
+		editor_open_journal(obj, buffer);
+	}
+	return read;
+}
+
+void editor_unload_buffer(Editor *obj, Buffer *buffer)
+{
+	if (!buffer->loaded)
+	{
+		return;
+	}
+	tassert(!buffer->file_data.modified, "editor_unload_buffer: the changes would be lost");
+
+	editor_close_journal(buffer);
+	editor_unwatch_buffer(obj, buffer);
+	editor_close_follow(buffer);
+	fdata_destroy(&buffer->file_data);
+	buffer->loaded = false;
+}
+
+void editor_switch_buffer(Editor *obj, size_t index)
+{
+	ScreenData *screen_data = obj->screen_data;
+	Buffer *previous = barr_get(obj->buffers, obj->current_buffer);
+	previous->cursor_pos = screen_data->cursor_pos;
+	previous->top_file_row = screen_data->top_file_row;
+	editor_clear_extra_cursors(screen_data);
+	editor_clear_selection(screen_data);
+	// Matches are positions in the buffer they were searched in
+	jsched_cancel(obj->jobs, obj->search_data.job);
+	parr_clear(obj->search_data.matches);
+	obj->search_data.matched_size = 0;
+
+	Buffer *buffer = barr_get(obj->buffers, index);
+	editor_load_buffer(obj, buffer);
+	obj->current_buffer = index;
+	obj->file_data = &buffer->file_data;
+	buffer->last_shown = ++obj->switch_count;
+	// A buffer that stayed loaded may be laid out for views that were closed since
+	editor_sync_layouts(obj, obj->file_data);
+	// Every view shows the buffer from where it was left, the file may have changed on disk since it was dropped
+	size_t line_count = fdata_get_line_count(obj->file_data);
+	for (size_t i = 0; i < varr_get_size(obj->views); i++)
+	{
+		View *view = varr_get(obj->views, i);
+		editor_clear_extra_cursors(&view->screen_data);
+		editor_clear_selection(&view->screen_data);
+		view->screen_data.cursor_pos = buffer->cursor_pos;
+		editor_clamp_cursor(&view->screen_data, obj->file_data);
+		view->screen_data.top_file_row = buffer->top_file_row < line_count ? buffer->top_file_row : 0;
+		view->redraw = true;
+	}
+	editor_reclaim_buffers(obj);
+}
+
+// Unmodified buffers that weren't shown for the longest time are dropped, they can be read again from their files
+void editor_reclaim_buffers(Editor *obj)
+{
+	size_t loaded_count = 0;
+	for (size_t i = 0; i < barr_get_size(obj->buffers); i++)
+	{
+		loaded_count += barr_get(obj->buffers, i)->loaded;
+	}
+	while (loaded_count > MX_LOADED_BUFFERS)
+	{
+		Buffer *oldest = NULL;
+		for (size_t i = 0; i < barr_get_size(obj->buffers); i++)
+		{
+			Buffer *buffer = barr_get(obj->buffers, i);
+			bool reclaimable = buffer->loaded && !buffer->file_data.modified && i != obj->current_buffer;
+			if (reclaimable && (oldest == NULL || buffer->last_shown < oldest->last_shown))
+			{
+				oldest = buffer;
+			}
+		}
+		if (oldest == NULL)
+		{
+			return;
+		}
+		editor_unload_buffer(obj, oldest);
+		loaded_count--;
+	}
+}
+
+// False when the file couldn't be opened or read to its end, the lines read so far are kept
+bool editor_read_lines(FileData *file_data, const char *filename)
+{
 	// Opening file
 	FILE *fp = fopen(filename, "r");
 	if (fp == NULL)
 	{
-		DynamicBuffer *dbuf = dbuf_create();
-		darr_add_single(obj->file_data.darr, &dbuf);
-		return;
+		fdata_add_line(file_data, dbuf_create(MEM_LINES));
+		return false;
 	}
 	// Reading line by line and 
 	char *line = NULL;
 	size_t len;
 	while (getline(&line, &len, fp) != EOF)
 	{
-		DynamicBuffer *dbuf = dbuf_create();
+		DynamicBuffer *dbuf = dbuf_create(MEM_LINES);
 		size_t line_size = strlen(line);
 		if (line[line_size-1] == '\n')
 		{
 			line_size--;
 		}
 		dbuf_adds(dbuf, line_size, line);
-		darr_add_single(obj->file_data.darr, &dbuf);
+		fdata_add_line(file_data, dbuf);
 	}
 	free(line);
+	// An empty file still has a line to put the cursor on
+	if (fdata_get_line_count(file_data) == 0)
+	{
+		fdata_add_line(file_data, dbuf_create(MEM_LINES));
+	}
 	// Closing file
+	bool read = !ferror(fp);
 	fclose(fp);
+	return read;
+}
+
+// Takes the lines of a big file where the line cache says they are, instead of splitting the file into lines. The file
+// is read into memory of its own in one go, lines in a mapping of it would change or fault when another process
+// changes or truncates the file before they are adopted. They are adopted on idle ticks
+bool editor_read_cached_lines(FileData *file_data, const char *filename, uint64_t file_hash, size_t file_size)
+{
+	if (file_size < LINE_CACHE_MIN_SIZE)
+	{
+		return false;
+	}
+	char path[PATH_MAX];
+	lcache_get_path(filename, path, sizeof(path));
+	LineCache cache;
+	if (!lcache_load(&cache, path, file_hash, file_size))
+	{
+		return false;
+	}
+	// The file may have changed since it was hashed, its lines are only taken when all of the cached size is read
+	char *text = mem_alloc(MEM_COLD, file_size);
+	size_t read_size = 0;
+	int fd = open(filename, O_RDONLY | O_CLOEXEC);
+	while (fd != -1 && read_size < file_size)
+	{
+		ssize_t size = read(fd, text + read_size, file_size - read_size);
+		if (size == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (size <= 0)
+		{
+			break;
+		}
+		read_size += size;
+	}
+	if (fd != -1)
+	{
+		close(fd);
+	}
+	bool taken = read_size == file_size && fdata_map_lines(file_data, text, file_size, cache.line_count, cache.line_sizes, cache.line_words);
+	if (!taken)
+	{
+		mem_free(MEM_COLD, text, file_size);
+	}
+	lcache_unload(&cache);
+	return taken;
+}
+
+// Only big files get a cache. The file is hashed before it's read, so a file that changes while it's read doesn't match
+// its cache
+void editor_write_line_cache(const FileData *file_data, const char *filename, uint64_t file_hash, size_t file_size)
+{
+	if (file_size < LINE_CACHE_MIN_SIZE)
+	{
+		return;
+	}
+	char path[PATH_MAX];
+	lcache_get_path(filename, path, sizeof(path));
+	lcache_write(path, file_hash, file_size, file_data);
+}
+
+// The lines go to a file next to filename, which is renamed over it once it's on the disk. A crash while saving leaves
+// either the old file, which the journal still applies to, or the new one. False when it couldn't be written, the file
+// is left as it was then
+bool editor_write_lines(const FileData *file_data, const char *filename)
+{
+	char temp_path[PATH_MAX];
+	sidecar_get_path(filename, ".tmp", temp_path, sizeof(temp_path));
+	FILE *fp = fopen(temp_path, "w");
+	if (fp == NULL)
+	{
+		return false;
+	}
+	// The file keeps its permissions
+	struct stat state;
+	if (stat(filename, &state) == 0)
+	{
+		fchmod(fileno(fp), state.st_mode & 07777);
+	}
+	for (size_t i = 0; i < fdata_get_line_count(file_data); i++)
+	{
+		// Lines may be shared with the clipboard, so they are only read here
+		size_t size;
+		const char *text = fdata_get_line_text(file_data, i, &size);
+		fwrite(text, 1, size, fp);
+		fputc('\n', fp);
+	}
+	bool written = fflush(fp) == 0 && !ferror(fp) && fsync(fileno(fp)) == 0;
+	written = fclose(fp) == 0 && written;
+	if (!written || rename(temp_path, filename) == -1)
+	{
+		unlink(temp_path);
+		return false;
+	}
+	return true;
+}
+
+// Replays the journal a crashed session left for the file, then journals the edits of this one
+size_t editor_open_journal(Editor *obj, Buffer *buffer)
+{
+	// Lines taken in from a followed file aren't journaled, so its journal couldn't be replayed
+	if (!buffer->loaded || buffer->filename[0] == NUL || buffer->file_data.journal != NULL || obj->following)
+	{
+		return 0;
+	}
+	jrnl_get_path(buffer->filename, buffer->journal_path, sizeof(buffer->journal_path));
+	size_t file_size;
+	uint64_t file_hash = hash_file_state(buffer->filename, &file_size);
+	size_t recovered = 0;
+	JournalReader reader;
+	if (jrnl_load(&reader, buffer->journal_path, file_hash, file_size))
+	{
+		recovered = fdata_replay_journal(&buffer->file_data, &reader);
+		jrnl_unload(&reader);
+	}
+	// The journal is started over for the file as it was written. One that can't be written keeps its journal
+	if (recovered > 0)
+	{
+		if (!editor_write_lines(&buffer->file_data, buffer->filename))
+		{
+			return recovered;
+		}
+		buffer->file_data.modified = false;
+		editor_note_disk_state(buffer);
+		file_hash = hash_file_state(buffer->filename, &file_size);
+	}
+	buffer->file_data.journal = jrnl_open(buffer->journal_path, file_hash, file_size);
+	return recovered;
+}
+
+void editor_close_journal(Buffer *buffer)
+{
+	if (buffer->file_data.journal == NULL)
+	{
+		return;
+	}
+	jrnl_close(buffer->file_data.journal);
+	buffer->file_data.journal = NULL;
+	unlink(buffer->journal_path);
+}
+
+// Buffers are only watched while they are loaded, a buffer that's loaded again is read from the file anyway.
+// Followed files take in their changes themselves
+void editor_watch_buffer(Editor *obj, Buffer *buffer)
+{
+	if (obj->file_watch == NULL || !buffer->loaded || buffer->filename[0] == NUL || obj->following)
+	{
+		return;
+	}
+	buffer->watch = fwatch_add(obj->file_watch, buffer->filename);
+	buffer->changed_on_disk = false;
+	fdata_keep_base(&buffer->file_data);
+}
+
+void editor_unwatch_buffer(Editor *obj, Buffer *buffer)
+{
+	if (buffer->watch == -1)
+	{
+		return;
+	}
+	// Buffers of the same file share its watch
+	bool shared = false;
+	for (size_t i = 0; i < barr_get_size(obj->buffers) && !shared; i++)
+	{
+		Buffer *other = barr_get(obj->buffers, i);
+		shared = other != buffer && other->loaded && other->watch == buffer->watch;
+	}
+	if (!shared)
+	{
+		fwatch_remove(obj->file_watch, buffer->watch);
+	}
+	buffer->watch = -1;
+}
+
+void editor_note_disk_state(Buffer *buffer)
+{
+	if (stat(buffer->filename, &buffer->disk_state) == -1)
+	{
+		memset(&buffer->disk_state, 0, sizeof(buffer->disk_state));
+	}
+}
+
+bool editor_is_same_disk_state(const struct stat *a, const struct stat *b)
+{
+	return a->st_ino == b->st_ino && a->st_size == b->st_size
+		&& a->st_mtim.tv_sec == b->st_mtim.tv_sec && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+void editor_check_file_changes(Editor *obj)
+{
+	int watch;
+	while (fwatch_next_change(obj->file_watch, &watch))
+	{
+		for (size_t i = 0; i < barr_get_size(obj->buffers); i++)
+		{
+			Buffer *buffer = barr_get(obj->buffers, i);
+			buffer->changed_on_disk |= buffer->loaded && buffer->watch == watch;
+		}
+	}
+	for (size_t i = 0; i < barr_get_size(obj->buffers); i++)
+	{
+		Buffer *buffer = barr_get(obj->buffers, i);
+		if (!buffer->changed_on_disk)
+		{
+			continue;
+		}
+		// A file that was replaced by a rename is a new file to watch
+		editor_unwatch_buffer(obj, buffer);
+		editor_watch_buffer(obj, buffer);
+		editor_reload_buffer(obj, buffer);
+	}
+}
+
+// Only the lines that changed on disk are replaced. A buffer with changes of its own keeps them, the changes on disk
+// that overlap them are a conflict
+void editor_reload_buffer(Editor *obj, Buffer *buffer)
+{
+	struct stat disk_state;
+	if (stat(buffer->filename, &disk_state) == -1 || editor_is_same_disk_state(&buffer->disk_state, &disk_state))
+	{
+		return;
+	}
+	int fd = open(buffer->filename, O_RDONLY);
+	if (fd == -1)
+	{
+		return;
+	}
+	fstat(fd, &disk_state);
+	CharArray *text = carr_create(MEM_OTHER);
+	carr_reserve(text, disk_state.st_size + 1);
+	char buf[1 << 16];
+	ssize_t read_size;
+	while ((read_size = read(fd, buf, sizeof(buf))) > 0)
+	{
+		carr_add_multiple(text, read_size, buf);
+	}
+	close(fd);
+	// The journal belongs to the old file, a new one is started from the new file
+	editor_close_journal(buffer);
+	FileData *file_data = &buffer->file_data;
+	HunkArray *hunks = harr_create(MEM_OTHER);
+	HunkArray *own_hunks = harr_create(MEM_OTHER);
+	if (file_data->modified)
+	{
+		buffer->disk_conflict |= fdata_merge_lines(file_data, carr_get_size(text), carr_get_ptr(text, 0), hunks, own_hunks) > 0;
+		// Edits that were made on disk too leave nothing to save
+		file_data->modified = harr_get_size(own_hunks) > 0;
+		buffer->disk_conflict &= file_data->modified;
+	}
+	else
+	{
+		fdata_patch_lines(file_data, carr_get_size(text), carr_get_ptr(text, 0), hunks);
+		file_data->modified = false;
+	}
+	carr_destroy(text);
+	buffer->disk_state = disk_state;
+	if (obj->journaling)
+	{
+		editor_open_journal(obj, buffer);
+		fdata_journal_hunks(file_data, own_hunks);
+	}
+	editor_follow_hunks(obj, buffer, hunks);
+	harr_destroy(hunks);
+	harr_destroy(own_hunks);
+}
+
+// Positions stay on the lines they were on, the ones on replaced lines go to the lines that replaced them
+void editor_follow_hunks(Editor *obj, Buffer *buffer, const HunkArray *hunks)
+{
+	if (harr_get_size(hunks) == 0)
+	{
+		return;
+	}
+	if (buffer != barr_get(obj->buffers, obj->current_buffer))
+	{
+		// Clamped when the buffer is shown again
+		buffer->cursor_pos.y = fdata_map_row(hunks, buffer->cursor_pos.y);
+		buffer->top_file_row = fdata_map_row(hunks, buffer->top_file_row);
+		return;
+	}
+	size_t line_count = fdata_get_line_count(obj->file_data);
+	for (size_t i = 0; i < varr_get_size(obj->views); i++)
+	{
+		View *view = varr_get(obj->views, i);
+		ScreenData *sd = &view->screen_data;
+		editor_clear_extra_cursors(sd);
+		editor_clear_selection(sd);
+		sd->cursor_pos.y = fdata_map_row(hunks, sd->cursor_pos.y);
+		editor_clamp_cursor(sd, obj->file_data);
+		size_t top_file_row = fdata_map_row(hunks, sd->top_file_row);
+		sd->top_file_row = top_file_row < line_count ? top_file_row : line_count - 1;
+		view->redraw = true;
+	}
+	// Matches on replaced lines are gone, the others move with their lines
+	PositionArray *matches = obj->search_data.matches;
+	size_t kept = 0;
+	for (size_t i = 0; i < parr_get_size(matches); i++)
+	{
+		vec2 match = parr_get(matches, i);
+		size_t row = fdata_map_row(hunks, match.y);
+		bool replaced = false;
+		for (size_t j = 0; j < harr_get_size(hunks) && !replaced; j++)
+		{
+			const LineHunk *hunk = harr_getc(hunks, j);
+			replaced = is_in_range(hunk->row, match.y, hunk->row + hunk->old_count);
+		}
+		if (!replaced)
+		{
+			parr_set(matches, kept++, (vec2) {.x = match.x, .y = row});
+		}
+	}
+	parr_remove_multiple(matches, kept, parr_get_size(matches) - kept);
+	if (obj->search_data.match_index >= kept)
+	{
+		obj->search_data.match_index = 0;
+	}
+	obj->search_data.change_count = obj->file_data->change_count;
+	obj->search_data.line_count = line_count;
+}
+
+// A file that can't be opened yet is followed once it's created
+void editor_open_follow(Buffer *buffer)
+{
+	buffer->follow_fd = open(buffer->filename, O_RDONLY | O_CLOEXEC);
+	buffer->follow_offset = 0;
+	buffer->follow_line_open = true;
+}
+
+void editor_close_follow(Buffer *buffer)
+{
+	if (buffer->follow_fd != -1)
+	{
+		close(buffer->follow_fd);
+		buffer->follow_fd = -1;
+	}
+}
+
+// One loaded buffer a tick has some of its lines that are far from every view and cursor compressed
+void editor_compress_cold_lines(Editor *obj)
+{
+	obj->compressed_buffer = (obj->compressed_buffer + 1) % barr_get_size(obj->buffers);
+	Buffer *buffer = barr_get(obj->buffers, obj->compressed_buffer);
+	bool compressed = false;
+	if (buffer->loaded)
+	{
+		// Every view shows the current buffer, the others only have where they were left
+		size_t view_count = obj->compressed_buffer == obj->current_buffer ? varr_get_size(obj->views) : 0;
+		size_t keep_count = 2 + 2 * view_count;
+		size_t *keep_rows = mem_alloc(MEM_OTHER, keep_count * sizeof(size_t));
+		keep_rows[0] = buffer->top_file_row;
+		keep_rows[1] = buffer->cursor_pos.y;
+		for (size_t i = 0; i < view_count; i++)
+		{
+			const ScreenData *screen_data = &varr_get(obj->views, i)->screen_data;
+			keep_rows[2 + 2 * i] = screen_data->top_file_row;
+			keep_rows[3 + 2 * i] = screen_data->cursor_pos.y;
+		}
+		compressed = fdata_compress_cold_lines(&buffer->file_data, keep_count, keep_rows, COLD_COMPRESS_LINES);
+		mem_free(MEM_OTHER, keep_rows, keep_count * sizeof(size_t));
+	}
+	// The lines that were freed are given back to the system once no buffer has anything left to compress
+	if (compressed)
+	{
+		obj->trim_pending = true;
+		obj->quiet_ticks = 0;
+	}
+	else if (obj->trim_pending && ++obj->quiet_ticks >= barr_get_size(obj->buffers))
+	{
+		malloc_trim(0);
+		obj->trim_pending = false;
+	}
+}
+
+// Polled on every tick, but the lines are taken in batches, so the screen is redrawn at most once per batch
+void editor_follow_files(Editor *obj)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	long long elapsed = (now.tv_sec - obj->followed_at.tv_sec) * 1000000000LL + (now.tv_nsec - obj->followed_at.tv_nsec);
+	if (elapsed < FOLLOW_INTERVAL_NS && !obj->follow_backlog)
+	{
+		return;
+	}
+	obj->followed_at = now;
+	obj->follow_backlog = false;
+	for (size_t i = 0; i < barr_get_size(obj->buffers); i++)
+	{
+		Buffer *buffer = barr_get(obj->buffers, i);
+		if (buffer->loaded && buffer->filename[0] != NUL)
+		{
+			obj->follow_backlog |= editor_follow_buffer(obj, buffer);
+		}
+	}
+}
+
+// Returns whether there's more to take in than one batch
+bool editor_follow_buffer(Editor *obj, Buffer *buffer)
+{
+	if (buffer->follow_fd == -1)
+	{
+		editor_open_follow(buffer);
+		if (buffer->follow_fd == -1)
+		{
+			return false;
+		}
+	}
+	// A rotated log is a new file under the same name, a truncated one starts over in the same file
+	struct stat fd_state, path_state;
+	fstat(buffer->follow_fd, &fd_state);
+	bool replaced = stat(buffer->filename, &path_state) == 0 && (path_state.st_ino != fd_state.st_ino || path_state.st_dev != fd_state.st_dev);
+	if (replaced || fd_state.st_size < buffer->follow_offset)
+	{
+		editor_restart_follow(obj, buffer);
+		return false;
+	}
+	size_t last_row = fdata_get_line_count(&buffer->file_data) - 1;
+	bool more = editor_read_appended(buffer, FOLLOW_BATCH_SIZE);
+	editor_scroll_to_appended(obj, buffer, last_row);
+	return more;
+}
+
+// Takes in at most max_size bytes, returns whether there's more
+bool editor_read_appended(Buffer *buffer, size_t max_size)
+{
+	struct stat state;
+	if (buffer->follow_fd == -1 || fstat(buffer->follow_fd, &state) == -1 || state.st_size <= buffer->follow_offset)
+	{
+		return false;
+	}
+	size_t size = state.st_size - buffer->follow_offset;
+	size = size < max_size ? size : max_size;
+	char *text = mem_alloc(MEM_OTHER, size);
+	ssize_t read_size = pread(buffer->follow_fd, text, size, buffer->follow_offset);
+	if (read_size > 0)
+	{
+		fdata_append_lines(&buffer->file_data, read_size, text, &buffer->follow_line_open);
+		buffer->follow_offset += read_size;
+	}
+	mem_free(MEM_OTHER, text, size);
+	return read_size > 0 && buffer->follow_offset < state.st_size;
+}
+
+// The buffer is read again like a buffer that was dropped, edits made to it go with the old file
+void editor_restart_follow(Editor *obj, Buffer *buffer)
+{
+	size_t last_row = fdata_get_line_count(&buffer->file_data) - 1;
+	// A search of the old lines can't go on
+	if (buffer == barr_get(obj->buffers, obj->current_buffer))
+	{
+		jsched_cancel(obj->jobs, obj->search_data.job);
+	}
+	editor_close_follow(buffer);
+	fdata_destroy(&buffer->file_data);
+	buffer->loaded = false;
+	editor_load_buffer(obj, buffer);
+	if (buffer == barr_get(obj->buffers, obj->current_buffer))
+	{
+		parr_clear(obj->search_data.matches);
+		obj->search_data.matched_size = 0;
+		obj->search_data.match_index = 0;
+		size_t line_count = fdata_get_line_count(obj->file_data);
+		for (size_t i = 0; i < varr_get_size(obj->views); i++)
+		{
+			View *view = varr_get(obj->views, i);
+			ScreenData *sd = &view->screen_data;
+			editor_clear_extra_cursors(sd);
+			editor_clear_selection(sd);
+			editor_clamp_cursor(sd, obj->file_data);
+			sd->top_file_row = sd->top_file_row < line_count ? sd->top_file_row : line_count - 1;
+			view->redraw = true;
+		}
+	}
+	editor_scroll_to_appended(obj, buffer, last_row);
+}
+
+// Cursors that were on the last line go to the new last line, the others stay where they were reading
+void editor_scroll_to_appended(Editor *obj, Buffer *buffer, size_t last_row)
+{
+	size_t new_last_row = fdata_get_line_count(&buffer->file_data) - 1;
+	if (new_last_row == last_row)
+	{
+		return;
+	}
+	if (buffer != barr_get(obj->buffers, obj->current_buffer))
+	{
+		if ((size_t)buffer->cursor_pos.y == last_row)
+		{
+			buffer->cursor_pos = (vec2) {.x = 0, .y = new_last_row};
+		}
+		return;
+	}
+	for (size_t i = 0; i < varr_get_size(obj->views); i++)
+	{
+		View *view = varr_get(obj->views, i);
+		ScreenData *sd = &view->screen_data;
+		if ((size_t)sd->cursor_pos.y != last_row || parr_get_size(sd->extra_cursors) > 0 || sd->selection_mode != SELECTION_NONE)
+		{
+			continue;
+		}
+		sd->cursor_pos = (vec2) {.x = 0, .y = new_last_row};
+		// Views other than the current one are only laid out again when they are told to
+		view->redraw = true;
+	}
+}
+
+View *editor_create_view(const ScreenData *screen_data)
+{
+	View *view = mem_alloc(MEM_OTHER, sizeof(View));
+	mem_add_used(MEM_OTHER, sizeof(View));
+	view->screen_data = *screen_data;
+	view->screen_data.extra_cursors = parr_create(MEM_OTHER);
+	view->screen_data.selection_mode = SELECTION_NONE;
+	view->screen_data.window_size = (vec2) {.x = 0, .y = 0};
+	view->print_text_data.col_count = 0;
+	view->print_text_data.data = NULL;
+	view->shown_rows = NULL;
+	view->origin = (vec2) {.x = 0, .y = 0};
+	view->redraw = true;
+	return view;
+}
+
+void editor_destroy_view(View *view)
+{
+	size_t row_count = view->print_text_data.col_count;
+	if (row_count > 0)
+	{
+		mem_add_used(MEM_RENDER, -(long long)(row_count * (sizeof(PrintRowData) + sizeof(ShownRow))));
+		mem_free(MEM_RENDER, view->print_text_data.data, row_count * sizeof(PrintRowData));
+		mem_free(MEM_RENDER, view->shown_rows, row_count * sizeof(ShownRow));
+	}
+	parr_destroy(view->screen_data.extra_cursors);
+	mem_add_used(MEM_OTHER, -(long long)sizeof(View));
+	mem_free(MEM_OTHER, view, sizeof(View));
+}
+
+void editor_place_views(Editor *obj)
+{
+	separr_clear(obj->separators);
+	obj->redraw = true;
+	editor_place_split(obj, obj->root_split, (vec2) {.x = 0, .y = 0}, obj->window_size);
+}
+
+// The first half gets the smaller part when the size is odd, the separator takes a row or a column
+void editor_place_split(Editor *obj, Split *split, vec2 origin, vec2 size)
+{
+	if (split->view != NULL)
+	{
+		editor_place_view(split->view, origin, size);
+		return;
+	}
+	vec2 first_size = size;
+	vec2 second_origin = origin;
+	vec2 second_size = size;
+	Separator separator = {.origin = origin, .vertical = split->vertical};
+	if (split->vertical)
+	{
+		first_size.x = (size.x - 1) / 2;
+		separator.origin.x += first_size.x;
+		separator.length = size.y;
+		second_origin.x += first_size.x + 1;
+		second_size.x = size.x - first_size.x - 1;
+	}
+	else
+	{
+		first_size.y = (size.y - 1) / 2;
+		separator.origin.y += first_size.y;
+		separator.length = size.x;
+		second_origin.y += first_size.y + 1;
+		second_size.y = size.y - first_size.y - 1;
+	}
+	separr_add(obj->separators, separator);
+	editor_place_split(obj, split->first, origin, first_size);
+	editor_place_split(obj, split->second, second_origin, second_size);
+}
+
+void editor_place_view(View *view, vec2 origin, vec2 size)
+{
+	size_t row_count = view->print_text_data.col_count;
+	if (row_count != (size_t)size.y)
+	{
+		if (row_count > 0)
+		{
+			mem_add_used(MEM_RENDER, -(long long)(row_count * (sizeof(PrintRowData) + sizeof(ShownRow))));
+			mem_free(MEM_RENDER, view->print_text_data.data, row_count * sizeof(PrintRowData));
+			mem_free(MEM_RENDER, view->shown_rows, row_count * sizeof(ShownRow));
+		}
+		row_count = size.y;
+		view->print_text_data.col_count = row_count;
+		view->print_text_data.data = mem_calloc(MEM_RENDER, row_count, sizeof(PrintRowData));
+		view->shown_rows = mem_calloc(MEM_RENDER, row_count, sizeof(ShownRow));
+		mem_add_used(MEM_RENDER, row_count * (sizeof(PrintRowData) + sizeof(ShownRow)));
+	}
+	view->origin = origin;
+	view->screen_data.window_size = size;
+	view->redraw = true;
+}
+
+Split *editor_create_split(Split *parent, View *view)
+{
+	Split *split = mem_alloc(MEM_OTHER, sizeof(Split));
+	mem_add_used(MEM_OTHER, sizeof(Split));
+	split->parent = parent;
+	split->first = NULL;
+	split->second = NULL;
+	split->vertical = false;
+	split->view = view;
+	return split;
+}
+
+// The views are owned by the editor, only the splits are destroyed
+void editor_destroy_split(Split *split)
+{
+	if (split->first != NULL)
+	{
+		editor_destroy_split(split->first);
+		editor_destroy_split(split->second);
+	}
+	mem_add_used(MEM_OTHER, -(long long)sizeof(Split));
+	mem_free(MEM_OTHER, split, sizeof(Split));
+}
+
+Split *editor_find_split(Split *split, const View *view)
+{
+	if (split->first == NULL)
+	{
+		return split->view == view ? split : NULL;
+	}
+	Split *found = editor_find_split(split->first, view);
+	return found != NULL ? found : editor_find_split(split->second, view);
+}
+
+bool editor_process_view_key(Editor *obj, int c)
+{
+	switch (c)
+	{
+		case SPLIT_HORIZONTAL_KEY:
+			editor_split_view(obj, false);
+			return true;
+		case SPLIT_VERTICAL_KEY:
+			editor_split_view(obj, true);
+			return true;
+		case NEXT_VIEW_KEY:
+			editor_switch_view(obj, (obj->current_view + 1) % varr_get_size(obj->views));
+			return true;
+		case CLOSE_VIEW_KEY:
+			editor_close_view(obj);
+			return true;
+	}
+	return false;
+}
+
+// The new view starts where the current one is and comes after it, the current view stays current
+bool editor_split_view(Editor *obj, bool vertical)
+{
+	View *view = varr_get(obj->views, obj->current_view);
+	vec2 size = view->screen_data.window_size;
+	// Both halves need at least a row or a column next to the separator
+	if ((vertical ? size.x : size.y) < 3)
+	{
+		return false;
+	}
+	View *copy = editor_create_view(&view->screen_data);
+	Split *split = editor_find_split(obj->root_split, view);
+	split->first = editor_create_split(split, view);
+	split->second = editor_create_split(split, copy);
+	split->vertical = vertical;
+	split->view = NULL;
+	varr_insert_to(obj->views, obj->current_view + 1, copy);
+	editor_place_views(obj);
+	editor_sync_layouts(obj, obj->file_data);
+	return true;
+}
+
+// The other half of the split takes the place of the closed view, the last view can't be closed
+void editor_close_view(Editor *obj)
+{
+	if (varr_get_size(obj->views) == 1)
+	{
+		return;
+	}
+	View *view = varr_get(obj->views, obj->current_view);
+	Split *split = editor_find_split(obj->root_split, view);
+	Split *parent = split->parent;
+	Split *sibling = parent->first == split ? parent->second : parent->first;
+	parent->first = sibling->first;
+	parent->second = sibling->second;
+	parent->vertical = sibling->vertical;
+	parent->view = sibling->view;
+	if (parent->first != NULL)
+	{
+		parent->first->parent = parent;
+		parent->second->parent = parent;
+	}
+	sibling->first = NULL;
+	sibling->second = NULL;
+	editor_destroy_split(sibling);
+	editor_destroy_split(split);
+	editor_destroy_view(view);
+	varr_remove(obj->views, obj->current_view);
+	// The first view of the half that grew becomes current
+	Split *next = parent;
+	while (next->view == NULL)
+	{
+		next = next->first;
+	}
+	for (size_t i = 0; i < varr_get_size(obj->views); i++)
+	{
+		if (varr_get(obj->views, i) == next->view)
+		{
+			editor_switch_view(obj, i);
+		}
+	}
+	editor_place_views(obj);
+	editor_sync_layouts(obj, obj->file_data);
+}
+
+void editor_switch_view(Editor *obj, size_t index)
+{
+	View *view = varr_get(obj->views, index);
+	obj->current_view = index;
+	obj->screen_data = &view->screen_data;
+	obj->print_text_data = &view->print_text_data;
+}
+
+// Views of the same width share the wrapped layout of the lines
+void editor_sync_layouts(const Editor *obj, FileData *file_data)
+{
+	size_t view_count = varr_get_size(obj->views);
+	size_t widths[view_count];
+	for (size_t i = 0; i < view_count; i++)
+	{
+		widths[i] = varr_get(obj->views, i)->screen_data.window_size.x;
+	}
+	fdata_set_layout_widths(file_data, view_count, widths);
+}
+
+// The views keep their share of the screen. Only the lines around what they show are laid out
+// at their new widths right away, the others once the size settled
+void editor_resize(Editor *obj, vec2 window_size)
+{
+	vec2 min_size = editor_get_min_split_size(obj->root_split);
+	obj->window_size.x = window_size.x > min_size.x ? window_size.x : min_size.x;
+	obj->window_size.y = window_size.y - 1 > min_size.y ? window_size.y - 1 : min_size.y;
+	jsched_cancel(obj->jobs, obj->layout_job);
+	clock_gettime(CLOCK_MONOTONIC, &obj->resized_at);
+	editor_place_views(obj);
+	editor_sync_layouts(obj, obj->file_data);
+	obj->io_interface.clear_screen();
+}
+
+// Every view needs a row and a column, the halves of a split are as big as each other or one bigger
+vec2 editor_get_min_split_size(const Split *split)
+{
+	if (split->view != NULL)
+	{
+		return (vec2) {.x = 1, .y = 1};
+	}
+	vec2 first = editor_get_min_split_size(split->first);
+	vec2 second = editor_get_min_split_size(split->second);
+	vec2 size = {.x = first.x > second.x ? first.x : second.x, .y = first.y > second.y ? first.y : second.y};
+	if (split->vertical)
+	{
+		size.x = 2 * size.x + 1;
+	}
+	else
+	{
+		size.y = 2 * size.y + 1;
+	}
+	return size;
+}
+
+// The rows between the top line and the cursor decide where the view starts and a page move
+// goes a page away from the cursor, the rows between exact lines are exact whatever is before them
+void editor_lay_out_view_lines(const View *view, FileData *fd)
+{
+	const ScreenData *sd = &view->screen_data;
+	size_t page = sd->window_size.y;
+	size_t cursor_row = sd->cursor_pos.y;
+	fdata_lay_out_rows(fd, sd->top_file_row, page);
+	fdata_lay_out_rows(fd, cursor_row > page ? cursor_row - page : 0, 2 * page + 1);
+}
+
+// Waits for the size to settle, a new size would only make the work stale
+void editor_start_layout_job(Editor *obj)
+{
+	if (obj->layout_job != JOB_NONE)
+	{
+		return;
+	}
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	long long elapsed = (now.tv_sec - obj->resized_at.tv_sec) * 1000000000LL + (now.tv_nsec - obj->resized_at.tv_nsec);
+	if (elapsed < RESIZE_SETTLE_NS)
+	{
+		return;
+	}
+	Job job = {
+		.priority = JOB_PRIORITY_LOW,
+		.cancel_on_input = false,
+		.state = obj,
+		.step = editor_step_layout,
+		.publish = editor_publish_layout,
+		.destroy = editor_destroy_layout,
+	};
+	obj->layout_job = jsched_submit(obj->jobs, job);
+}
+
+// For what needs every line laid out, like going to a percentage of the rows
+void editor_finish_layout(Editor *obj)
+{
+	jsched_cancel(obj->jobs, obj->layout_job);
+	fdata_lay_out_more(obj->file_data, SIZE_MAX);
+}
+
+// The lines are laid out in place, between keys like every job step. Until then their rows are
+// estimates that only lines far from the views have, so nothing shown depends on them
+bool editor_step_layout(void *state)
+{
+	Editor *obj = state;
+	return fdata_lay_out_more(obj->file_data, LAYOUT_JOB_STEP_LINES);
+}
+
+void editor_publish_layout(void *state)
+{
+}
+
+// The state is the editor itself, there's nothing to free
+void editor_destroy_layout(void *state)
+{
+	Editor *obj = state;
+	obj->layout_job = JOB_NONE;
+}
+
+void editor_clamp_cursor(ScreenData *screen_data, const FileData *file_data)
+{
+	size_t line_count = fdata_get_line_count(file_data);
+	if ((size_t)screen_data->cursor_pos.y >= line_count)
+	{
+		screen_data->cursor_pos.y = line_count - 1;
+	}
+	size_t line_size = fdata_get_line_size(file_data, screen_data->cursor_pos.y);
+	if ((size_t)screen_data->cursor_pos.x > line_size)
+	{
+		screen_data->cursor_pos.x = line_size;
+	}
+}
+
+// Only the rows that changed since the last frame are drawn
+void editor_render_screen(Editor *obj)
+{
+	PROFILE_SCOPE(PROFILE_RENDER);
+	obj->io_interface.hide_cursor();
+	bool redraw = obj->redraw;
+	editor_render_views(obj);
+	int bar_row = obj->window_size.y;
+	bool bar_shown = true;
+	if (obj->state == EDITOR_SEARCH_STATE)
+	{
+		editor_render_search_bar(&obj->search_data, bar_row, &obj->io_interface);
+	}
+	else if (obj->state == EDITOR_GOTO_STATE)
+	{
+		editor_render_goto_bar(&obj->goto_data, bar_row, &obj->io_interface);
+	}
+	else if (obj->state == EDITOR_MACRO_STATE || obj->macro_data.recording)
+	{
+		editor_render_macro_bar(&obj->macro_data, obj->state, bar_row, &obj->io_interface);
+	}
+	else if (obj->overlay != OVERLAY_NONE)
+	{
+		editor_render_overlay(obj);
+	}
+	else
+	{
+		// Rows aren't cleared between frames, so the last bar stays until the status line is drawn over it
+		editor_render_status_line(obj, redraw || obj->bar_shown);
+		bar_shown = false;
+	}
+	obj->bar_shown = bar_shown;
+	// Set before the flush, so the frame it publishes has the cursor where this frame puts it
+	const View *view = varr_get(obj->views, obj->current_view);
+	vec2 real_cursor_position = get_real_cursor_position(obj->screen_data, obj->file_data);
+	obj->io_interface.set_cursor_position(view->origin.x + real_cursor_position.x, view->origin.y + real_cursor_position.y);
+	obj->io_interface.reveal_cursor();
+	{
+		PROFILE_SCOPE(PROFILE_FLUSH);
+		obj->io_interface.flush_output();
+	}
+	PROFILE_FRAME_FLUSHED();
+}
+
+// The counts are kept up to date by the FileData as it's edited, so the line costs the same for any file. The bytes are
+// the ones editor_write_lines writes, which ends the last line too. It's only drawn when its text changed, the rows above
+// it aren't touched for it
+void editor_render_status_line(Editor *obj, bool redraw)
+{
+	const Buffer *buffer = barr_get(obj->buffers, obj->current_buffer);
+	const FileData *fd = obj->file_data;
+	char text[MX_STATUS_LENGTH];
+	int text_len = snprintf(text, sizeof(text), "%s%s%s  %d:%d  %zu lines  %zu words  %zu bytes",
+		buffer->filename[0] == NUL ? "[No Name]" : buffer->filename, fd->modified ? " [+]" : "",
+		buffer->disk_conflict ? " [conflict]" : "",
+		obj->screen_data->cursor_pos.y + 1, obj->screen_data->cursor_pos.x + 1,
+		fdata_get_line_count(fd), fdata_get_word_count(fd), fdata_get_byte_count(fd) + 1);
+	size_t size = (size_t)text_len < sizeof(text) ? (size_t)text_len : sizeof(text) - 1;
+	if (size > (size_t)obj->window_size.x)
+	{
+		size = obj->window_size.x;
+	}
+	if (!redraw && size == obj->status_size && memcmp(text, obj->status_text, size) == 0)
+	{
+		return;
+	}
+	memcpy(obj->status_text, text, size);
+	obj->status_size = size;
+	obj->io_interface.render_row(obj->window_size.y, size, text);
+}
+
+void editor_render_overlay(const Editor *obj)
+{
+	char msg[MX_OVERLAY_LENGTH];
+	if (obj->overlay == OVERLAY_PROFILER)
+	{
+		profiler_format_overlay(msg, sizeof(msg));
+	}
+	else
+	{
+		mem_format_report(msg, sizeof(msg));
+	}
+	size_t msg_len = strlen(msg);
+	if (msg_len > obj->window_size.x)
+	{
+		msg_len = obj->window_size.x;
+	}
+	obj->io_interface.render_row(obj->window_size.y, msg_len, msg);
+}
+
+void editor_render_search_bar(const SearchData *search_data, int row, const IO_Interface *io_interface)
+{
+	const char *prefix = search_data->job != JOB_NONE ? "Searching: " : "Search: ";
+	editor_render_prompt_bar(prefix, search_data->searched_text_index, search_data->searched_text, row, io_interface);
+}
+
+void editor_render_goto_bar(const GotoData *goto_data, int row, const IO_Interface *io_interface)
+{
+	editor_render_prompt_bar("Go to line (or N%): ", goto_data->text_index, goto_data->text, row, io_interface);
+}
+
+void editor_render_macro_bar(const MacroData *macro_data, int state, int row, const IO_Interface *io_interface)
+{
+	if (state == EDITOR_MACRO_STATE)
+	{
+		editor_render_prompt_bar("Replay macro how many times: ", macro_data->count_index, macro_data->count_text, row, io_interface);
+		return;
+	}
+	editor_render_prompt_bar("Recording macro (Ctrl-R to stop)", 0, "", row, io_interface);
+}
+
+void editor_render_prompt_bar(const char *prefix, size_t text_size, const char *text, int row, const IO_Interface *io_interface)
+{
+	size_t prefix_len  = strlen(prefix);
+	size_t msg_len     = text_size + prefix_len;
+	char *msg = malloc(msg_len * sizeof(char));
+	strncpy(msg, prefix, prefix_len);
+	strncpy(msg + prefix_len, text, text_size);
+	io_interface->render_row(row, msg_len, msg);
+	free(msg);
+}
+
+void editor_set_undo_budget(Editor *obj, size_t budget)
+{
+	obj->undo_budget = budget;
+	for (size_t i = 0; i < barr_get_size(obj->buffers); i++)
+	{
+		Buffer *buffer = barr_get(obj->buffers, i);
+		if (buffer->loaded)
+		{
+			ulog_set_budget(buffer->file_data.undo_log, budget);
+		}
+	}
+}
+
+void editor_clear_screen(const Editor *obj)
+{
+	obj->io_interface.clear_screen();
+	obj->io_interface.flush_output();
+}
+
+int ctrl_key(char c)
+{
+	return c & (0x1f);
+}
+
+vec2 get_real_cursor_position(const ScreenData *screen_data, const FileData *file_data)
+{
+	size_t row_offset = editor_get_cursor_row_offset(screen_data);
+	size_t screen_row = editor_get_cursor_visual_row(screen_data, file_data) - fdata_get_visual_rows_before(file_data, screen_data->window_size.x, screen_data->top_file_row);
+	tassert(screen_row < screen_data->window_size.y || screen_data->top_file_row == screen_data->cursor_pos.y, "get_real_cursor_position: cursor is out of the screen");
+	// The cursor is further down its line than the view is tall
+	if (screen_row >= screen_data->window_size.y)
+	{
+		return (vec2) { .x = screen_data->window_size.x, .y = screen_data->window_size.y - 1 };
+	}
+	return (vec2) { .x = screen_data->cursor_pos.x - row_offset * screen_data->window_size.x, .y = screen_row };
+}
+
+size_t editor_get_cursor_visual_row(const ScreenData *screen_data, const FileData *file_data)
+{
+	return fdata_get_visual_rows_before(file_data, screen_data->window_size.x, screen_data->cursor_pos.y) + editor_get_cursor_row_offset(screen_data);
+}
+
+size_t editor_get_cursor_row_offset(const ScreenData *screen_data)
+{
+	// A cursor right after a full row stays at the end of that row instead of starting a new one
+	if (screen_data->cursor_pos.x == 0)
+	{
+		return 0;
+	}
+	return (screen_data->cursor_pos.x - 1) / screen_data->window_size.x;
+}
+
+void editor_render_views(Editor *obj)
+{
+	DynamicBuffer *row_buffer = obj->row_buffer;
+	for (size_t row = 0; row < (size_t)obj->window_size.y; row++)
+	{
+		// Plain rows of a view as wide as the screen go out as they are, without a copy
+		View *view = editor_find_view_at(obj, 0, row);
+		if (view != NULL && view->screen_data.window_size.x == obj->window_size.x)
+		{
+			size_t view_row = row - view->origin.y;
+			const PrintRowData *row_data = &view->print_text_data.data[view_row];
+			size_t first_cursor;
+			bool highlighted = editor_is_row_highlighted(&view->screen_data, row_data, &first_cursor);
+			if (!obj->redraw && !editor_is_view_row_damaged(view, obj->file_data, view_row, highlighted))
+			{
+				continue;
+			}
+			if (row_data->index != -1 && !highlighted)
+			{
+				view->shown_rows[view_row] = (ShownRow) {.data = *row_data, .highlighted = false};
+				const DynamicBuffer *line = fdata_get_line(obj->file_data, row_data->file_row);
+				obj->io_interface.render_row(row, row_data->index, dbuf_get_with_nulc(line, row_data->file_start_col));
+				continue;
+			}
+		}
+		else if (!obj->redraw && !editor_is_screen_row_damaged(obj, row))
+		{
+			continue;
+		}
+		// Views and separators on a row are put together from left to right
+		dbuf_clear(row_buffer);
+		size_t x = 0;
+		while (x < (size_t)obj->window_size.x)
+		{
+			view = editor_find_view_at(obj, x, row);
+			if (view != NULL)
+			{
+				size_t width = view->screen_data.window_size.x;
+				size_t shown = editor_render_view_row(obj->file_data, view, row - view->origin.y, row_buffer);
+				// The end of the screen row is cleared anyway
+				if (x + width < (size_t)obj->window_size.x)
+				{
+					for (; shown < width; shown++)
+					{
+						dbuf_addc(row_buffer, ' ');
+					}
+				}
+				x += width;
+				continue;
+			}
+			const Separator *separator = NULL;
+			for (size_t i = 0; i < separr_get_size(obj->separators) && separator == NULL; i++)
+			{
+				const Separator *candidate = separr_get_ptr(obj->separators, i);
+				size_t length_y = candidate->vertical ? candidate->length : 1;
+				if ((size_t)candidate->origin.x == x && is_in_range(candidate->origin.y, row, candidate->origin.y + length_y))
+				{
+					separator = candidate;
+				}
+			}
+			tassert(separator, "editor_render_views: the views don't cover the screen");
+			size_t length_x = separator->vertical ? 1 : separator->length;
+			for (size_t i = 0; i < length_x; i++)
+			{
+				dbuf_addc(row_buffer, separator->vertical ? '|' : '-');
+			}
+			x += length_x;
+		}
+		obj->io_interface.render_row(row, dbuf_get_size(row_buffer), dbuf_get_with_nulc(row_buffer, 0));
+	}
+	for (size_t i = 0; i < varr_get_size(obj->views); i++)
+	{
+		varr_get(obj->views, i)->redraw = false;
+	}
+	obj->redraw = false;
+	fdata_clear_damage(obj->file_data);
+}
+
+View *editor_find_view_at(const Editor *obj, size_t x, size_t row)
+{
+	for (size_t i = 0; i < varr_get_size(obj->views); i++)
+	{
+		View *view = varr_get(obj->views, i);
+		if ((size_t)view->origin.x == x && is_in_range(view->origin.y, row, view->origin.y + view->screen_data.window_size.y))
+		{
+			return view;
+		}
+	}
+	return NULL;
+}
+
+bool editor_is_screen_row_damaged(const Editor *obj, size_t row)
+{
+	for (size_t i = 0; i < varr_get_size(obj->views); i++)
+	{
+		const View *view = varr_get(obj->views, i);
+		size_t view_row = row - view->origin.y;
+		if (row < (size_t)view->origin.y || view_row >= (size_t)view->screen_data.window_size.y)
+		{
+			continue;
+		}
+		size_t first_cursor;
+		bool highlighted = editor_is_row_highlighted(&view->screen_data, &view->print_text_data.data[view_row], &first_cursor);
+		if (editor_is_view_row_damaged(view, obj->file_data, view_row, highlighted))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// A row is drawn again when it shows other text, or when the text it shows was edited from any view
+bool editor_is_view_row_damaged(const View *view, const FileData *fd, size_t row, bool highlighted)
+{
+	const PrintRowData *row_data = &view->print_text_data.data[row];
+	const ShownRow *shown = &view->shown_rows[row];
+	return view->redraw || shown->highlighted || highlighted
+		|| shown->data.index != row_data->index || shown->data.file_row != row_data->file_row
+		|| shown->data.file_start_col != row_data->file_start_col
+		|| (row_data->index != -1 && fdata_is_row_damaged(fd, row_data->file_row));
+}
+
+bool editor_is_row_highlighted(const ScreenData *sd, const PrintRowData *row_data, size_t *first_cursor)
+{
+	if (row_data->index == -1)
+	{
+		return false;
+	}
+	vec2 selection_start, selection_end;
+	if (editor_get_selection(sd, &selection_start, &selection_end))
+	{
+		return selection_start.y <= row_data->file_row && row_data->file_row <= selection_end.y;
+	}
+	vec2 row_start = {.x = row_data->file_start_col, .y = row_data->file_row};
+	*first_cursor = editor_find_first_cursor(sd->extra_cursors, row_start);
+	return *first_cursor < parr_get_size(sd->extra_cursors) && parr_get(sd->extra_cursors, *first_cursor).y == row_start.y
+		&& parr_get(sd->extra_cursors, *first_cursor).x <= row_start.x + row_data->index;
+}
+
+// Appends the row of the view to out and returns how many cells it takes on the screen
+size_t editor_render_view_row(const FileData *fd, View *view, size_t row, DynamicBuffer *out)
+{
+	const ScreenData *sd = &view->screen_data;
+	const PrintRowData *row_data = &view->print_text_data.data[row];
+	size_t first_cursor;
+	bool highlighted = editor_is_row_highlighted(sd, row_data, &first_cursor);
+	view->shown_rows[row] = (ShownRow) {.data = *row_data, .highlighted = highlighted};
+	if (row_data->index == -1)
+	{
+		dbuf_addc(out, '~');
+		return 1;
+	}
+	const DynamicBuffer *line = fdata_get_line(fd, row_data->file_row);
+	vec2 selection_start, selection_end;
+	if (highlighted && editor_get_selection(sd, &selection_start, &selection_end))
+	{
+		return editor_render_row_with_selection(line, row_data, selection_start, selection_end, sd->window_size.x, out);
+	}
+	if (highlighted)
+	{
+		return editor_render_row_with_cursors(line, row_data, sd->extra_cursors, first_cursor, sd->window_size.x, out);
+	}
+	dbuf_adds(out, row_data->index, dbuf_get_with_nulc(line, row_data->file_start_col));
+	return row_data->index;
+}
+
+size_t editor_render_row_with_selection(const DynamicBuffer *line, const PrintRowData *row_data, vec2 start, vec2 end, size_t width, DynamicBuffer *out)
+{
+	size_t row_start = row_data->file_start_col;
+	size_t row_end = row_start + row_data->index;
+	// Wrapped lines are printed in parts, the selection is clipped to this part
+	size_t from = start.y == row_data->file_row ? start.x : row_start;
+	size_t to = end.y == row_data->file_row ? end.x : row_end;
+	from = from < row_start ? row_start : (from > row_end ? row_end : from);
+	to = to < from ? from : (to > row_end ? row_end : to);
+	size_t shown = row_data->index;
+	dbuf_adds(out, from - row_start, dbuf_get_with_nulc(line, row_start));
+	dbuf_adds(out, 4, "\x1b[7m");
+	dbuf_adds(out, to - from, dbuf_get_with_nulc(line, from));
+	// When only the line break of this row is selected, a space stands in for it if the row has room
+	bool line_break_selected = end.y > row_data->file_row && row_end == dbuf_get_size(line);
+	if (line_break_selected && from == to && shown < width)
+	{
+		dbuf_addc(out, ' ');
+		shown++;
+	}
+	dbuf_adds(out, 5, "\x1b[27m");
+	dbuf_adds(out, row_end - to, dbuf_get_with_nulc(line, to));
+	return shown;
+}
+
+size_t editor_render_row_with_cursors(const DynamicBuffer *line, const PrintRowData *row_data, const PositionArray *cursors, size_t first_cursor, size_t width, DynamicBuffer *out)
+{
+	// Extra cursors are drawn in reverse video, the terminal cursor only shows the primary one
+	size_t start = row_data->file_start_col;
+	size_t end = start + row_data->index;
+	size_t col = start;
+	size_t shown = row_data->index;
+	for (size_t i = first_cursor; i < parr_get_size(cursors); i++)
+	{
+		vec2 cursor = parr_get(cursors, i);
+		if (cursor.y != row_data->file_row || cursor.x > end || (cursor.x == end && (end != dbuf_get_size(line) || shown == width)))
+		{
+			break;
+		}
+		dbuf_adds(out, cursor.x - col, dbuf_get_with_nulc(line, col));
+		dbuf_adds(out, 4, "\x1b[7m");
+		dbuf_addc(out, cursor.x == dbuf_get_size(line) ? ' ' : *dbuf_getc(line, cursor.x));
+		dbuf_adds(out, 5, "\x1b[27m");
+		shown += cursor.x == dbuf_get_size(line);
+		col = cursor.x + 1;
+	}
+	if (col < end)
+	{
+		dbuf_adds(out, end - col, dbuf_get_with_nulc(line, col));
+	}
+	return shown;
+}
+
+void editor_update_print_text_data(PrintTextData *print_text_data, const FileData *fd, const ScreenData *sd)
+{
+	size_t file_row = sd->top_file_row;
+	size_t file_col = 0;
+	for (int i = 0; i < sd->window_size.y; i++)
+	{
+		if (file_row >= fdata_get_line_count(fd) && sd->cursor_pos.y != file_row)
+		{
+			print_text_data->data[i] = editor_update_out_of_range_row_data();
+			continue;
+		}
+		if (file_row >= fdata_get_line_count(fd))
+		{
+			print_text_data->data[i] = editor_update_empty_cursor_row_data(fd, file_row);
+			continue;
+		}
+		print_text_data->data[i] = editor_update_normal_row_data(fd, sd, &file_row, &file_col);
+	}
+}
+
+PrintRowData editor_update_normal_row_data(const FileData *fd, const ScreenData *sd, size_t *old_file_row, size_t *old_file_col)
+{
+	size_t file_row = *old_file_row;
+	size_t file_col = *old_file_col;
+	const DynamicBuffer *current_line_data = fdata_get_line(fd, file_row);
+	size_t row_render_size = dbuf_get_size(current_line_data) - file_col;
+	// Continue printing current file
+	if (row_render_size > sd->window_size.x) 
+	{
+		row_render_size = sd->window_size.x;
+	}
+	PrintRowData res = (PrintRowData) { .index = row_render_size, .file_row = file_row, .file_start_col = file_col };
+	file_col += row_render_size;
+	if (file_col == dbuf_get_size(current_line_data))
+	{
+		file_row++;
+		file_col = 0;
+	}
+	*old_file_row = file_row;
+	*old_file_col = file_col;
+	return res;
+}
+
+PrintRowData editor_update_out_of_range_row_data()
+{
+	return (PrintRowData) { .index = -1, .file_row = -1, .file_start_col = -1 };
+}
+
+PrintRowData editor_update_empty_cursor_row_data(const FileData *fd, size_t last_file_row)
+{
+	size_t last_line_size = fdata_get_line_size(fd, last_file_row);
+	return (PrintRowData) { .index = 0, .file_row = last_file_row, .file_start_col = last_line_size };
+}
+
+int editor_process_tick(Editor *obj)
+{
+	int c = editor_read_key(obj);
+	// Keys that go through the matches wait for the search, any other key makes the jobs that depend on input stale.
+	// A resize isn't typed, it changes nothing the jobs work on
+	if (c != NUL && !IS_RESIZE_KEY(c))
+	{
+		if (obj->state == EDITOR_SEARCH_STATE && (c == ARROW_UP || c == ARROW_DOWN || c == ADD_CURSORS_KEY))
+		{
+			jsched_finish(obj->jobs, obj->search_data.job);
+		}
+		jsched_note_input(obj->jobs);
+	}
+	// Files are only checked while no keys are coming in, their changes can wait until typing stops
+	if (c == NUL && obj->file_watch != NULL)
+	{
+		editor_check_file_changes(obj);
+	}
+	// Compression waits for the jobs, it's only a saving
+	if (c == NUL && !jsched_has_jobs(obj->jobs))
+	{
+		editor_compress_cold_lines(obj);
+	}
+	if (obj->following)
+	{
+		editor_follow_files(obj);
+	}
+	editor_record_macro_key(&obj->macro_data, c);
+	int res = editor_process_key(obj, c);
+	// Jobs go on for a slice of every tick, the keys that come in meanwhile are handled in the next one
+	jsched_run(obj->jobs, JOB_SLICE_NS);
+	editor_update_layout(obj);
+	return editor_process_state_tick_result(&obj->state, res);
+}
+
+int editor_apply_keys(Editor *obj, size_t count, const int *keys)
+{
+	int res = editor_process_keys(obj, count, keys);
+	editor_update_layout(obj);
+	return res;
+}
+
+int editor_process_keys(Editor *obj, size_t count, const int *keys)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		int res = editor_process_key(obj, keys[i]);
+		// Keys that weren't typed don't wait for anything, the next key sees the results of the jobs this one started
+		jsched_run(obj->jobs, UINT64_MAX);
+		if (editor_process_state_tick_result(&obj->state, res) == TEXT_EDITOR_EOF)
+		{
+			return TEXT_EDITOR_EOF;
+		}
+	}
+	return TEXT_EDITOR_SUCCESSFUL_READ;
+}
+
+int editor_read_key(Editor *obj)
+{
+	int c;
+	KeyArray *typed_keys = obj->macro_data.typed_keys;
+	if (karr_get_size(typed_keys) > 0)
+	{
+		c = karr_get(typed_keys, 0);
+		karr_remove(typed_keys, 0);
+	}
+	else
+	{
+		PROFILE_SCOPE(PROFILE_READ_KEY);
+		// Waiting jobs only give way to keys that are already there
+		c = jsched_has_jobs(obj->jobs) ? obj->io_interface.poll_key() : obj->io_interface.read_key();
+	}
+	if (c != NUL)
+	{
+		PROFILE_KEY_READ();
+	}
+	return c;
+}
+
+int editor_process_key(Editor *obj, int c)
+{
+	PROFILE_SCOPE(PROFILE_KEYPRESS);
+	int res = TEXT_EDITOR_SUCCESSFUL_READ;
+	if (editor_process_global_key(obj, c))
+	{
+		return res;
+	}
+	if (obj->state == EDITOR_WRITE_STATE && c == NEXT_BUFFER_KEY)
+	{
+		editor_switch_buffer(obj, (obj->current_buffer + 1) % barr_get_size(obj->buffers));
+		return res;
+	}
+	if (obj->state == EDITOR_WRITE_STATE && editor_process_view_key(obj, c))
+	{
+		return res;
+	}
+	if (obj->state == EDITOR_WRITE_STATE && editor_process_line_command(obj->screen_data, obj->file_data, &obj->clipboard, c))
+	{
+		return res;
+	}
+	if (obj->state == EDITOR_WRITE_STATE && editor_process_selection_key(obj->screen_data, obj->file_data, &obj->clipboard, c))
+	{
+		return res;
+	}
+	if (obj->state == EDITOR_WRITE_STATE)
+	{
+		res = editor_process_keypress_for_write_state(obj->screen_data, obj->file_data, obj->print_text_data, c);	
+	}
+	else if (obj->state == EDITOR_SEARCH_STATE)
+	{
+		res = editor_process_keypress_for_search_state(obj, c);
+	}
+	else if (obj->state == EDITOR_GOTO_STATE)
+	{
+		if (c == CARRIAGE_RETURN)
+		{
+			editor_finish_layout(obj);
+		}
+		res = editor_process_keypress_for_goto_state(&obj->goto_data, obj->screen_data, obj->file_data, c);
+	}
+	else if (obj->state == EDITOR_MACRO_STATE)
+	{
+		res = editor_process_keypress_for_macro_state(obj, c);
+	}
+	return res;
+}
+
+bool editor_process_global_key(Editor *obj, int c)
+{
+	if (IS_RESIZE_KEY(c))
+	{
+		editor_resize(obj, GET_RESIZE_KEY_SIZE(c));
+		return true;
+	}
+	switch (c)
+	{
+		case PROFILER_KEY:
+			obj->overlay = obj->overlay == OVERLAY_PROFILER ? OVERLAY_NONE : OVERLAY_PROFILER;
+			return true;
+		case MEMORY_KEY:
+			obj->overlay = obj->overlay == OVERLAY_MEMORY ? OVERLAY_NONE : OVERLAY_MEMORY;
+			return true;
+		case MACRO_RECORD_KEY:
+			editor_toggle_macro_recording(&obj->macro_data);
+			return true;
+	}
+	return false;
+}
+
+void editor_update_layout(Editor *obj)
+{
+	PROFILE_SCOPE(PROFILE_LAYOUT);
+	if (!fdata_is_laid_out(obj->file_data))
+	{
+		for (size_t i = 0; i < varr_get_size(obj->views); i++)
+		{
+			editor_lay_out_view_lines(varr_get(obj->views, i), obj->file_data);
+		}
+		editor_start_layout_job(obj);
+	}
+	for (size_t i = 0; i < varr_get_size(obj->views); i++)
+	{
+		editor_update_view_layout(varr_get(obj->views, i), obj->file_data, i == obj->current_view);
+	}
+}
+
+// Other views are only laid out again when an edit reaches the rows they show
+void editor_update_view_layout(View *view, const FileData *fd, bool current)
+{
+	ScreenData *sd = &view->screen_data;
+	if (!current)
+	{
+		const PrintTextData *ptd = &view->print_text_data;
+		size_t last_file_row = ptd->data[ptd->col_count - 1].file_row;
+		bool damaged = fd->damage_start < fd->damage_end && fd->damage_start <= last_file_row && fd->damage_end > sd->top_file_row;
+		if (!damaged && !view->redraw)
+		{
+			return;
+		}
+		// Positions in this view may not point at the same text anymore
+		if (damaged)
+		{
+			editor_clear_extra_cursors(sd);
+			editor_clear_selection(sd);
+			editor_clamp_cursor(sd, fd);
+		}
+	}
+	adjust_top_file_row(sd, fd);
+	editor_update_print_text_data(&view->print_text_data, fd, sd);
+}
+
+const char *editor_get_key_operation(const Editor *obj, int c)
+{
+	if (IS_RESIZE_KEY(c))
+	{
+		return "resize";
+	}
+	switch (c)
+	{
+		case NUL:
+			return "timeout";
+		case QUIT_KEY:
+			return "quit";
+	}
+	if (obj->state == EDITOR_SEARCH_STATE)
+	{
+		switch (c)
+		{
+			case CARRIAGE_RETURN:
+				return "search";
+			case ARROW_UP:
+			case ARROW_DOWN:
+				return "jump to match";
+			case CTRL('X'):
+				return "leave search";
+			case ADD_CURSORS_KEY:
+				return "add cursors at matches";
+		}
+		return "edit search text";
+	}
+	if (obj->state == EDITOR_GOTO_STATE)
+	{
+		return c == CARRIAGE_RETURN ? "go to line" : "edit go to text";
+	}
+	if (obj->state == EDITOR_MACRO_STATE)
+	{
+		return c == CARRIAGE_RETURN ? "replay macro" : "edit replay count";
+	}
+	switch (c)
+	{
+		case ARROW_UP:
+		case ARROW_DOWN:
+		case ARROW_LEFT:
+		case ARROW_RIGHT:
+			return "move cursor";
+		case PAGE_UP:
+		case PAGE_DOWN:
+			return "move page";
+		case BACKSPACE:
+			return obj->screen_data->cursor_pos.x == 0 ? "join lines" : "delete character";
+		case CARRIAGE_RETURN:
+			return "split line";
+		case CTRL('f'):
+			return "open search";
+		case GOTO_KEY:
+			return "open go to";
+		case PROFILER_KEY:
+			return "toggle profiler";
+		case MEMORY_KEY:
+			return "toggle memory report";
+		case UNDO_KEY:
+			return "undo";
+		case REDO_KEY:
+			return "redo";
+		case ADD_CURSOR_KEY:
+			return "add cursor below";
+		case ESCAPE_KEY:
+			return "clear cursors";
+		case CUT_LINES_KEY:
+			return "cut lines";
+		case PASTE_LINES_KEY:
+		case PASTE_KEY:
+			return "paste";
+		case MARK_KEY:
+			return "toggle selection";
+		case SHIFT_ARROW_UP:
+		case SHIFT_ARROW_DOWN:
+		case SHIFT_ARROW_LEFT:
+		case SHIFT_ARROW_RIGHT:
+			return "extend selection";
+		case COPY_KEY:
+			return "copy";
+		case CUT_KEY:
+			return "cut";
+		case DUPLICATE_LINES_KEY:
+			return "duplicate lines";
+		case DELETE_LINES_KEY:
+			return "delete lines";
+		case MOVE_LINES_UP_KEY:
+		case MOVE_LINES_DOWN_KEY:
+			return "move lines";
+		case MACRO_RECORD_KEY:
+			return "toggle macro recording";
+		case MACRO_REPLAY_KEY:
+			return "open macro replay";
+		case NEXT_BUFFER_KEY:
+			return "next buffer";
+		case SPLIT_HORIZONTAL_KEY:
+		case SPLIT_VERTICAL_KEY:
+			return "split view";
+		case NEXT_VIEW_KEY:
+			return "next view";
+		case CLOSE_VIEW_KEY:
+			return "close view";
+	}
+	return is_a_printable_character(c) ? "insert character" : "ignored key";
+}
+
+int editor_process_state_tick_result(int* state, int res)
+{
+	switch (res)
+	{
+		case TEXT_EDITOR_SWITCH_TO_SEARCH_STATE:
+			*state = EDITOR_SEARCH_STATE;
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case TEXT_EDITOR_SWITCH_TO_WRITE_STATE:
+			*state = EDITOR_WRITE_STATE;
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case TEXT_EDITOR_SWITCH_TO_GOTO_STATE:
+			*state = EDITOR_GOTO_STATE;
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case TEXT_EDITOR_SWITCH_TO_MACRO_STATE:
+			*state = EDITOR_MACRO_STATE;
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case TEXT_EDITOR_EOF:
+			return TEXT_EDITOR_EOF;
+	}
+	return TEXT_EDITOR_SUCCESSFUL_READ;
+}
+
+int editor_process_keypress_for_search_state(Editor *obj, int c)
+{
+	SearchData *search_data = &obj->search_data;
+	ScreenData *screen_data = obj->screen_data;
+	editor_update_stale_matches(obj);
+	switch (c)
+	{
+		case QUIT_KEY:
+			return TEXT_EDITOR_EOF;
+		case NUL:
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case CTRL('X'):
+			return TEXT_EDITOR_SWITCH_TO_WRITE_STATE;
+		case BACKSPACE:
+			editor_process_backspace_for_search_state(search_data);
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case CARRIAGE_RETURN:
+			editor_process_carriage_return_for_search_state(obj);
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case ARROW_UP:
+			editor_process_arrow_for_search_state(search_data, screen_data, -1);
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case ARROW_DOWN:
+			editor_process_arrow_for_search_state(search_data, screen_data, 1);
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case ADD_CURSORS_KEY:
+			editor_add_cursors_at_matches(search_data, screen_data);
+			return TEXT_EDITOR_SWITCH_TO_WRITE_STATE;
+	}
+	if (is_a_printable_character(c))
+	{
+		search_data->searched_text[search_data->searched_text_index++] = c;
+	}
+	return TEXT_EDITOR_SUCCESSFUL_READ;
+}
+
+void editor_process_backspace_for_search_state(SearchData *search_data)
+{
+	if (search_data->searched_text_index > 0)
+	{
+		search_data->searched_text_index--;
+	}
+}
+
+// The search runs as a job, there are no matches until it's done
+void editor_process_carriage_return_for_search_state(Editor *obj)
+{
+	SearchData *search_data = &obj->search_data;
+	jsched_cancel(obj->jobs, search_data->job);
+	parr_clear(search_data->matches);
+	search_data->match_index = 0;
+	SearchJob *search = mem_alloc(MEM_SEARCH, sizeof(SearchJob));
+	search->editor = obj;
+	search->file_data = obj->file_data;
+	search->snapshot = fdata_take_snapshot(obj->file_data);
+	search->row = 0;
+	search->text_size = search_data->searched_text_index;
+	memcpy(search->text, search_data->searched_text, search->text_size);
+	search->matches = parr_create(MEM_SEARCH);
+	Job job = {
+		.priority = JOB_PRIORITY_NORMAL,
+		.cancel_on_input = true,
+		.state = search,
+		.step = editor_step_search,
+		.publish = editor_publish_search,
+		.destroy = editor_destroy_search,
+	};
+	search->id = jsched_submit(obj->jobs, job);
+	search_data->job = search->id;
+}
+
+bool editor_step_search(void *state)
+{
+	SearchJob *search = state;
+	if (search->file_data->change_count != search->snapshot->change_count)
+	{
+		snap_destroy(search->snapshot);
+		search->snapshot = fdata_take_snapshot(search->file_data);
+		parr_clear(search->matches);
+		search->row = 0;
+	}
+	size_t line_count = snap_get_line_count(search->snapshot);
+	size_t end = search->row + SEARCH_JOB_STEP_LINES < line_count ? search->row + SEARCH_JOB_STEP_LINES : line_count;
+	for (; search->row < end; search->row++)
+	{
+		// Compressed blocks are read through once, without being made hot
+		size_t size;
+		const char *text = snap_get_line_text(search->snapshot, search->row, &size);
+		editor_process_line_matches(search->matches, search->text_size, search->text, size, text, search->row);
+	}
+	return search->row == line_count;
+}
+
+// The matches of the last search are swapped for the new ones, the cursor goes to the first of them
+void editor_publish_search(void *state)
+{
+	SearchJob *search = state;
+	SearchData *search_data = &search->editor->search_data;
+	PositionArray *matches = search_data->matches;
+	search_data->matches = search->matches;
+	search->matches = matches;
+	search_data->match_index = 0;
+	search_data->matched_size = search->text_size;
+	memcpy(search_data->matched_text, search->text, search->text_size);
+	search_data->change_count = search->snapshot->change_count;
+	search_data->line_count = snap_get_line_count(search->snapshot);
+	if (parr_get_size(search_data->matches) > 0)
+	{
+		search->editor->screen_data->cursor_pos = editor_get_match_pos(search_data);
+	}
+}
+
+void editor_destroy_search(void *state)
+{
+	SearchJob *search = state;
+	if (search->editor->search_data.job == search->id)
+	{
+		search->editor->search_data.job = JOB_NONE;
+	}
+	snap_destroy(search->snapshot);
+	parr_destroy(search->matches);
+	mem_free(MEM_SEARCH, search, sizeof(SearchJob));
+}
+
+void editor_process_line_matches(PositionArray *matches, size_t searched_size, const char *searched_text, size_t size, const char *text, int line_index)
+{
+	for (int j = 0; j + searched_size <= size; j++)
+	{
+		if (memcmp(text + j, searched_text, searched_size) == 0)
+		{
+			parr_add(matches, (vec2) {.x = j, .y = line_index});
+		}
+	}
+}
+
+void editor_process_arrow_for_search_state(SearchData *search_data, ScreenData *screen_data, int change)
+{
+	if (parr_get_size(search_data->matches) == 0)
+	{
+		return;
+	}
+	editor_change_match_index(search_data, screen_data, change);
+	screen_data->cursor_pos = editor_get_match_pos(search_data);
+}
+
+// Matches move with the lines that weren't touched since the search, the lines that were are searched again. When the
+// changes go back further than the FileData remembers the matches are dropped, they are searched for again
+void editor_update_stale_matches(Editor *obj)
+{
+	SearchData *search_data = &obj->search_data;
+	const FileData *file_data = obj->file_data;
+	if (search_data->change_count == file_data->change_count)
+	{
+		return;
+	}
+	// Cleared matches aren't of any text
+	RowChange change;
+	if (search_data->matched_size == 0 || !fdata_get_changed_rows(file_data, search_data->change_count, &change)
+		|| change.tail > search_data->line_count)
+	{
+		parr_clear(search_data->matches);
+		search_data->match_index = 0;
+		return;
+	}
+	size_t line_count = fdata_get_line_count(file_data);
+	size_t old_end = search_data->line_count - change.tail;
+	size_t new_end = line_count - change.tail;
+	PositionArray *matches = search_data->matches;
+	size_t first = 0;
+	while (first < parr_get_size(matches) && (size_t)parr_get(matches, first).y < change.start)
+	{
+		first++;
+	}
+	size_t last = first;
+	while (last < parr_get_size(matches) && (size_t)parr_get(matches, last).y < old_end)
+	{
+		last++;
+	}
+	// The rows after the changed ones moved by as many rows as were inserted or removed
+	for (size_t i = last; i < parr_get_size(matches); i++)
+	{
+		parr_get_ptr(matches, i)->y += (long long)new_end - (long long)old_end;
+	}
+	PositionArray *found = parr_create(MEM_SEARCH);
+	for (size_t row = change.start; row < new_end; row++)
+	{
+		size_t size;
+		const char *text = fdata_get_line_text(file_data, row, &size);
+		editor_process_line_matches(found, search_data->matched_size, search_data->matched_text, size, text, row);
+	}
+	parr_remove_multiple(matches, first, last - first);
+	parr_insert_multiple(matches, first, parr_get_size(found), found->arr);
+	parr_destroy(found);
+	if (search_data->match_index >= parr_get_size(matches))
+	{
+		search_data->match_index = 0;
+	}
+	search_data->change_count = file_data->change_count;
+	search_data->line_count = line_count;
+}
+
+void editor_change_match_index(SearchData *search_data, ScreenData *screen_data, int change)
+{
+	size_t match_count = parr_get_size(search_data->matches);
+	search_data->match_index = ((search_data->match_index + change) + match_count) % match_count;
+}
+
+vec2 editor_get_match_pos(const SearchData* search_data)
+{
+	return parr_get(search_data->matches, search_data->match_index);
+}
+
+int editor_process_keypress_for_goto_state(GotoData *goto_data, ScreenData *screen_data, const FileData *file_data, int c)
+{
+	switch (c)
+	{
+		case QUIT_KEY:
+			return TEXT_EDITOR_EOF;
+		case NUL:
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case CTRL('X'):
+			goto_data->text_index = 0;
+			return TEXT_EDITOR_SWITCH_TO_WRITE_STATE;
+		case BACKSPACE:
+			if (goto_data->text_index > 0)
+			{
+				goto_data->text_index--;
+			}
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case CARRIAGE_RETURN:
+			editor_process_carriage_return_for_goto_state(goto_data, screen_data, file_data);
+			return TEXT_EDITOR_SWITCH_TO_WRITE_STATE;
+	}
+	if ((isdigit(c) || c == '%') && goto_data->text_index < MX_GOTO_TEXT_LENGTH)
+	{
+		goto_data->text[goto_data->text_index++] = c;
+	}
+	return TEXT_EDITOR_SUCCESSFUL_READ;
+}
+
+void editor_process_carriage_return_for_goto_state(GotoData *goto_data, ScreenData *screen_data, const FileData *file_data)
+{
+	if (goto_data->text_index > 0)
+	{
+		size_t line = editor_get_goto_target_line(goto_data, file_data, screen_data->window_size.x);
+		editor_move_cursor_to_line(screen_data, file_data, line);
+		screen_data->top_file_row = line;
+	}
+	goto_data->text_index = 0;
+}
+
+size_t editor_get_goto_target_line(const GotoData *goto_data, const FileData *file_data, size_t width)
+{
+	size_t value = 0;
+	for (size_t i = 0; i < goto_data->text_index && isdigit(goto_data->text[i]); i++)
+	{
+		value = value * 10 + (goto_data->text[i] - '0');
+	}
+	size_t line_count = fdata_get_line_count(file_data);
+	// Percentages are taken over the wrapped rows, so that 50% is the middle of what you'd scroll through
+	if (goto_data->text[goto_data->text_index - 1] == '%')
+	{
+		if (value >= 100)
+		{
+			return line_count - 1;
+		}
+		size_t visual_row = fdata_get_total_visual_rows(file_data, width) * value / 100;
+		return fdata_find_line_of_visual_row(file_data, width, visual_row);
+	}
+	// Lines are 1-indexed for the user
+	if (value == 0)
+	{
+		return 0;
+	}
+	if (value > line_count)
+	{
+		return line_count - 1;
+	}
+	return value - 1;
+}
+
+int editor_process_keypress_for_macro_state(Editor *obj, int c)
+{
+	MacroData *macro_data = &obj->macro_data;
+	switch (c)
+	{
+		case QUIT_KEY:
+			return TEXT_EDITOR_EOF;
+		case NUL:
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case CTRL('X'):
+		case ESCAPE_KEY:
+			macro_data->count_index = 0;
+			return TEXT_EDITOR_SWITCH_TO_WRITE_STATE;
+		case BACKSPACE:
+			if (macro_data->count_index > 0)
+			{
+				macro_data->count_index--;
+			}
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case CARRIAGE_RETURN:
+		{
+			size_t count = editor_get_replay_count(macro_data);
+			macro_data->count_index = 0;
+			// The macro starts in the write state like it was recorded, and may leave the editor in another one
+			obj->state = EDITOR_WRITE_STATE;
+			return editor_replay_macro(obj, count);
+		}
+	}
+	if (isdigit(c) && macro_data->count_index < MX_REPLAY_TEXT_LENGTH)
+	{
+		macro_data->count_text[macro_data->count_index++] = c;
+	}
+	return TEXT_EDITOR_SUCCESSFUL_READ;
 }
 
-void editor_write_file(Editor *obj, const char *filename)
+void editor_record_macro_key(MacroData *macro_data, int c)
 {
-	FILE *fp = fopen(filename, "w");
-	for (size_t i = 0; i < darr_get_size(obj->file_data.darr); i++)
+	if (!macro_data->recording || c == NUL || c == MACRO_RECORD_KEY || IS_RESIZE_KEY(c))
+	{
+		return;
+	}
+	// A macro can't replay itself, so opening the replay prompt ends the recording
+	if (c == MACRO_REPLAY_KEY)
 	{
-		DynamicBuffer *dbuf = *(DynamicBuffer**)darr_get(obj->file_data.darr, i);
-		// Dashes are for debugging: To clearly see where each file ends
-		dbuf_addc(dbuf, '\n');
-		fputs(dbuf_get_with_nulc(dbuf, 0), fp);
-		dbuf_popc(dbuf);
+		macro_data->recording = false;
+		return;
 	}
-	fclose(fp);
+	karr_add(macro_data->keys, c);
 }
 
-void editor_render_screen(const Editor *obj)
+void editor_toggle_macro_recording(MacroData *macro_data)
 {
-	obj->io_interface.hide_cursor();
-	obj->io_interface.clear_screen();
-	editor_render_rows(&obj->file_data, &obj->print_text_data, &obj->io_interface);
-	if (obj->state == EDITOR_SEARCH_STATE)
+	macro_data->recording = !macro_data->recording;
+	if (macro_data->recording)
 	{
-		editor_render_search_bar(&obj->search_data, &obj->print_text_data, &obj->io_interface);
+		karr_clear(macro_data->keys);
 	}
-	obj->io_interface.reveal_cursor();
-	obj->io_interface.flush_output();
-	vec2 real_cursor_position = get_real_cursor_position(&obj->screen_data, &obj->print_text_data);
-	obj->io_interface.set_cursor_position(real_cursor_position.x, real_cursor_position.y);
 }
 
-void editor_render_search_bar(const SearchData *search_data, const PrintTextData *print_text_data, const IO_Interface *io_interface)
+size_t editor_get_replay_count(const MacroData *macro_data)
 {
-
-	const char *prefix = "Search: ";
-	size_t prefix_len  = strlen(prefix);
-	size_t msg_len     = search_data->searched_text_index + prefix_len;
-	char *msg = malloc(msg_len * sizeof(char));
-	strncpy(msg, prefix, prefix_len);
-	strncpy(msg + prefix_len, search_data->searched_text, search_data->searched_text_index);
-	io_interface->render_row(print_text_data->col_count, msg_len, msg);
+	if (macro_data->count_index == 0)
+	{
+		return 1;
+	}
+	size_t value = 0;
+	for (size_t i = 0; i < macro_data->count_index; i++)
+	{
+		value = value * 10 + (macro_data->count_text[i] - '0');
+	}
+	return value;
 }
 
-void editor_clear_screen(const Editor *obj)
+// Keys go straight to the handlers, the layout and the screen are only updated once after the last iteration
+int editor_replay_macro(Editor *obj, size_t count)
 {
-	obj->io_interface.clear_screen();
-	obj->io_interface.flush_output();
+	size_t key_count = karr_get_size(obj->macro_data.keys);
+	if (key_count == 0)
+	{
+		return TEXT_EDITOR_SUCCESSFUL_READ;
+	}
+	const int *keys = karr_getc(obj->macro_data.keys, 0);
+	struct timespec last_poll;
+	clock_gettime(CLOCK_MONOTONIC, &last_poll);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (editor_process_keys(obj, key_count, keys) == TEXT_EDITOR_EOF)
+		{
+			return TEXT_EDITOR_EOF;
+		}
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		long long elapsed = (now.tv_sec - last_poll.tv_sec) * 1000000000LL + (now.tv_nsec - last_poll.tv_nsec);
+		if (elapsed < MACRO_POLL_INTERVAL_NS)
+		{
+			continue;
+		}
+		if (editor_poll_replay_cancel(obj, i + 1, count))
+		{
+			break;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &last_poll);
+	}
+	return TEXT_EDITOR_SUCCESSFUL_READ;
 }
 
-int ctrl_key(char c)
+// Shows how far the replay got and takes the keys that are already waiting, without waiting for more. Keys other than a
+// cancel are kept, they are handled once the replay is over
+bool editor_poll_replay_cancel(Editor *obj, size_t done, size_t count)
 {
-	return c & (0x1f);
+	char msg[MX_OVERLAY_LENGTH];
+	int msg_len = snprintf(msg, sizeof(msg), "Replaying macro %zu/%zu (ESC to cancel)", done, count);
+	obj->io_interface.render_row(obj->window_size.y, msg_len, msg);
+	obj->io_interface.flush_output();
+	for (int c = obj->io_interface.poll_key(); c != NUL; c = obj->io_interface.poll_key())
+	{
+		if (c == ESCAPE_KEY || c == CTRL('X') || c == QUIT_KEY)
+		{
+			return true;
+		}
+		karr_add(obj->macro_data.typed_keys, c);
+	}
+	return false;
 }
 
-vec2 get_real_cursor_position(const ScreenData *screen_data, const PrintTextData *print_text_data)
+void editor_move_cursor_by_page(ScreenData *screen_data, FileData *file_data, int change)
 {
-	for (int i = 0; i < print_text_data->col_count; i++)
+	// Keys replayed in one go move the cursor farther than the lines laid out around the views
+	size_t page_lines = screen_data->window_size.y;
+	size_t cursor_row = screen_data->cursor_pos.y;
+	fdata_lay_out_rows(file_data, cursor_row > page_lines ? cursor_row - page_lines : 0, 2 * page_lines + 1);
+	size_t visual_row = editor_get_cursor_visual_row(screen_data, file_data);
+	size_t page_size  = screen_data->window_size.y;
+	if (change < 0)
 	{
-		size_t file_row       = print_text_data->data[i].file_row;
-		size_t file_start_col = print_text_data->data[i].file_start_col;
-		size_t file_end_col   = file_start_col + print_text_data->data[i].index;
-		if (screen_data->cursor_pos.y == file_row && is_in_range(file_start_col, screen_data->cursor_pos.x, file_end_col+1))
-		{
-			return (vec2) { .x = screen_data->cursor_pos.x - file_start_col, .y = i };
-		}
+		visual_row = visual_row > page_size ? visual_row - page_size : 0;
+	}
+	else
+	{
+		visual_row += page_size;
 	}
-	throw_up("Couldn't find cursor");
-	return (vec2) {.x = -1, .y = -1};
+	editor_move_cursor_to_line(screen_data, file_data, fdata_find_line_of_visual_row(file_data, screen_data->window_size.x, visual_row));
 }
 
-void editor_render_rows(const FileData *fd, const PrintTextData *print_text_data, const IO_Interface *io_interface)
+void editor_move_cursor_to_line(ScreenData *screen_data, const FileData *file_data, size_t line)
 {
-	for (size_t i = 0; i < print_text_data->col_count; i++)
+	size_t line_size = fdata_get_line_size(file_data, line);
+	screen_data->cursor_pos.y = line;
+	if (screen_data->cursor_pos.x > line_size)
 	{
-		if (print_text_data->data[i].index == -1)
-		{
-			io_interface->render_row(i, 1, "~");
-			continue;
-		}
-		const DynamicBuffer *dbuf = *(DynamicBuffer**)darr_getc(fd->darr, print_text_data->data[i].file_row);
-		const char *row_data      = dbuf_get_with_nulc(dbuf, print_text_data->data[i].file_start_col);
-		size_t row_size           = print_text_data->data[i].index;
-		io_interface->render_row(i, row_size, row_data);
+		screen_data->cursor_pos.x = line_size;
 	}
 }
 
-void editor_update_print_text_data(PrintTextData *print_text_data, const FileData *fd, const ScreenData *sd)
+// Line commands work on the block of lines from the first cursor (or the selection anchor) to the last one
+bool editor_process_line_command(ScreenData *screen_data, FileData *file_data, Clipboard *clipboard, int c)
 {
-	size_t file_row = sd->top_file_row;
-	size_t file_col = 0;
-	for (int i = 0; i < sd->window_size.y; i++)
+	size_t first, count;
+	editor_get_line_block(screen_data, &first, &count);
+	switch (c)
 	{
-		if (file_row >= darr_get_size(fd->darr) && sd->cursor_pos.y != file_row)
-		{
-			print_text_data->data[i] = editor_update_out_of_range_row_data();
-			continue;
-		}
-		if (file_row >= darr_get_size(fd->darr))
-		{
-			print_text_data->data[i] = editor_update_empty_cursor_row_data(fd, file_row);
-			continue;
-		}
-		print_text_data->data[i] = editor_update_normal_row_data(fd, sd, &file_row, &file_col);
+		case DELETE_LINES_KEY:
+			fdata_remove_lines(file_data, first, count, NULL);
+			editor_place_cursor_after_removal(screen_data, file_data, first);
+			return true;
+		case CUT_LINES_KEY:
+			editor_clear_clipboard(clipboard);
+			fdata_remove_lines(file_data, first, count, clipboard->pieces);
+			clipboard->whole_lines = true;
+			editor_place_cursor_after_removal(screen_data, file_data, first);
+			return true;
+		case DUPLICATE_LINES_KEY:
+			// Compressed lines have no handles to share
+			fdata_thaw(file_data, first, count);
+			editor_insert_shared_lines(file_data, first + count, count, file_data->lines->arr + first);
+			editor_shift_cursors(screen_data, count);
+			return true;
+		case MOVE_LINES_UP_KEY:
+			if (first > 0)
+			{
+				fdata_move_lines(file_data, first, count, first - 1);
+				editor_shift_cursors(screen_data, -1);
+			}
+			return true;
+		case MOVE_LINES_DOWN_KEY:
+			if (first + count < fdata_get_line_count(file_data))
+			{
+				fdata_move_lines(file_data, first, count, first + 1);
+				editor_shift_cursors(screen_data, 1);
+			}
+			return true;
 	}
+	return false;
 }
 
-PrintRowData editor_update_normal_row_data(const FileData *fd, const ScreenData *sd, size_t *old_file_row, size_t *old_file_col)
+void editor_get_line_block(const ScreenData *screen_data, size_t *first, size_t *count)
 {
-	size_t file_row = *old_file_row;
-	size_t file_col = *old_file_col;
-	const DynamicBuffer *current_line_data = *(DynamicBuffer **)darr_getc(fd->darr, file_row);
-	size_t row_render_size = dbuf_get_size(current_line_data) - file_col;
-	// Continue printing current file
-	if (row_render_size > sd->window_size.x) 
+	size_t first_row = screen_data->cursor_pos.y;
+	size_t last_row = screen_data->cursor_pos.y;
+	if (screen_data->selection_mode != SELECTION_NONE)
 	{
-		row_render_size = sd->window_size.x;
+		size_t anchor_row = screen_data->selection_anchor.y;
+		first_row = anchor_row < first_row ? anchor_row : first_row;
+		last_row = anchor_row > last_row ? anchor_row : last_row;
 	}
-	PrintRowData res = (PrintRowData) { .index = row_render_size, .file_row = file_row, .file_start_col = file_col };
-	file_col += row_render_size;
-	if (file_col == dbuf_get_size(current_line_data))
+	size_t extra_count = parr_get_size(screen_data->extra_cursors);
+	if (extra_count > 0)
 	{
-		file_row++;
-		file_col = 0;
+		size_t extra_first = parr_get(screen_data->extra_cursors, 0).y;
+		size_t extra_last = parr_get(screen_data->extra_cursors, extra_count - 1).y;
+		first_row = extra_first < first_row ? extra_first : first_row;
+		last_row = extra_last > last_row ? extra_last : last_row;
 	}
-	*old_file_row = file_row;
-	*old_file_col = file_col;
-	return res;
+	*first = first_row;
+	*count = last_row - first_row + 1;
 }
 
-PrintRowData editor_update_out_of_range_row_data()
+// Lines moved as a whole, so the cursors keep their columns
+void editor_shift_cursors(ScreenData *screen_data, int change)
 {
-	return (PrintRowData) { .index = -1, .file_row = -1, .file_start_col = -1 };
+	screen_data->cursor_pos.y += change;
+	screen_data->selection_anchor.y += change;
+	for (size_t i = 0; i < parr_get_size(screen_data->extra_cursors); i++)
+	{
+		parr_get_ptr(screen_data->extra_cursors, i)->y += change;
+	}
 }
 
-PrintRowData editor_update_empty_cursor_row_data(const FileData *fd, size_t last_file_row)
+void editor_place_cursor_after_removal(ScreenData *screen_data, const FileData *file_data, size_t row)
 {
-	const DynamicBuffer *last_line_data = *(DynamicBuffer**)darr_getc(fd->darr, last_file_row);
-	size_t last_line_size = dbuf_get_size(last_line_data);
-	return (PrintRowData) { .index = 0, .file_row = last_file_row, .file_start_col = last_line_size };
+	editor_clear_extra_cursors(screen_data);
+	editor_clear_selection(screen_data);
+	if (row >= fdata_get_line_count(file_data))
+	{
+		row = fdata_get_line_count(file_data) - 1;
+	}
+	screen_data->cursor_pos = (vec2) {.x = 0, .y = row};
 }
 
-int editor_process_tick(Editor *obj)
+// The lines are shared, they are only copied once one of the copies is edited
+void editor_insert_shared_lines(FileData *file_data, size_t row, size_t count, DynamicBuffer *const *lines)
 {
-	int res;
-	int c = obj->io_interface.read_key();
-	if (obj->state == EDITOR_WRITE_STATE)
+	if (count == 0)
 	{
-		res = editor_process_keypress_for_write_state(&obj->screen_data, &obj->file_data, &obj->print_text_data, c);	
+		return;
 	}
-	else if (obj->state == EDITOR_SEARCH_STATE)
+	DynamicBuffer **shared = mem_alloc(MEM_OTHER, count * sizeof(DynamicBuffer *));
+	for (size_t i = 0; i < count; i++)
 	{
-		res = editor_process_keypress_for_search_state(&obj->search_data, &obj->screen_data, &obj->file_data, c);
+		shared[i] = dbuf_share(lines[i]);
 	}
-	adjust_top_file_row(&obj->screen_data, &obj->file_data);
-	editor_update_print_text_data(&obj->print_text_data, &obj->file_data, &obj->screen_data);
-	return editor_process_state_tick_result(&obj->state, res);
+	fdata_insert_lines(file_data, row, count, shared);
+	mem_free(MEM_OTHER, shared, count * sizeof(DynamicBuffer *));
 }
 
-int editor_process_state_tick_result(int* state, int res)
+void editor_clear_clipboard(Clipboard *clipboard)
 {
-	switch (res)
+	for (size_t i = 0; i < larr_get_size(clipboard->pieces); i++)
 	{
-		case TEXT_EDITOR_SWITCH_TO_SEARCH_STATE:
-			*state = EDITOR_SEARCH_STATE;
-			return TEXT_EDITOR_SUCCESSFUL_READ;
-		case TEXT_EDITOR_SWITCH_TO_WRITE_STATE:
-			*state = EDITOR_WRITE_STATE;
-			return TEXT_EDITOR_SUCCESSFUL_READ;
-		case TEXT_EDITOR_EOF:
-			return TEXT_EDITOR_EOF;
+		dbuf_destroy(larr_get(clipboard->pieces, i));
 	}
-	return TEXT_EDITOR_SUCCESSFUL_READ;
+	larr_clear(clipboard->pieces);
 }
 
-int editor_process_keypress_for_search_state(SearchData *search_data, ScreenData *screen_data, const FileData *file_data, int c) 
+bool editor_process_selection_key(ScreenData *screen_data, FileData *file_data, Clipboard *clipboard, int c)
 {
 	switch (c)
 	{
-		case QUIT_KEY:
-			return TEXT_EDITOR_EOF;
-		case NUL:
-			return TEXT_EDITOR_SUCCESSFUL_READ;
-		case CTRL('X'):
-			return TEXT_EDITOR_SWITCH_TO_WRITE_STATE;
-		case BACKSPACE:
-			editor_process_backspace_for_search_state(search_data);
-			return TEXT_EDITOR_SUCCESSFUL_READ;
-		case CARRIAGE_RETURN:
-			editor_process_carriage_return_for_search_state(search_data, screen_data, file_data);
-			return TEXT_EDITOR_SUCCESSFUL_READ;
-		case ARROW_UP:
-			editor_process_arrow_for_search_state(search_data, screen_data, -1);
-			return TEXT_EDITOR_SUCCESSFUL_READ;
-		case ARROW_DOWN:
-			editor_process_arrow_for_search_state(search_data, screen_data, 1);
-			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case MARK_KEY:
+			if (screen_data->selection_mode == SELECTION_NONE)
+			{
+				editor_start_selection(screen_data, SELECTION_MARK);
+			}
+			else
+			{
+				editor_clear_selection(screen_data);
+			}
+			return true;
+		case SHIFT_ARROW_UP:
+		case SHIFT_ARROW_DOWN:
+		case SHIFT_ARROW_LEFT:
+		case SHIFT_ARROW_RIGHT:
+		{
+			if (screen_data->selection_mode == SELECTION_NONE)
+			{
+				editor_start_selection(screen_data, SELECTION_SHIFT);
+			}
+			static const vec2 changes[] = {{.x = 0, .y = -1}, {.x = 0, .y = 1}, {.x = -1, .y = 0}, {.x = 1, .y = 0}};
+			screen_data->cursor_pos = editor_move_cursor(file_data, screen_data->cursor_pos, changes[c - SHIFT_ARROW_UP]);
+			return true;
+		}
+		case COPY_KEY:
+			editor_copy_selection(screen_data, file_data, clipboard);
+			editor_clear_selection(screen_data);
+			return true;
+		case CUT_KEY:
+			editor_copy_selection(screen_data, file_data, clipboard);
+			if (clipboard->whole_lines)
+			{
+				size_t row = screen_data->cursor_pos.y;
+				fdata_remove_lines(file_data, row, 1, NULL);
+				editor_place_cursor_after_removal(screen_data, file_data, row);
+				return true;
+			}
+			editor_delete_selection(screen_data, file_data);
+			return true;
+		case PASTE_KEY:
+		case PASTE_LINES_KEY:
+			editor_delete_selection(screen_data, file_data);
+			editor_paste(screen_data, file_data, clipboard);
+			return true;
 	}
-	if (is_a_printable_character(c))
+	if (screen_data->selection_mode == SELECTION_NONE)
 	{
-		search_data->searched_text[search_data->searched_text_index++] = c;
+		return false;
 	}
-	return TEXT_EDITOR_SUCCESSFUL_READ;
+	// Typing replaces the selection, backspace only deletes it
+	if (c == BACKSPACE || c == CARRIAGE_RETURN || is_a_printable_character(c))
+	{
+		editor_delete_selection(screen_data, file_data);
+		return c == BACKSPACE;
+	}
+	if (c == ESCAPE_KEY)
+	{
+		editor_clear_selection(screen_data);
+		return true;
+	}
+	if (screen_data->selection_mode == SELECTION_SHIFT || !editor_is_movement_key(c))
+	{
+		editor_clear_selection(screen_data);
+	}
+	return false;
 }
 
-void editor_process_backspace_for_search_state(SearchData *search_data)
+void editor_start_selection(ScreenData *screen_data, int mode)
 {
-	if (search_data->searched_text_index > 0)
-	{
-		search_data->searched_text_index--;
-	}
+	editor_clear_extra_cursors(screen_data);
+	screen_data->selection_mode = mode;
+	screen_data->selection_anchor = screen_data->cursor_pos;
 }
 
-void editor_process_carriage_return_for_search_state(SearchData *search_data, ScreenData *screen_data, const FileData *file_data)
+void editor_clear_selection(ScreenData *screen_data)
 {
-	darr_clear(search_data->matches);
-	search_data->match_index = 0;
-	for (int i = 0; i < darr_get_size(file_data->darr); i++)
+	screen_data->selection_mode = SELECTION_NONE;
+}
+
+bool editor_get_selection(const ScreenData *screen_data, vec2 *start, vec2 *end)
+{
+	if (screen_data->selection_mode == SELECTION_NONE)
 	{
-		const DynamicBuffer *current_line = *(const DynamicBuffer**)darr_getc(file_data->darr, i);
-		editor_process_line_matches(search_data, current_line, i);
+		return false;
 	}
-	if (darr_get_size(search_data->matches) == 0)
+	bool anchor_first = fdata_compare_positions(screen_data->selection_anchor, screen_data->cursor_pos) < 0;
+	*start = anchor_first ? screen_data->selection_anchor : screen_data->cursor_pos;
+	*end = anchor_first ? screen_data->cursor_pos : screen_data->selection_anchor;
+	return fdata_compare_positions(*start, *end) != 0;
+}
+
+// Without a selection the cursor line is copied as a whole line
+void editor_copy_selection(const ScreenData *screen_data, const FileData *file_data, Clipboard *clipboard)
+{
+	vec2 start, end;
+	editor_clear_clipboard(clipboard);
+	if (editor_get_selection(screen_data, &start, &end))
 	{
+		fdata_share_range(file_data, start, end, clipboard->pieces);
+		clipboard->whole_lines = false;
 		return;
 	}
-	screen_data->cursor_pos = editor_get_match_pos(search_data);
+	size_t row = screen_data->cursor_pos.y;
+	start = (vec2) {.x = 0, .y = row};
+	end = (vec2) {.x = fdata_get_line_size(file_data, row), .y = row};
+	fdata_share_range(file_data, start, end, clipboard->pieces);
+	clipboard->whole_lines = true;
 }
 
-void editor_process_line_matches(SearchData *search_data, const DynamicBuffer *line, int line_index)
-{		
-	for (int j = 0; j + search_data->searched_text_index <= dbuf_get_size(line); j++)
+void editor_delete_selection(ScreenData *screen_data, FileData *file_data)
+{
+	vec2 start, end;
+	if (editor_get_selection(screen_data, &start, &end))
 	{
-		int res = strncmp(dbuf_getc(line, j), search_data->searched_text, search_data->searched_text_index);
-		if (!res)
-		{
-			darr_add_single(search_data->matches, &((vec2) {.x = j, .y = line_index}));
-		}
+		fdata_delete_range(file_data, start, end);
+		screen_data->cursor_pos = start;
 	}
+	editor_clear_selection(screen_data);
 }
 
-void editor_process_arrow_for_search_state(SearchData *search_data, ScreenData *screen_data, int change)
+void editor_paste(ScreenData *screen_data, FileData *file_data, const Clipboard *clipboard)
 {
-	if (darr_get_size(search_data->matches) == 0)
+	size_t count = larr_get_size(clipboard->pieces);
+	if (count == 0)
 	{
 		return;
 	}
-	editor_change_match_index(search_data, screen_data, change);
-	screen_data->cursor_pos = editor_get_match_pos(search_data);
-}
-
-void editor_change_match_index(SearchData *search_data, ScreenData *screen_data, int change)
-{
-	size_t match_count = darr_get_size(search_data->matches);
-	search_data->match_index = ((search_data->match_index + change) + match_count) % match_count;
+	editor_clear_extra_cursors(screen_data);
+	if (clipboard->whole_lines)
+	{
+		// Pasted above the cursor, the cursor stays on its line
+		editor_insert_shared_lines(file_data, screen_data->cursor_pos.y, count, clipboard->pieces->arr);
+		screen_data->cursor_pos.y += count;
+		return;
+	}
+	screen_data->cursor_pos = fdata_insert_pieces(file_data, screen_data->cursor_pos, count, clipboard->pieces->arr);
 }
 
-vec2 editor_get_match_pos(const SearchData* search_data)
+bool editor_is_movement_key(int c)
 {
-	return *(const vec2*)darr_getc(search_data->matches, search_data->match_index);
+	return c == ARROW_UP || c == ARROW_DOWN || c == ARROW_LEFT || c == ARROW_RIGHT || c == PAGE_UP || c == PAGE_DOWN || c == GOTO_KEY;
 }
 
 int editor_process_keypress_for_write_state(ScreenData *screen_data, FileData *file_data, const PrintTextData *print_text_data, int c)
 {
+	// Typing after the cursor was moved starts a new undo entry even if it ends up in the same place
+	if (!is_a_printable_character(c) && c != BACKSPACE && c != NUL)
+	{
+		fdata_seal_undo(file_data);
+	}
 	switch(c)
 	{
 		case QUIT_KEY:
@@ -340,27 +2722,64 @@ int editor_process_keypress_for_write_state(ScreenData *screen_data, FileData *f
 		case NUL:
 			return TEXT_EDITOR_SUCCESSFUL_READ;
 		case ARROW_UP:
-			screen_data->cursor_pos = editor_move_cursor(file_data, screen_data->cursor_pos, (vec2) {.x = 0, .y = -1});
+			editor_move_cursors(screen_data, file_data, (vec2) {.x = 0, .y = -1});
 			return TEXT_EDITOR_SUCCESSFUL_READ;
 		case ARROW_DOWN:
-			screen_data->cursor_pos = editor_move_cursor(file_data, screen_data->cursor_pos, (vec2) {.x = 0, .y = 1});
+			editor_move_cursors(screen_data, file_data, (vec2) {.x = 0, .y = 1});
 			return TEXT_EDITOR_SUCCESSFUL_READ;
 		case ARROW_LEFT:
-			screen_data->cursor_pos = editor_move_cursor(file_data, screen_data->cursor_pos, (vec2) {.x = -1, .y = 0});
+			editor_move_cursors(screen_data, file_data, (vec2) {.x = -1, .y = 0});
 			return TEXT_EDITOR_SUCCESSFUL_READ;
 		case ARROW_RIGHT:
-			screen_data->cursor_pos = editor_move_cursor(file_data, screen_data->cursor_pos, (vec2) {.x = 1, .y = 0});
+			editor_move_cursors(screen_data, file_data, (vec2) {.x = 1, .y = 0});
 			return TEXT_EDITOR_SUCCESSFUL_READ;
-		case BACKSPACE:
-			process_backspace(screen_data, file_data, print_text_data);
+		case PAGE_UP:
+			editor_clear_extra_cursors(screen_data);
+			editor_move_cursor_by_page(screen_data, file_data, -1);
 			return TEXT_EDITOR_SUCCESSFUL_READ;
-		case CARRIAGE_RETURN:
-			process_carriage_return(screen_data, file_data, print_text_data);
+		case PAGE_DOWN:
+			editor_clear_extra_cursors(screen_data);
+			editor_move_cursor_by_page(screen_data, file_data, 1);
 			return TEXT_EDITOR_SUCCESSFUL_READ;
 		case CTRL('f'):
 			return TEXT_EDITOR_SWITCH_TO_SEARCH_STATE;
+		case GOTO_KEY:
+			editor_clear_extra_cursors(screen_data);
+			return TEXT_EDITOR_SWITCH_TO_GOTO_STATE;
+		case UNDO_KEY:
+			editor_clear_extra_cursors(screen_data);
+			fdata_undo(file_data, &screen_data->cursor_pos);
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case REDO_KEY:
+			editor_clear_extra_cursors(screen_data);
+			fdata_redo(file_data, &screen_data->cursor_pos);
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case ADD_CURSOR_KEY:
+			editor_add_cursor_below(screen_data, file_data);
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case ESCAPE_KEY:
+			editor_clear_extra_cursors(screen_data);
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case MACRO_REPLAY_KEY:
+			return TEXT_EDITOR_SWITCH_TO_MACRO_STATE;
 	}
-	if (is_a_printable_character(c))
+	if (c != BACKSPACE && c != CARRIAGE_RETURN && !is_a_printable_character(c))
+	{
+		return TEXT_EDITOR_SUCCESSFUL_READ;
+	}
+	if (parr_get_size(screen_data->extra_cursors) > 0)
+	{
+		editor_edit_at_all_cursors(screen_data, file_data, c);
+	}
+	else if (c == BACKSPACE)
+	{
+		process_backspace(screen_data, file_data, print_text_data);
+	}
+	else if (c == CARRIAGE_RETURN)
+	{
+		process_carriage_return(screen_data, file_data, print_text_data);
+	}
+	else
 	{
 		process_printable_character(screen_data, file_data, print_text_data, c);
 	}
@@ -377,42 +2796,170 @@ void process_backspace(ScreenData *screen_data, FileData *file_data, const Print
 	{
 		return;
 	}
+	// Reverting the cursor position by one, at the start of a line this goes to the end of the previous line,
+	// so removing the text in between appends the current line to the previous line
+	vec2 end = screen_data->cursor_pos;
 	screen_data->cursor_pos = editor_retreat_cursor(screen_data->cursor_pos, file_data);
-	// If we're at the start of a line (that's not the start of file), we append the current line to the previous line
-	DynamicBuffer *current_row = *(DynamicBuffer**)darr_get(file_data->darr, file_row);
-	if (file_col == 0)
-	{
-		DynamicBuffer *prev_row  = *(DynamicBuffer**)darr_get(file_data->darr, file_row - 1);
-		size_t current_row_size  = dbuf_get_size(current_row);
-		const char *current_row_s = dbuf_get_with_nulc(current_row, 0);
-		dbuf_adds(prev_row, current_row_size, current_row_s);
-		free(current_row);
-		darr_shift_left(file_data->darr, file_row);
-	}
-	// else we remove one character from the line (previous character)
-	else
+	fdata_delete_range(file_data, screen_data->cursor_pos, end);
+}
+
+
+void process_carriage_return(ScreenData *screen_data, FileData *file_data, const PrintTextData *print_text_data)
+{
+	// The text on the right of the cursor moves to a new line
+	screen_data->cursor_pos = fdata_insert_text(file_data, screen_data->cursor_pos, 1, "\n");
+}
+
+void editor_move_cursors(ScreenData *screen_data, const FileData *file_data, vec2 change)
+{
+	screen_data->cursor_pos = editor_move_cursor(file_data, screen_data->cursor_pos, change);
+	size_t count = parr_get_size(screen_data->extra_cursors);
+	if (count == 0)
+	{
+		return;
+	}
+	// Cursors that can't move stay in place, which can change their order, so the set is sorted again
+	vec2 *cursors = screen_data->extra_cursors->arr;
+	for (size_t i = 0; i < count; i++)
+	{
+		cursors[i] = editor_move_cursor(file_data, cursors[i], change);
+	}
+	qsort(cursors, count, sizeof(vec2), editor_compare_cursors);
+	size_t kept = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		bool duplicate = kept > 0 && fdata_compare_positions(cursors[kept-1], cursors[i]) == 0;
+		if (!duplicate && fdata_compare_positions(cursors[i], screen_data->cursor_pos) != 0)
+		{
+			cursors[kept++] = cursors[i];
+		}
+	}
+	parr_remove_multiple(screen_data->extra_cursors, kept, count - kept);
+}
+
+void editor_edit_at_all_cursors(ScreenData *screen_data, FileData *file_data, int c)
+{
+	size_t count = parr_get_size(screen_data->extra_cursors) + 1;
+	vec2 *cursors = mem_alloc(MEM_OTHER, count * sizeof(vec2));
+	Splice *splices = mem_alloc(MEM_OTHER, count * sizeof(Splice));
+	vec2 *ends = mem_alloc(MEM_OTHER, count * sizeof(vec2));
+	size_t primary = editor_collect_cursors(screen_data, cursors);
+	char text = c == CARRIAGE_RETURN ? '\n' : c;
+	// Nothing can be deleted before the start of the file, the cursor there just stays
+	size_t first = c == BACKSPACE && cursors[0].x == 0 && cursors[0].y == 0 ? 1 : 0;
+	for (size_t i = first; i < count; i++)
+	{
+		if (c == BACKSPACE)
+		{
+			splices[i - first] = (Splice) {.start = editor_retreat_cursor(cursors[i], file_data), .end = cursors[i], .size = 0, .text = NULL};
+		}
+		else
+		{
+			splices[i - first] = (Splice) {.start = cursors[i], .end = cursors[i], .size = 1, .text = &text};
+		}
+	}
+	// All the cursors go in as one batch, every affected line is rebuilt once and it's a single undo step
+	if (count > first)
 	{
-		dbuf_shift_left(current_row, file_col - 1); 
+		fdata_apply_splices(file_data, count - first, splices, ends);
 	}
-	// Reverting the cursor position by one
-	return;
+	for (size_t i = first; i < count; i++)
+	{
+		cursors[i] = ends[i - first];
+	}
+	editor_set_cursors(screen_data, cursors, count, primary);
+	mem_free(MEM_OTHER, cursors, count * sizeof(vec2));
+	mem_free(MEM_OTHER, splices, count * sizeof(Splice));
+	mem_free(MEM_OTHER, ends, count * sizeof(vec2));
 }
 
+void editor_add_cursor_below(ScreenData *screen_data, const FileData *file_data)
+{
+	vec2 lowest = screen_data->cursor_pos;
+	size_t count = parr_get_size(screen_data->extra_cursors);
+	if (count > 0 && fdata_compare_positions(parr_get(screen_data->extra_cursors, count - 1), lowest) > 0)
+	{
+		lowest = parr_get(screen_data->extra_cursors, count - 1);
+	}
+	if (lowest.y + 1 >= fdata_get_line_count(file_data))
+	{
+		return;
+	}
+	vec2 cursor = {.x = screen_data->cursor_pos.x, .y = lowest.y + 1};
+	if (cursor.x > fdata_get_line_size(file_data, cursor.y))
+	{
+		cursor.x = fdata_get_line_size(file_data, cursor.y);
+	}
+	parr_add(screen_data->extra_cursors, cursor);
+}
 
-void process_carriage_return(ScreenData *screen_data, FileData *file_data, const PrintTextData *print_text_data)
+void editor_add_cursors_at_matches(const SearchData *search_data, ScreenData *screen_data)
 {
-	size_t file_row = screen_data->cursor_pos.y;
-	size_t file_col = screen_data->cursor_pos.x;
-	// Create new line
-	DynamicBuffer *current_row = *(DynamicBuffer**)darr_get(file_data->darr, file_row);
-	DynamicBuffer *new_row     = dbuf_create();
-	const char *current_row_text_at_cursor_right = dbuf_get_with_nulc(current_row, file_col);
-	size_t current_row_text_at_cursor_right_size = dbuf_get_size(current_row) - file_col;
+	size_t match_count = parr_get_size(search_data->matches);
+	if (match_count == 0)
+	{
+		return;
+	}
+	// Matches are found in order, so they are already sorted
+	editor_set_cursors(screen_data, search_data->matches->arr, match_count, search_data->match_index);
+}
+
+void editor_clear_extra_cursors(ScreenData *screen_data)
+{
+	parr_clear(screen_data->extra_cursors);
+}
+
+size_t editor_collect_cursors(const ScreenData *screen_data, vec2 *cursors)
+{
+	const PositionArray *extra_cursors = screen_data->extra_cursors;
+	size_t primary = editor_find_first_cursor(extra_cursors, screen_data->cursor_pos);
+	memcpy(cursors, extra_cursors->arr, primary * sizeof(vec2));
+	cursors[primary] = screen_data->cursor_pos;
+	memcpy(cursors + primary + 1, extra_cursors->arr + primary, (parr_get_size(extra_cursors) - primary) * sizeof(vec2));
+	return primary;
+}
+
+void editor_set_cursors(ScreenData *screen_data, const vec2 *cursors, size_t count, size_t primary)
+{
+	screen_data->cursor_pos = cursors[primary];
+	parr_clear(screen_data->extra_cursors);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (i == primary || fdata_compare_positions(cursors[i], cursors[primary]) == 0)
+		{
+			continue;
+		}
+		size_t size = parr_get_size(screen_data->extra_cursors);
+		if (size > 0 && fdata_compare_positions(parr_get(screen_data->extra_cursors, size - 1), cursors[i]) == 0)
+		{
+			continue;
+		}
+		parr_add(screen_data->extra_cursors, cursors[i]);
+	}
+}
+
+size_t editor_find_first_cursor(const PositionArray *cursors, vec2 pos)
+{
+	size_t low = 0;
+	size_t high = parr_get_size(cursors);
+	while (low < high)
+	{
+		size_t mid = (low + high) / 2;
+		if (fdata_compare_positions(parr_get(cursors, mid), pos) < 0)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	return low;
+}
 
-	dbuf_adds(new_row, current_row_text_at_cursor_right_size, current_row_text_at_cursor_right);
-	dbuf_popm(current_row, current_row_text_at_cursor_right_size);
-	darr_insert_to(file_data->darr, file_row + 1, &new_row);
-	screen_data->cursor_pos = editor_move_cursor_to_next_line_beginning(screen_data->cursor_pos);
+int editor_compare_cursors(const void *a, const void *b)
+{
+	return fdata_compare_positions(*(const vec2 *)a, *(const vec2 *)b);
 }
 
 vec2 editor_move_cursor_to_next_line_beginning(vec2 cursor_pos)
@@ -424,10 +2971,7 @@ vec2 editor_move_cursor_to_next_line_beginning(vec2 cursor_pos)
 
 void process_printable_character(ScreenData *screen_data, FileData *file_data, const PrintTextData *print_text_data, char c)
 {
-	size_t file_row = screen_data->cursor_pos.y;
-	size_t file_col = screen_data->cursor_pos.x;
-	dbuf_insertc_to(*(DynamicBuffer**)darr_get(file_data->darr, file_row), file_col, c);
-	screen_data->cursor_pos = editor_advance_cursor(screen_data->cursor_pos);
+	screen_data->cursor_pos = fdata_insert_text(file_data, screen_data->cursor_pos, 1, &c);
 }
 
 void adjust_top_file_row(ScreenData *screen_data, const FileData *file_data)
@@ -438,19 +2982,22 @@ void adjust_top_file_row(ScreenData *screen_data, const FileData *file_data)
 		screen_data->top_file_row = screen_data->cursor_pos.y;
 		return;
 	}
-	// Add required lines until we reach cursor file (it will need to contain the entire lines)
-	int lines_needed = 0;
-	for (int i = screen_data->top_file_row; i <= screen_data->cursor_pos.y; i++)
+	// The screen needs to contain every row from the top line until the end of the cursor line
+	size_t width = screen_data->window_size.x;
+	size_t cursor_end_row = fdata_get_visual_rows_before(file_data, width, screen_data->cursor_pos.y + 1);
+	if (cursor_end_row - fdata_get_visual_rows_before(file_data, width, screen_data->top_file_row) <= screen_data->window_size.y)
 	{
-		const DynamicBuffer *current_line = *(const DynamicBuffer**)darr_getc(file_data->darr, i);
-		lines_needed += 1 + (((int)dbuf_get_size(current_line) - 1) / screen_data->window_size.x);
+		return;
 	}
-	for (; lines_needed > screen_data->window_size.y; screen_data->top_file_row++)
+	// First line that starts at or after the first visual row that fits
+	size_t first_row = cursor_end_row - screen_data->window_size.y;
+	size_t top_file_row = fdata_find_line_of_visual_row(file_data, width, first_row);
+	if (fdata_get_visual_rows_before(file_data, width, top_file_row) < first_row)
 	{
-		tassert(screen_data->top_file_row < screen_data->cursor_pos.y, "adjust_top_file_row: cursor line is too big"); 
-		const DynamicBuffer *current_line = *(const DynamicBuffer**)darr_getc(file_data->darr, screen_data->top_file_row);
-		lines_needed -= 1 + (((int)dbuf_get_size(current_line) - 1) / screen_data->window_size.x);
+		top_file_row++;
 	}
+	// A line taller than the view is shown from its start, small views make that easy to run into
+	screen_data->top_file_row = top_file_row <= screen_data->cursor_pos.y ? top_file_row : screen_data->cursor_pos.y;
 }
 
 size_t shift_top_file_row(size_t top_file, int change, size_t file_row_count)
@@ -482,8 +3029,7 @@ vec2 editor_retreat_cursor(vec2 cursor, const FileData *file_data)
 	if (cursor.x == 0)
 	{
 		cursor.y--;
-		DynamicBuffer *current_line = *(DynamicBuffer**)darr_getc(file_data->darr, cursor.y);
-		cursor.x = dbuf_get_size(current_line);
+		cursor.x = fdata_get_line_size(file_data, cursor.y);
 		return cursor;
 	}
 	cursor.x--;
@@ -507,12 +3053,11 @@ vec2 editor_move_cursor(const FileData *file_data, vec2 current_cursor, vec2 cha
 
 bool editor_is_cursor_in_range(const FileData *file_data, vec2 cursor_pos)
 {
-	if (!is_in_range(0, cursor_pos.y, darr_get_size(file_data->darr)))
+	if (!is_in_range(0, cursor_pos.y, fdata_get_line_count(file_data)))
 	{
 		return false;
 	}
-	const DynamicBuffer *cursor_line = *(DynamicBuffer**)darr_getc(file_data->darr, cursor_pos.y);
-	return is_in_range(0, cursor_pos.x, dbuf_get_size(cursor_line) + 1);
+	return is_in_range(0, cursor_pos.x, fdata_get_line_size(file_data, cursor_pos.y) + 1);
 }
 
 bool is_in_range(int l, int i, int r)
@@ -1,10 +1,14 @@
 #pragma once
+#include <stdbool.h>
 #include <stdlib.h>
 #include "definitions.h"
 
+#define CONFLICT_SUFFIX ".conflict" // Added to the name of a file for where a buffer that conflicts with it is saved
+
 typedef struct
 {
 	int (*read_key) ();
+	int (*poll_key) (); // Like read_key, but NUL right away when no key is waiting
 	void (*render_row) (int row_index, size_t row_size, const char *data);
 	void (*flush_output) ();
 	void (*set_cursor_position) (int x, int y);
@@ -18,9 +22,17 @@ typedef struct _editor Editor;
 Editor *editor_create(vec2 window_size, IO_Interface io_interface);
 void editor_destroy(Editor *obj);
 
-void editor_read_file(Editor *obj, const char *filename);
-void editor_write_file(Editor *obj, const char *filename);
+bool editor_read_file(Editor *obj, const char *filename);
+bool editor_open_file(Editor *obj, const char *filename);
+bool editor_write_file(Editor *obj, const char *filename);
+size_t editor_enable_journal(Editor *obj);
+void editor_enable_file_watch(Editor *obj);
+void editor_enable_follow(Editor *obj);
+bool editor_save_all(Editor *obj);
+void editor_set_undo_budget(Editor *obj, size_t budget);
 void editor_clear_screen(const Editor *obj);
-void editor_render_screen(const Editor *obj);
+void editor_render_screen(Editor *obj);
 int editor_process_tick(Editor *obj);
+int editor_apply_keys(Editor *obj, size_t count, const int *keys); // Without rendering, the layout is updated once after the last key
+const char *editor_get_key_operation(const Editor *obj, int c);
 
@@ -1,12 +1,38 @@
 #pragma once
+#include <limits.h>
 #include <stdio.h>
+#include <sys/stat.h>
+#include <time.h>
 #include "definitions.h"
-#include "dynamic_array.h"
 #include "dynamic_buffer.h"
+#include "file_data.h"
+#include "file_watch.h"
+#include "job_scheduler.h"
+#include "typed_array.h"
 #include "editor.h"
 
 #define MX_SEARCH_TEXT_LENGTH 1024
+#define SEARCH_JOB_STEP_LINES 4096 // Lines searched per step of a search job
+#define MX_GOTO_TEXT_LENGTH   32
+#define MX_OVERLAY_LENGTH     256
+#define MX_STATUS_LENGTH      256
+#define MX_REPLAY_TEXT_LENGTH 16
+#define MX_LOADED_BUFFERS     8 // Unmodified buffers beyond this are dropped, least recently shown first
+
+#define MACRO_POLL_INTERVAL_NS 500000000 // How often a running replay shows its progress and checks for a cancel
+#define FOLLOW_INTERVAL_NS     50000000  // Appended lines are taken in at most this often, a fast log doesn't redraw for every line
+#define FOLLOW_BATCH_SIZE      (8 << 20) // Bytes taken in per tick at most, keys still come in while a big backlog is read
+#define COLD_COMPRESS_LINES    16384     // Rows looked at for compression per idle tick, a key that comes in waits for them
+#define RESIZE_SETTLE_NS       100000000 // The lines are all laid out again once the size held this long, dragging a window resizes it many times
+#define LAYOUT_JOB_STEP_LINES  16384     // Lines laid out per step of a layout job
+
+#define SELECTION_NONE  0
+#define SELECTION_MARK  1 // Started with MARK_KEY, stays until it's used or cleared
+#define SELECTION_SHIFT 2 // Started with a shift arrow, a plain arrow clears it
 /* Private data types */
+DEFINE_TYPED_ARRAY(PositionArray, parr, vec2)
+DEFINE_TYPED_ARRAY(KeyArray, karr, int)
+
 typedef struct { 
 	size_t index;
 	size_t file_row;
@@ -23,42 +49,252 @@ typedef struct
 {
 	vec2 window_size;
 	vec2 cursor_pos;
+	PositionArray *extra_cursors; // Sorted and never contains cursor_pos, edits apply to these too
+	int selection_mode;           // There are never extra cursors while there is a selection
+	vec2 selection_anchor;        // The selection is between the anchor and cursor_pos
 	size_t top_file_row;
 } ScreenData;
 
-typedef struct
-{
-	DynamicArray *darr; // Dynamic Array of Dynamic buffers
-} FileData;
-
 typedef struct
 {
 	size_t searched_text_index;
 	size_t match_index;
 	char searched_text[MX_SEARCH_TEXT_LENGTH];
-	DynamicArray *matches;
+	PositionArray *matches;
+	size_t matched_size;      // The text the matches are of, the searched text is changed before the next search
+	char matched_text[MX_SEARCH_TEXT_LENGTH];
+	size_t change_count;      // Of the FileData when the matches were found, they are stale once it moved on
+	size_t line_count;        // Of the FileData when the matches were found
+	size_t job;               // The search that's running, JOB_NONE when there's none
 } SearchData;
 
+typedef struct
+{
+	size_t text_index;
+	char text[MX_GOTO_TEXT_LENGTH];
+} GotoData;
+
+typedef struct
+{
+	LineArray *pieces; // The copied text is the pieces joined with line breaks, whole lines are shared with the file
+	bool whole_lines;  // Pasted as lines above the cursor line instead of at the cursor
+} Clipboard;
+
+typedef struct
+{
+	KeyArray *keys;   // Keys read while recording, without the macro keys themselves
+	KeyArray *typed_keys; // Typed while a replay ran, they are read before the keys that come after them
+	bool recording;
+	size_t count_index;
+	char count_text[MX_REPLAY_TEXT_LENGTH]; // How many times to replay, typed into the replay prompt
+} MacroData;
+
+typedef struct
+{
+	char filename[PATH_MAX]; // Empty for the unnamed buffer
+	char journal_path[PATH_MAX];
+	FileData file_data;      // Only valid while the buffer is loaded
+	bool loaded;
+	vec2 cursor_pos;         // Where the buffer was left, restored when it's shown again
+	size_t top_file_row;
+	size_t last_shown;       // Switch count when the buffer was last shown
+	int watch;               // -1 while the file isn't watched
+	bool changed_on_disk;    // The watch saw a change that wasn't checked yet
+	bool disk_conflict;      // A change on disk overlapped an edit, the buffer isn't saved over the file
+	struct stat disk_state;  // The file as it was last read or written here, its own writes aren't changes
+	int follow_fd;           // -1 while the buffer doesn't follow its file
+	off_t follow_offset;     // Bytes of the file that were taken in
+	bool follow_line_open;   // The last line that was taken in didn't end with a line break yet
+} Buffer;
+
+DEFINE_TYPED_ARRAY(BufferArray, barr, Buffer*)
+
+typedef struct
+{
+	PrintRowData data;
+	bool highlighted; // Drawn with a selection or extra cursors, which can change without the text changing
+} ShownRow;
+
+typedef struct
+{
+	ScreenData screen_data;        // window_size is the size of the view
+	PrintTextData print_text_data;
+	ShownRow *shown_rows;          // What every row showed when it was last drawn
+	vec2 origin;                   // Top left cell of the view on the screen
+	bool redraw;                   // Every row is drawn in the next frame, not only the damaged ones
+} View;
+
+/* Splits tile the screen, every split is either a single view or two splits with a separator between them */
+typedef struct _split
+{
+	struct _split *parent;
+	struct _split *first;  // Above or to the left of second
+	struct _split *second;
+	bool vertical;         // first and second are side by side
+	View *view;            // Only set when the split is a single view
+} Split;
+
+typedef struct
+{
+	vec2 origin;
+	size_t length;
+	bool vertical;
+} Separator;
+
+DEFINE_TYPED_ARRAY(ViewArray, varr, View*)
+DEFINE_TYPED_ARRAY(SeparatorArray, separr, Separator)
+
 typedef struct _editor
 {
 	int state;
-	PrintTextData print_text_data;
-	FileData file_data;
-	ScreenData screen_data;
+	int overlay;
+	vec2 window_size;    // Without the prompt row
+	ViewArray *views;    // Every view shows the current buffer
+	size_t current_view;
+	Split *root_split;
+	SeparatorArray *separators; // Placed with the views
+	bool redraw;         // Every row is drawn in the next frame, separators included
+	bool bar_shown;      // The prompt row showed something in the last frame
+	char status_text[MX_STATUS_LENGTH]; // Last drawn on the prompt row, which shows it when no bar is
+	size_t status_size;
+	ScreenData *screen_data;         // The current view's
+	PrintTextData *print_text_data;  // The current view's
+	FileData *file_data; // The current buffer's
+	BufferArray *buffers;
+	size_t current_buffer;
+	size_t switch_count;
+	bool journaling;
+	FileWatch *file_watch; // Loaded buffers follow changes made to their files while this is set
+	bool following;      // Named buffers take in what's appended to their files, like logs, instead of being watched
+	bool follow_backlog; // The last batch didn't take in everything, so the next one doesn't wait
+	struct timespec followed_at;
+	size_t compressed_buffer; // Buffer whose cold lines were compressed in the last idle tick
+	bool trim_pending;   // Lines were freed by compression since the heap was last trimmed
+	size_t quiet_ticks;  // Idle ticks since lines were last compressed
+	size_t undo_budget;
 	IO_Interface io_interface;
+	JobScheduler *jobs;  // Run between keys, the keys are polled while they wait
+	size_t layout_job;   // Lays out the lines the views don't show at their widths, JOB_NONE when there's none
+	struct timespec resized_at;
 	SearchData search_data;
+	GotoData goto_data;
+	DynamicBuffer *row_buffer; // Rows with extra cursors are rebuilt here with the cursors highlighted
+	Clipboard clipboard;
+	MacroData macro_data;
 } Editor;
 
+/* A search of the whole file, run as a job. The matches are only handed over once every line was searched */
+typedef struct
+{
+	Editor *editor;
+	FileData *file_data;
+	Snapshot *snapshot;  // The lines being searched, the search starts over on a new one when the lines change
+	size_t row;          // Next line to search
+	size_t text_size;
+	char text[MX_SEARCH_TEXT_LENGTH];
+	PositionArray *matches;
+	size_t id;
+} SearchJob;
+
 /* Private function declarations */
 void editor_update_print_text_data(PrintTextData *print_text_data, const FileData *fd, const ScreenData *sd);
 PrintRowData editor_update_out_of_range_row_data();
 PrintRowData editor_update_empty_cursor_row_data(const FileData *fd, size_t last_file_row);
 PrintRowData editor_update_normal_row_data(const FileData *fd, const ScreenData *sd, size_t *old_file_row, size_t *old_file_col);
 
-void editor_render_rows(const FileData *fd, const PrintTextData *print_text_data, const IO_Interface *io_interface);
-
+void editor_render_views(Editor *obj);
+View *editor_find_view_at(const Editor *obj, size_t x, size_t row);
+bool editor_is_screen_row_damaged(const Editor *obj, size_t row);
+bool editor_is_view_row_damaged(const View *view, const FileData *fd, size_t row, bool highlighted);
+bool editor_is_row_highlighted(const ScreenData *sd, const PrintRowData *row_data, size_t *first_cursor);
+size_t editor_render_view_row(const FileData *fd, View *view, size_t row, DynamicBuffer *out);
+size_t editor_render_row_with_selection(const DynamicBuffer *line, const PrintRowData *row_data, vec2 start, vec2 end, size_t width, DynamicBuffer *out);
+size_t editor_render_row_with_cursors(const DynamicBuffer *line, const PrintRowData *row_data, const PositionArray *cursors, size_t first_cursor, size_t width, DynamicBuffer *out);
+
+View *editor_create_view(const ScreenData *screen_data);
+void editor_destroy_view(View *view);
+void editor_place_views(Editor *obj);
+void editor_place_split(Editor *obj, Split *split, vec2 origin, vec2 size);
+void editor_place_view(View *view, vec2 origin, vec2 size);
+Split *editor_create_split(Split *parent, View *view);
+void editor_destroy_split(Split *split);
+Split *editor_find_split(Split *split, const View *view);
+bool editor_process_view_key(Editor *obj, int c);
+bool editor_split_view(Editor *obj, bool vertical);
+void editor_close_view(Editor *obj);
+void editor_switch_view(Editor *obj, size_t index);
+void editor_sync_layouts(const Editor *obj, FileData *file_data);
+void editor_resize(Editor *obj, vec2 window_size);
+vec2 editor_get_min_split_size(const Split *split);
+void editor_lay_out_view_lines(const View *view, FileData *fd);
+void editor_start_layout_job(Editor *obj);
+void editor_finish_layout(Editor *obj);
+bool editor_step_layout(void *state);
+void editor_publish_layout(void *state);
+void editor_destroy_layout(void *state);
+void editor_update_view_layout(View *view, const FileData *fd, bool current);
+void editor_clamp_cursor(ScreenData *screen_data, const FileData *file_data);
+
+void editor_add_buffer(Editor *obj, const char *filename);
+bool editor_load_buffer(Editor *obj, Buffer *buffer);
+void editor_unload_buffer(Editor *obj, Buffer *buffer);
+void editor_switch_buffer(Editor *obj, size_t index);
+void editor_reclaim_buffers(Editor *obj);
+bool editor_read_lines(FileData *file_data, const char *filename);
+bool editor_read_cached_lines(FileData *file_data, const char *filename, uint64_t file_hash, size_t file_size);
+void editor_write_line_cache(const FileData *file_data, const char *filename, uint64_t file_hash, size_t file_size);
+bool editor_write_lines(const FileData *file_data, const char *filename);
+size_t editor_open_journal(Editor *obj, Buffer *buffer);
+void editor_close_journal(Buffer *buffer);
+void editor_watch_buffer(Editor *obj, Buffer *buffer);
+void editor_unwatch_buffer(Editor *obj, Buffer *buffer);
+void editor_note_disk_state(Buffer *buffer);
+bool editor_is_same_disk_state(const struct stat *a, const struct stat *b);
+void editor_check_file_changes(Editor *obj);
+void editor_reload_buffer(Editor *obj, Buffer *buffer);
+void editor_follow_hunks(Editor *obj, Buffer *buffer, const HunkArray *hunks);
+void editor_open_follow(Buffer *buffer);
+void editor_close_follow(Buffer *buffer);
+void editor_compress_cold_lines(Editor *obj);
+void editor_follow_files(Editor *obj);
+bool editor_follow_buffer(Editor *obj, Buffer *buffer);
+bool editor_read_appended(Buffer *buffer, size_t max_size);
+void editor_restart_follow(Editor *obj, Buffer *buffer);
+void editor_scroll_to_appended(Editor *obj, Buffer *buffer, size_t last_row);
+
+int editor_read_key(Editor *obj);
+int editor_process_key(Editor *obj, int c);
+int editor_process_keys(Editor *obj, size_t count, const int *keys);
+bool editor_process_global_key(Editor *obj, int c);
+void editor_update_layout(Editor *obj);
+void editor_render_status_line(Editor *obj, bool redraw);
+void editor_render_overlay(const Editor *obj);
+
+bool editor_process_line_command(ScreenData *screen_data, FileData *file_data, Clipboard *clipboard, int c);
+void editor_get_line_block(const ScreenData *screen_data, size_t *first, size_t *count);
+void editor_shift_cursors(ScreenData *screen_data, int change);
+void editor_place_cursor_after_removal(ScreenData *screen_data, const FileData *file_data, size_t row);
+void editor_insert_shared_lines(FileData *file_data, size_t row, size_t count, DynamicBuffer *const *lines);
+void editor_clear_clipboard(Clipboard *clipboard);
+
+bool editor_process_selection_key(ScreenData *screen_data, FileData *file_data, Clipboard *clipboard, int c);
+void editor_start_selection(ScreenData *screen_data, int mode);
+void editor_clear_selection(ScreenData *screen_data);
+bool editor_get_selection(const ScreenData *screen_data, vec2 *start, vec2 *end);
+void editor_copy_selection(const ScreenData *screen_data, const FileData *file_data, Clipboard *clipboard);
+void editor_delete_selection(ScreenData *screen_data, FileData *file_data);
+void editor_paste(ScreenData *screen_data, FileData *file_data, const Clipboard *clipboard);
+bool editor_is_movement_key(int c);
 int editor_process_keypress_for_write_state(ScreenData *screen_data, FileData *file_data, const PrintTextData *print_text_data, int c);
-int editor_process_keypress_for_search_state(SearchData *search_data, ScreenData *screen_data, const FileData *file_data, int c);
+int editor_process_keypress_for_search_state(Editor *obj, int c);
+int editor_process_keypress_for_goto_state(GotoData *goto_data, ScreenData *screen_data, const FileData *file_data, int c);
+int editor_process_keypress_for_macro_state(Editor *obj, int c);
+
+void editor_record_macro_key(MacroData *macro_data, int c);
+void editor_toggle_macro_recording(MacroData *macro_data);
+size_t editor_get_replay_count(const MacroData *macro_data);
+int editor_replay_macro(Editor *obj, size_t count);
+bool editor_poll_replay_cancel(Editor *obj, size_t done, size_t count);
 
 void adjust_top_file_row(ScreenData *screen_data, const FileData *file_data);
 
@@ -72,9 +308,27 @@ vec2 editor_move_cursor(const FileData *file_data, vec2 current_cursor, vec2 cha
 bool editor_is_cursor_in_range(const FileData *file_data, vec2 cursor_pos);
 
 vec2 editor_advance_cursor(vec2 cursor);
+
+void editor_move_cursors(ScreenData *screen_data, const FileData *file_data, vec2 change);
+void editor_edit_at_all_cursors(ScreenData *screen_data, FileData *file_data, int c);
+void editor_add_cursor_below(ScreenData *screen_data, const FileData *file_data);
+void editor_add_cursors_at_matches(const SearchData *search_data, ScreenData *screen_data);
+void editor_clear_extra_cursors(ScreenData *screen_data);
+size_t editor_collect_cursors(const ScreenData *screen_data, vec2 *cursors);
+void editor_set_cursors(ScreenData *screen_data, const vec2 *cursors, size_t count, size_t primary);
+size_t editor_find_first_cursor(const PositionArray *cursors, vec2 pos);
+int editor_compare_cursors(const void *a, const void *b);
 vec2 editor_retreat_cursor(vec2 cursor, const FileData *file_data);
 
-vec2 get_real_cursor_position(const ScreenData *screen_data, const PrintTextData *file_data);
+vec2 get_real_cursor_position(const ScreenData *screen_data, const FileData *file_data);
+size_t editor_get_cursor_visual_row(const ScreenData *screen_data, const FileData *file_data);
+size_t editor_get_cursor_row_offset(const ScreenData *screen_data);
+
+void editor_move_cursor_by_page(ScreenData *screen_data, FileData *file_data, int change);
+void editor_move_cursor_to_line(ScreenData *screen_data, const FileData *file_data, size_t line);
+
+void editor_process_carriage_return_for_goto_state(GotoData *goto_data, ScreenData *screen_data, const FileData *file_data);
+size_t editor_get_goto_target_line(const GotoData *goto_data, const FileData *file_data, size_t width);
 
 size_t shift_top_file_row(size_t top_file, int change, size_t file_row_count);
 
@@ -88,9 +342,13 @@ bool is_a_printable_character(int c);
 
 int editor_process_state_tick_result(int* state, int res);
 
+void editor_update_stale_matches(Editor *obj);
 void editor_change_match_index(SearchData *search_data, ScreenData *screen_data, int change);
 
-void editor_process_carriage_return_for_search_state(SearchData *search_data, ScreenData *screen_data, const FileData *file_data);
+void editor_process_carriage_return_for_search_state(Editor *obj);
+bool editor_step_search(void *state);
+void editor_publish_search(void *state);
+void editor_destroy_search(void *state);
 
 
 void editor_process_backspace_for_search_state(SearchData *search_data);
@@ -101,6 +359,9 @@ vec2 editor_get_match_pos(const SearchData* search_data);
 void editor_process_arrow_for_search_state(SearchData *search_data, ScreenData *screen_data, int change);
 
 
-void editor_process_line_matches(SearchData *search_data, const DynamicBuffer *line, int line_index);
+void editor_process_line_matches(PositionArray *matches, size_t searched_size, const char *searched_text, size_t size, const char *text, int line_index);
 
-void editor_render_search_bar(const SearchData *search_data, const PrintTextData *print_text_data, const IO_Interface *io_interface);
+void editor_render_search_bar(const SearchData *search_data, int row, const IO_Interface *io_interface);
+void editor_render_goto_bar(const GotoData *goto_data, int row, const IO_Interface *io_interface);
+void editor_render_macro_bar(const MacroData *macro_data, int state, int row, const IO_Interface *io_interface);
+void editor_render_prompt_bar(const char *prefix, size_t text_size, const char *text, int row, const IO_Interface *io_interface);
@@ -0,0 +1,1851 @@
+#include <string.h>
+#include "allocator.h"
+#include "error_handling.h"
+#include "file_data.h"
+#include "hashing.h"
+
+/* Private Function Declarations */
+vec2 fdata_splice_insert(FileData *obj, vec2 pos, size_t size, const char *text);
+void fdata_splice_delete(FileData *obj, vec2 start, vec2 end, DynamicBuffer *removed);
+void fdata_splice_batch(FileData *obj, size_t count, const Splice *splices, vec2 *ends, DynamicBuffer *removed, size_t *removed_sizes);
+size_t fdata_splice_line(FileData *obj, size_t row, size_t new_row, size_t count, const Splice *splices, vec2 *ends, DynamicBuffer *removed, size_t *removed_sizes);
+size_t fdata_count_line_splices(size_t row, size_t count, const Splice *splices);
+void fdata_replace_lines(FileData *obj, size_t row, size_t old_count, LineArray *new_lines);
+void fdata_append_text(LineArray *new_lines, DynamicBuffer **line, size_t size, const char *text);
+void fdata_copy_range(const FileData *obj, vec2 start, vec2 end, DynamicBuffer *out);
+void fdata_apply_history(FileData *obj, size_t count, Splice *ops, vec2 *cursor_pos);
+bool fdata_history_to_batch(size_t count, Splice *ops);
+vec2 fdata_get_text_end(vec2 start, size_t size, const char *text);
+bool fdata_copy_for_undo(FileData *obj, vec2 start, vec2 end);
+size_t fdata_get_range_size(const FileData *obj, vec2 start, vec2 end);
+void fdata_relink_lines(FileData *obj, size_t row, size_t count, size_t to);
+void fdata_record_lines(FileData *obj, int type, size_t row, size_t count);
+void fdata_unlink_lines(FileData *obj, size_t row, size_t count, LineArray *removed);
+void fdata_link_lines(FileData *obj, size_t row, size_t count, DynamicBuffer *const *lines);
+void fdata_apply_line_entry(FileData *obj, const UndoEntry *entry, bool insert, vec2 *cursor_pos);
+size_t fdata_count_line_breaks(size_t size, const char *text);
+bool fdata_note_change(FileData *obj);
+void fdata_journal_insert(FileData *obj, vec2 pos, size_t size, const char *text);
+void fdata_journal_delete(FileData *obj, vec2 start, vec2 end);
+void fdata_journal_splices(FileData *obj, size_t count, const Splice *splices);
+void fdata_journal_lines(FileData *obj, int type, size_t row, size_t count, size_t to);
+void fdata_journal_insert_lines(FileData *obj, size_t row, size_t count, DynamicBuffer *const *lines);
+void fdata_journal_insert_pieces(FileData *obj, vec2 pos, size_t count, DynamicBuffer *const *pieces);
+void fdata_replay_splices(FileData *obj, JournalReader *reader);
+void fdata_replay_insert_lines(FileData *obj, JournalReader *reader);
+LayoutTree *fdata_get_layout(const FileData *obj, size_t width);
+void fdata_insert_row_data(FileData *obj, size_t row, size_t count, const size_t *line_sizes, const uint32_t *line_words);
+void fdata_remove_row_data(FileData *obj, size_t row, size_t count);
+void fdata_insert_stats(FileData *obj, size_t row, size_t count, const size_t *line_sizes, const uint32_t *line_words);
+void fdata_remove_stats(FileData *obj, size_t row, size_t count);
+void fdata_update_stats(FileData *obj, size_t row);
+void fdata_damage_rows(FileData *obj, size_t start, size_t end, bool moved);
+size_t *fdata_split_text(size_t size, const char *text, size_t *line_count);
+void fdata_apply_hunks(FileData *obj, const char *text, const size_t *line_starts, const HunkArray *hunks);
+void fdata_hash_lines(const FileData *obj, LineHashArray *hashes);
+const char *fdata_read_line(void *lines, size_t row, size_t *size);
+bool fdata_is_near_rows(size_t start, size_t end, size_t count, const size_t *rows);
+void fdata_sync_rows(FileData *obj, size_t row, size_t old_count, size_t new_count);
+
+void fdata_init(FileData *obj, size_t width)
+{
+	tassert(obj, "fdata_init: obj is NULL");
+
+	obj->lines = larr_create(MEM_LINES);
+	obj->layouts = lyarr_create(MEM_LAYOUT);
+	lyarr_add(obj->layouts, ltree_create(width));
+	obj->line_stats = lsarr_create(MEM_LAYOUT);
+	obj->text_size = 0;
+	obj->word_count = 0;
+	obj->undo_log = ulog_create(UNDO_DEFAULT_BUDGET);
+	obj->removed_text = dbuf_create(MEM_UNDO);
+	obj->batch_lines = larr_create(MEM_LINES);
+	obj->batch_text = dbuf_create(MEM_LINES);
+	obj->journal = NULL;
+	obj->modified = false;
+	obj->damage_start = SIZE_MAX;
+	obj->damage_end = 0;
+	obj->cold = cold_create();
+	obj->freeze_row = 0;
+	for (size_t i = 0; i < FILE_DATA_EDIT_HISTORY; i++)
+	{
+		obj->edited_rows[i] = SIZE_MAX;
+	}
+	obj->edited_index = 0;
+	obj->change_count = 0;
+	obj->versions = NULL;
+	obj->base_hashes = NULL;
+}
+
+void fdata_destroy(FileData *obj)
+{
+	tassert(obj, "fdata_destroy: obj is NULL");
+
+	snap_drop(obj->versions, obj->cold);
+	for (size_t i = 0; i < larr_get_size(obj->lines); i++)
+	{
+		if (!cold_is_slot(larr_get(obj->lines, i)))
+		{
+			dbuf_destroy(larr_get(obj->lines, i));
+		}
+	}
+	larr_destroy(obj->lines);
+	cold_destroy(obj->cold);
+	for (size_t i = 0; i < lyarr_get_size(obj->layouts); i++)
+	{
+		ltree_destroy(lyarr_get(obj->layouts, i));
+	}
+	lyarr_destroy(obj->layouts);
+	lsarr_destroy(obj->line_stats);
+	ulog_destroy(obj->undo_log);
+	dbuf_destroy(obj->removed_text);
+	larr_destroy(obj->batch_lines);
+	dbuf_destroy(obj->batch_text);
+	if (obj->base_hashes != NULL)
+	{
+		lharr_destroy(obj->base_hashes);
+	}
+}
+
+size_t fdata_get_line_size(const FileData *obj, size_t row)
+{
+	const DynamicBuffer *line = larr_get(obj->lines, row);
+	return cold_is_slot(line) ? cold_get_line_size(obj->cold, line) : dbuf_get_size(line);
+}
+
+void fdata_add_line(FileData *obj, DynamicBuffer *line)
+{
+	tassert(line, "fdata_add_line: line is NULL");
+
+	larr_add(obj->lines, line);
+	fdata_sync_rows(obj, fdata_get_line_count(obj) - 1, 0, 1);
+	for (size_t i = 0; i < lyarr_get_size(obj->layouts); i++)
+	{
+		ltree_add_line(lyarr_get(obj->layouts, i), dbuf_get_size(line));
+	}
+	size_t size = dbuf_get_size(line);
+	fdata_insert_stats(obj, fdata_get_line_count(obj) - 1, 1, &size, NULL);
+	fdata_damage_rows(obj, fdata_get_line_count(obj) - 1, fdata_get_line_count(obj), true);
+}
+
+void fdata_insert_line(FileData *obj, size_t row, DynamicBuffer *line)
+{
+	tassert(line, "fdata_insert_line: line is NULL");
+
+	fdata_thaw(obj, row, 0);
+	larr_insert_to(obj->lines, row, line);
+	fdata_sync_rows(obj, row, 0, 1);
+	for (size_t i = 0; i < lyarr_get_size(obj->layouts); i++)
+	{
+		ltree_insert_line(lyarr_get(obj->layouts, i), row, dbuf_get_size(line));
+	}
+	size_t size = dbuf_get_size(line);
+	fdata_insert_stats(obj, row, 1, &size, NULL);
+	fdata_damage_rows(obj, row, row + 1, true);
+}
+
+void fdata_remove_line(FileData *obj, size_t row)
+{
+	fdata_thaw(obj, row, 1);
+	fdata_touch_rows(obj, row, 1);
+	dbuf_destroy(larr_get(obj->lines, row));
+	larr_remove(obj->lines, row);
+	fdata_sync_rows(obj, row, 1, 0);
+	for (size_t i = 0; i < lyarr_get_size(obj->layouts); i++)
+	{
+		ltree_remove_line(lyarr_get(obj->layouts, i), row);
+	}
+	fdata_remove_stats(obj, row, 1);
+	fdata_damage_rows(obj, row, row, true);
+}
+
+void fdata_line_changed(FileData *obj, size_t row)
+{
+	for (size_t i = 0; i < lyarr_get_size(obj->layouts); i++)
+	{
+		ltree_update_line(lyarr_get(obj->layouts, i), row, fdata_get_line_size(obj, row));
+	}
+	fdata_update_stats(obj, row);
+	fdata_damage_rows(obj, row, row + 1, false);
+}
+
+vec2 fdata_insert_text(FileData *obj, vec2 pos, size_t size, const char *text)
+{
+	vec2 end = fdata_splice_insert(obj, pos, size, text);
+	ulog_record_insert(obj->undo_log, pos, end, size, text);
+	return end;
+}
+
+void fdata_delete_range(FileData *obj, vec2 start, vec2 end)
+{
+	if (end.y - start.y < 2)
+	{
+		bool recorded = fdata_copy_for_undo(obj, start, end);
+		fdata_splice_delete(obj, start, end, NULL);
+		if (recorded)
+		{
+			ulog_record_delete(obj->undo_log, start, end, dbuf_get_size(obj->removed_text), dbuf_get_with_nulc(obj->removed_text, 0));
+		}
+		return;
+	}
+	// Recorded as the removal of the whole lines in between followed by the delete of what is left around them,
+	// so only the partial lines at the ends are copied
+	fdata_thaw(obj, start.y, end.y - start.y + 1);
+	ulog_begin_group(obj->undo_log);
+	fdata_record_lines(obj, UNDO_DELETE_LINES, start.y + 1, end.y - start.y - 1);
+	vec2 first_end = {.x = fdata_get_line_size(obj, start.y), .y = start.y};
+	vec2 last_start = {.x = 0, .y = end.y};
+	bool recorded = fdata_get_range_size(obj, start, first_end) + 1 + end.x <= obj->undo_log->budget;
+	if (recorded)
+	{
+		dbuf_clear(obj->removed_text);
+		fdata_copy_range(obj, start, first_end, obj->removed_text);
+		dbuf_addc(obj->removed_text, '\n');
+		fdata_copy_range(obj, last_start, end, obj->removed_text);
+	}
+	fdata_splice_delete(obj, start, end, NULL);
+	if (recorded)
+	{
+		vec2 joined_end = {.x = end.x, .y = start.y + 1};
+		ulog_record_delete(obj->undo_log, start, joined_end, dbuf_get_size(obj->removed_text), dbuf_get_with_nulc(obj->removed_text, 0));
+	}
+	else
+	{
+		ulog_drop_history(obj->undo_log);
+	}
+	ulog_end_group(obj->undo_log);
+}
+
+void fdata_apply_splices(FileData *obj, size_t count, const Splice *splices, vec2 *ends)
+{
+	tassert(count > 0, "fdata_apply_splices: no splices");
+
+	size_t *removed_sizes = mem_alloc(MEM_UNDO, count * sizeof(size_t));
+	dbuf_clear(obj->removed_text);
+	fdata_splice_batch(obj, count, splices, ends, obj->removed_text, removed_sizes);
+	// Recorded bottom up, so that every entry's position is still valid when the entries are replayed one by one
+	size_t removed_end = dbuf_get_size(obj->removed_text);
+	ulog_begin_group(obj->undo_log);
+	for (size_t i = count; i > 0; i--)
+	{
+		const Splice *splice = &splices[i-1];
+		removed_end -= removed_sizes[i-1];
+		ulog_record_delete(obj->undo_log, splice->start, splice->end, removed_sizes[i-1], dbuf_get_with_nulc(obj->removed_text, removed_end));
+		ulog_record_insert(obj->undo_log, splice->start, fdata_get_text_end(splice->start, splice->size, splice->text), splice->size, splice->text);
+	}
+	ulog_end_group(obj->undo_log);
+	mem_free(MEM_UNDO, removed_sizes, count * sizeof(size_t));
+}
+
+// Whole line commands only move handles, the bytes of the lines are never copied, not even by the undo log
+void fdata_remove_lines(FileData *obj, size_t row, size_t count, LineArray *removed)
+{
+	tassert(count > 0 && row + count <= fdata_get_line_count(obj), "fdata_remove_lines: rows are out of range");
+
+	ulog_begin_group(obj->undo_log);
+	// The file always has a line to put the cursor on. It goes in before the others leave, so that replaying the
+	// journal or the undo log never runs out of lines either
+	if (count == fdata_get_line_count(obj))
+	{
+		DynamicBuffer *line = dbuf_create(MEM_LINES);
+		fdata_insert_lines(obj, count, 1, &line);
+	}
+	fdata_thaw(obj, row, count);
+	fdata_record_lines(obj, UNDO_DELETE_LINES, row, count);
+	fdata_unlink_lines(obj, row, count, removed);
+	ulog_end_group(obj->undo_log);
+}
+
+void fdata_unlink_lines(FileData *obj, size_t row, size_t count, LineArray *removed)
+{
+	fdata_journal_lines(obj, JOURNAL_REMOVE_LINES, row, count, 0);
+	fdata_thaw(obj, row, count);
+	fdata_touch_rows(obj, row, count);
+	if (removed != NULL)
+	{
+		larr_add_multiple(removed, count, larr_getc(obj->lines, row));
+	}
+	else
+	{
+		for (size_t i = row; i < row + count; i++)
+		{
+			dbuf_destroy(larr_get(obj->lines, i));
+		}
+	}
+	larr_remove_multiple(obj->lines, row, count);
+	fdata_sync_rows(obj, row, count, 0);
+	fdata_remove_row_data(obj, row, count);
+}
+
+void fdata_insert_lines(FileData *obj, size_t row, size_t count, DynamicBuffer *const *lines)
+{
+	tassert(row <= fdata_get_line_count(obj), "fdata_insert_lines: row is out of range");
+
+	if (count == 0)
+	{
+		return;
+	}
+	fdata_link_lines(obj, row, count, lines);
+	fdata_record_lines(obj, UNDO_INSERT_LINES, row, count);
+}
+
+void fdata_link_lines(FileData *obj, size_t row, size_t count, DynamicBuffer *const *lines)
+{
+	fdata_journal_insert_lines(obj, row, count, lines);
+	fdata_thaw(obj, row, 0);
+	larr_insert_multiple(obj->lines, row, count, lines);
+	fdata_sync_rows(obj, row, 0, count);
+	size_t *line_sizes = mem_alloc(MEM_LAYOUT, count * sizeof(size_t));
+	for (size_t i = 0; i < count; i++)
+	{
+		line_sizes[i] = dbuf_get_size(lines[i]);
+	}
+	fdata_insert_row_data(obj, row, count, line_sizes, NULL);
+	mem_free(MEM_LAYOUT, line_sizes, count * sizeof(size_t));
+}
+
+void fdata_move_lines(FileData *obj, size_t row, size_t count, size_t to)
+{
+	fdata_relink_lines(obj, row, count, to);
+	ulog_record_move(obj->undo_log, row, count, to);
+}
+
+// Whole lines of the range are shared, only the partial lines at its ends and compressed lines are copied
+void fdata_share_range(const FileData *obj, vec2 start, vec2 end, LineArray *pieces)
+{
+	for (size_t row = start.y; row <= (size_t)end.y; row++)
+	{
+		DynamicBuffer *line = larr_get(obj->lines, row);
+		size_t size;
+		const char *text = fdata_get_line_text(obj, row, &size);
+		size_t from = row == (size_t)start.y ? start.x : 0;
+		size_t to = row == (size_t)end.y ? end.x : size;
+		if (from == 0 && to == size && !cold_is_slot(line))
+		{
+			larr_add(pieces, dbuf_share(line));
+			continue;
+		}
+		DynamicBuffer *piece = dbuf_create(MEM_LINES);
+		dbuf_adds(piece, to - from, text + from);
+		larr_add(pieces, piece);
+	}
+}
+
+// Inserts the text made of pieces joined by line breaks, pieces in the middle become lines of the file as they are
+vec2 fdata_insert_pieces(FileData *obj, vec2 pos, size_t count, DynamicBuffer *const *pieces)
+{
+	tassert(count > 0, "fdata_insert_pieces: no pieces");
+
+	if (count == 1)
+	{
+		return fdata_insert_text(obj, pos, dbuf_get_size(pieces[0]), dbuf_get_with_nulc(pieces[0], 0));
+	}
+	fdata_journal_insert_pieces(obj, pos, count, pieces);
+	fdata_thaw(obj, pos.y, 1);
+	DynamicBuffer *line = fdata_get_line_mut(obj, pos.y);
+	size_t new_count = count - 1;
+	DynamicBuffer **new_lines = mem_alloc(MEM_LINES, new_count * sizeof(DynamicBuffer *));
+	size_t *new_line_sizes = mem_alloc(MEM_LAYOUT, new_count * sizeof(size_t));
+	for (size_t i = 1; i < count; i++)
+	{
+		new_lines[i-1] = dbuf_share(pieces[i]);
+	}
+	vec2 end = {.x = dbuf_get_size(pieces[count-1]), .y = pos.y + new_count};
+	// The text after pos goes after the last piece, which needs its own copy for that
+	if ((size_t)pos.x < dbuf_get_size(line))
+	{
+		DynamicBuffer *last = dbuf_clone(pieces[count-1]);
+		dbuf_adds(last, dbuf_get_size(line) - pos.x, dbuf_get_with_nulc(line, pos.x));
+		dbuf_destroy(new_lines[new_count-1]);
+		new_lines[new_count-1] = last;
+	}
+	dbuf_truncate(line, pos.x);
+	dbuf_adds(line, dbuf_get_size(pieces[0]), dbuf_get_with_nulc(pieces[0], 0));
+	fdata_line_changed(obj, pos.y);
+	for (size_t i = 0; i < new_count; i++)
+	{
+		new_line_sizes[i] = dbuf_get_size(new_lines[i]);
+	}
+	larr_insert_multiple(obj->lines, pos.y + 1, new_count, new_lines);
+	fdata_sync_rows(obj, pos.y + 1, 0, new_count);
+	fdata_insert_row_data(obj, pos.y + 1, new_count, new_line_sizes, NULL);
+	mem_free(MEM_LINES, new_lines, new_count * sizeof(DynamicBuffer *));
+	mem_free(MEM_LAYOUT, new_line_sizes, new_count * sizeof(size_t));
+	// Recorded as a line break at pos, the first and last pieces typed around it and the lines in between put in as
+	// they are, so only the first and last pieces are copied
+	const DynamicBuffer *first = pieces[0];
+	const DynamicBuffer *last = pieces[count-1];
+	vec2 first_end = {.x = pos.x + dbuf_get_size(first), .y = pos.y};
+	vec2 last_start = {.x = 0, .y = pos.y + 1};
+	vec2 last_end = {.x = dbuf_get_size(last), .y = pos.y + 1};
+	ulog_begin_group(obj->undo_log);
+	ulog_record_insert(obj->undo_log, pos, last_start, 1, "\n");
+	ulog_record_insert(obj->undo_log, pos, first_end, dbuf_get_size(first), dbuf_get_with_nulc(first, 0));
+	ulog_record_insert(obj->undo_log, last_start, last_end, dbuf_get_size(last), dbuf_get_with_nulc(last, 0));
+	fdata_record_lines(obj, UNDO_INSERT_LINES, pos.y + 1, new_count - 1);
+	ulog_end_group(obj->undo_log);
+	return end;
+}
+
+void fdata_unshare_line(FileData *obj, size_t row)
+{
+	DynamicBuffer *line = larr_get(obj->lines, row);
+	larr_set(obj->lines, row, dbuf_clone(line));
+	fdata_sync_rows(obj, row, 1, 1);
+	dbuf_destroy(line);
+}
+
+bool fdata_undo(FileData *obj, vec2 *cursor_pos)
+{
+	const UndoEntry *entries;
+	size_t count = ulog_undo(obj->undo_log, &entries);
+	if (count == 0)
+	{
+		return false;
+	}
+	if (entries[0].type == UNDO_MOVE_LINES)
+	{
+		fdata_relink_lines(obj, entries[0].end.y, entries[0].line_count, entries[0].start.y);
+		*cursor_pos = entries[0].start;
+		return true;
+	}
+	// Newest first, each entry is undone on the text it left behind
+	Splice *ops = mem_alloc(MEM_UNDO, count * sizeof(Splice));
+	size_t op_count = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const UndoEntry *entry = &entries[count - 1 - i];
+		if (entry->type == UNDO_INSERT_LINES || entry->type == UNDO_DELETE_LINES)
+		{
+			// The text entries before a line entry go first, they were recorded after it
+			fdata_apply_history(obj, op_count, ops, cursor_pos);
+			op_count = 0;
+			fdata_apply_line_entry(obj, entry, entry->type == UNDO_DELETE_LINES, cursor_pos);
+		}
+		else if (entry->type == UNDO_INSERT)
+		{
+			ops[op_count++] = (Splice) {.start = entry->start, .end = entry->end, .size = 0, .text = NULL};
+		}
+		else
+		{
+			ops[op_count++] = (Splice) {.start = entry->start, .end = entry->start, .size = entry->text_size, .text = ulog_get_text(obj->undo_log, entry)};
+		}
+	}
+	fdata_apply_history(obj, op_count, ops, cursor_pos);
+	mem_free(MEM_UNDO, ops, count * sizeof(Splice));
+	return true;
+}
+
+bool fdata_redo(FileData *obj, vec2 *cursor_pos)
+{
+	const UndoEntry *entries;
+	size_t count = ulog_redo(obj->undo_log, &entries);
+	if (count == 0)
+	{
+		return false;
+	}
+	if (entries[0].type == UNDO_MOVE_LINES)
+	{
+		fdata_relink_lines(obj, entries[0].start.y, entries[0].line_count, entries[0].end.y);
+		*cursor_pos = entries[0].end;
+		return true;
+	}
+	Splice *ops = mem_alloc(MEM_UNDO, count * sizeof(Splice));
+	size_t op_count = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const UndoEntry *entry = &entries[i];
+		if (entry->type == UNDO_INSERT_LINES || entry->type == UNDO_DELETE_LINES)
+		{
+			fdata_apply_history(obj, op_count, ops, cursor_pos);
+			op_count = 0;
+			fdata_apply_line_entry(obj, entry, entry->type == UNDO_INSERT_LINES, cursor_pos);
+		}
+		else if (entry->type == UNDO_INSERT)
+		{
+			ops[op_count++] = (Splice) {.start = entry->start, .end = entry->start, .size = entry->text_size, .text = ulog_get_text(obj->undo_log, entry)};
+		}
+		else
+		{
+			ops[op_count++] = (Splice) {.start = entry->start, .end = entry->end, .size = 0, .text = NULL};
+		}
+	}
+	fdata_apply_history(obj, op_count, ops, cursor_pos);
+	mem_free(MEM_UNDO, ops, count * sizeof(Splice));
+	return true;
+}
+
+void fdata_seal_undo(FileData *obj)
+{
+	ulog_seal(obj->undo_log);
+}
+
+void fdata_begin_undo_group(FileData *obj)
+{
+	ulog_begin_group(obj->undo_log);
+}
+
+void fdata_end_undo_group(FileData *obj)
+{
+	ulog_end_group(obj->undo_log);
+}
+
+// Applies the edits of a journal that was left behind, they start a new history and aren't journaled again
+size_t fdata_replay_journal(FileData *obj, JournalReader *reader)
+{
+	tassert(obj->journal == NULL, "fdata_replay_journal: the edits would be journaled again");
+
+	size_t count = 0;
+	int type;
+	while (jrnl_next_record(reader, &type))
+	{
+		switch (type)
+		{
+			case JOURNAL_INSERT:
+			{
+				vec2 pos = jrnl_read_position(reader);
+				size_t size;
+				const char *text = jrnl_read_text(reader, &size);
+				fdata_splice_insert(obj, pos, size, text);
+				break;
+			}
+			case JOURNAL_DELETE:
+			{
+				vec2 start = jrnl_read_position(reader);
+				vec2 end = jrnl_read_position(reader);
+				fdata_splice_delete(obj, start, end, NULL);
+				break;
+			}
+			case JOURNAL_SPLICES:
+				fdata_replay_splices(obj, reader);
+				break;
+			case JOURNAL_MOVE_LINES:
+			{
+				size_t row = jrnl_read_number(reader);
+				size_t line_count = jrnl_read_number(reader);
+				fdata_relink_lines(obj, row, line_count, jrnl_read_number(reader));
+				break;
+			}
+			case JOURNAL_REMOVE_LINES:
+			{
+				size_t row = jrnl_read_number(reader);
+				fdata_remove_lines(obj, row, jrnl_read_number(reader), NULL);
+				break;
+			}
+			case JOURNAL_INSERT_LINES:
+				fdata_replay_insert_lines(obj, reader);
+				break;
+			default:
+				throw_up("fdata_replay_journal: unknown record type");
+		}
+		count++;
+	}
+	ulog_clear(obj->undo_log);
+	return count;
+}
+
+// Makes the lines those of text with as few line changes as it can, the lines that are the same aren't touched
+void fdata_patch_lines(FileData *obj, size_t size, const char *text, HunkArray *hunks)
+{
+	size_t new_line_count;
+	size_t *line_starts = fdata_split_text(size, text, &new_line_count);
+	TextLines text_lines = {.text = text, .line_starts = line_starts};
+	LineSource lines = fdata_get_line_source(obj);
+	LineSource new_lines = ldiff_text_source(&text_lines, new_line_count);
+	ldiff_find_hunks(&lines, &new_lines, hunks);
+	fdata_apply_hunks(obj, text, line_starts, hunks);
+	mem_free(MEM_OTHER, line_starts, (new_line_count + 1) * sizeof(size_t));
+}
+
+// Takes in the changes the text made to the base that don't overlap the changes made to the lines since then, a change
+// made the same way on both sides is only there once. hunks are the changes that were taken in, own_hunks go from the
+// rows of the text to the lines that still differ from it, and the text is the base from then on. Returns how many
+// changes of the text overlap changes of the lines, the lines keep their own
+size_t fdata_merge_lines(FileData *obj, size_t size, const char *text, HunkArray *hunks, HunkArray *own_hunks)
+{
+	tassert(obj->base_hashes != NULL && obj->modified, "fdata_merge_lines: the lines have no base");
+
+	size_t new_line_count;
+	size_t *line_starts = fdata_split_text(size, text, &new_line_count);
+	TextLines text_lines = {.text = text, .line_starts = line_starts};
+	LineSource base_lines = ldiff_hash_source(obj->base_hashes->arr, lharr_get_size(obj->base_hashes));
+	LineSource lines = fdata_get_line_source(obj);
+	LineSource new_lines = ldiff_text_source(&text_lines, new_line_count);
+	HunkArray *their_hunks = harr_create(MEM_OTHER);
+	ldiff_find_hunks(&base_lines, &new_lines, their_hunks);
+	ldiff_find_hunks(&base_lines, &lines, own_hunks);
+	harr_clear(hunks);
+	size_t conflicts = 0;
+	size_t first_own = 0;
+	for (size_t i = 0; i < harr_get_size(their_hunks); i++)
+	{
+		const LineHunk *theirs = harr_getc(their_hunks, i);
+		// Both are in order, own hunks that end before this one end before the ones after it too
+		while (first_own < harr_get_size(own_hunks) && harr_getc(own_hunks, first_own)->row + harr_getc(own_hunks, first_own)->old_count < theirs->row)
+		{
+			first_own++;
+		}
+		bool overlaps = false;
+		bool same = false;
+		for (size_t j = first_own; j < harr_get_size(own_hunks) && harr_getc(own_hunks, j)->row <= theirs->row + theirs->old_count && !overlaps; j++)
+		{
+			const LineHunk *own = harr_getc(own_hunks, j);
+			overlaps = ldiff_hunks_overlap(theirs, own);
+			same = overlaps && ldiff_is_same_change(&new_lines, theirs, &lines, own);
+		}
+		if (overlaps)
+		{
+			conflicts += !same;
+			continue;
+		}
+		// The hunk goes where its rows are in the lines, new_row stays the row of the text until it's applied
+		harr_add(hunks, (LineHunk) {.row = fdata_map_row(own_hunks, theirs->row), .old_count = theirs->old_count, .new_row = theirs->new_row, .new_count = theirs->new_count});
+	}
+	harr_destroy(their_hunks);
+	fdata_apply_hunks(obj, text, line_starts, hunks);
+	// Like those of a patch, new_row is where the lines of a hunk ended up
+	long long shift = 0;
+	for (size_t i = 0; i < harr_get_size(hunks); i++)
+	{
+		LineHunk *hunk = harr_get_ptr(hunks, i);
+		hunk->new_row = hunk->row + shift;
+		shift += (long long)hunk->new_count - (long long)hunk->old_count;
+	}
+	lines = fdata_get_line_source(obj);
+	ldiff_find_hunks(&new_lines, &lines, own_hunks);
+	lharr_clear(obj->base_hashes);
+	for (size_t i = 0; i < new_line_count; i++)
+	{
+		lharr_add(obj->base_hashes, ldiff_get_line_hash(&new_lines, i));
+	}
+	mem_free(MEM_OTHER, line_starts, (new_line_count + 1) * sizeof(size_t));
+	return conflicts;
+}
+
+// Bottom up, so the rows of the hunks above stay where they were. The new lines are the rows of the text at new_row
+void fdata_apply_hunks(FileData *obj, const char *text, const size_t *line_starts, const HunkArray *hunks)
+{
+	fdata_seal_undo(obj);
+	fdata_begin_undo_group(obj);
+	for (size_t i = harr_get_size(hunks); i-- > 0;)
+	{
+		const LineHunk *hunk = harr_getc(hunks, i);
+		// Lines that are only changed keep their place in the layouts, which is much cheaper than moving the lines after them
+		size_t changed_count = hunk->old_count < hunk->new_count ? hunk->old_count : hunk->new_count;
+		for (size_t j = 0; j < changed_count; j++)
+		{
+			size_t row = hunk->row + j;
+			size_t start = line_starts[hunk->new_row + j];
+			size_t size = line_starts[hunk->new_row + j + 1] - 1 - start;
+			if (fdata_get_line_size(obj, row) > 0)
+			{
+				fdata_delete_range(obj, (vec2) {.x = 0, .y = row}, (vec2) {.x = fdata_get_line_size(obj, row), .y = row});
+			}
+			fdata_insert_text(obj, (vec2) {.x = 0, .y = row}, size, text + start);
+		}
+		if (hunk->new_count > changed_count)
+		{
+			size_t count = hunk->new_count - changed_count;
+			DynamicBuffer **lines = mem_alloc(MEM_LINES, count * sizeof(DynamicBuffer*));
+			for (size_t j = 0; j < count; j++)
+			{
+				size_t start = line_starts[hunk->new_row + changed_count + j];
+				lines[j] = dbuf_create(MEM_LINES);
+				dbuf_adds(lines[j], line_starts[hunk->new_row + changed_count + j + 1] - 1 - start, text + start);
+			}
+			fdata_insert_lines(obj, hunk->row + changed_count, count, lines);
+			mem_free(MEM_LINES, lines, count * sizeof(DynamicBuffer*));
+		}
+		if (hunk->old_count > changed_count)
+		{
+			fdata_remove_lines(obj, hunk->row + changed_count, hunk->old_count - changed_count, NULL);
+		}
+	}
+	fdata_end_undo_group(obj);
+	fdata_seal_undo(obj);
+}
+
+// Where a row before the patch is after it, rows of a changed block go to the block that replaced it
+size_t fdata_map_row(const HunkArray *hunks, size_t row)
+{
+	size_t new_row = row;
+	for (size_t i = 0; i < harr_get_size(hunks) && harr_getc(hunks, i)->row <= row; i++)
+	{
+		const LineHunk *hunk = harr_getc(hunks, i);
+		if (row < hunk->row + hunk->old_count)
+		{
+			size_t offset = row - hunk->row;
+			return hunk->new_row + (offset < hunk->new_count ? offset : (hunk->new_count > 0 ? hunk->new_count - 1 : 0));
+		}
+		new_row = hunk->new_row + hunk->new_count + row - hunk->row - hunk->old_count;
+	}
+	return new_row;
+}
+
+// Text that was added to the end of the file, like the lines of a growing log. It isn't an edit, so it's neither recorded
+// for undo nor journaled. line_open tells whether the last line is still waiting for its line break
+void fdata_append_lines(FileData *obj, size_t size, const char *text, bool *line_open)
+{
+	size_t offset = 0;
+	if (*line_open && fdata_get_line_count(obj) > 0)
+	{
+		const char *line_break = memchr(text, '\n', size);
+		size_t line_size = line_break == NULL ? size : (size_t)(line_break - text);
+		size_t row = fdata_get_line_count(obj) - 1;
+		if (line_size > 0)
+		{
+			dbuf_adds(fdata_get_line_mut(obj, row), line_size, text);
+			fdata_line_changed(obj, row);
+		}
+		if (line_break == NULL)
+		{
+			return;
+		}
+		offset = line_size + 1;
+		*line_open = false;
+	}
+	// The new lines go into the layouts together, which costs as much as rebuilding only their part of the layouts
+	LineArray *new_lines = obj->batch_lines;
+	while (offset < size)
+	{
+		const char *line_break = memchr(text + offset, '\n', size - offset);
+		size_t line_size = line_break == NULL ? size - offset : (size_t)(line_break - (text + offset));
+		DynamicBuffer *line = dbuf_create(MEM_LINES);
+		dbuf_adds(line, line_size, text + offset);
+		larr_add(new_lines, line);
+		offset += line_size + 1;
+		*line_open = line_break == NULL;
+	}
+	size_t count = larr_get_size(new_lines);
+	if (count == 0)
+	{
+		return;
+	}
+	size_t row = fdata_get_line_count(obj);
+	larr_add_multiple(obj->lines, count, larr_get_ptr(new_lines, 0));
+	fdata_sync_rows(obj, row, 0, count);
+	size_t *line_sizes = mem_alloc(MEM_LAYOUT, count * sizeof(size_t));
+	for (size_t i = 0; i < count; i++)
+	{
+		line_sizes[i] = dbuf_get_size(larr_get(new_lines, i));
+	}
+	fdata_insert_row_data(obj, row, count, line_sizes, NULL);
+	mem_free(MEM_LAYOUT, line_sizes, count * sizeof(size_t));
+	larr_clear(new_lines);
+}
+
+// Views of the same width share a layout, layouts of widths that aren't listed anymore are dropped.
+// A layout that isn't used anymore is taken for a new width instead, its rows are estimates until
+// the lines are laid out again with fdata_lay_out_rows or fdata_lay_out_more, so a resize is O(1) here
+void fdata_set_layout_widths(FileData *obj, size_t count, const size_t *widths)
+{
+	tassert(count > 0, "fdata_set_layout_widths: no widths");
+
+	size_t layout_count = lyarr_get_size(obj->layouts);
+	bool used[layout_count];
+	for (size_t j = 0; j < layout_count; j++)
+	{
+		used[j] = false;
+		for (size_t i = 0; i < count && !used[j]; i++)
+		{
+			used[j] = widths[i] == lyarr_get(obj->layouts, j)->width;
+		}
+	}
+	size_t line_count = fdata_get_line_count(obj);
+	size_t unused = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		bool found = false;
+		for (size_t j = 0; j < lyarr_get_size(obj->layouts) && !found; j++)
+		{
+			found = widths[i] == lyarr_get(obj->layouts, j)->width;
+		}
+		if (found)
+		{
+			continue;
+		}
+		for (; unused < layout_count && used[unused]; unused++);
+		if (unused < layout_count)
+		{
+			ltree_set_width(lyarr_get(obj->layouts, unused), widths[i]);
+			used[unused] = true;
+			continue;
+		}
+		LayoutTree *layout = ltree_create(widths[i]);
+		lyarr_add(obj->layouts, layout);
+		if (line_count == 0)
+		{
+			continue;
+		}
+		size_t *line_sizes = mem_alloc(MEM_LAYOUT, line_count * sizeof(size_t));
+		for (size_t row = 0; row < line_count; row++)
+		{
+			line_sizes[row] = fdata_get_line_size(obj, row);
+		}
+		ltree_insert_lines(layout, 0, line_count, line_sizes);
+		mem_free(MEM_LAYOUT, line_sizes, line_count * sizeof(size_t));
+	}
+	for (size_t j = layout_count; j-- > 0;)
+	{
+		if (!used[j])
+		{
+			ltree_destroy(lyarr_get(obj->layouts, j));
+			lyarr_remove(obj->layouts, j);
+		}
+	}
+}
+
+bool fdata_is_laid_out(const FileData *obj)
+{
+	for (size_t i = 0; i < lyarr_get_size(obj->layouts); i++)
+	{
+		const LayoutTree *layout = lyarr_get(obj->layouts, i);
+		if (ltree_get_exact_length(layout) < ltree_get_size(layout))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// The visual rows between two lines are exact once every line between them is laid out, whatever is before them
+void fdata_lay_out_rows(FileData *obj, size_t row, size_t count)
+{
+	size_t line_count = fdata_get_line_count(obj);
+	size_t end = row + count < line_count ? row + count : line_count;
+	for (size_t i = 0; i < lyarr_get_size(obj->layouts); i++)
+	{
+		LayoutTree *layout = lyarr_get(obj->layouts, i);
+		if (ltree_get_exact_length(layout) >= end)
+		{
+			continue;
+		}
+		for (size_t r = row; r < end; r++)
+		{
+			ltree_update_line(layout, r, fdata_get_line_size(obj, r));
+		}
+	}
+}
+
+// Lays out up to count lines after the exact ones of every layout, true once every line is laid out
+bool fdata_lay_out_more(FileData *obj, size_t count)
+{
+	size_t line_sizes[FILE_DATA_LAYOUT_STEP];
+	for (size_t i = 0; i < lyarr_get_size(obj->layouts); i++)
+	{
+		LayoutTree *layout = lyarr_get(obj->layouts, i);
+		size_t left = count;
+		while (left > 0 && ltree_get_exact_length(layout) < ltree_get_size(layout))
+		{
+			size_t row = ltree_get_exact_length(layout);
+			size_t step = ltree_get_size(layout) - row;
+			step = step < left ? step : left;
+			step = step < FILE_DATA_LAYOUT_STEP ? step : FILE_DATA_LAYOUT_STEP;
+			for (size_t j = 0; j < step; j++)
+			{
+				line_sizes[j] = fdata_get_line_size(obj, row + j);
+			}
+			ltree_update_lines(layout, row, step, line_sizes);
+			left -= step;
+		}
+	}
+	return fdata_is_laid_out(obj);
+}
+
+LayoutTree *fdata_get_layout(const FileData *obj, size_t width)
+{
+	for (size_t i = 0; i < lyarr_get_size(obj->layouts); i++)
+	{
+		if (lyarr_get(obj->layouts, i)->width == width)
+		{
+			return lyarr_get(obj->layouts, i);
+		}
+	}
+	throw_up("fdata_get_layout: lines aren't laid out at this width");
+	return NULL;
+}
+
+// Everything kept per row besides the lines themselves, the lines are in place already. line_words are NULL when the
+// words of the lines weren't counted yet
+void fdata_insert_row_data(FileData *obj, size_t row, size_t count, const size_t *line_sizes, const uint32_t *line_words)
+{
+	for (size_t i = 0; i < lyarr_get_size(obj->layouts); i++)
+	{
+		ltree_insert_lines(lyarr_get(obj->layouts, i), row, count, line_sizes);
+	}
+	fdata_insert_stats(obj, row, count, line_sizes, line_words);
+	fdata_damage_rows(obj, row, row + count, true);
+}
+
+void fdata_remove_row_data(FileData *obj, size_t row, size_t count)
+{
+	for (size_t i = 0; i < lyarr_get_size(obj->layouts); i++)
+	{
+		ltree_remove_lines(lyarr_get(obj->layouts, i), row, count);
+	}
+	fdata_remove_stats(obj, row, count);
+	fdata_damage_rows(obj, row, row, true);
+}
+
+// The totals only take the difference the changed lines make, they are never counted over
+void fdata_insert_stats(FileData *obj, size_t row, size_t count, const size_t *line_sizes, const uint32_t *line_words)
+{
+	// Lines are mostly added one at a time, as a file is read
+	LineStats line_stats;
+	LineStats *stats = count == 1 ? &line_stats : mem_alloc(MEM_LAYOUT, count * sizeof(LineStats));
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t size = line_sizes[i];
+		if (line_words == NULL)
+		{
+			const char *text = fdata_get_line_text(obj, row + i, &size);
+			stats[i].words = fdata_count_words(size, text);
+		}
+		else
+		{
+			stats[i].words = line_words[i];
+		}
+		stats[i].size = size;
+		obj->text_size += size;
+		obj->word_count += stats[i].words;
+	}
+	lsarr_insert_multiple(obj->line_stats, row, count, stats);
+	if (stats != &line_stats)
+	{
+		mem_free(MEM_LAYOUT, stats, count * sizeof(LineStats));
+	}
+}
+
+void fdata_remove_stats(FileData *obj, size_t row, size_t count)
+{
+	for (size_t i = row; i < row + count; i++)
+	{
+		LineStats stats = lsarr_get(obj->line_stats, i);
+		obj->text_size -= stats.size;
+		obj->word_count -= stats.words;
+	}
+	lsarr_remove_multiple(obj->line_stats, row, count);
+}
+
+void fdata_update_stats(FileData *obj, size_t row)
+{
+	LineStats *stats = lsarr_get_ptr(obj->line_stats, row);
+	size_t size;
+	const char *text = fdata_get_line_text(obj, row, &size);
+	size_t words = fdata_count_words(size, text);
+	obj->text_size += size - stats->size;
+	obj->word_count += words - stats->words;
+	*stats = (LineStats) {.size = size, .words = words};
+}
+
+size_t fdata_get_byte_count(const FileData *obj)
+{
+	// Every line but the last ends with a line break
+	return obj->text_size + fdata_get_line_count(obj) - (fdata_get_line_count(obj) > 0);
+}
+
+size_t fdata_get_word_count(const FileData *obj)
+{
+	return obj->word_count;
+}
+
+uint32_t fdata_get_line_words(const FileData *obj, size_t row)
+{
+	return lsarr_get(obj->line_stats, row).words;
+}
+
+// Words are runs of anything but blanks, like wc counts them. Lines hold no line breaks, so the words of a text are the
+// words of its lines added up
+size_t fdata_count_words(size_t size, const char *text)
+{
+	size_t count = 0;
+	bool in_word = false;
+	for (size_t i = 0; i < size; i++)
+	{
+		// Blanks are ' ' and '\t' to '\r'
+		bool blank = text[i] == ' ' || (unsigned char)(text[i] - '\t') <= '\r' - '\t';
+		count += !blank && !in_word;
+		in_word = !blank;
+	}
+	return count;
+}
+
+size_t fdata_get_visual_rows_before(const FileData *obj, size_t width, size_t row)
+{
+	return ltree_get_rows_before(fdata_get_layout(obj, width), row);
+}
+
+size_t fdata_get_visual_row_count(const FileData *obj, size_t width, size_t row)
+{
+	return ltree_get_line_rows(fdata_get_layout(obj, width), row);
+}
+
+size_t fdata_get_total_visual_rows(const FileData *obj, size_t width)
+{
+	return ltree_get_total_rows(fdata_get_layout(obj, width));
+}
+
+size_t fdata_find_line_of_visual_row(const FileData *obj, size_t width, size_t visual_row)
+{
+	return ltree_find_line(fdata_get_layout(obj, width), visual_row);
+}
+
+// The rows from start to end changed, end is a row of the lines as they are now. Moved is set when the rows after them
+// moved, the lines were inserted or removed
+void fdata_damage_rows(FileData *obj, size_t start, size_t end, bool moved)
+{
+	obj->damage_start = start < obj->damage_start ? start : obj->damage_start;
+	obj->damage_end = moved ? SIZE_MAX : end > obj->damage_end ? end : obj->damage_end;
+	// Lines around the last edits stay as they are, they are likely to be changed again
+	obj->edited_rows[obj->edited_index] = start;
+	obj->edited_index = (obj->edited_index + 1) % FILE_DATA_EDIT_HISTORY;
+	obj->change_count++;
+	size_t line_count = fdata_get_line_count(obj);
+	obj->changes[obj->change_count % FILE_DATA_CHANGE_HISTORY] = (RowChange) {.start = start, .tail = end < line_count ? line_count - end : 0};
+}
+
+// The rows the changes made after change_count was since touched, all of them put together. Their tail is the same rows
+// before and after the changes. False when the changes go back further than the ones remembered
+bool fdata_get_changed_rows(const FileData *obj, size_t since, RowChange *change)
+{
+	if (obj->change_count - since > FILE_DATA_CHANGE_HISTORY)
+	{
+		return false;
+	}
+	*change = (RowChange) {.start = SIZE_MAX, .tail = SIZE_MAX};
+	for (size_t i = since + 1; i <= obj->change_count; i++)
+	{
+		const RowChange *next = &obj->changes[i % FILE_DATA_CHANGE_HISTORY];
+		change->start = next->start < change->start ? next->start : change->start;
+		change->tail = next->tail < change->tail ? next->tail : change->tail;
+	}
+	return true;
+}
+
+// Called once every view has drawn the damaged rows
+void fdata_clear_damage(FileData *obj)
+{
+	obj->damage_start = SIZE_MAX;
+	obj->damage_end = 0;
+}
+
+// Turns the compressed lines of the rows and of the rows right around them back into lines, so lines can go between them
+void fdata_thaw(FileData *obj, size_t row, size_t count)
+{
+	if (cold_is_empty(obj->cold))
+	{
+		return;
+	}
+	size_t line_count = fdata_get_line_count(obj);
+	size_t end = row + count + 1 < line_count ? row + count + 1 : line_count;
+	for (size_t i = row > 0 ? row - 1 : 0; i < end; i++)
+	{
+		const DynamicBuffer *slot = larr_get(obj->lines, i);
+		if (!cold_is_slot(slot))
+		{
+			continue;
+		}
+		// The block's rows get new handles, snapshots keep the block until they let go of it
+		size_t start = i - cold_get_slot_index(slot);
+		size_t block_line_count = cold_get_block_line_count(obj->cold, slot);
+		fdata_touch_rows(obj, start, block_line_count);
+		i += cold_thaw(obj->cold, larr_get_ptr(obj->lines, i)) - 1;
+		fdata_sync_rows(obj, start, block_line_count, block_line_count);
+	}
+}
+
+// Takes the lines of an empty FileData from the text of a file, where line_sizes says they are. The lines are read from
+// the text until fdata_compress_cold_lines adopts them, the FileData owns the text from then on, see cold_map_file.
+// line_words are their word counts, so the text isn't scanned for them. False when the sizes don't add up to the text,
+// nothing is taken then
+bool fdata_map_lines(FileData *obj, char *text, size_t size, size_t line_count, const uint32_t *line_sizes, const uint32_t *line_words)
+{
+	tassert(fdata_get_line_count(obj) == 0, "fdata_map_lines: the FileData has lines");
+
+	if (line_count == 0 || size == 0)
+	{
+		return false;
+	}
+	// The last line may end without a line break
+	size_t text_size = line_count - (text[size - 1] != '\n');
+	for (size_t i = 0; i < line_count; i++)
+	{
+		text_size += line_sizes[i];
+	}
+	if (text_size != size)
+	{
+		return false;
+	}
+	cold_map_file(obj->cold, text, size);
+	larr_reserve(obj->lines, line_count);
+	lsarr_reserve(obj->line_stats, line_count);
+	size_t *block_sizes = mem_alloc(MEM_LAYOUT, COLD_BLOCK_LINES * sizeof(size_t));
+	for (size_t row = 0; row < line_count; row += COLD_BLOCK_LINES)
+	{
+		size_t count = line_count - row < COLD_BLOCK_LINES ? line_count - row : COLD_BLOCK_LINES;
+		DynamicBuffer *slots[COLD_BLOCK_LINES];
+		text += cold_map_lines(obj->cold, count, text, line_sizes + row, slots);
+		larr_add_multiple(obj->lines, count, slots);
+		fdata_sync_rows(obj, row, 0, count);
+		for (size_t i = 0; i < count; i++)
+		{
+			block_sizes[i] = line_sizes[row + i];
+		}
+		fdata_insert_row_data(obj, row, count, block_sizes, line_words + row);
+	}
+	mem_free(MEM_LAYOUT, block_sizes, COLD_BLOCK_LINES * sizeof(size_t));
+	return true;
+}
+
+// Compresses blocks of lines that are far from keep_rows and from the last edits, going on from where the last call
+// stopped. Lines still in the text of a file are adopted first, wherever they are. At most budget rows are looked at, true
+// when some lines were compressed
+bool fdata_compress_cold_lines(FileData *obj, size_t keep_count, const size_t *keep_rows, size_t budget)
+{
+	if (cold_adopt_mapped(obj->cold, budget / COLD_BLOCK_LINES))
+	{
+		return true;
+	}
+	bool compressed = false;
+	size_t line_count = fdata_get_line_count(obj);
+	size_t row = obj->freeze_row;
+	for (size_t looked = 0; looked < budget; looked += COLD_BLOCK_LINES)
+	{
+		// The last line is where a followed file grows, the block with it is never compressed
+		if (row + COLD_BLOCK_LINES >= line_count)
+		{
+			row = 0;
+			break;
+		}
+		size_t end = row + COLD_BLOCK_LINES;
+		size_t first_slot = row;
+		while (first_slot < end && !cold_is_slot(larr_get(obj->lines, first_slot)))
+		{
+			first_slot++;
+		}
+		if (first_slot < end)
+		{
+			// Rows in between blocks that are too few for a block of their own are left as they are
+			for (row = first_slot; row < line_count && cold_is_slot(larr_get(obj->lines, row)); row++);
+			continue;
+		}
+		if (!fdata_is_near_rows(row, end, keep_count, keep_rows) && !fdata_is_near_rows(row, end, FILE_DATA_EDIT_HISTORY, obj->edited_rows))
+		{
+			fdata_touch_rows(obj, row, COLD_BLOCK_LINES);
+			if (cold_freeze(obj->cold, COLD_BLOCK_LINES, larr_get_ptr(obj->lines, row)))
+			{
+				fdata_sync_rows(obj, row, COLD_BLOCK_LINES, COLD_BLOCK_LINES);
+				compressed = true;
+			}
+		}
+		row = end;
+	}
+	obj->freeze_row = row;
+	return compressed;
+}
+
+bool fdata_is_near_rows(size_t start, size_t end, size_t count, const size_t *rows)
+{
+	size_t near_start = start > COLD_KEEP_DISTANCE ? start - COLD_KEEP_DISTANCE : 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (near_start <= rows[i] && rows[i] < end + COLD_KEEP_DISTANCE)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool fdata_is_row_damaged(const FileData *obj, size_t row)
+{
+	return obj->damage_start <= row && row < obj->damage_end;
+}
+
+// The lines as they are now, for reading on any thread. The first snapshot builds the tree of the lines, every one after
+// it takes a reference to its root. Snapshots with compressed lines are let go of before the FileData is destroyed
+Snapshot *fdata_take_snapshot(FileData *obj)
+{
+	if (obj->versions == NULL)
+	{
+		obj->versions = snap_build(fdata_get_line_count(obj), obj->lines->arr);
+	}
+	return snap_create(obj->versions, obj->cold, obj->change_count);
+}
+
+// Changes on disk can be merged from then on, the lines are the base until the first change after modified is cleared
+void fdata_keep_base(FileData *obj)
+{
+	if (obj->base_hashes == NULL)
+	{
+		obj->base_hashes = lharr_create(MEM_LINES);
+	}
+}
+
+void fdata_hash_lines(const FileData *obj, LineHashArray *hashes)
+{
+	LineSource lines = fdata_get_line_source(obj);
+	lharr_clear(hashes);
+	lharr_reserve(hashes, lines.count);
+	for (size_t i = 0; i < lines.count; i++)
+	{
+		lharr_add(hashes, ldiff_get_line_hash(&lines, i));
+	}
+}
+
+LineSource fdata_get_line_source(const FileData *obj)
+{
+	return (LineSource) {.read = fdata_read_line, .lines = (void*)obj, .count = fdata_get_line_count(obj)};
+}
+
+const char *fdata_read_line(void *lines, size_t row, size_t *size)
+{
+	return fdata_get_line_text(lines, row, size);
+}
+
+// Called before lines of the rows are changed in place or destroyed, snapshots that hold them keep them as they are
+void fdata_touch_rows(FileData *obj, size_t row, size_t count)
+{
+	if (obj->versions != NULL)
+	{
+		snap_touch(&obj->versions, obj->cold, row, count);
+	}
+}
+
+// Called once old_count rows at row were replaced with new_count rows
+void fdata_sync_rows(FileData *obj, size_t row, size_t old_count, size_t new_count)
+{
+	if (obj->versions != NULL)
+	{
+		snap_replace(&obj->versions, obj->cold, row, old_count, new_count, obj->lines->arr);
+	}
+}
+
+vec2 fdata_splice_insert(FileData *obj, vec2 pos, size_t size, const char *text)
+{
+	tassert(pos.y < fdata_get_line_count(obj), "fdata_splice_insert: row is out of range");
+	tassert(pos.x <= fdata_get_line_size(obj, pos.y), "fdata_splice_insert: column is out of range");
+
+	fdata_journal_insert(obj, pos, size, text);
+	fdata_thaw(obj, pos.y, 1);
+	DynamicBuffer *line = fdata_get_line_mut(obj, pos.y);
+	size_t new_line_count = fdata_count_line_breaks(size, text);
+	if (new_line_count == 0)
+	{
+		dbuf_inserts_to(line, pos.x, size, text);
+		fdata_line_changed(obj, pos.y);
+		return (vec2) {.x = pos.x + size, .y = pos.y};
+	}
+	// Every new line is built first and then spliced in with one move of the line and layout arrays
+	DynamicBuffer **new_lines = mem_alloc(MEM_LINES, new_line_count * sizeof(DynamicBuffer*));
+	size_t *new_line_sizes = mem_alloc(MEM_LAYOUT, new_line_count * sizeof(size_t));
+	const char *text_end = text + size;
+	const char *first_break = memchr(text, '\n', size);
+	const char *segment = first_break + 1;
+	for (size_t i = 0; i < new_line_count; i++)
+	{
+		const char *segment_end = memchr(segment, '\n', text_end - segment);
+		if (segment_end == NULL)
+		{
+			segment_end = text_end;
+		}
+		new_lines[i] = dbuf_create(MEM_LINES);
+		dbuf_adds(new_lines[i], segment_end - segment, segment);
+		segment = segment_end + 1;
+	}
+	DynamicBuffer *last_line = new_lines[new_line_count - 1];
+	vec2 end = {.x = dbuf_get_size(last_line), .y = pos.y + new_line_count};
+	// The text after pos ends up after the inserted text
+	dbuf_adds(last_line, dbuf_get_size(line) - pos.x, dbuf_get_with_nulc(line, pos.x));
+	dbuf_truncate(line, pos.x);
+	dbuf_adds(line, first_break - text, text);
+	fdata_line_changed(obj, pos.y);
+	for (size_t i = 0; i < new_line_count; i++)
+	{
+		new_line_sizes[i] = dbuf_get_size(new_lines[i]);
+	}
+	larr_insert_multiple(obj->lines, pos.y + 1, new_line_count, new_lines);
+	fdata_sync_rows(obj, pos.y + 1, 0, new_line_count);
+	fdata_insert_row_data(obj, pos.y + 1, new_line_count, new_line_sizes, NULL);
+	mem_free(MEM_LINES, new_lines, new_line_count * sizeof(DynamicBuffer*));
+	mem_free(MEM_LAYOUT, new_line_sizes, new_line_count * sizeof(size_t));
+	return end;
+}
+
+void fdata_splice_delete(FileData *obj, vec2 start, vec2 end, DynamicBuffer *removed)
+{
+	tassert(start.y <= end.y && end.y < fdata_get_line_count(obj), "fdata_splice_delete: rows are out of range");
+	tassert(start.y < end.y || start.x <= end.x, "fdata_splice_delete: start is after end");
+
+	fdata_journal_delete(obj, start, end);
+	fdata_thaw(obj, start.y, end.y - start.y + 1);
+	DynamicBuffer *first_line = fdata_get_line_mut(obj, start.y);
+	if (start.y == end.y)
+	{
+		if (removed != NULL)
+		{
+			fdata_copy_range(obj, start, end, removed);
+		}
+		dbuf_removes(first_line, start.x, end.x - start.x);
+		fdata_line_changed(obj, start.y);
+		return;
+	}
+	DynamicBuffer *last_line = larr_get(obj->lines, end.y);
+	if (removed != NULL)
+	{
+		fdata_copy_range(obj, start, end, removed);
+	}
+	dbuf_truncate(first_line, start.x);
+	dbuf_adds(first_line, dbuf_get_size(last_line) - end.x, dbuf_get_with_nulc(last_line, end.x));
+	fdata_line_changed(obj, start.y);
+	fdata_touch_rows(obj, start.y + 1, end.y - start.y);
+	for (size_t row = start.y + 1; row <= end.y; row++)
+	{
+		dbuf_destroy(larr_get(obj->lines, row));
+	}
+	larr_remove_multiple(obj->lines, start.y + 1, end.y - start.y);
+	fdata_sync_rows(obj, start.y + 1, end.y - start.y, 0);
+	fdata_remove_row_data(obj, start.y + 1, end.y - start.y);
+}
+
+size_t fdata_count_line_breaks(size_t size, const char *text)
+{
+	size_t count = 0;
+	const char *text_end = text + size;
+	for (const char *c = memchr(text, '\n', size); c != NULL; c = memchr(c + 1, '\n', text_end - c - 1))
+	{
+		count++;
+	}
+	return count;
+}
+
+// Line i of text is between line_starts[i] and line_starts[i+1] - 1, like every line was followed by a line break
+size_t *fdata_split_text(size_t size, const char *text, size_t *line_count)
+{
+	// The line break at the end of a file doesn't start another line
+	bool ends_with_break = size > 0 && text[size - 1] == '\n';
+	*line_count = fdata_count_line_breaks(size, text) + !ends_with_break;
+	size_t *line_starts = mem_alloc(MEM_OTHER, (*line_count + 1) * sizeof(size_t));
+	line_starts[0] = 0;
+	const char *text_end = text + size;
+	size_t line = 1;
+	for (const char *c = memchr(text, '\n', size); c != NULL; c = memchr(c + 1, '\n', text_end - c - 1))
+	{
+		line_starts[line++] = c + 1 - text;
+	}
+	if (!ends_with_break)
+	{
+		line_starts[*line_count] = size + 1;
+	}
+	return line_starts;
+}
+
+void fdata_splice_batch(FileData *obj, size_t count, const Splice *splices, vec2 *ends, DynamicBuffer *removed, size_t *removed_sizes)
+{
+	size_t first_row = splices[0].start.y;
+	size_t last_row = splices[count-1].end.y;
+	tassert(last_row < fdata_get_line_count(obj), "fdata_splice_batch: rows are out of range");
+
+	fdata_journal_splices(obj, count, splices);
+	fdata_thaw(obj, first_row, last_row - first_row + 1);
+	fdata_touch_rows(obj, first_row, last_row - first_row + 1);
+	// Lines without a splice keep their handle, every other line is built once with all of its splices
+	LineArray *new_lines = obj->batch_lines;
+	size_t i = 0;
+	for (size_t row = first_row; row <= last_row; row++)
+	{
+		if (i == count || splices[i].start.y != row)
+		{
+			larr_add(new_lines, larr_get(obj->lines, row));
+			continue;
+		}
+		size_t line_splices = fdata_count_line_splices(row, count - i, splices + i);
+		if (i + line_splices == count || splices[i + line_splices].start.y != row)
+		{
+			// The common case, the row stays one line and keeps its handle
+			i += fdata_splice_line(obj, row, first_row + larr_get_size(new_lines), line_splices, splices + i, ends + i, removed, removed == NULL ? NULL : removed_sizes + i);
+			larr_add(new_lines, larr_get(obj->lines, row));
+			continue;
+		}
+		DynamicBuffer *old_line = larr_get(obj->lines, row);
+		DynamicBuffer *line = dbuf_create(MEM_LINES);
+		size_t col = 0;
+		for (; i < count && splices[i].start.y == row; i++)
+		{
+			const Splice *splice = &splices[i];
+			tassert(splice->start.x >= col, "fdata_splice_batch: splices overlap or aren't sorted");
+
+			dbuf_adds(line, splice->start.x - col, dbuf_get_with_nulc(old_line, col));
+			if (removed != NULL)
+			{
+				size_t removed_size = dbuf_get_size(removed);
+				fdata_copy_range(obj, splice->start, splice->end, removed);
+				removed_sizes[i] = dbuf_get_size(removed) - removed_size;
+			}
+			fdata_append_text(new_lines, &line, splice->size, splice->text);
+			ends[i] = (vec2) {.x = dbuf_get_size(line), .y = first_row + larr_get_size(new_lines)};
+			// Lines that are covered by the splice are dropped, the rest of the last one is kept
+			for (; row < splice->end.y; row++)
+			{
+				dbuf_destroy(old_line);
+				old_line = larr_get(obj->lines, row + 1);
+			}
+			col = splice->end.x;
+		}
+		dbuf_adds(line, dbuf_get_size(old_line) - col, dbuf_get_with_nulc(old_line, col));
+		dbuf_destroy(old_line);
+		larr_add(new_lines, line);
+	}
+	fdata_replace_lines(obj, first_row, last_row - first_row + 1, new_lines);
+	larr_clear(new_lines);
+}
+
+size_t fdata_splice_line(FileData *obj, size_t row, size_t new_row, size_t count, const Splice *splices, vec2 *ends, DynamicBuffer *removed, size_t *removed_sizes)
+{
+	DynamicBuffer *line = fdata_get_line_mut(obj, row);
+	DynamicBuffer *text = obj->batch_text;
+	size_t col = 0;
+	dbuf_clear(text);
+	for (size_t i = 0; i < count; i++)
+	{
+		const Splice *splice = &splices[i];
+		tassert(splice->start.x >= col, "fdata_splice_line: splices overlap or aren't sorted");
+
+		dbuf_adds(text, splice->start.x - col, dbuf_get_with_nulc(line, col));
+		if (removed != NULL)
+		{
+			size_t removed_size = dbuf_get_size(removed);
+			dbuf_adds(removed, splice->end.x - splice->start.x, dbuf_get_with_nulc(line, splice->start.x));
+			removed_sizes[i] = dbuf_get_size(removed) - removed_size;
+		}
+		dbuf_adds(text, splice->size, splice->text);
+		ends[i] = (vec2) {.x = dbuf_get_size(text), .y = new_row};
+		col = splice->end.x;
+	}
+	dbuf_adds(text, dbuf_get_size(line) - col, dbuf_get_with_nulc(line, col));
+	dbuf_truncate(line, 0);
+	dbuf_adds(line, dbuf_get_size(text), dbuf_get_with_nulc(text, 0));
+	return count;
+}
+
+// Counts the splices at the start that stay within row and insert no line breaks
+size_t fdata_count_line_splices(size_t row, size_t count, const Splice *splices)
+{
+	size_t i = 0;
+	while (i < count && splices[i].start.y == row && splices[i].end.y == row
+			&& (splices[i].size == 0 || memchr(splices[i].text, '\n', splices[i].size) == NULL))
+	{
+		i++;
+	}
+	return i;
+}
+
+void fdata_replace_lines(FileData *obj, size_t row, size_t old_count, LineArray *new_lines)
+{
+	size_t new_count = larr_get_size(new_lines);
+	if (old_count == new_count)
+	{
+		for (size_t i = 0; i < new_count; i++)
+		{
+			larr_set(obj->lines, row + i, larr_get(new_lines, i));
+			fdata_line_changed(obj, row + i);
+		}
+		fdata_sync_rows(obj, row, old_count, new_count);
+		return;
+	}
+	larr_remove_multiple(obj->lines, row, old_count);
+	larr_insert_multiple(obj->lines, row, new_count, new_lines->arr);
+	fdata_sync_rows(obj, row, old_count, new_count);
+	size_t *line_sizes = mem_alloc(MEM_LAYOUT, new_count * sizeof(size_t));
+	for (size_t i = 0; i < new_count; i++)
+	{
+		line_sizes[i] = dbuf_get_size(larr_get(new_lines, i));
+	}
+	fdata_remove_row_data(obj, row, old_count);
+	fdata_insert_row_data(obj, row, new_count, line_sizes, NULL);
+	mem_free(MEM_LAYOUT, line_sizes, new_count * sizeof(size_t));
+}
+
+void fdata_append_text(LineArray *new_lines, DynamicBuffer **line, size_t size, const char *text)
+{
+	const char *text_end = text + size;
+	while (text != text_end)
+	{
+		const char *line_break = memchr(text, '\n', text_end - text);
+		if (line_break == NULL)
+		{
+			dbuf_adds(*line, text_end - text, text);
+			return;
+		}
+		dbuf_adds(*line, line_break - text, text);
+		larr_add(new_lines, *line);
+		*line = dbuf_create(MEM_LINES);
+		text = line_break + 1;
+	}
+}
+
+void fdata_copy_range(const FileData *obj, vec2 start, vec2 end, DynamicBuffer *out)
+{
+	for (size_t row = start.y; row <= end.y; row++)
+	{
+		size_t size;
+		const char *text = fdata_get_line_text(obj, row, &size);
+		size_t from = row == start.y ? start.x : 0;
+		size_t to = row == end.y ? end.x : size;
+		if (row != start.y)
+		{
+			dbuf_addc(out, '\n');
+		}
+		dbuf_adds(out, to - from, text + from);
+	}
+}
+
+void fdata_apply_history(FileData *obj, size_t count, Splice *ops, vec2 *cursor_pos)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	// Groups made by fdata_apply_splices can be redone or undone with a single batch
+	if (count > 1 && fdata_history_to_batch(count, ops))
+	{
+		vec2 *ends = mem_alloc(MEM_UNDO, count * sizeof(vec2));
+		fdata_splice_batch(obj, count, ops, ends, NULL, NULL);
+		*cursor_pos = ends[0];
+		mem_free(MEM_UNDO, ends, count * sizeof(vec2));
+		return;
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		if (fdata_compare_positions(ops[i].start, ops[i].end) != 0)
+		{
+			fdata_splice_delete(obj, ops[i].start, ops[i].end, NULL);
+		}
+		*cursor_pos = fdata_splice_insert(obj, ops[i].start, ops[i].size, ops[i].text);
+	}
+}
+
+bool fdata_history_to_batch(size_t count, Splice *ops)
+{
+	// Going bottom up, no operation moves the ones after it, so their positions are already batch positions
+	bool descending = true;
+	for (size_t i = 1; i < count && descending; i++)
+	{
+		descending = fdata_compare_positions(ops[i].end, ops[i-1].start) <= 0;
+	}
+	if (descending)
+	{
+		for (size_t i = 0; i < count / 2; i++)
+		{
+			Splice tmp = ops[i];
+			ops[i] = ops[count - 1 - i];
+			ops[count - 1 - i] = tmp;
+		}
+		return true;
+	}
+	// Going top down, every operation starts after the text the previous one left behind
+	for (size_t i = 1; i < count; i++)
+	{
+		if (fdata_compare_positions(ops[i].start, fdata_get_text_end(ops[i-1].start, ops[i-1].size, ops[i-1].text)) < 0)
+		{
+			return false;
+		}
+	}
+	// and is shifted by the ones before it, which is undone here
+	vec2 result_end = {.x = 0, .y = 0};
+	vec2 original_end = {.x = 0, .y = 0};
+	for (size_t i = 0; i < count; i++)
+	{
+		vec2 next_result_end = fdata_get_text_end(ops[i].start, ops[i].size, ops[i].text);
+		vec2 *positions[] = {&ops[i].start, &ops[i].end};
+		for (size_t j = 0; j < 2; j++)
+		{
+			vec2 *pos = positions[j];
+			if (pos->y == result_end.y)
+			{
+				pos->x = original_end.x + pos->x - result_end.x;
+			}
+			pos->y = original_end.y + pos->y - result_end.y;
+		}
+		result_end = next_result_end;
+		original_end = ops[i].end;
+	}
+	return true;
+}
+
+int fdata_compare_positions(vec2 a, vec2 b)
+{
+	if (a.y != b.y)
+	{
+		return a.y < b.y ? -1 : 1;
+	}
+	if (a.x != b.x)
+	{
+		return a.x < b.x ? -1 : 1;
+	}
+	return 0;
+}
+
+void fdata_relink_lines(FileData *obj, size_t row, size_t count, size_t to)
+{
+	tassert(row + count <= fdata_get_line_count(obj) && to + count <= fdata_get_line_count(obj), "fdata_relink_lines: rows are out of range");
+
+	fdata_journal_lines(obj, JOURNAL_MOVE_LINES, row, count, to);
+	fdata_thaw(obj, row, count);
+	fdata_thaw(obj, to, count);
+	larr_move_multiple(obj->lines, row, count, to);
+	size_t first = row < to ? row : to;
+	size_t span = (row < to ? to : row) + count - first;
+	fdata_sync_rows(obj, first, span, span);
+	for (size_t i = 0; i < lyarr_get_size(obj->layouts); i++)
+	{
+		ltree_move_lines(lyarr_get(obj->layouts, i), row, count, to);
+	}
+	lsarr_move_multiple(obj->line_stats, row, count, to);
+	fdata_damage_rows(obj, row < to ? row : to, (row < to ? to : row) + count, false);
+}
+
+// The undo log takes a reference to each line instead of a copy of its text, the rows must be thawed
+void fdata_record_lines(FileData *obj, int type, size_t row, size_t count)
+{
+	ulog_record_lines(obj->undo_log, type, row, count, larr_getc(obj->lines, row));
+}
+
+// Puts the lines of a line entry back in, or takes them out again, the undo log keeps its own references
+void fdata_apply_line_entry(FileData *obj, const UndoEntry *entry, bool insert, vec2 *cursor_pos)
+{
+	size_t row = entry->start.y;
+	if (insert)
+	{
+		DynamicBuffer *const *handles = ulog_get_lines(obj->undo_log, entry);
+		DynamicBuffer **lines = mem_alloc(MEM_LINES, entry->line_count * sizeof(DynamicBuffer *));
+		for (size_t i = 0; i < entry->line_count; i++)
+		{
+			lines[i] = dbuf_share(handles[i]);
+		}
+		fdata_link_lines(obj, row, entry->line_count, lines);
+		mem_free(MEM_LINES, lines, entry->line_count * sizeof(DynamicBuffer *));
+	}
+	else
+	{
+		fdata_unlink_lines(obj, row, entry->line_count, NULL);
+	}
+	size_t line_count = fdata_get_line_count(obj);
+	*cursor_pos = (vec2) {.x = 0, .y = row < line_count ? row : line_count - 1};
+}
+
+// The undo log keeps its own copy of the text, which is skipped when it wouldn't fit in the budget anyway
+bool fdata_copy_for_undo(FileData *obj, vec2 start, vec2 end)
+{
+	dbuf_clear(obj->removed_text);
+	if (fdata_get_range_size(obj, start, end) > obj->undo_log->budget)
+	{
+		ulog_drop_history(obj->undo_log);
+		return false;
+	}
+	fdata_copy_range(obj, start, end, obj->removed_text);
+	return true;
+}
+
+size_t fdata_get_range_size(const FileData *obj, vec2 start, vec2 end)
+{
+	if (start.y == end.y)
+	{
+		return end.x - start.x;
+	}
+	size_t size = fdata_get_line_size(obj, start.y) - start.x + end.x;
+	for (size_t row = start.y + 1; row < (size_t)end.y; row++)
+	{
+		size += fdata_get_line_size(obj, row);
+	}
+	return size + end.y - start.y;
+}
+
+vec2 fdata_get_text_end(vec2 start, size_t size, const char *text)
+{
+	vec2 end = start;
+	for (size_t i = 0; i < size; i++)
+	{
+		if (text[i] == '\n')
+		{
+			end.y++;
+			end.x = 0;
+		}
+		else
+		{
+			end.x++;
+		}
+	}
+	return end;
+}
+
+// Every change to the lines goes through here before the lines change, true when it has to be journaled too
+bool fdata_note_change(FileData *obj)
+{
+	// The lines are still those of the file, they are the base of the changes made from now on
+	if (!obj->modified && obj->base_hashes != NULL)
+	{
+		fdata_hash_lines(obj, obj->base_hashes);
+	}
+	obj->modified = true;
+	return obj->journal != NULL;
+}
+
+void fdata_journal_insert(FileData *obj, vec2 pos, size_t size, const char *text)
+{
+	if (size == 0 || !fdata_note_change(obj))
+	{
+		return;
+	}
+	jrnl_begin_record(obj->journal, JOURNAL_INSERT);
+	jrnl_add_position(obj->journal, pos);
+	jrnl_add_text(obj->journal, size, text);
+	jrnl_end_record(obj->journal);
+}
+
+void fdata_journal_delete(FileData *obj, vec2 start, vec2 end)
+{
+	if (!fdata_note_change(obj))
+	{
+		return;
+	}
+	jrnl_begin_record(obj->journal, JOURNAL_DELETE);
+	jrnl_add_position(obj->journal, start);
+	jrnl_add_position(obj->journal, end);
+	jrnl_end_record(obj->journal);
+}
+
+void fdata_journal_splices(FileData *obj, size_t count, const Splice *splices)
+{
+	if (!fdata_note_change(obj))
+	{
+		return;
+	}
+	jrnl_begin_record(obj->journal, JOURNAL_SPLICES);
+	jrnl_add_number(obj->journal, count);
+	for (size_t i = 0; i < count; i++)
+	{
+		jrnl_add_position(obj->journal, splices[i].start);
+		jrnl_add_position(obj->journal, splices[i].end);
+		jrnl_add_text(obj->journal, splices[i].size, splices[i].text);
+	}
+	jrnl_end_record(obj->journal);
+}
+
+void fdata_journal_lines(FileData *obj, int type, size_t row, size_t count, size_t to)
+{
+	if (!fdata_note_change(obj))
+	{
+		return;
+	}
+	jrnl_begin_record(obj->journal, type);
+	jrnl_add_number(obj->journal, row);
+	jrnl_add_number(obj->journal, count);
+	if (type == JOURNAL_MOVE_LINES)
+	{
+		jrnl_add_number(obj->journal, to);
+	}
+	jrnl_end_record(obj->journal);
+}
+
+void fdata_journal_insert_lines(FileData *obj, size_t row, size_t count, DynamicBuffer *const *lines)
+{
+	if (!fdata_note_change(obj))
+	{
+		return;
+	}
+	jrnl_begin_record(obj->journal, JOURNAL_INSERT_LINES);
+	jrnl_add_number(obj->journal, row);
+	jrnl_add_number(obj->journal, count);
+	for (size_t i = 0; i < count; i++)
+	{
+		jrnl_add_text(obj->journal, dbuf_get_size(lines[i]), dbuf_get_with_nulc(lines[i], 0));
+	}
+	jrnl_end_record(obj->journal);
+}
+
+// Journals what turns the text of the file into the lines, hunks go from the rows of the text to the rows of the lines.
+// The lines are inserted before the ones they replace are removed, so the file never runs out of lines
+void fdata_journal_hunks(FileData *obj, const HunkArray *hunks)
+{
+	for (size_t i = 0; i < harr_get_size(hunks) && fdata_note_change(obj); i++)
+	{
+		// The hunks before it were replayed by then, so the hunk starts at its row in the lines
+		const LineHunk *hunk = harr_getc(hunks, i);
+		if (hunk->new_count > 0)
+		{
+			jrnl_begin_record(obj->journal, JOURNAL_INSERT_LINES);
+			jrnl_add_number(obj->journal, hunk->new_row);
+			jrnl_add_number(obj->journal, hunk->new_count);
+			for (size_t row = hunk->new_row; row < hunk->new_row + hunk->new_count; row++)
+			{
+				size_t size;
+				const char *line = fdata_get_line_text(obj, row, &size);
+				jrnl_add_text(obj->journal, size, line);
+			}
+			jrnl_end_record(obj->journal);
+		}
+		if (hunk->old_count > 0)
+		{
+			fdata_journal_lines(obj, JOURNAL_REMOVE_LINES, hunk->new_row + hunk->new_count, hunk->old_count, 0);
+		}
+	}
+}
+
+// Journaled as the plain insert of the pieces joined with line breaks
+void fdata_journal_insert_pieces(FileData *obj, vec2 pos, size_t count, DynamicBuffer *const *pieces)
+{
+	if (!fdata_note_change(obj))
+	{
+		return;
+	}
+	size_t size = count - 1;
+	for (size_t i = 0; i < count; i++)
+	{
+		size += dbuf_get_size(pieces[i]);
+	}
+	jrnl_begin_record(obj->journal, JOURNAL_INSERT);
+	jrnl_add_position(obj->journal, pos);
+	jrnl_add_number(obj->journal, size);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (i > 0)
+		{
+			jrnl_add_bytes(obj->journal, 1, "\n");
+		}
+		jrnl_add_bytes(obj->journal, dbuf_get_size(pieces[i]), dbuf_get_with_nulc(pieces[i], 0));
+	}
+	jrnl_end_record(obj->journal);
+}
+
+void fdata_replay_splices(FileData *obj, JournalReader *reader)
+{
+	size_t count = jrnl_read_number(reader);
+	Splice *splices = mem_alloc(MEM_LINES, count * sizeof(Splice));
+	vec2 *ends = mem_alloc(MEM_LINES, count * sizeof(vec2));
+	for (size_t i = 0; i < count; i++)
+	{
+		splices[i].start = jrnl_read_position(reader);
+		splices[i].end = jrnl_read_position(reader);
+		splices[i].text = jrnl_read_text(reader, &splices[i].size);
+	}
+	fdata_splice_batch(obj, count, splices, ends, NULL, NULL);
+	mem_free(MEM_LINES, splices, count * sizeof(Splice));
+	mem_free(MEM_LINES, ends, count * sizeof(vec2));
+}
+
+void fdata_replay_insert_lines(FileData *obj, JournalReader *reader)
+{
+	size_t row = jrnl_read_number(reader);
+	size_t count = jrnl_read_number(reader);
+	DynamicBuffer **lines = mem_alloc(MEM_LINES, count * sizeof(DynamicBuffer *));
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t size;
+		const char *text = jrnl_read_text(reader, &size);
+		lines[i] = dbuf_create(MEM_LINES);
+		dbuf_adds(lines[i], size, text);
+	}
+	fdata_insert_lines(obj, row, count, lines);
+	mem_free(MEM_LINES, lines, count * sizeof(DynamicBuffer *));
+}
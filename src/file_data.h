@@ -0,0 +1,171 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "cold_store.h"
+#include "definitions.h"
+#include "dynamic_buffer.h"
+#include "journal.h"
+#include "layout_tree.h"
+#include "line_diff.h"
+#include "snapshot.h"
+#include "typed_array.h"
+#include "undo_log.h"
+
+#define COLD_KEEP_DISTANCE       1024 // Lines this close to a kept row or a recent edit aren't compressed
+#define FILE_DATA_EDIT_HISTORY   8    // Recently changed rows that are remembered
+#define FILE_DATA_LAYOUT_STEP    1024 // Line sizes gathered at a time by fdata_lay_out_more
+#define FILE_DATA_CHANGE_HISTORY 256  // Recent changes whose rows are remembered, see fdata_get_changed_rows
+
+DEFINE_TYPED_ARRAY(LayoutArray, lyarr, LayoutTree*)
+
+/* What the document statistics are kept from, lines are under 4 GiB like in the line cache */
+typedef struct
+{
+	uint32_t size;
+	uint32_t words;
+} LineStats;
+
+DEFINE_TYPED_ARRAY(LineStatsArray, lsarr, LineStats)
+DEFINE_TYPED_ARRAY(LineHashArray, lharr, uint64_t)
+
+/* Rows a change touched, the rows from start on except the last tail rows of the file. Rows only moved are untouched */
+typedef struct
+{
+	size_t start;
+	size_t tail;
+} RowChange;
+
+typedef struct
+{
+	LineArray *lines;
+	LayoutArray *layouts; // Wrapped row counts of lines at every width they are shown at, kept in sync with every line change
+	LineStatsArray *line_stats; // Of every line, kept in sync with the lines like the layouts
+	size_t text_size;   // Of the lines added up, line breaks aside
+	size_t word_count;
+	UndoLog *undo_log;  // Every edit made through fdata_insert_text, fdata_delete_range and fdata_apply_splices
+	DynamicBuffer *removed_text;
+	LineArray *batch_lines;
+	DynamicBuffer *batch_text;
+	Journal *journal;   // Every change to the lines is appended here when set, the owner opens and closes it
+	bool modified;      // Set by every change to the lines, the owner clears it when the lines are saved
+	size_t damage_start; // Rows changed since fdata_clear_damage, damage_end is SIZE_MAX when the rows after them moved
+	size_t damage_end;
+	ColdStore *cold;     // Blocks of compressed lines, their rows hold slots instead of handles
+	size_t freeze_row;   // Where fdata_compress_cold_lines goes on from
+	size_t edited_rows[FILE_DATA_EDIT_HISTORY];
+	size_t edited_index;
+	size_t change_count; // Goes up with every change to the lines, work done on the lines is stale when it moved
+	RowChange changes[FILE_DATA_CHANGE_HISTORY]; // Of the last changes, by change_count
+	SnapNode *versions;  // The lines as a persistent tree for snapshots, NULL until the first one is taken
+	LineHashArray *base_hashes; // Of the lines as the file had them, changes on disk are merged from them. NULL unless kept
+} FileData;
+
+/* Replaces the text between start and end with text */
+typedef struct
+{
+	vec2 start;
+	vec2 end;
+	size_t size;
+	const char *text;
+} Splice;
+
+void fdata_init(FileData *obj, size_t width);
+void fdata_destroy(FileData *obj);
+
+size_t fdata_get_line_size(const FileData *obj, size_t row);
+
+void fdata_add_line(FileData *obj, DynamicBuffer *line);
+void fdata_insert_line(FileData *obj, size_t row, DynamicBuffer *line);
+void fdata_remove_line(FileData *obj, size_t row);
+void fdata_line_changed(FileData *obj, size_t row);
+
+vec2 fdata_insert_text(FileData *obj, vec2 pos, size_t size, const char *text);
+void fdata_delete_range(FileData *obj, vec2 start, vec2 end);
+void fdata_apply_splices(FileData *obj, size_t count, const Splice *splices, vec2 *ends);
+void fdata_remove_lines(FileData *obj, size_t row, size_t count, LineArray *removed);
+void fdata_insert_lines(FileData *obj, size_t row, size_t count, DynamicBuffer *const *lines);
+void fdata_move_lines(FileData *obj, size_t row, size_t count, size_t to);
+void fdata_share_range(const FileData *obj, vec2 start, vec2 end, LineArray *pieces);
+vec2 fdata_insert_pieces(FileData *obj, vec2 pos, size_t count, DynamicBuffer *const *pieces);
+void fdata_unshare_line(FileData *obj, size_t row);
+int fdata_compare_positions(vec2 a, vec2 b);
+bool fdata_undo(FileData *obj, vec2 *cursor_pos);
+bool fdata_redo(FileData *obj, vec2 *cursor_pos);
+void fdata_seal_undo(FileData *obj);
+void fdata_begin_undo_group(FileData *obj);
+void fdata_end_undo_group(FileData *obj);
+size_t fdata_replay_journal(FileData *obj, JournalReader *reader);
+void fdata_patch_lines(FileData *obj, size_t size, const char *text, HunkArray *hunks);
+size_t fdata_merge_lines(FileData *obj, size_t size, const char *text, HunkArray *hunks, HunkArray *own_hunks);
+void fdata_journal_hunks(FileData *obj, const HunkArray *hunks);
+size_t fdata_map_row(const HunkArray *hunks, size_t row);
+void fdata_append_lines(FileData *obj, size_t size, const char *text, bool *line_open);
+bool fdata_map_lines(FileData *obj, char *text, size_t size, size_t line_count, const uint32_t *line_sizes, const uint32_t *line_words);
+
+size_t fdata_get_byte_count(const FileData *obj);
+size_t fdata_get_word_count(const FileData *obj);
+uint32_t fdata_get_line_words(const FileData *obj, size_t row);
+size_t fdata_count_words(size_t size, const char *text);
+
+void fdata_set_layout_widths(FileData *obj, size_t count, const size_t *widths);
+bool fdata_is_laid_out(const FileData *obj);
+void fdata_lay_out_rows(FileData *obj, size_t row, size_t count);
+bool fdata_lay_out_more(FileData *obj, size_t count);
+size_t fdata_get_visual_rows_before(const FileData *obj, size_t width, size_t row);
+size_t fdata_get_visual_row_count(const FileData *obj, size_t width, size_t row);
+size_t fdata_get_total_visual_rows(const FileData *obj, size_t width);
+size_t fdata_find_line_of_visual_row(const FileData *obj, size_t width, size_t visual_row);
+
+void fdata_clear_damage(FileData *obj);
+void fdata_thaw(FileData *obj, size_t row, size_t count);
+bool fdata_compress_cold_lines(FileData *obj, size_t keep_count, const size_t *keep_rows, size_t budget);
+bool fdata_is_row_damaged(const FileData *obj, size_t row);
+bool fdata_get_changed_rows(const FileData *obj, size_t since, RowChange *change);
+Snapshot *fdata_take_snapshot(FileData *obj);
+void fdata_keep_base(FileData *obj);
+LineSource fdata_get_line_source(const FileData *obj);
+void fdata_touch_rows(FileData *obj, size_t row, size_t count);
+
+// Line lookups are on every hot path (rendering, scrolling, search), so they are inlined
+static FORCE_INLINE size_t fdata_get_line_count(const FileData *obj)
+{
+	return larr_get_size(obj->lines);
+}
+
+// A compressed line is read through a hot block, the line is only valid until a few other blocks are read
+static FORCE_INLINE const DynamicBuffer *fdata_get_line(const FileData *obj, size_t row)
+{
+	const DynamicBuffer *line = larr_get(obj->lines, row);
+	return cold_is_slot(line) ? cold_get_line(obj->cold, line) : line;
+}
+
+// For reading lines in order, like search and save do, compressed lines don't make their blocks hot. Valid until the next call
+static FORCE_INLINE const char *fdata_get_line_text(const FileData *obj, size_t row, size_t *size)
+{
+	const DynamicBuffer *line = larr_get(obj->lines, row);
+	if (cold_is_slot(line))
+	{
+		return cold_get_line_text(obj->cold, line, size);
+	}
+	*size = dbuf_get_size(line);
+	return dbuf_get_with_nulc(line, 0);
+}
+
+// Lines can be shared with the clipboard and with snapshots, a shared line is copied the first time it's written to
+static FORCE_INLINE DynamicBuffer *fdata_get_line_mut(FileData *obj, size_t row)
+{
+	if (cold_is_slot(larr_get(obj->lines, row)))
+	{
+		fdata_thaw(obj, row, 1);
+	}
+	if (obj->versions != NULL)
+	{
+		fdata_touch_rows(obj, row, 1);
+	}
+	if (dbuf_is_shared(larr_get(obj->lines, row)))
+	{
+		fdata_unshare_line(obj, row);
+	}
+	return larr_get(obj->lines, row);
+}
@@ -0,0 +1,163 @@
+/* Includes */
+#define _GNU_SOURCE // memrchr
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "allocator.h"
+#include "error_handling.h"
+#include "file_view.h"
+
+/* Private Function Declarations */
+bool fview_extend_index(FileView *obj);
+
+// NULL when the file can't be opened. The file isn't expected to change while it's viewed, a mapping of a file that
+// shrinks faults on the pages that are gone
+FileView *fview_open(const char *filename)
+{
+	int fd = open(filename, O_RDONLY | O_CLOEXEC);
+	struct stat state;
+	if (fd == -1 || fstat(fd, &state) == -1)
+	{
+		if (fd != -1)
+		{
+			close(fd);
+		}
+		return NULL;
+	}
+	// An empty file can't be mapped, it's shown as a single empty line
+	const char *data = NULL;
+	if (state.st_size > 0)
+	{
+		data = mmap(NULL, state.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+		{
+			close(fd);
+			return NULL;
+		}
+	}
+	FileView *obj = mem_alloc(MEM_OTHER, sizeof(FileView));
+	mem_add_used(MEM_OTHER, sizeof(FileView));
+	obj->fd = fd;
+	obj->data = data;
+	obj->size = state.st_size;
+	obj->checkpoints = oarr_create(MEM_OTHER);
+	oarr_add(obj->checkpoints, 0);
+	obj->indexed = false;
+	return obj;
+}
+
+void fview_close(FileView *obj)
+{
+	tassert(obj, "fview_close: obj is NULL");
+
+	if (obj->data != NULL)
+	{
+		munmap((void *)obj->data, obj->size);
+	}
+	close(obj->fd);
+	oarr_destroy(obj->checkpoints);
+	mem_add_used(MEM_OTHER, -(long long)sizeof(FileView));
+	mem_free(MEM_OTHER, obj, sizeof(FileView));
+}
+
+// Without the line break, a line that's longer than the width goes on in the next row
+size_t fview_get_row_size(const FileView *obj, size_t offset, size_t width)
+{
+	size_t size = obj->size - offset < width ? obj->size - offset : width;
+	const char *line_break = size > 0 ? memchr(obj->data + offset, '\n', size) : NULL;
+	return line_break == NULL ? size : (size_t)(line_break - (obj->data + offset));
+}
+
+// A line that fills its last row exactly doesn't get an empty row after it, the same as in the editor
+bool fview_get_next_row(const FileView *obj, size_t *offset, size_t width)
+{
+	size_t row_size = fview_get_row_size(obj, *offset, width);
+	size_t next = *offset + row_size;
+	if (next < obj->size && (row_size < width || obj->data[next] == '\n'))
+	{
+		next++;
+	}
+	// A line break at the end of the file doesn't start another line
+	if (next >= obj->size)
+	{
+		return false;
+	}
+	*offset = next;
+	return true;
+}
+
+// Only a row that starts a line has to look for the start of the line before it. offset has to start a row of this
+// width, one in the middle of a row would be moved back past its line start
+bool fview_get_previous_row(const FileView *obj, size_t *offset, size_t width)
+{
+	if (*offset == 0)
+	{
+		return false;
+	}
+	if (obj->data[*offset - 1] != '\n')
+	{
+		*offset -= width;
+		return true;
+	}
+	size_t line_start = fview_get_line_start(obj, *offset - 1);
+	size_t line_size = *offset - 1 - line_start;
+	size_t row_count = line_size == 0 ? 1 : (line_size + width - 1) / width;
+	*offset = line_start + (row_count - 1) * width;
+	return true;
+}
+
+size_t fview_get_line_start(const FileView *obj, size_t offset)
+{
+	if (offset == 0)
+	{
+		return 0;
+	}
+	const char *line_break = memrchr(obj->data, '\n', offset);
+	return line_break == NULL ? 0 : (size_t)(line_break - obj->data) + 1;
+}
+
+// Lines past the end go to the last line. Only the lines between the checkpoint before the line and the line are scanned
+size_t fview_find_line(FileView *obj, size_t line)
+{
+	size_t checkpoint = line / FILE_VIEW_CHECKPOINT_LINES;
+	while (checkpoint >= oarr_get_size(obj->checkpoints) && fview_extend_index(obj));
+	if (checkpoint >= oarr_get_size(obj->checkpoints))
+	{
+		checkpoint = oarr_get_size(obj->checkpoints) - 1;
+	}
+	size_t offset = oarr_get(obj->checkpoints, checkpoint);
+	for (size_t i = checkpoint * FILE_VIEW_CHECKPOINT_LINES; i < line && offset < obj->size; i++)
+	{
+		const char *line_break = memchr(obj->data + offset, '\n', obj->size - offset);
+		if (line_break == NULL || (size_t)(line_break - obj->data) + 1 >= obj->size)
+		{
+			break;
+		}
+		offset = line_break - obj->data + 1;
+	}
+	return offset;
+}
+
+// Adds the next checkpoint, false when the file ends before it
+bool fview_extend_index(FileView *obj)
+{
+	if (obj->indexed)
+	{
+		return false;
+	}
+	size_t offset = oarr_get(obj->checkpoints, oarr_get_size(obj->checkpoints) - 1);
+	for (size_t i = 0; i < FILE_VIEW_CHECKPOINT_LINES; i++)
+	{
+		const char *line_break = offset < obj->size ? memchr(obj->data + offset, '\n', obj->size - offset) : NULL;
+		if (line_break == NULL || (size_t)(line_break - obj->data) + 1 >= obj->size)
+		{
+			obj->indexed = true;
+			return false;
+		}
+		offset = line_break - obj->data + 1;
+	}
+	oarr_add(obj->checkpoints, offset);
+	return true;
+}
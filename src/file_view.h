@@ -0,0 +1,33 @@
+#pragma once
+#include <stdbool.h>
+#include <stdlib.h>
+#include "typed_array.h"
+
+#define FILE_VIEW_CHECKPOINT_LINES 1024
+
+DEFINE_TYPED_ARRAY(OffsetArray, oarr, size_t)
+
+/*
+ * A file that is only read, shown straight from a mapping instead of being split into lines.
+ * Rows are found by scanning the mapping around them, so nothing is kept per line. Only going
+ * to a line number needs the index, which keeps where every FILE_VIEW_CHECKPOINT_LINES-th
+ * line starts and is only built as far into the file as a lookup needed.
+ * Offsets are where visual rows start, a row is at most width bytes of a line.
+ */
+typedef struct
+{
+	int fd;
+	const char *data;
+	size_t size;
+	OffsetArray *checkpoints; // checkpoints[i] is where line i * FILE_VIEW_CHECKPOINT_LINES starts
+	bool indexed;             // The checkpoints reach the end of the file
+} FileView;
+
+FileView *fview_open(const char *filename);
+void fview_close(FileView *obj);
+
+size_t fview_get_row_size(const FileView *obj, size_t offset, size_t width);
+bool fview_get_next_row(const FileView *obj, size_t *offset, size_t width);
+bool fview_get_previous_row(const FileView *obj, size_t *offset, size_t width);
+size_t fview_get_line_start(const FileView *obj, size_t offset);
+size_t fview_find_line(FileView *obj, size_t line);
@@ -0,0 +1,87 @@
+/* Includes */
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "allocator.h"
+#include "error_handling.h"
+#include "file_watch.h"
+
+/* Definitions */
+// A file that is replaced by a rename only tells that it lost its name, the new file has to be watched again
+#define FILE_WATCH_MASK (IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)
+
+// NULL when inotify isn't available, files just aren't watched then
+FileWatch *fwatch_create()
+{
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd == -1)
+	{
+		return NULL;
+	}
+	FileWatch *obj = mem_alloc(MEM_OTHER, sizeof(FileWatch));
+	mem_add_used(MEM_OTHER, sizeof(FileWatch));
+	obj->fd = fd;
+	obj->event_offset = 0;
+	obj->event_size = 0;
+	return obj;
+}
+
+void fwatch_destroy(FileWatch *obj)
+{
+	tassert(obj, "fwatch_destroy: obj is NULL");
+
+	close(obj->fd);
+	mem_add_used(MEM_OTHER, -(long long)sizeof(FileWatch));
+	mem_free(MEM_OTHER, obj, sizeof(FileWatch));
+}
+
+// -1 when the file can't be watched, for example when it doesn't exist yet
+int fwatch_add(FileWatch *obj, const char *filename)
+{
+	tassert(obj, "fwatch_add: obj is NULL");
+
+	return inotify_add_watch(obj->fd, filename, FILE_WATCH_MASK);
+}
+
+void fwatch_remove(FileWatch *obj, int watch)
+{
+	tassert(obj, "fwatch_remove: obj is NULL");
+
+	if (watch != -1)
+	{
+		inotify_rm_watch(obj->fd, watch);
+	}
+}
+
+// A file may be reported more than once for a single change
+bool fwatch_next_change(FileWatch *obj, int *watch)
+{
+	tassert(obj, "fwatch_next_change: obj is NULL");
+
+	while (true)
+	{
+		if (obj->event_offset == obj->event_size)
+		{
+			ssize_t read_size = read(obj->fd, obj->events, sizeof(obj->events));
+			if (read_size == -1 && errno == EINTR)
+			{
+				continue;
+			}
+			if (read_size <= 0)
+			{
+				return false;
+			}
+			obj->event_offset = 0;
+			obj->event_size = read_size;
+		}
+		const struct inotify_event *event = (const struct inotify_event *)(obj->events + obj->event_offset);
+		obj->event_offset += sizeof(struct inotify_event) + event->len;
+		// The watch of a file that was removed goes away by itself
+		if (event->mask & IN_IGNORED)
+		{
+			continue;
+		}
+		*watch = event->wd;
+		return true;
+	}
+}
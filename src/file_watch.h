@@ -0,0 +1,25 @@
+#pragma once
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define FILE_WATCH_EVENT_BUFFER_SIZE 4096
+
+/*
+ * Tells which watched files were written, replaced or removed by other processes, through inotify.
+ * Reading the changes never blocks, so it can be polled from the editor loop.
+ * The same file watched twice has the same watch.
+ */
+typedef struct
+{
+	int fd;
+	size_t event_offset; // Events that were read but not returned yet are between these
+	size_t event_size;
+	char events[FILE_WATCH_EVENT_BUFFER_SIZE] __attribute__((aligned(8)));
+} FileWatch;
+
+FileWatch *fwatch_create();
+void fwatch_destroy(FileWatch *obj);
+
+int fwatch_add(FileWatch *obj, const char *filename);
+void fwatch_remove(FileWatch *obj, int watch);
+bool fwatch_next_change(FileWatch *obj, int *watch);
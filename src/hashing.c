@@ -0,0 +1,58 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "hashing.h"
+
+uint64_t hash_file(const char *filename, size_t *file_size)
+{
+	uint64_t hash = HASH_INITIAL_VALUE;
+	*file_size = 0;
+	FILE *fp = fopen(filename, "r");
+	if (fp == NULL)
+	{
+		return hash;
+	}
+	char buf[1 << 16];
+	size_t read_size;
+	while ((read_size = fread(buf, 1, sizeof(buf), fp)) > 0)
+	{
+		hash = hash_bytes(hash, read_size, buf);
+		*file_size += read_size;
+	}
+	fclose(fp);
+	return hash;
+}
+
+// The size, the change time and a few pieces of the file, so it's as cheap for a huge file as for a small one. A missing
+// file hashes like an empty one
+uint64_t hash_file_state(const char *filename, size_t *file_size)
+{
+	uint64_t hash = HASH_INITIAL_VALUE;
+	*file_size = 0;
+	int fd = open(filename, O_RDONLY | O_CLOEXEC);
+	struct stat state;
+	if (fd == -1 || fstat(fd, &state) == -1)
+	{
+		if (fd != -1)
+		{
+			close(fd);
+		}
+		return hash;
+	}
+	*file_size = state.st_size;
+	hash = hash_bytes(hash, sizeof(state.st_size), (const char *)&state.st_size);
+	hash = hash_bytes(hash, sizeof(state.st_mtim), (const char *)&state.st_mtim);
+	char buf[HASH_SAMPLE_SIZE];
+	size_t step = *file_size > HASH_SAMPLE_SIZE ? (*file_size - HASH_SAMPLE_SIZE) / (HASH_SAMPLE_COUNT - 1) : 0;
+	for (size_t i = 0; i < HASH_SAMPLE_COUNT; i++)
+	{
+		ssize_t read_size = pread(fd, buf, sizeof(buf), i * step);
+		if (read_size > 0)
+		{
+			hash = hash_bytes(hash, read_size, buf);
+		}
+	}
+	close(fd);
+	return hash;
+}
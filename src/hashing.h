@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include "definitions.h"
+
+#define HASH_INITIAL_VALUE 0xcbf29ce484222325ULL
+#define HASH_PRIME         0x100000001b3ULL
+#define HASH_SAMPLE_SIZE   4096 // Bytes of every piece hash_file_state reads
+#define HASH_SAMPLE_COUNT  17   // Pieces spread evenly over the file, the first and the last one included
+
+/* FNV-1a, cheap enough to run over whole files and lines */
+FORCE_INLINE uint64_t hash_bytes(uint64_t hash, size_t size, const char *data)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= HASH_PRIME;
+	}
+	return hash;
+}
+
+uint64_t hash_file(const char *filename, size_t *file_size);
+uint64_t hash_file_state(const char *filename, size_t *file_size);
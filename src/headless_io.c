@@ -0,0 +1,218 @@
+/* Includes */
+#include "allocator.h"
+#include "definitions.h"
+#include "error_handling.h"
+#include "dynamic_array.h"
+#include "dynamic_buffer.h"
+#include "headless_io.h"
+
+/* Global Data */
+static DynamicArray *keys;
+static size_t key_index;
+static DynamicBuffer *output;
+static DynamicBuffer *last_frame;
+static size_t frame_count;
+static size_t total_output_size;
+static vec2 cursor_position;
+
+/* Private Function Declarations */
+void headless_io_init();
+int  headless_io_read_key();
+int  headless_io_read_no_key();
+void headless_io_null_render_row(int row_id, size_t size, const char *row);
+void headless_io_null_flush_output();
+void headless_io_set_cursor_position(int x, int y);
+void headless_io_null_set_cursor_position(int x, int y);
+void headless_io_null_escape();
+void headless_io_record_render_row(int row_id, size_t size, const char *row);
+void headless_io_record_flush_output();
+void headless_io_record_hide_cursor();
+void headless_io_record_reveal_cursor();
+void headless_io_record_clear_screen();
+
+IO_Interface headless_io_null_interface()
+{
+	headless_io_init();
+	return (IO_Interface)
+	{
+		.read_key = headless_io_read_key,
+		.poll_key = headless_io_read_key,
+		.render_row = headless_io_null_render_row,
+		.flush_output = headless_io_null_flush_output,
+		.set_cursor_position = headless_io_set_cursor_position,
+		.hide_cursor = headless_io_null_escape,
+		.reveal_cursor = headless_io_null_escape,
+		.clear_screen = headless_io_null_escape,
+	};
+}
+
+// Keeps no state at all, so any number of threads can use it at once
+IO_Interface headless_io_stateless_interface()
+{
+	return (IO_Interface)
+	{
+		.read_key = headless_io_read_no_key,
+		.poll_key = headless_io_read_no_key,
+		.render_row = headless_io_null_render_row,
+		.flush_output = headless_io_null_escape,
+		.set_cursor_position = headless_io_null_set_cursor_position,
+		.hide_cursor = headless_io_null_escape,
+		.reveal_cursor = headless_io_null_escape,
+		.clear_screen = headless_io_null_escape,
+	};
+}
+
+IO_Interface headless_io_recording_interface()
+{
+	headless_io_init();
+	return (IO_Interface)
+	{
+		.read_key = headless_io_read_key,
+		.poll_key = headless_io_read_key,
+		.render_row = headless_io_record_render_row,
+		.flush_output = headless_io_record_flush_output,
+		.set_cursor_position = headless_io_set_cursor_position,
+		.hide_cursor = headless_io_record_hide_cursor,
+		.reveal_cursor = headless_io_record_reveal_cursor,
+		.clear_screen = headless_io_record_clear_screen,
+	};
+}
+
+void headless_io_init()
+{
+	if (keys != NULL)
+	{
+		return;
+	}
+	keys = darr_create(sizeof(int), MEM_OTHER);
+	output = dbuf_create(MEM_TERMINAL);
+	last_frame = dbuf_create(MEM_TERMINAL);
+	headless_io_reset();
+}
+
+void headless_io_reset()
+{
+	tassert(keys, "headless_io_reset: no interface was created");
+
+	darr_clear(keys);
+	key_index = 0;
+	dbuf_clear(output);
+	dbuf_clear(last_frame);
+	frame_count = 0;
+	total_output_size = 0;
+	cursor_position = (vec2) {.x = 0, .y = 0};
+}
+
+void headless_io_feed_keys(size_t count, const int *new_keys)
+{
+	tassert(keys, "headless_io_feed_keys: no interface was created");
+
+	// Dropping the keys that were already read so that the queue doesn't grow forever
+	if (key_index == darr_get_size(keys))
+	{
+		darr_clear(keys);
+		key_index = 0;
+	}
+	darr_add_multiple(keys, count, new_keys);
+}
+
+size_t headless_io_get_pending_key_count()
+{
+	return darr_get_size(keys) - key_index;
+}
+
+size_t headless_io_get_frame_count()
+{
+	return frame_count;
+}
+
+size_t headless_io_get_last_frame_size()
+{
+	return dbuf_get_size(last_frame);
+}
+
+size_t headless_io_get_total_output_size()
+{
+	return total_output_size;
+}
+
+const char *headless_io_get_last_frame()
+{
+	return dbuf_get_with_nulc(last_frame, 0);
+}
+
+vec2 headless_io_get_cursor_position()
+{
+	return cursor_position;
+}
+
+int headless_io_read_key()
+{
+	// Running out of keys looks like a read timeout to the editor
+	if (key_index == darr_get_size(keys))
+	{
+		return NUL;
+	}
+	return *(const int *)darr_getc(keys, key_index++);
+}
+
+void headless_io_null_render_row(int row_id, size_t size, const char *row)
+{
+}
+
+void headless_io_null_flush_output()
+{
+	frame_count++;
+}
+
+void headless_io_set_cursor_position(int x, int y)
+{
+	cursor_position = (vec2) {.x = x, .y = y};
+}
+
+void headless_io_null_set_cursor_position(int x, int y)
+{
+}
+
+void headless_io_null_escape()
+{
+}
+
+void headless_io_record_render_row(int row_id, size_t size, const char *row)
+{
+	dbuf_adds(output, 2, "\x1b[");
+	dbuf_addi(output, row_id + 1);
+	dbuf_adds(output, 3, ";1H");
+	dbuf_adds(output, size, row);
+	dbuf_adds(output, 3, "\x1b[K");
+}
+
+void headless_io_record_flush_output()
+{
+	frame_count++;
+	total_output_size += dbuf_get_size(output);
+	dbuf_clear(last_frame);
+	dbuf_adds(last_frame, dbuf_get_size(output), dbuf_get_with_nulc(output, 0));
+	dbuf_clear(output);
+}
+
+void headless_io_record_hide_cursor()
+{
+	dbuf_adds(output, 6, "\x1b[?25l");
+}
+
+void headless_io_record_reveal_cursor()
+{
+	dbuf_adds(output, 6, "\x1b[?25h");
+}
+
+void headless_io_record_clear_screen()
+{
+	dbuf_adds(output, 4, "\x1b[2J");
+	dbuf_adds(output, 3, "\x1b[H");
+}
+
+int headless_io_read_no_key()
+{
+	return NUL;
+}
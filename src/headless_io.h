@@ -0,0 +1,23 @@
+#pragma once
+#include <stdlib.h>
+#include "editor.h"
+
+/*
+ * IO_Interface backends that don't need a terminal. Keys are fed from memory,
+ * the null backend discards the output and the recording one keeps the bytes
+ * a terminal would have received. The stateless backend reads no keys and
+ * counts nothing, it's the only one that can be shared between threads.
+ */
+IO_Interface headless_io_null_interface();
+IO_Interface headless_io_stateless_interface();
+IO_Interface headless_io_recording_interface();
+
+void headless_io_reset();
+void headless_io_feed_keys(size_t count, const int *keys);
+size_t headless_io_get_pending_key_count();
+
+size_t headless_io_get_frame_count();
+size_t headless_io_get_last_frame_size();
+size_t headless_io_get_total_output_size();
+const char *headless_io_get_last_frame();
+vec2 headless_io_get_cursor_position();
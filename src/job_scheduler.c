@@ -0,0 +1,154 @@
+/* Includes */
+#include <time.h>
+#include "allocator.h"
+#include "error_handling.h"
+#include "job_scheduler.h"
+
+/* Private Function Declarations */
+size_t jsched_find_job(const JobScheduler *obj, size_t id);
+size_t jsched_find_next_job(const JobScheduler *obj);
+void jsched_complete_job(JobScheduler *obj, size_t index);
+void jsched_remove_job(JobScheduler *obj, size_t index);
+uint64_t jsched_get_time();
+
+JobScheduler *jsched_create(void)
+{
+	JobScheduler *obj = mem_alloc(MEM_OTHER, sizeof(JobScheduler));
+	mem_add_used(MEM_OTHER, sizeof(JobScheduler));
+	obj->jobs = jarr_create(MEM_OTHER);
+	obj->next_id = JOB_NONE + 1;
+	return obj;
+}
+
+// Jobs that didn't finish are cancelled
+void jsched_destroy(JobScheduler *obj)
+{
+	tassert(obj, "jsched_destroy: obj is NULL");
+
+	while (jsched_has_jobs(obj))
+	{
+		jsched_remove_job(obj, jarr_get_size(obj->jobs) - 1);
+	}
+	jarr_destroy(obj->jobs);
+	mem_add_used(MEM_OTHER, -(long long)sizeof(JobScheduler));
+	mem_free(MEM_OTHER, obj, sizeof(JobScheduler));
+}
+
+// Returns the job's id, which is only valid while the job is running
+size_t jsched_submit(JobScheduler *obj, Job job)
+{
+	tassert(job.step && job.publish && job.destroy, "jsched_submit: the job is missing a function");
+
+	job.id = obj->next_id++;
+	jarr_add(obj->jobs, job);
+	return job.id;
+}
+
+// Nothing happens for a job that already finished
+void jsched_cancel(JobScheduler *obj, size_t id)
+{
+	size_t index = jsched_find_job(obj, id);
+	if (index != SIZE_MAX)
+	{
+		jsched_remove_job(obj, index);
+	}
+}
+
+// Called for every key, before the key is handled
+void jsched_note_input(JobScheduler *obj)
+{
+	for (size_t i = jarr_get_size(obj->jobs); i-- > 0;)
+	{
+		if (jarr_get(obj->jobs, i).cancel_on_input)
+		{
+			jsched_remove_job(obj, i);
+		}
+	}
+}
+
+// Runs steps of the highest priority job, and of the ones after it when it finishes, until budget_ns is spent. A step
+// isn't cut short, so a slice ends late by up to one step. True when jobs are left
+bool jsched_run(JobScheduler *obj, uint64_t budget_ns)
+{
+	uint64_t start = jsched_get_time();
+	while (jsched_has_jobs(obj))
+	{
+		size_t index = jsched_find_next_job(obj);
+		Job job = jarr_get(obj->jobs, index);
+		if (job.step(job.state))
+		{
+			jsched_complete_job(obj, index);
+		}
+		if (jsched_get_time() - start >= budget_ns)
+		{
+			break;
+		}
+	}
+	return jsched_has_jobs(obj);
+}
+
+// Runs the job until it's done, for when its result is needed right away
+void jsched_finish(JobScheduler *obj, size_t id)
+{
+	size_t index = jsched_find_job(obj, id);
+	if (index == SIZE_MAX)
+	{
+		return;
+	}
+	Job job = jarr_get(obj->jobs, index);
+	while (!job.step(job.state));
+	jsched_complete_job(obj, index);
+}
+
+bool jsched_is_running(const JobScheduler *obj, size_t id)
+{
+	return jsched_find_job(obj, id) != SIZE_MAX;
+}
+
+size_t jsched_find_job(const JobScheduler *obj, size_t id)
+{
+	for (size_t i = 0; i < jarr_get_size(obj->jobs); i++)
+	{
+		if (jarr_get(obj->jobs, i).id == id)
+		{
+			return i;
+		}
+	}
+	return SIZE_MAX;
+}
+
+size_t jsched_find_next_job(const JobScheduler *obj)
+{
+	size_t next = 0;
+	for (size_t i = 1; i < jarr_get_size(obj->jobs); i++)
+	{
+		if (jarr_get(obj->jobs, i).priority < jarr_get(obj->jobs, next).priority)
+		{
+			next = i;
+		}
+	}
+	return next;
+}
+
+// Taken out of the list before it's published, publishing may submit or cancel jobs
+void jsched_complete_job(JobScheduler *obj, size_t index)
+{
+	Job job = jarr_get(obj->jobs, index);
+	jarr_remove(obj->jobs, index);
+	job.publish(job.state);
+	job.destroy(job.state);
+}
+
+void jsched_remove_job(JobScheduler *obj, size_t index)
+{
+	Job job = jarr_get(obj->jobs, index);
+	jarr_remove(obj->jobs, index);
+	job.destroy(job.state);
+}
+
+uint64_t jsched_get_time()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "typed_array.h"
+
+#define JOB_PRIORITY_HIGH   0
+#define JOB_PRIORITY_NORMAL 1
+#define JOB_PRIORITY_LOW    2
+
+#define JOB_NONE     0           // An id no job gets
+#define JOB_SLICE_NS 8000000ULL  // Work done per tick while jobs wait, half a frame at 60 Hz leaves time to draw it
+
+/*
+ * A job is a long operation split into small steps, each one is a call to step that does a bounded
+ * piece of the work and keeps where it got to in state. Jobs only touch their own state while
+ * they run, so their results are only seen when publish hands them over in one go, right after
+ * the last step. destroy frees the state, whether the job finished or was cancelled.
+ */
+typedef struct
+{
+	int priority;         // JOB_PRIORITY_*, jobs with the same priority run in the order they were submitted
+	bool cancel_on_input; // The job is cancelled by jsched_note_input, its result would be stale after the key
+	void *state;
+	bool (*step) (void *state);    // True once the work is done
+	void (*publish) (void *state);
+	void (*destroy) (void *state);
+	size_t id;
+} Job;
+
+DEFINE_TYPED_ARRAY(JobArray, jarr, Job)
+
+/*
+ * Runs jobs cooperatively on the editor thread, a time slice at a time between keys. Only the
+ * highest priority job runs in a slice, the others wait for it. Cancelling is safe at any time
+ * outside of a step, a job that finished was already published.
+ */
+typedef struct
+{
+	JobArray *jobs;  // In the order they were submitted
+	size_t next_id;
+} JobScheduler;
+
+JobScheduler *jsched_create(void);
+void jsched_destroy(JobScheduler *obj);
+
+size_t jsched_submit(JobScheduler *obj, Job job);
+void jsched_cancel(JobScheduler *obj, size_t id);
+void jsched_note_input(JobScheduler *obj);
+bool jsched_run(JobScheduler *obj, uint64_t budget_ns);
+void jsched_finish(JobScheduler *obj, size_t id);
+bool jsched_is_running(const JobScheduler *obj, size_t id);
+
+static inline bool jsched_has_jobs(const JobScheduler *obj)
+{
+	return jarr_get_size(obj->jobs) > 0;
+}
@@ -0,0 +1,289 @@
+/* Includes */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "allocator.h"
+#include "error_handling.h"
+#include "hashing.h"
+#include "journal.h"
+#include "sidecar.h"
+
+/* Definitions */
+#define JOURNAL_MAGIC        "TEJ1"
+#define JOURNAL_MAGIC_SIZE   4
+#define JOURNAL_HEADER_SIZE  (JOURNAL_MAGIC_SIZE + 2 * sizeof(uint64_t))
+#define RECORD_HEADER_SIZE   (2 * sizeof(uint32_t))
+
+/* Private Function Declarations */
+void *jrnl_flush_loop(void *arg);
+void jrnl_write_all(int fd, size_t size, const char *data);
+uint32_t jrnl_checksum(size_t size, const char *data);
+
+void jrnl_get_path(const char *filename, char *path, size_t path_size)
+{
+	sidecar_get_path(filename, ".journal", path, path_size);
+}
+
+Journal *jrnl_open(const char *path, uint64_t file_hash, size_t file_size)
+{
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd == -1)
+	{
+		return NULL;
+	}
+	Journal *obj = mem_alloc(MEM_OTHER, sizeof(Journal));
+	mem_add_used(MEM_OTHER, sizeof(Journal));
+	obj->fd = fd;
+	obj->record = carr_create(MEM_OTHER);
+	obj->pending = carr_create(MEM_OTHER);
+	obj->flushing = carr_create(MEM_OTHER);
+	obj->stopping = false;
+	uint64_t header[2] = {file_hash, file_size};
+	carr_add_multiple(obj->pending, JOURNAL_MAGIC_SIZE, JOURNAL_MAGIC);
+	carr_add_multiple(obj->pending, sizeof(header), (const char *)header);
+	pthread_mutex_init(&obj->lock, NULL);
+	pthread_cond_init(&obj->wake, NULL);
+	if (pthread_create(&obj->flusher, NULL, jrnl_flush_loop, obj) != 0)
+	{
+		throw_up("jrnl_open: couldn't start the flusher");
+	}
+	return obj;
+}
+
+// Writes out everything that was recorded, the journal file itself is left for the caller
+void jrnl_close(Journal *obj)
+{
+	tassert(obj, "jrnl_close: obj is NULL");
+
+	pthread_mutex_lock(&obj->lock);
+	obj->stopping = true;
+	pthread_cond_signal(&obj->wake);
+	pthread_mutex_unlock(&obj->lock);
+	pthread_join(obj->flusher, NULL);
+	pthread_mutex_destroy(&obj->lock);
+	pthread_cond_destroy(&obj->wake);
+	close(obj->fd);
+	carr_destroy(obj->record);
+	carr_destroy(obj->pending);
+	carr_destroy(obj->flushing);
+	mem_add_used(MEM_OTHER, -(long long)sizeof(Journal));
+	mem_free(MEM_OTHER, obj, sizeof(Journal));
+}
+
+void jrnl_begin_record(Journal *obj, int type)
+{
+	carr_clear(obj->record);
+	// Room for the size and the checksum, which are only known at the end
+	char header[RECORD_HEADER_SIZE] = {0};
+	carr_add_multiple(obj->record, RECORD_HEADER_SIZE, header);
+	carr_add(obj->record, (char)type);
+}
+
+void jrnl_add_number(Journal *obj, size_t value)
+{
+	// LEB128, positions and sizes of typing edits fit in a byte or two
+	while (value >= 0x80)
+	{
+		carr_add(obj->record, (char)(value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	carr_add(obj->record, (char)value);
+}
+
+void jrnl_add_position(Journal *obj, vec2 pos)
+{
+	jrnl_add_number(obj, pos.y);
+	jrnl_add_number(obj, pos.x);
+}
+
+void jrnl_add_text(Journal *obj, size_t size, const char *text)
+{
+	jrnl_add_number(obj, size);
+	jrnl_add_bytes(obj, size, text);
+}
+
+void jrnl_add_bytes(Journal *obj, size_t size, const char *bytes)
+{
+	if (size > 0)
+	{
+		carr_add_multiple(obj->record, size, bytes);
+	}
+}
+
+void jrnl_end_record(Journal *obj)
+{
+	char *record = carr_get_ptr(obj->record, 0);
+	size_t record_size = carr_get_size(obj->record);
+	uint32_t header[2];
+	header[0] = record_size - RECORD_HEADER_SIZE;
+	header[1] = jrnl_checksum(header[0], record + RECORD_HEADER_SIZE);
+	memcpy(record, header, RECORD_HEADER_SIZE);
+	pthread_mutex_lock(&obj->lock);
+	carr_add_multiple(obj->pending, record_size, record);
+	if (carr_get_size(obj->pending) >= JOURNAL_FLUSH_BYTES)
+	{
+		pthread_cond_signal(&obj->wake);
+	}
+	pthread_mutex_unlock(&obj->lock);
+}
+
+void *jrnl_flush_loop(void *arg)
+{
+	Journal *obj = arg;
+	pthread_mutex_lock(&obj->lock);
+	while (true)
+	{
+		if (carr_get_size(obj->pending) < JOURNAL_FLUSH_BYTES && !obj->stopping)
+		{
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_nsec += JOURNAL_FLUSH_INTERVAL_MS * 1000000L;
+			deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+			deadline.tv_nsec %= 1000000000L;
+			pthread_cond_timedwait(&obj->wake, &obj->lock, &deadline);
+		}
+		bool stopping = obj->stopping;
+		// Everything recorded since the last flush goes out with one write and one sync
+		CharArray *batch = obj->pending;
+		obj->pending = obj->flushing;
+		obj->flushing = batch;
+		pthread_mutex_unlock(&obj->lock);
+		if (carr_get_size(batch) > 0)
+		{
+			jrnl_write_all(obj->fd, carr_get_size(batch), carr_getc(batch, 0));
+			fdatasync(obj->fd);
+			carr_clear(batch);
+		}
+		if (stopping)
+		{
+			return NULL;
+		}
+		pthread_mutex_lock(&obj->lock);
+	}
+}
+
+void jrnl_write_all(int fd, size_t size, const char *data)
+{
+	while (size > 0)
+	{
+		ssize_t written = write(fd, data, size);
+		if (written == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		// A full disk loses the journal but not the buffer, which can still be saved somewhere else
+		if (written <= 0)
+		{
+			return;
+		}
+		data += written;
+		size -= written;
+	}
+}
+
+uint32_t jrnl_checksum(size_t size, const char *data)
+{
+	uint64_t hash = hash_bytes(HASH_INITIAL_VALUE, size, data);
+	return (uint32_t)(hash ^ (hash >> 32));
+}
+
+bool jrnl_load(JournalReader *reader, const char *path, uint64_t file_hash, size_t file_size)
+{
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		return false;
+	}
+	reader->data = carr_create(MEM_OTHER);
+	reader->offset = JOURNAL_HEADER_SIZE;
+	reader->record_end = JOURNAL_HEADER_SIZE;
+	char buf[1 << 16];
+	size_t read_size;
+	while ((read_size = fread(buf, 1, sizeof(buf), fp)) > 0)
+	{
+		carr_add_multiple(reader->data, read_size, buf);
+	}
+	fclose(fp);
+	// The file was saved or changed since the journal was started, so its edits don't apply anymore
+	uint64_t header[2];
+	bool valid = carr_get_size(reader->data) >= JOURNAL_HEADER_SIZE
+		&& memcmp(carr_getc(reader->data, 0), JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE) == 0;
+	if (valid)
+	{
+		memcpy(header, carr_getc(reader->data, JOURNAL_MAGIC_SIZE), sizeof(header));
+		valid = header[0] == file_hash && header[1] == file_size;
+	}
+	if (!valid)
+	{
+		jrnl_unload(reader);
+	}
+	return valid;
+}
+
+void jrnl_unload(JournalReader *reader)
+{
+	carr_destroy(reader->data);
+	reader->data = NULL;
+}
+
+bool jrnl_next_record(JournalReader *reader, int *type)
+{
+	size_t size = carr_get_size(reader->data);
+	size_t start = reader->record_end;
+	if (start + RECORD_HEADER_SIZE + 1 > size)
+	{
+		return false;
+	}
+	uint32_t header[2];
+	memcpy(header, carr_getc(reader->data, start), RECORD_HEADER_SIZE);
+	start += RECORD_HEADER_SIZE;
+	// A record that was cut off by a crash is where the journal ends
+	if (header[0] == 0 || header[0] > size - start || jrnl_checksum(header[0], carr_getc(reader->data, start)) != header[1])
+	{
+		return false;
+	}
+	*type = (unsigned char)*carr_getc(reader->data, start);
+	reader->offset = start + 1;
+	reader->record_end = start + header[0];
+	return true;
+}
+
+size_t jrnl_read_number(JournalReader *reader)
+{
+	size_t value = 0;
+	for (int shift = 0; reader->offset < reader->record_end; shift += 7)
+	{
+		unsigned char byte = *carr_getc(reader->data, reader->offset++);
+		value |= (size_t)(byte & 0x7f) << shift;
+		if (byte < 0x80)
+		{
+			break;
+		}
+	}
+	return value;
+}
+
+vec2 jrnl_read_position(JournalReader *reader)
+{
+	vec2 pos;
+	pos.y = jrnl_read_number(reader);
+	pos.x = jrnl_read_number(reader);
+	return pos;
+}
+
+const char *jrnl_read_text(JournalReader *reader, size_t *size)
+{
+	*size = jrnl_read_number(reader);
+	tassert(*size <= reader->record_end - reader->offset, "jrnl_read_text: text runs past the record");
+
+	if (*size == 0)
+	{
+		return "";
+	}
+	const char *text = carr_getc(reader->data, reader->offset);
+	reader->offset += *size;
+	return text;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "definitions.h"
+#include "dynamic_buffer.h"
+
+#define JOURNAL_INSERT       0 // pos, text
+#define JOURNAL_DELETE       1 // start, end
+#define JOURNAL_SPLICES      2 // count, then start, end and text of every splice
+#define JOURNAL_MOVE_LINES   3 // row, count, to
+#define JOURNAL_REMOVE_LINES 4 // row, count
+#define JOURNAL_INSERT_LINES 5 // row, count, then the text of every line
+
+#define JOURNAL_FLUSH_BYTES       (64 << 10) // Pending bytes that wake the flusher before its interval is up
+#define JOURNAL_FLUSH_INTERVAL_MS 200
+
+/*
+ * Write-ahead log of the edits made since the file was last saved, kept next to the file.
+ * Records are built on the editor thread and handed to a flusher thread, which writes and
+ * syncs whatever piled up at once, so a key never waits for the disk.
+ *
+ *   header: "TEJ1" <u64 hash of the file> <u64 size of the file>
+ *   record: <u32 payload size> <u32 checksum> <u8 type> <varint fields and texts>
+ *
+ * A journal only applies to the exact file it was started on, a torn last record is dropped.
+ */
+typedef struct
+{
+	int fd;
+	CharArray *record;   // Record being built, only used by the editor thread
+	CharArray *pending;  // Finished records that the flusher hasn't taken yet
+	CharArray *flushing; // Owned by the flusher while it writes
+	pthread_t flusher;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	bool stopping;
+} Journal;
+
+typedef struct
+{
+	CharArray *data;
+	size_t offset;
+	size_t record_end;
+} JournalReader;
+
+void jrnl_get_path(const char *filename, char *path, size_t path_size);
+
+Journal *jrnl_open(const char *path, uint64_t file_hash, size_t file_size);
+void jrnl_close(Journal *obj);
+
+void jrnl_begin_record(Journal *obj, int type);
+void jrnl_add_number(Journal *obj, size_t value);
+void jrnl_add_position(Journal *obj, vec2 pos);
+void jrnl_add_text(Journal *obj, size_t size, const char *text);
+void jrnl_add_bytes(Journal *obj, size_t size, const char *bytes);
+void jrnl_end_record(Journal *obj);
+
+bool jrnl_load(JournalReader *reader, const char *path, uint64_t file_hash, size_t file_size);
+void jrnl_unload(JournalReader *reader);
+bool jrnl_next_record(JournalReader *reader, int *type);
+size_t jrnl_read_number(JournalReader *reader);
+vec2 jrnl_read_position(JournalReader *reader);
+const char *jrnl_read_text(JournalReader *reader, size_t *size);
@@ -0,0 +1,125 @@
+/* Includes */
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "allocator.h"
+#include "definitions.h"
+#include "error_handling.h"
+#include "hashing.h"
+#include "key_trace.h"
+
+/* Definitions */
+#define TRACE_HEADER "text-editor-trace 1"
+
+/* Global Data */
+static FILE *trace_fp;
+static uint64_t start_time;
+static int (*recorded_read_key) ();
+static int (*recorded_poll_key) ();
+
+/* Private Function Declarations */
+int ktrace_read_key();
+int ktrace_poll_key();
+void ktrace_record_key(int c);
+uint64_t ktrace_get_time();
+
+IO_Interface ktrace_start_recording(IO_Interface io_interface, const char *trace_filename, const char *filename, vec2 window_size)
+{
+	tassert(trace_fp == NULL, "ktrace_start_recording: already recording");
+
+	trace_fp = fopen(trace_filename, "w");
+	if (trace_fp == NULL)
+	{
+		throw_up("ktrace_start_recording: couldn't open trace file");
+	}
+	// The hash has to be taken before the editor gets a chance to write the file
+	size_t file_size;
+	uint64_t file_hash = hash_file(filename, &file_size);
+	fprintf(trace_fp, "%s\n", TRACE_HEADER);
+	fprintf(trace_fp, "file %016" PRIx64 " %zu\n", file_hash, file_size);
+	fprintf(trace_fp, "window %d %d\n", window_size.x, window_size.y);
+	start_time = ktrace_get_time();
+	recorded_read_key = io_interface.read_key;
+	recorded_poll_key = io_interface.poll_key;
+	io_interface.read_key = ktrace_read_key;
+	io_interface.poll_key = ktrace_poll_key;
+	return io_interface;
+}
+
+void ktrace_stop_recording()
+{
+	if (trace_fp == NULL)
+	{
+		return;
+	}
+	fclose(trace_fp);
+	trace_fp = NULL;
+}
+
+int ktrace_read_key()
+{
+	int c = recorded_read_key();
+	ktrace_record_key(c);
+	return c;
+}
+
+int ktrace_poll_key()
+{
+	int c = recorded_poll_key();
+	ktrace_record_key(c);
+	return c;
+}
+
+void ktrace_record_key(int c)
+{
+	// Timeouts aren't keys, the replay doesn't need them
+	if (c != NUL)
+	{
+		fprintf(trace_fp, "%" PRIu64 " %d\n", ktrace_get_time() - start_time, c);
+	}
+}
+
+KeyTrace *ktrace_load(const char *trace_filename)
+{
+	FILE *fp = fopen(trace_filename, "r");
+	if (fp == NULL)
+	{
+		return NULL;
+	}
+	KeyTrace *obj = mem_alloc(MEM_OTHER, sizeof(KeyTrace));
+	mem_add_used(MEM_OTHER, sizeof(KeyTrace));
+	obj->events = darr_create(sizeof(KeyTraceEvent), MEM_OTHER);
+	char header[64];
+	bool valid = fgets(header, sizeof(header), fp) != NULL && strncmp(header, TRACE_HEADER, strlen(TRACE_HEADER)) == 0;
+	valid = valid && fscanf(fp, " file %" SCNx64 " %zu", &obj->file_hash, &obj->file_size) == 2;
+	valid = valid && fscanf(fp, " window %d %d", &obj->window_size.x, &obj->window_size.y) == 2;
+	KeyTraceEvent event;
+	while (valid && fscanf(fp, "%" SCNu64 " %d", &event.time, &event.key) == 2)
+	{
+		darr_add_single(obj->events, &event);
+	}
+	fclose(fp);
+	if (!valid)
+	{
+		ktrace_destroy(obj);
+		return NULL;
+	}
+	return obj;
+}
+
+void ktrace_destroy(KeyTrace *obj)
+{
+	tassert(obj, "ktrace_destroy: obj is NULL");
+
+	darr_destroy(obj->events);
+	mem_add_used(MEM_OTHER, -(long long)sizeof(KeyTrace));
+	mem_free(MEM_OTHER, obj, sizeof(KeyTrace));
+}
+
+uint64_t ktrace_get_time()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include "dynamic_array.h"
+#include "editor.h"
+
+/*
+ * Key traces are text files so they can be attached to bug reports:
+ *
+ *   text-editor-trace 1
+ *   file <hash> <size>
+ *   window <columns> <rows>
+ *   <microseconds since start> <key>
+ *   ...
+ */
+typedef struct
+{
+	uint64_t time;
+	int key;
+} KeyTraceEvent;
+
+typedef struct
+{
+	uint64_t file_hash;
+	size_t file_size;
+	vec2 window_size;
+	DynamicArray *events; // Dynamic Array of KeyTraceEvents
+} KeyTrace;
+
+IO_Interface ktrace_start_recording(IO_Interface io_interface, const char *trace_filename, const char *filename, vec2 window_size);
+void ktrace_stop_recording();
+
+KeyTrace *ktrace_load(const char *trace_filename);
+void ktrace_destroy(KeyTrace *obj);
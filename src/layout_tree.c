@@ -0,0 +1,376 @@
+#include <string.h>
+#include "allocator.h"
+#include "error_handling.h"
+#include "layout_tree.h"
+#include "typed_array.h"
+
+/* Definitions */
+#define INITIAL_RESERVED 64
+#define LINE_BYTES (sizeof(unsigned int) + sizeof(size_t))
+
+/* Private Functions */
+void ltree_reserve(LayoutTree *obj, size_t length);
+void ltree_rebuild_from(LayoutTree *obj, size_t pos);
+void ltree_rebuild_range(LayoutTree *obj, size_t low, size_t high);
+void ltree_update_rotated_range(LayoutTree *obj, size_t low, size_t high, size_t left);
+size_t ltree_compute_node(const LayoutTree *obj, size_t i);
+void ltree_add_to_node(LayoutTree *obj, size_t pos, long long change);
+size_t ltree_lowbit(size_t i);
+
+LayoutTree *ltree_create(size_t width)
+{
+	tassert(width > 0, "ltree_create: width is 0");
+
+	LayoutTree *obj = mem_alloc(MEM_LAYOUT, sizeof(LayoutTree));
+	mem_add_used(MEM_LAYOUT, sizeof(LayoutTree));
+	obj->width = width;
+	obj->length = 0;
+	obj->exact_length = 0;
+	obj->reserved_length = INITIAL_RESERVED;
+	obj->rows = mem_alloc(MEM_LAYOUT, obj->reserved_length * sizeof(unsigned int));
+	obj->tree = mem_alloc(MEM_LAYOUT, (obj->reserved_length + 1) * sizeof(size_t));
+	obj->tree[0] = 0;
+	return obj;
+}
+
+void ltree_destroy(LayoutTree *obj)
+{
+	tassert(obj, "ltree_destroy: obj is NULL");
+
+	mem_add_used(MEM_LAYOUT, -(long long)(obj->length * LINE_BYTES + sizeof(LayoutTree)));
+	mem_free(MEM_LAYOUT, obj->rows, obj->reserved_length * sizeof(unsigned int));
+	mem_free(MEM_LAYOUT, obj->tree, (obj->reserved_length + 1) * sizeof(size_t));
+	mem_free(MEM_LAYOUT, obj, sizeof(LayoutTree));
+}
+
+// O(1), the rows at the old width are what the lines are thought to take until they are laid out again
+void ltree_set_width(LayoutTree *obj, size_t width)
+{
+	tassert(obj, "ltree_set_width: obj is NULL");
+	tassert(width > 0, "ltree_set_width: width is 0");
+
+	if (width == obj->width)
+	{
+		return;
+	}
+	obj->width = width;
+	obj->exact_length = 0;
+}
+
+size_t ltree_get_rows_for_size(const LayoutTree *obj, size_t line_size)
+{
+	// Empty lines still take a row on the screen
+	if (line_size == 0)
+	{
+		return 1;
+	}
+	return 1 + (line_size - 1) / obj->width;
+}
+
+void ltree_add_line(LayoutTree *obj, size_t line_size)
+{
+	tassert(obj, "ltree_add_line: obj is NULL");
+
+	ltree_reserve(obj, obj->length + 1);
+	obj->rows[obj->length] = ltree_get_rows_for_size(obj, line_size);
+	obj->exact_length += obj->exact_length == obj->length;
+	obj->length++;
+	mem_add_used(MEM_LAYOUT, LINE_BYTES);
+	// The new node covers (i - lowbit(i), i], so its value can be computed from the prefix sums
+	size_t i = obj->length;
+	obj->tree[i] = obj->rows[i-1] + ltree_get_rows_before(obj, i-1) - ltree_get_rows_before(obj, i - ltree_lowbit(i));
+}
+
+void ltree_insert_line(LayoutTree *obj, size_t pos, size_t line_size)
+{
+	tassert(obj, "ltree_insert_line: obj is NULL");
+	tassert(pos <= obj->length, "ltree_insert_line: pos is out of range");
+
+	if (pos == obj->length)
+	{
+		ltree_add_line(obj, line_size);
+		return;
+	}
+	ltree_insert_lines(obj, pos, 1, &line_size);
+}
+
+void ltree_remove_line(LayoutTree *obj, size_t pos)
+{
+	tassert(obj, "ltree_remove_line: obj is NULL");
+	tassert(pos < obj->length, "ltree_remove_line: pos is out of range");
+
+	ltree_remove_lines(obj, pos, 1);
+}
+
+void ltree_insert_lines(LayoutTree *obj, size_t pos, size_t count, const size_t *line_sizes)
+{
+	tassert(obj, "ltree_insert_lines: obj is NULL");
+	tassert(pos <= obj->length, "ltree_insert_lines: pos is out of range");
+
+	// One memmove and one rebuild no matter how many lines come in, so a big paste costs the same as a single line
+	ltree_reserve(obj, obj->length + count);
+	memmove(&obj->rows[pos+count], &obj->rows[pos], (obj->length - pos) * sizeof(unsigned int));
+	for (size_t i = 0; i < count; i++)
+	{
+		obj->rows[pos+i] = ltree_get_rows_for_size(obj, line_sizes[i]);
+	}
+	obj->length += count;
+	// New lines are laid out at width, but they only extend the exact lines when they are among them
+	if (pos <= obj->exact_length)
+	{
+		obj->exact_length += count;
+	}
+	mem_add_used(MEM_LAYOUT, count * LINE_BYTES);
+	ltree_rebuild_from(obj, pos);
+}
+
+void ltree_remove_lines(LayoutTree *obj, size_t pos, size_t count)
+{
+	tassert(obj, "ltree_remove_lines: obj is NULL");
+	tassert(pos + count <= obj->length, "ltree_remove_lines: range is out of range");
+
+	memmove(&obj->rows[pos], &obj->rows[pos+count], (obj->length - pos - count) * sizeof(unsigned int));
+	obj->length -= count;
+	if (pos < obj->exact_length)
+	{
+		obj->exact_length -= count < obj->exact_length - pos ? count : obj->exact_length - pos;
+	}
+	mem_add_used(MEM_LAYOUT, -(long long)(count * LINE_BYTES));
+	ltree_rebuild_from(obj, pos);
+}
+
+void ltree_move_lines(LayoutTree *obj, size_t pos, size_t count, size_t to)
+{
+	tassert(obj, "ltree_move_lines: obj is NULL");
+	tassert(pos + count <= obj->length && to + count <= obj->length, "ltree_move_lines: range is out of range");
+
+	if (pos == to || count == 0)
+	{
+		return;
+	}
+	size_t low = pos < to ? pos : to;
+	size_t high = (pos < to ? to : pos) + count;
+	size_t left = to < pos ? pos - to : count;
+	// Estimated lines that come before exact ones would make the exact prefix a lie
+	if (high > obj->exact_length && low < obj->exact_length)
+	{
+		obj->exact_length = low;
+	}
+	tarr_rotate(&obj->rows[low], left, high - low - left, sizeof(unsigned int), MEM_LAYOUT);
+	ltree_update_rotated_range(obj, low, high, left);
+}
+
+void ltree_update_line(LayoutTree *obj, size_t pos, size_t line_size)
+{
+	tassert(obj, "ltree_update_line: obj is NULL");
+	tassert(pos < obj->length, "ltree_update_line: pos is out of range");
+
+	obj->exact_length += pos == obj->exact_length;
+	size_t rows = ltree_get_rows_for_size(obj, line_size);
+	if (rows == obj->rows[pos])
+	{
+		return;
+	}
+	ltree_add_to_node(obj, pos, (long long)rows - (long long)obj->rows[pos]);
+	obj->rows[pos] = rows;
+}
+
+// Lays the lines out again, the ones that keep their row count cost nothing
+void ltree_update_lines(LayoutTree *obj, size_t pos, size_t count, const size_t *line_sizes)
+{
+	tassert(obj, "ltree_update_lines: obj is NULL");
+	tassert(pos + count <= obj->length, "ltree_update_lines: range is out of range");
+
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t rows = ltree_get_rows_for_size(obj, line_sizes[i]);
+		if (rows != obj->rows[pos+i])
+		{
+			ltree_add_to_node(obj, pos + i, (long long)rows - (long long)obj->rows[pos+i]);
+			obj->rows[pos+i] = rows;
+		}
+	}
+	if (pos <= obj->exact_length && pos + count > obj->exact_length)
+	{
+		obj->exact_length = pos + count;
+	}
+}
+
+void ltree_clear(LayoutTree *obj)
+{
+	tassert(obj, "ltree_clear: obj is NULL");
+
+	mem_add_used(MEM_LAYOUT, -(long long)(obj->length * LINE_BYTES));
+	obj->length = 0;
+	obj->exact_length = 0;
+}
+
+size_t ltree_get_size(const LayoutTree *obj)
+{
+	tassert(obj, "ltree_get_size: obj is NULL");
+
+	return obj->length;
+}
+
+size_t ltree_get_exact_length(const LayoutTree *obj)
+{
+	tassert(obj, "ltree_get_exact_length: obj is NULL");
+
+	return obj->exact_length;
+}
+
+size_t ltree_get_line_rows(const LayoutTree *obj, size_t pos)
+{
+	tassert(obj, "ltree_get_line_rows: obj is NULL");
+	tassert(pos < obj->length, "ltree_get_line_rows: pos is out of range");
+
+	return obj->rows[pos];
+}
+
+size_t ltree_get_rows_before(const LayoutTree *obj, size_t pos)
+{
+	tassert(obj, "ltree_get_rows_before: obj is NULL");
+	tassert(pos <= obj->length, "ltree_get_rows_before: pos is out of range");
+
+	size_t res = 0;
+	for (size_t i = pos; i > 0; i -= ltree_lowbit(i))
+	{
+		res += obj->tree[i];
+	}
+	return res;
+}
+
+size_t ltree_get_total_rows(const LayoutTree *obj)
+{
+	return ltree_get_rows_before(obj, obj->length);
+}
+
+size_t ltree_find_line(const LayoutTree *obj, size_t visual_row)
+{
+	tassert(obj, "ltree_find_line: obj is NULL");
+	tassert(obj->length > 0, "ltree_find_line: tree is empty");
+
+	// Finding the biggest prefix whose row count doesn't exceed visual_row, the line after it contains visual_row
+	size_t pos = 0;
+	size_t step = 1;
+	while ((step << 1) <= obj->length)
+	{
+		step <<= 1;
+	}
+	for (; step > 0; step >>= 1)
+	{
+		if (pos + step <= obj->length && obj->tree[pos + step] <= visual_row)
+		{
+			pos += step;
+			visual_row -= obj->tree[pos];
+		}
+	}
+	if (pos >= obj->length)
+	{
+		return obj->length - 1;
+	}
+	return pos;
+}
+
+void ltree_reserve(LayoutTree *obj, size_t length)
+{
+	if (length <= obj->reserved_length)
+	{
+		return;
+	}
+	size_t old_reserved_length = obj->reserved_length;
+	while (obj->reserved_length < length)
+	{
+		obj->reserved_length <<= 1;
+	}
+	obj->rows = mem_realloc(MEM_LAYOUT, obj->rows, old_reserved_length * sizeof(unsigned int), obj->reserved_length * sizeof(unsigned int));
+	obj->tree = mem_realloc(MEM_LAYOUT, obj->tree, (old_reserved_length + 1) * sizeof(size_t), (obj->reserved_length + 1) * sizeof(size_t));
+}
+
+void ltree_rebuild_from(LayoutTree *obj, size_t pos)
+{
+	// Every node covering a line after pos is rebuilt from its children, which are either
+	// untouched (before pos) or already rebuilt in this loop. Amortized O(length - pos).
+	for (size_t i = pos + 1; i <= obj->length; i++)
+	{
+		obj->tree[i] = ltree_compute_node(obj, i);
+	}
+}
+
+void ltree_update_rotated_range(LayoutTree *obj, size_t low, size_t high, size_t left)
+{
+	// Most lines take the same number of rows, so usually only a few positions actually change
+	// and updating those is cheaper than rebuilding every node of the range.
+	// The line that was at i before the rotation is now at i - left, or i + right for the first ones.
+	const unsigned int *rows = &obj->rows[low];
+	size_t right = high - low - left;
+	size_t changed = 0;
+	for (size_t i = 0; i < left; i++)
+	{
+		changed += rows[i] != rows[i + right];
+	}
+	for (size_t i = left; i < high - low; i++)
+	{
+		changed += rows[i] != rows[i - left];
+	}
+	size_t depth = 1;
+	while (((size_t)1 << depth) <= obj->length)
+	{
+		depth++;
+	}
+	if (changed * depth >= high - low)
+	{
+		ltree_rebuild_range(obj, low, high);
+		return;
+	}
+	for (size_t i = 0; i < high - low && changed > 0; i++)
+	{
+		unsigned int old_rows = i < left ? rows[i + right] : rows[i - left];
+		if (rows[i] != old_rows)
+		{
+			ltree_add_to_node(obj, low + i, (long long)rows[i] - (long long)old_rows);
+			changed--;
+		}
+	}
+}
+
+void ltree_rebuild_range(LayoutTree *obj, size_t low, size_t high)
+{
+	// Lines in [low, high) were reordered, their total didn't change. Only the nodes inside the range
+	// and the nodes after it that start inside it are stale, there is at most one of the latter per level.
+	for (size_t i = low + 1; i <= high; i++)
+	{
+		obj->tree[i] = ltree_compute_node(obj, i);
+	}
+	for (size_t step = 1; step <= obj->length; step <<= 1)
+	{
+		size_t i = (high / step + 1) * step;
+		if (i <= obj->length && ltree_lowbit(i) == step && i - step < high)
+		{
+			obj->tree[i] = ltree_compute_node(obj, i);
+		}
+	}
+}
+
+size_t ltree_compute_node(const LayoutTree *obj, size_t i)
+{
+	size_t sum = obj->rows[i-1];
+	for (size_t child = 1; child < ltree_lowbit(i); child <<= 1)
+	{
+		sum += obj->tree[i - child];
+	}
+	return sum;
+}
+
+void ltree_add_to_node(LayoutTree *obj, size_t pos, long long change)
+{
+	for (size_t i = pos + 1; i <= obj->length; i += ltree_lowbit(i))
+	{
+		obj->tree[i] += change;
+	}
+}
+
+size_t ltree_lowbit(size_t i)
+{
+	return i & (~i + 1);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <stdlib.h>
+
+/*
+ * Wrapped row count of every line, kept in a Fenwick tree so that
+ * file row <-> visual row conversions are O(log n).
+ *
+ * When the width changes the old row counts are kept as estimates, only the lines before
+ * exact_length are known to be laid out at the new width. Lines are laid out again with
+ * ltree_update_line(s), the sums stay consistent whichever lines are exact.
+ */
+typedef struct
+{
+	size_t width;
+	size_t length;
+	size_t reserved_length;
+	size_t exact_length; // Lines before this one have their rows at width
+	unsigned int *rows;  // Wrapped row count of each line
+	size_t *tree;        // Fenwick tree over rows (1-indexed)
+} LayoutTree;
+
+LayoutTree *ltree_create(size_t width);
+void ltree_destroy(LayoutTree *obj);
+void ltree_set_width(LayoutTree *obj, size_t width);
+
+size_t ltree_get_rows_for_size(const LayoutTree *obj, size_t line_size);
+
+void ltree_add_line(LayoutTree *obj, size_t line_size);
+void ltree_insert_line(LayoutTree *obj, size_t pos, size_t line_size);
+void ltree_remove_line(LayoutTree *obj, size_t pos);
+void ltree_insert_lines(LayoutTree *obj, size_t pos, size_t count, const size_t *line_sizes);
+void ltree_remove_lines(LayoutTree *obj, size_t pos, size_t count);
+void ltree_move_lines(LayoutTree *obj, size_t pos, size_t count, size_t to);
+void ltree_update_line(LayoutTree *obj, size_t pos, size_t line_size);
+void ltree_update_lines(LayoutTree *obj, size_t pos, size_t count, const size_t *line_sizes);
+void ltree_clear(LayoutTree *obj);
+
+size_t ltree_get_size(const LayoutTree *obj);
+size_t ltree_get_exact_length(const LayoutTree *obj);
+size_t ltree_get_line_rows(const LayoutTree *obj, size_t pos);
+size_t ltree_get_rows_before(const LayoutTree *obj, size_t pos);
+size_t ltree_get_total_rows(const LayoutTree *obj);
+size_t ltree_find_line(const LayoutTree *obj, size_t visual_row);
@@ -0,0 +1,112 @@
+/* Includes */
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "allocator.h"
+#include "error_handling.h"
+#include "line_cache.h"
+#include "sidecar.h"
+
+/* Definitions */
+#define LINE_CACHE_MAGIC       "TELC"
+#define LINE_CACHE_MAGIC_SIZE  4
+#define LINE_CACHE_HEADER_SIZE (LINE_CACHE_MAGIC_SIZE + sizeof(uint32_t) + 3 * sizeof(uint64_t))
+#define LINE_CACHE_WRITE_LINES 16384 // Counts written at once
+
+void lcache_get_path(const char *filename, char *path, size_t path_size)
+{
+	sidecar_get_path(filename, ".lines", path, path_size);
+}
+
+// Only the header is checked here, the line sizes are checked against the file when they are used. The word counts
+// are trusted, they were taken from the same lines
+bool lcache_load(LineCache *obj, const char *path, uint64_t file_hash, size_t file_size)
+{
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	struct stat state;
+	if (fd == -1 || fstat(fd, &state) == -1 || (size_t)state.st_size < LINE_CACHE_HEADER_SIZE)
+	{
+		if (fd != -1)
+		{
+			close(fd);
+		}
+		return false;
+	}
+	const char *data = mmap(NULL, state.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+	uint32_t version;
+	uint64_t header[3];
+	memcpy(&version, data + LINE_CACHE_MAGIC_SIZE, sizeof(version));
+	memcpy(header, data + LINE_CACHE_MAGIC_SIZE + sizeof(version), sizeof(header));
+	bool valid = memcmp(data, LINE_CACHE_MAGIC, LINE_CACHE_MAGIC_SIZE) == 0 && version == LINE_CACHE_VERSION
+		&& header[0] == file_hash && header[1] == file_size
+		&& (size_t)state.st_size == LINE_CACHE_HEADER_SIZE + 2 * header[2] * sizeof(uint32_t);
+	if (!valid)
+	{
+		munmap((void *)data, state.st_size);
+		return false;
+	}
+	obj->data = data;
+	obj->size = state.st_size;
+	obj->line_count = header[2];
+	obj->line_sizes = (const uint32_t *)(data + LINE_CACHE_HEADER_SIZE);
+	obj->line_words = obj->line_sizes + obj->line_count;
+	return true;
+}
+
+void lcache_unload(LineCache *obj)
+{
+	munmap((void *)obj->data, obj->size);
+	obj->data = NULL;
+}
+
+// Written next to the cache and renamed over it, so a cache is never seen half written. False when it couldn't be written
+bool lcache_write(const char *path, uint64_t file_hash, size_t file_size, const FileData *file_data)
+{
+	char temp_path[PATH_MAX + 8];
+	snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+	FILE *fp = fopen(temp_path, "w");
+	if (fp == NULL)
+	{
+		return false;
+	}
+	size_t line_count = fdata_get_line_count(file_data);
+	uint32_t version = LINE_CACHE_VERSION;
+	uint64_t header[3] = {file_hash, file_size, line_count};
+	fwrite(LINE_CACHE_MAGIC, 1, LINE_CACHE_MAGIC_SIZE, fp);
+	fwrite(&version, sizeof(version), 1, fp);
+	fwrite(header, sizeof(header), 1, fp);
+	uint32_t *counts = mem_alloc(MEM_OTHER, LINE_CACHE_WRITE_LINES * sizeof(uint32_t));
+	bool written = true;
+	// The sizes of every line and then their word counts
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (size_t row = 0; row < line_count && written; row += LINE_CACHE_WRITE_LINES)
+		{
+			size_t count = line_count - row < LINE_CACHE_WRITE_LINES ? line_count - row : LINE_CACHE_WRITE_LINES;
+			for (size_t i = 0; i < count && written; i++)
+			{
+				size_t value = pass == 0 ? fdata_get_line_size(file_data, row + i) : fdata_get_line_words(file_data, row + i);
+				written = value <= UINT32_MAX;
+				counts[i] = value;
+			}
+			written = written && fwrite(counts, sizeof(uint32_t), count, fp) == count;
+		}
+	}
+	mem_free(MEM_OTHER, counts, LINE_CACHE_WRITE_LINES * sizeof(uint32_t));
+	written = fclose(fp) == 0 && written;
+	if (!written || rename(temp_path, path) != 0)
+	{
+		unlink(temp_path);
+		return false;
+	}
+	return true;
+}
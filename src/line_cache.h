@@ -0,0 +1,33 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "file_data.h"
+
+#define LINE_CACHE_MIN_SIZE (16 << 20) // Smaller files are read fast enough without a cache
+#define LINE_CACHE_VERSION  2
+
+/*
+ * Sidecar kept next to a big file with the size and the word count of every one of its lines, so the
+ * file can be opened again without being split into lines: it's read in one go, its lines are taken
+ * from where the sizes say and its statistics are added up from the counts.
+ *
+ *   header: "TELC" <u32 version> <u64 hash of the file state> <u64 size of the file> <u64 line count>
+ *   then:   <u32 size> of every line, then <u32 word count> of every line
+ *
+ * The wrapped row counts of the lines follow from their sizes, so they aren't kept. A cache only
+ * applies to the exact file state it was written for (see hash_file_state), anything else is ignored.
+ */
+typedef struct
+{
+	const char *data; // The mapping of the whole cache
+	size_t size;
+	size_t line_count;
+	const uint32_t *line_sizes;
+	const uint32_t *line_words;
+} LineCache;
+
+void lcache_get_path(const char *filename, char *path, size_t path_size);
+bool lcache_load(LineCache *obj, const char *path, uint64_t file_hash, size_t file_size);
+void lcache_unload(LineCache *obj);
+bool lcache_write(const char *path, uint64_t file_hash, size_t file_size, const FileData *file_data);
@@ -0,0 +1,183 @@
+/* Includes */
+#include <stdint.h>
+#include <string.h>
+#include "allocator.h"
+#include "hashing.h"
+#include "line_diff.h"
+
+/* Definitions */
+#define DIFF_FIRST_WINDOW 64 // Lines looked at on both sides for the end of a changed block, doubled until it's found
+
+/* Private Function Declarations */
+const char *ldiff_read_text_line(void *lines, size_t row, size_t *size);
+bool ldiff_find_common_line(const LineSource *old_lines, size_t *row, size_t row_end, const LineSource *new_lines, size_t *new_row, size_t new_row_end);
+
+LineSource ldiff_text_source(TextLines *text_lines, size_t line_count)
+{
+	return (LineSource) {.read = ldiff_read_text_line, .hashes = NULL, .lines = text_lines, .count = line_count};
+}
+
+LineSource ldiff_hash_source(const uint64_t *hashes, size_t line_count)
+{
+	return (LineSource) {.read = NULL, .hashes = hashes, .lines = NULL, .count = line_count};
+}
+
+const char *ldiff_read_text_line(void *lines, size_t row, size_t *size)
+{
+	const TextLines *text_lines = lines;
+	*size = text_lines->line_starts[row + 1] - 1 - text_lines->line_starts[row];
+	return text_lines->text + text_lines->line_starts[row];
+}
+
+uint64_t ldiff_get_line_hash(const LineSource *lines, size_t row)
+{
+	if (lines->read == NULL)
+	{
+		return lines->hashes[row];
+	}
+	size_t size;
+	const char *line = lines->read(lines->lines, row, &size);
+	return hash_bytes(HASH_INITIAL_VALUE, size, line);
+}
+
+bool ldiff_is_same_line(const LineSource *a, size_t row, const LineSource *b, size_t new_row)
+{
+	if (a->read == NULL || b->read == NULL)
+	{
+		return ldiff_get_line_hash(a, row) == ldiff_get_line_hash(b, new_row);
+	}
+	size_t size, new_size;
+	const char *line = a->read(a->lines, row, &size);
+	const char *new_line = b->read(b->lines, new_row, &new_size);
+	return size == new_size && memcmp(line, new_line, size) == 0;
+}
+
+// Blocks of lines that differ, as few lines as it finds. Lines that are the same stay out of the hunks
+void ldiff_find_hunks(const LineSource *old_lines, const LineSource *new_lines, HunkArray *hunks)
+{
+	harr_clear(hunks);
+	// The lines before and after the changes are skipped without hashing them
+	size_t first = 0;
+	size_t row_end = old_lines->count;
+	size_t new_row_end = new_lines->count;
+	while (first < row_end && first < new_row_end && ldiff_is_same_line(old_lines, first, new_lines, first))
+	{
+		first++;
+	}
+	while (row_end > first && new_row_end > first && ldiff_is_same_line(old_lines, row_end - 1, new_lines, new_row_end - 1))
+	{
+		row_end--;
+		new_row_end--;
+	}
+	size_t row = first;
+	size_t new_row = first;
+	while (row < row_end || new_row < new_row_end)
+	{
+		if (row < row_end && new_row < new_row_end && ldiff_is_same_line(old_lines, row, new_lines, new_row))
+		{
+			row++;
+			new_row++;
+			continue;
+		}
+		size_t common_row = row;
+		size_t common_new_row = new_row;
+		if (!ldiff_find_common_line(old_lines, &common_row, row_end, new_lines, &common_new_row, new_row_end))
+		{
+			common_row = row_end;
+			common_new_row = new_row_end;
+		}
+		harr_add(hunks, (LineHunk) {.row = row, .old_count = common_row - row, .new_row = new_row, .new_count = common_new_row - new_row});
+		row = common_row;
+		new_row = common_new_row;
+	}
+}
+
+// Finds the first line after row that is also in the new lines after new_row, looking further every time it fails
+bool ldiff_find_common_line(const LineSource *old_lines, size_t *row, size_t row_end, const LineSource *new_lines, size_t *new_row, size_t new_row_end)
+{
+	for (size_t window = DIFF_FIRST_WINDOW; *row < row_end && *new_row < new_row_end; window *= 2)
+	{
+		size_t row_stop = *row + window < row_end ? *row + window : row_end;
+		size_t new_row_stop = *new_row + window < new_row_end ? *new_row + window : new_row_end;
+		// The new lines go in an open addressed table, the first of the lines with the same hash stays
+		size_t capacity = 1;
+		while (capacity < 2 * (new_row_stop - *new_row))
+		{
+			capacity <<= 1;
+		}
+		uint64_t *hashes = mem_alloc(MEM_OTHER, capacity * sizeof(uint64_t));
+		size_t *rows = mem_alloc(MEM_OTHER, capacity * sizeof(size_t));
+		memset(rows, 0xff, capacity * sizeof(size_t));
+		for (size_t i = *new_row; i < new_row_stop; i++)
+		{
+			uint64_t hash = ldiff_get_line_hash(new_lines, i);
+			size_t slot = hash & (capacity - 1);
+			while (rows[slot] != SIZE_MAX && hashes[slot] != hash)
+			{
+				slot = (slot + 1) & (capacity - 1);
+			}
+			if (rows[slot] == SIZE_MAX)
+			{
+				hashes[slot] = hash;
+				rows[slot] = i;
+			}
+		}
+		bool found = false;
+		for (size_t i = *row; i < row_stop && !found; i++)
+		{
+			uint64_t hash = ldiff_get_line_hash(old_lines, i);
+			size_t slot = hash & (capacity - 1);
+			while (rows[slot] != SIZE_MAX && hashes[slot] != hash)
+			{
+				slot = (slot + 1) & (capacity - 1);
+			}
+			if (rows[slot] != SIZE_MAX && ldiff_is_same_line(old_lines, i, new_lines, rows[slot]))
+			{
+				*row = i;
+				*new_row = rows[slot];
+				found = true;
+			}
+		}
+		mem_free(MEM_OTHER, hashes, capacity * sizeof(uint64_t));
+		mem_free(MEM_OTHER, rows, capacity * sizeof(size_t));
+		if (found)
+		{
+			return true;
+		}
+		if (row_stop == row_end && new_row_stop == new_row_end)
+		{
+			return false;
+		}
+	}
+	return false;
+}
+
+// Changes to the same lines of a text overlap. A line inserted next to or into a changed block does too, it can't be
+// told which side of the change it goes on
+bool ldiff_hunks_overlap(const LineHunk *a, const LineHunk *b)
+{
+	size_t a_end = a->row + a->old_count;
+	size_t b_end = b->row + b->old_count;
+	if (a->old_count == 0 || b->old_count == 0)
+	{
+		return a->row <= b_end && b->row <= a_end;
+	}
+	return a->row < b_end && b->row < a_end;
+}
+
+// Hunks from the same lines that replace the same rows with the same lines
+bool ldiff_is_same_change(const LineSource *a, const LineHunk *a_hunk, const LineSource *b, const LineHunk *b_hunk)
+{
+	if (a_hunk->row != b_hunk->row || a_hunk->old_count != b_hunk->old_count || a_hunk->new_count != b_hunk->new_count)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < a_hunk->new_count; i++)
+	{
+		if (!ldiff_is_same_line(a, a_hunk->new_row + i, b, b_hunk->new_row + i))
+		{
+			return false;
+		}
+	}
+	return true;
+}
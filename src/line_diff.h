@@ -0,0 +1,45 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "typed_array.h"
+
+/* Lines of a patch that differ from the lines before it, row and new_row are where they start before and after */
+typedef struct
+{
+	size_t row;
+	size_t old_count;
+	size_t new_row;
+	size_t new_count;
+} LineHunk;
+
+DEFINE_TYPED_ARRAY(HunkArray, harr, LineHunk)
+
+typedef const char *(*LineReader)(void *lines, size_t row, size_t *size);
+
+/*
+ * Lines that are diffed, whatever keeps them. A line that was read is valid until the next line of the same source is
+ * read. Lines that are gone can still be diffed through their hashes, they are told apart from other lines by hash only
+ */
+typedef struct
+{
+	LineReader read;        // NULL when only the hashes are kept
+	const uint64_t *hashes; // Of every line when read is NULL
+	void *lines;
+	size_t count;
+} LineSource;
+
+/* Lines of a text, line_starts has the start of the line after the last one too */
+typedef struct
+{
+	const char *text;
+	const size_t *line_starts;
+} TextLines;
+
+LineSource ldiff_text_source(TextLines *text_lines, size_t line_count);
+LineSource ldiff_hash_source(const uint64_t *hashes, size_t line_count);
+uint64_t ldiff_get_line_hash(const LineSource *lines, size_t row);
+bool ldiff_is_same_line(const LineSource *a, size_t row, const LineSource *b, size_t new_row);
+void ldiff_find_hunks(const LineSource *old_lines, const LineSource *new_lines, HunkArray *hunks);
+bool ldiff_hunks_overlap(const LineHunk *a, const LineHunk *b);
+bool ldiff_is_same_change(const LineSource *a, const LineHunk *a_hunk, const LineSource *b, const LineHunk *b_hunk);
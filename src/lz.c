@@ -0,0 +1,150 @@
+/* Includes */
+#include <stdint.h>
+#include <string.h>
+#include "lz.h"
+
+/* Definitions */
+#define LZ_HASH_BITS 12
+
+/* Private Function Declarations */
+uint32_t lz_read_u32(const char *p);
+char *lz_write_length(char *out, size_t length);
+char *lz_write_sequence(char *out, size_t literal_count, const char *literals, size_t offset, size_t match_length);
+size_t lz_read_length(const unsigned char **in);
+
+size_t lz_get_max_compressed_size(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+// Only the last position of every 4 bytes is remembered, a match is taken as soon as one is found
+size_t lz_compress(size_t size, const char *src, char *dst)
+{
+	uint32_t table[1 << LZ_HASH_BITS];
+	memset(table, 0, sizeof(table));
+	char *out = dst;
+	size_t anchor = 0;
+	size_t pos = 0;
+	while (pos + LZ_MIN_MATCH <= size)
+	{
+		uint32_t sequence = lz_read_u32(src + pos);
+		uint32_t slot = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+		size_t candidate = table[slot];
+		table[slot] = pos;
+		if (candidate >= pos || pos - candidate > LZ_MAX_OFFSET || lz_read_u32(src + candidate) != sequence)
+		{
+			pos++;
+			continue;
+		}
+		size_t length = LZ_MIN_MATCH;
+		while (pos + length < size && src[candidate + length] == src[pos + length])
+		{
+			length++;
+		}
+		out = lz_write_sequence(out, pos - anchor, src + anchor, pos - candidate, length);
+		pos += length;
+		anchor = pos;
+	}
+	out = lz_write_sequence(out, size - anchor, src + anchor, 0, 0);
+	return out - dst;
+}
+
+// dst has to fit the whole text, the size it was compressed from isn't kept in the data
+void lz_decompress(size_t size, const char *src, char *dst)
+{
+	const unsigned char *in = (const unsigned char *)src;
+	const unsigned char *end = in + size;
+	char *out = dst;
+	while (in < end)
+	{
+		unsigned token = *in++;
+		size_t literal_count = token >> 4;
+		if (literal_count == 15)
+		{
+			literal_count += lz_read_length(&in);
+		}
+		memcpy(out, in, literal_count);
+		out += literal_count;
+		in += literal_count;
+		if (in == end)
+		{
+			return;
+		}
+		size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+		size_t match_length = token & 15;
+		if (match_length == 15)
+		{
+			match_length += lz_read_length(&in);
+		}
+		match_length += LZ_MIN_MATCH;
+		const char *match = out - offset;
+		// A match that overlaps its own output repeats the bytes before it, which has to go a byte at a time
+		if (offset >= match_length)
+		{
+			memcpy(out, match, match_length);
+		}
+		else
+		{
+			for (size_t i = 0; i < match_length; i++)
+			{
+				out[i] = match[i];
+			}
+		}
+		out += match_length;
+	}
+}
+
+uint32_t lz_read_u32(const char *p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+char *lz_write_length(char *out, size_t length)
+{
+	for (; length >= 255; length -= 255)
+	{
+		*out++ = (char)255;
+	}
+	*out++ = (char)length;
+	return out;
+}
+
+// A match_length of 0 writes the last sequence, which has no match
+char *lz_write_sequence(char *out, size_t literal_count, const char *literals, size_t offset, size_t match_length)
+{
+	size_t match_code = match_length == 0 ? 0 : match_length - LZ_MIN_MATCH;
+	char *token = out++;
+	*token = (char)(((literal_count < 15 ? literal_count : 15) << 4) | (match_code < 15 ? match_code : 15));
+	if (literal_count >= 15)
+	{
+		out = lz_write_length(out, literal_count - 15);
+	}
+	memcpy(out, literals, literal_count);
+	out += literal_count;
+	if (match_length == 0)
+	{
+		return out;
+	}
+	*out++ = (char)(offset & 0xff);
+	*out++ = (char)(offset >> 8);
+	if (match_code >= 15)
+	{
+		out = lz_write_length(out, match_code - 15);
+	}
+	return out;
+}
+
+size_t lz_read_length(const unsigned char **in)
+{
+	size_t length = 0;
+	unsigned byte;
+	do
+	{
+		byte = *(*in)++;
+		length += byte;
+	} while (byte == 255);
+	return length;
+}
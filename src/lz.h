@@ -0,0 +1,18 @@
+#pragma once
+#include <stdlib.h>
+
+#define LZ_MIN_MATCH  4
+#define LZ_MAX_OFFSET 0xffff
+
+/*
+ * Small LZ77 codec for text that is kept compressed in memory, fast on both sides rather than small.
+ *
+ *   sequence: <u8 token> [literal length bytes] <literals> [<u16 offset> [match length bytes]]
+ *
+ * The high nibble of the token is the literal count and the low one the match length minus
+ * LZ_MIN_MATCH, a nibble of 15 goes on in bytes after it, every 255 byte adding another one.
+ * The last sequence only has literals.
+ */
+size_t lz_get_max_compressed_size(size_t size);
+size_t lz_compress(size_t size, const char *src, char *dst);
+void lz_decompress(size_t size, const char *src, char *dst);
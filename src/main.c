@@ -1,12 +1,21 @@
 /*  Includes */
+#include <string.h>
+#include "allocator.h"
+#include "batch.h"
 #include "definitions.h"
 #include "error_handling.h"
 #include "terminal.h"
 #include "editor.h"
+#include "key_trace.h"
+#include "pipeline.h"
+#include "profiler.h"
+#include "undo_log.h"
+#include "viewer.h"
 
 static IO_Interface terminal_interface = 
 {
 	.read_key = terminal_read_key,
+	.poll_key = terminal_poll_key,
 	.render_row = terminal_render_row,
 	.flush_output = terminal_flush_output,
 	.set_cursor_position = terminal_set_cursor_position,
@@ -20,15 +29,107 @@ int main(int argc, char **argv)
 #ifdef DEBUGGING
 	setvbuf(stderr, NULL, _IONBF, 0);
 #endif
-	if (argc < 2)
+	// Batch mode edits files without a terminal: --batch <script> <file>...
+	if (argc >= 2 && strcmp(argv[1], "--batch") == 0)
+	{
+		if (argc < 4)
+		{
+			printf("Usage: %s --batch <key script> <file>...\n", argv[0]);
+			return 1;
+		}
+		BatchReport report;
+		if (!batch_run(argv[2], argc - 3, argv + 3, batch_get_default_thread_count(), &report))
+		{
+			printf("Couldn't read the key script %s\n", argv[2]);
+			return 1;
+		}
+		batch_print_report(&report, stdout);
+		return report.failed_count > 0;
+	}
+	// View mode shows a file without reading it into lines: --view <file>
+	if (argc >= 2 && strcmp(argv[1], "--view") == 0)
+	{
+		if (argc < 3)
+		{
+			printf("Usage: %s --view <file>\n", argv[0]);
+			return 1;
+		}
+		terminal_init();
+		Viewer *viewer = viewer_create(argv[2], get_window_size(), terminal_interface);
+		if (viewer == NULL)
+		{
+			terminal_terminate();
+			printf("Couldn't open %s\n", argv[2]);
+			return 1;
+		}
+		terminal_clear_screen();
+		while (viewer_process_tick(viewer) == TEXT_EDITOR_SUCCESSFUL_READ)
+		{
+			viewer_render_screen(viewer);
+		}
+		viewer_destroy(viewer);
+		terminal_reveal_cursor();
+		terminal_terminate();
+		system("clear");
+		return 0;
+	}
+	const char *trace_filename = NULL;
+	const char *first_filename = NULL;
+	size_t undo_budget = UNDO_DEFAULT_BUDGET;
+	bool follow = false;
+	// Every argument that isn't an option is a file to open, the first one is shown
+	bool is_file[argc];
+	for (int i = 1; i < argc; i++)
+	{
+		is_file[i] = false;
+		if (strcmp(argv[i], "--record-trace") == 0 && i + 1 < argc)
+		{
+			trace_filename = argv[++i];
+		}
+		else if (strcmp(argv[i], "--undo-budget") == 0 && i + 1 < argc)
+		{
+			undo_budget = strtoull(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--follow") == 0)
+		{
+			follow = true;
+		}
+		else
+		{
+			is_file[i] = true;
+			first_filename = first_filename == NULL ? argv[i] : first_filename;
+		}
+	}
+	if (first_filename == NULL)
 	{
 		printf("You need to include the file name as the second argument\n");
 		return 0;
 	}
 	terminal_init();
 	vec2 window_size = get_window_size();
-	Editor *editor = editor_create(window_size, terminal_interface);
-	editor_read_file(editor, argv[1]);
+	// Keys are read and frames are sent to the terminal on threads of their own
+	pline_start(window_size, terminal_interface);
+	IO_Interface io_interface = pline_get_interface();
+	if (trace_filename != NULL)
+	{
+		io_interface = ktrace_start_recording(io_interface, trace_filename, first_filename, window_size);
+	}
+	Editor *editor = editor_create(window_size, io_interface);
+	editor_set_undo_budget(editor, undo_budget);
+	editor_enable_journal(editor);
+	editor_enable_file_watch(editor);
+	if (follow)
+	{
+		editor_enable_follow(editor);
+	}
+	// Only the first file is read now, the others when they are switched to
+	for (int i = 1; i < argc; i++)
+	{
+		if (is_file[i])
+		{
+			editor_open_file(editor, argv[i]);
+		}
+	}
 	editor_clear_screen(editor);
 	int user_input_res;
 	do
@@ -36,11 +137,22 @@ int main(int argc, char **argv)
 		user_input_res = editor_process_tick(editor);
 		editor_render_screen(editor);
 	} while (user_input_res == TEXT_EDITOR_SUCCESSFUL_READ);
-	editor_write_file(editor, argv[1]);
+	ktrace_stop_recording();
+	bool saved = editor_save_all(editor);
 	editor_clear_screen(editor);
+	pline_stop();
 	editor_destroy(editor);
 	terminal_terminate();
 	system("clear");
+	if (!saved)
+	{
+		printf("Some files couldn't be saved, their edits are kept in their journals or in " CONFLICT_SUFFIX " files next to them\n");
+	}
+	mem_print_summary(stderr);
+#ifdef PROFILING
+	profiler_write_trace(PROFILE_OUTPUT_FILE);
+	profiler_shutdown();
+#endif
 	return 0;
 }
 
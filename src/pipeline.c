@@ -0,0 +1,514 @@
+/* Includes */
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "allocator.h"
+#include "dynamic_buffer.h"
+#include "error_handling.h"
+#include "pipeline.h"
+#include "spsc_ring.h"
+
+/* Definitions */
+#define PIPELINE_FULL_WAIT_US 1000 // How long the input thread sleeps when the editor is behind by a whole key ring
+
+typedef struct
+{
+	vec2 size;         // Of the screen when the frame was published, frames of another size are drawn after a clear
+	char *cells;       // Row r is cells[r * stride], row_sizes[r] bytes of it are shown
+	size_t *row_sizes;
+	size_t stride;     // Bytes of cells a row has room for, escape sequences take no columns so a row can be wider
+	vec2 cursor;
+	bool cursor_shown;
+	size_t clear_count; // Clears since the start, a frame with more than the frame drawn last is drawn after a clear
+} Frame;
+
+DEFINE_SPSC_RING(KeyRing, kring, int)
+DEFINE_SPSC_RING(FrameRing, fring, Frame*)
+
+/* Global Data */
+static IO_Interface output;
+static Frame screen;          // What the editor drew, only the editor thread touches it
+static DynamicBuffer *row_text; // What render_row keeps of a row, before it's compared with the screen
+static bool rows_changed;     // Since the last published frame
+static Frame published;       // Cursor and clears of the last published frame, its rows aren't kept
+static Frame *frames[PIPELINE_FRAME_COUNT];
+static KeyRing *keys;
+static FrameRing *ready_frames; // From the editor to the renderer
+static FrameRing *free_frames;  // Back from the renderer
+static sem_t keys_ready;
+static sem_t frames_ready;
+static atomic_bool stopping;
+static atomic_size_t published_count;
+static atomic_size_t drawn_count;
+static pthread_t input_thread;
+static pthread_t render_thread;
+
+/* Private Function Declarations */
+Frame *pline_create_frame();
+void pline_destroy_frame(Frame *frame);
+void pline_allocate_cells(Frame *frame, vec2 size, size_t stride);
+void pline_free_cells(Frame *frame);
+void pline_resize_screen(vec2 size);
+void pline_widen_screen(size_t stride);
+void *pline_read_input(void *arg);
+void *pline_render(void *arg);
+void pline_draw(const Frame *shown, const Frame *frame);
+int  pline_read_key();
+int  pline_poll_key();
+void pline_render_row(int row_id, size_t size, const char *row);
+void pline_cut_row(size_t size, const char *row, size_t width, DynamicBuffer *out);
+size_t pline_get_escape_size(size_t size, const char *text);
+unsigned pline_apply_sgr(unsigned attributes, size_t size, const char *sgr);
+void pline_flush_output();
+bool pline_publish();
+void pline_set_cursor_position(int x, int y);
+void pline_hide_cursor();
+void pline_reveal_cursor();
+void pline_clear_screen();
+
+// Keys are read with output.read_key, which may block for a while like the terminal's read does
+void pline_start(vec2 window_size, IO_Interface _output)
+{
+	output = _output;
+	pline_allocate_cells(&screen, window_size, window_size.x);
+	memset(screen.row_sizes, 0, screen.size.y * sizeof(size_t));
+	screen.cursor = (vec2) {.x = 0, .y = 0};
+	screen.cursor_shown = true;
+	screen.clear_count = 0;
+	published = screen;
+	rows_changed = true;
+	row_text = dbuf_create(MEM_TERMINAL);
+	keys = kring_create(MEM_TERMINAL, PIPELINE_KEY_CAPACITY);
+	ready_frames = fring_create(MEM_TERMINAL, PIPELINE_FRAME_COUNT);
+	free_frames = fring_create(MEM_TERMINAL, PIPELINE_FRAME_COUNT);
+	for (size_t i = 0; i < PIPELINE_FRAME_COUNT; i++)
+	{
+		frames[i] = pline_create_frame();
+		fring_push(free_frames, frames[i]);
+	}
+	sem_init(&keys_ready, 0, 0);
+	sem_init(&frames_ready, 0, 0);
+	atomic_store(&stopping, false);
+	atomic_store(&published_count, 0);
+	atomic_store(&drawn_count, 0);
+	if (pthread_create(&input_thread, NULL, pline_read_input, NULL) != 0 || pthread_create(&render_thread, NULL, pline_render, NULL) != 0)
+	{
+		throw_up("pline_start: couldn't start the threads");
+	}
+}
+
+// Draws the last frame the editor drew, keys that were read but not taken are dropped
+void pline_stop()
+{
+	while (!pline_publish())
+	{
+		sched_yield();
+	}
+	atomic_store(&stopping, true);
+	sem_post(&frames_ready);
+	pthread_join(render_thread, NULL);
+	pthread_join(input_thread, NULL);
+	sem_destroy(&keys_ready);
+	sem_destroy(&frames_ready);
+	for (size_t i = 0; i < PIPELINE_FRAME_COUNT; i++)
+	{
+		pline_destroy_frame(frames[i]);
+	}
+	kring_destroy(keys);
+	fring_destroy(ready_frames);
+	fring_destroy(free_frames);
+	pline_free_cells(&screen);
+	dbuf_destroy(row_text);
+}
+
+IO_Interface pline_get_interface()
+{
+	return (IO_Interface)
+	{
+		.read_key = pline_read_key,
+		.poll_key = pline_poll_key,
+		.render_row = pline_render_row,
+		.flush_output = pline_flush_output,
+		.set_cursor_position = pline_set_cursor_position,
+		.hide_cursor = pline_hide_cursor,
+		.reveal_cursor = pline_reveal_cursor,
+		.clear_screen = pline_clear_screen,
+	};
+}
+
+size_t pline_get_published_frame_count()
+{
+	return atomic_load(&published_count);
+}
+
+size_t pline_get_drawn_frame_count()
+{
+	return atomic_load(&drawn_count);
+}
+
+Frame *pline_create_frame()
+{
+	Frame *frame = mem_alloc(MEM_TERMINAL, sizeof(Frame));
+	pline_allocate_cells(frame, screen.size, screen.stride);
+	return frame;
+}
+
+void pline_destroy_frame(Frame *frame)
+{
+	pline_free_cells(frame);
+	mem_free(MEM_TERMINAL, frame, sizeof(Frame));
+}
+
+void pline_allocate_cells(Frame *frame, vec2 size, size_t stride)
+{
+	frame->size = size;
+	frame->stride = stride;
+	frame->cells = mem_alloc(MEM_TERMINAL, stride * size.y);
+	frame->row_sizes = mem_alloc(MEM_TERMINAL, size.y * sizeof(size_t));
+}
+
+void pline_free_cells(Frame *frame)
+{
+	mem_free(MEM_TERMINAL, frame->cells, frame->stride * frame->size.y);
+	mem_free(MEM_TERMINAL, frame->row_sizes, frame->size.y * sizeof(size_t));
+}
+
+// The screen starts out empty at its new size, the editor draws every row after a resize anyway.
+// Frames are given the new size when they are published next, the renderer may still hold old ones
+void pline_resize_screen(vec2 size)
+{
+	pline_free_cells(&screen);
+	pline_allocate_cells(&screen, size, size.x);
+	memset(screen.row_sizes, 0, size.y * sizeof(size_t));
+	rows_changed = true;
+}
+
+// The rows are kept, the stride is at least doubled so a few highlighted rows don't widen it one by one
+void pline_widen_screen(size_t stride)
+{
+	Frame widened;
+	stride = stride > 2 * screen.stride ? stride : 2 * screen.stride;
+	pline_allocate_cells(&widened, screen.size, stride);
+	for (int row = 0; row < screen.size.y; row++)
+	{
+		memcpy(widened.cells + (size_t)row * stride, screen.cells + (size_t)row * screen.stride, screen.row_sizes[row]);
+	}
+	memcpy(widened.row_sizes, screen.row_sizes, screen.size.y * sizeof(size_t));
+	pline_free_cells(&screen);
+	screen.cells = widened.cells;
+	screen.row_sizes = widened.row_sizes;
+	screen.stride = stride;
+}
+
+// Timeouts of the read aren't keys, every key the editor is sent is queued even while it's behind
+void *pline_read_input(void *arg)
+{
+	while (!atomic_load(&stopping))
+	{
+		int c = output.read_key();
+		if (c == NUL)
+		{
+			sched_yield();
+			continue;
+		}
+		while (!kring_push(keys, c) && !atomic_load(&stopping))
+		{
+			usleep(PIPELINE_FULL_WAIT_US);
+		}
+		sem_post(&keys_ready);
+	}
+	return NULL;
+}
+
+// Frames that were published while the last one was drawn are dropped, only the newest one is drawn
+void *pline_render(void *arg)
+{
+	Frame *shown = NULL;
+	while (true)
+	{
+		sem_wait(&frames_ready);
+		Frame *newest = NULL;
+		Frame *frame;
+		while (fring_pop(ready_frames, &frame))
+		{
+			if (newest != NULL)
+			{
+				fring_push(free_frames, newest);
+			}
+			newest = frame;
+		}
+		// Every frame is published before the pipeline is stopped, so there's nothing left to draw then
+		if (newest == NULL)
+		{
+			if (atomic_load(&stopping))
+			{
+				break;
+			}
+			continue;
+		}
+		pline_draw(shown, newest);
+		atomic_fetch_add(&drawn_count, 1);
+		if (shown != NULL)
+		{
+			fring_push(free_frames, shown);
+		}
+		shown = newest;
+	}
+	if (shown != NULL)
+	{
+		fring_push(free_frames, shown);
+	}
+	return NULL;
+}
+
+// Only the rows that differ from the frame drawn last are sent, all of them after a clear or a resize
+void pline_draw(const Frame *shown, const Frame *frame)
+{
+	output.hide_cursor();
+	bool resized = shown != NULL && (shown->size.x != frame->size.x || shown->size.y != frame->size.y);
+	bool cleared = resized || frame->clear_count != (shown != NULL ? shown->clear_count : 0);
+	if (cleared)
+	{
+		output.clear_screen();
+	}
+	for (int row = 0; row < frame->size.y; row++)
+	{
+		size_t size = frame->row_sizes[row];
+		const char *text = frame->cells + (size_t)row * frame->stride;
+		bool same = shown != NULL && !cleared && shown->row_sizes[row] == size && memcmp(shown->cells + (size_t)row * shown->stride, text, size) == 0;
+		// A cleared row is already empty
+		if (!same && !(cleared && size == 0))
+		{
+			output.render_row(row, size, text);
+		}
+	}
+	if (frame->cursor_shown)
+	{
+		output.reveal_cursor();
+	}
+	output.set_cursor_position(frame->cursor.x, frame->cursor.y);
+	output.flush_output();
+}
+
+// Waits for a key for PIPELINE_TICK_MS at most, NUL when none came
+int pline_read_key()
+{
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_nsec += PIPELINE_TICK_MS * 1000000L;
+	deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+	deadline.tv_nsec %= 1000000000L;
+	while (sem_timedwait(&keys_ready, &deadline) == -1)
+	{
+		if (errno != EINTR)
+		{
+			return NUL;
+		}
+	}
+	int c;
+	kring_pop(keys, &c);
+	if (IS_RESIZE_KEY(c))
+	{
+		pline_resize_screen(GET_RESIZE_KEY_SIZE(c));
+	}
+	return c;
+}
+
+int pline_poll_key()
+{
+	if (sem_trywait(&keys_ready) == -1)
+	{
+		return NUL;
+	}
+	int c;
+	kring_pop(keys, &c);
+	if (IS_RESIZE_KEY(c))
+	{
+		pline_resize_screen(GET_RESIZE_KEY_SIZE(c));
+	}
+	return c;
+}
+
+// Rows are cut at the width of the screen, a longer row would wrap over the next one anyway
+void pline_render_row(int row_id, size_t size, const char *row)
+{
+	if (row_id < 0 || row_id >= screen.size.y)
+	{
+		return;
+	}
+	pline_cut_row(size, row, screen.size.x, row_text);
+	size = dbuf_get_size(row_text);
+	if (size > screen.stride)
+	{
+		pline_widen_screen(size);
+	}
+	char *cells = screen.cells + (size_t)row_id * screen.stride;
+	if (screen.row_sizes[row_id] == size && memcmp(cells, dbuf_get_with_nulc(row_text, 0), size) == 0)
+	{
+		return;
+	}
+	memcpy(cells, dbuf_get_with_nulc(row_text, 0), size);
+	screen.row_sizes[row_id] = size;
+	rows_changed = true;
+}
+
+// Escape sequences take no columns, so the width is counted without them. Every one of them is kept, an attribute
+// the row turns off after the cut is still turned off. One that is still on at the end is turned off with a reset,
+// or the line clear after the row and the rows below would take it on
+void pline_cut_row(size_t size, const char *row, size_t width, DynamicBuffer *out)
+{
+	dbuf_clear(out);
+	size_t columns = 0;
+	unsigned attributes = 0;
+	for (size_t i = 0; i < size;)
+	{
+		size_t escape_size = pline_get_escape_size(size - i, row + i);
+		if (escape_size == 0)
+		{
+			if (columns < width)
+			{
+				dbuf_addc(out, row[i]);
+			}
+			columns++;
+			i++;
+			continue;
+		}
+		if (escape_size > 2 && row[i + 1] == '[' && row[i + escape_size - 1] == 'm')
+		{
+			attributes = pline_apply_sgr(attributes, escape_size, row + i);
+		}
+		dbuf_adds(out, escape_size, row + i);
+		i += escape_size;
+	}
+	if (attributes != 0)
+	{
+		dbuf_adds(out, 3, "\x1b[m");
+	}
+}
+
+// 0 when text doesn't start with an escape sequence. A control sequence runs up to its final byte, the rest of text
+// when it's cut before that
+size_t pline_get_escape_size(size_t size, const char *text)
+{
+	if (text[0] != ESCAPE_KEY)
+	{
+		return 0;
+	}
+	if (size < 2 || text[1] != '[')
+	{
+		return size < 2 ? size : 2;
+	}
+	size_t i = 2;
+	while (i < size && (text[i] < 0x40 || text[i] > 0x7e))
+	{
+		i++;
+	}
+	return i < size ? i + 1 : size;
+}
+
+// The attributes left on after the SGR sequence "\x1b[<codes>m". Bit n is code n, bold is 1 and reverse video is 7.
+// Bit 0 stands for colors and every other code, they are only turned off by a reset
+unsigned pline_apply_sgr(unsigned attributes, size_t size, const char *sgr)
+{
+	// Codes are separated by ';', an empty one is a reset
+	for (size_t i = 2; i < size; i++)
+	{
+		unsigned code = 0;
+		for (; i < size && sgr[i] >= '0' && sgr[i] <= '9'; i++)
+		{
+			code = code < 1000 ? code * 10 + (sgr[i] - '0') : code;
+		}
+		if (code == 0)
+		{
+			attributes = 0;
+		}
+		else if (code <= 9)
+		{
+			attributes |= 1u << code;
+		}
+		else if (code == 22)
+		{
+			attributes &= ~(1u << 1 | 1u << 2);
+		}
+		else if (code == 25)
+		{
+			attributes &= ~(1u << 5 | 1u << 6);
+		}
+		else if (code >= 23 && code <= 29)
+		{
+			attributes &= ~(1u << (code - 20));
+		}
+		else
+		{
+			attributes |= 1;
+		}
+	}
+	return attributes;
+}
+
+void pline_flush_output()
+{
+	pline_publish();
+}
+
+// Publishes the screen when it changed. False when the renderer still holds every frame, it's tried again at the next flush
+bool pline_publish()
+{
+	bool changed = rows_changed || screen.cursor.x != published.cursor.x || screen.cursor.y != published.cursor.y
+		|| screen.cursor_shown != published.cursor_shown || screen.clear_count != published.clear_count;
+	Frame *frame;
+	if (!changed)
+	{
+		return true;
+	}
+	if (!fring_pop(free_frames, &frame))
+	{
+		return false;
+	}
+	if (frame->size.x != screen.size.x || frame->size.y != screen.size.y || frame->stride != screen.stride)
+	{
+		pline_free_cells(frame);
+		pline_allocate_cells(frame, screen.size, screen.stride);
+	}
+	memcpy(frame->cells, screen.cells, screen.stride * screen.size.y);
+	memcpy(frame->row_sizes, screen.row_sizes, screen.size.y * sizeof(size_t));
+	frame->cursor = screen.cursor;
+	frame->cursor_shown = screen.cursor_shown;
+	frame->clear_count = screen.clear_count;
+	// There are as many places in the ring as there are frames
+	fring_push(ready_frames, frame);
+	sem_post(&frames_ready);
+	atomic_fetch_add(&published_count, 1);
+	published.cursor = screen.cursor;
+	published.cursor_shown = screen.cursor_shown;
+	published.clear_count = screen.clear_count;
+	rows_changed = false;
+	return true;
+}
+
+void pline_set_cursor_position(int x, int y)
+{
+	screen.cursor = (vec2) {.x = x, .y = y};
+}
+
+void pline_hide_cursor()
+{
+	screen.cursor_shown = false;
+}
+
+void pline_reveal_cursor()
+{
+	screen.cursor_shown = true;
+}
+
+void pline_clear_screen()
+{
+	memset(screen.row_sizes, 0, screen.size.y * sizeof(size_t));
+	screen.clear_count++;
+	rows_changed = true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <stdlib.h>
+#include "definitions.h"
+#include "editor.h"
+
+#define PIPELINE_KEY_CAPACITY 4096 // Keys waiting for the editor, the input thread waits when they fill up
+#define PIPELINE_FRAME_COUNT  8    // Frames going around between the editor and the renderer
+#define PIPELINE_TICK_MS      100  // A read without a key returns NUL after this long, like the terminal's read
+
+/*
+ * Runs the input and the output of the editor on threads of their own, so a slow terminal
+ * never holds up key handling:
+ *
+ *   input thread:  reads keys from the output interface and queues them
+ *   editor thread: the caller, reads the queued keys through the pipeline's interface and
+ *                  draws into a screen that's only in memory
+ *   render thread: draws the newest published frame to the output interface
+ *
+ * Every flush publishes a copy of the screen as a frame. The renderer skips to the newest
+ * frame and only sends the rows that differ from the frame it drew last, so frames can be
+ * dropped without losing a row. Keys and frames go through lock-free single producer, single
+ * consumer rings and the threads only sleep on semaphores while their ring is empty.
+ * The screen takes the size of a RESIZE_KEY when the editor reads it, in order with the keys.
+ * There is one pipeline, like there is one terminal.
+ */
+void pline_start(vec2 window_size, IO_Interface output);
+void pline_stop();
+IO_Interface pline_get_interface();
+
+size_t pline_get_published_frame_count();
+size_t pline_get_drawn_frame_count();
@@ -0,0 +1,258 @@
+/* Includes */
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "error_handling.h"
+#include "profiler.h"
+
+/* Definitions */
+// Every power of two is split into 4 buckets, which keeps the percentiles within 25%
+#define BUCKET_SUB_BITS   2
+#define BUCKET_SUB_COUNT  (1 << BUCKET_SUB_BITS)
+#define BUCKET_COUNT      (64 * BUCKET_SUB_COUNT)
+#define TRACE_EVENT_COUNT (1 << 16)
+
+typedef struct
+{
+	int zone;
+	uint64_t start;
+	uint64_t duration;
+} ProfileEvent;
+
+// Only the owner thread writes, so relaxed stores are enough to make the readers see whole values
+typedef struct _profile_thread_data
+{
+	int thread_id;
+	_Atomic uint64_t counts[PROFILE_ZONE_COUNT][BUCKET_COUNT];
+	_Atomic uint64_t event_count;
+	ProfileEvent events[TRACE_EVENT_COUNT];
+	struct _profile_thread_data *next;
+} ProfileThreadData;
+
+/* Global Data */
+static const char *zone_names[PROFILE_ZONE_COUNT] = { "read_key", "keypress", "layout", "render", "flush", "key_to_flush" };
+static _Atomic(ProfileThreadData *) thread_list;
+static atomic_int thread_count;
+static _Atomic uint64_t unflushed_key_time;
+static _Thread_local ProfileThreadData *thread_data;
+
+/* Private Function Declarations */
+ProfileThreadData *profiler_get_thread_data();
+size_t profiler_get_bucket(uint64_t duration);
+uint64_t profiler_get_bucket_value(size_t bucket);
+void profiler_write_events(FILE *fp, uint64_t base_time);
+void profiler_write_histograms(FILE *fp);
+
+ProfileTimer profiler_start_timer(int zone)
+{
+	return (ProfileTimer) { .zone = zone, .start = profiler_get_time() };
+}
+
+void profiler_end_timer(ProfileTimer *timer)
+{
+	profiler_record(timer->zone, timer->start, profiler_get_time() - timer->start);
+}
+
+void profiler_record(int zone, uint64_t start, uint64_t duration)
+{
+	tassert(0 <= zone && zone < PROFILE_ZONE_COUNT, "profiler_record: zone is out of range");
+
+	ProfileThreadData *data = profiler_get_thread_data();
+	_Atomic uint64_t *count = &data->counts[zone][profiler_get_bucket(duration)];
+	atomic_store_explicit(count, atomic_load_explicit(count, memory_order_relaxed) + 1, memory_order_relaxed);
+	uint64_t event_index = atomic_load_explicit(&data->event_count, memory_order_relaxed);
+	data->events[event_index % TRACE_EVENT_COUNT] = (ProfileEvent) { .zone = zone, .start = start, .duration = duration };
+	atomic_store_explicit(&data->event_count, event_index + 1, memory_order_release);
+}
+
+void profiler_mark_key_read()
+{
+	// Only the oldest key that hasn't reached the screen yet counts
+	uint64_t expected = 0;
+	atomic_compare_exchange_strong(&unflushed_key_time, &expected, profiler_get_time());
+}
+
+void profiler_mark_frame_flushed()
+{
+	uint64_t key_time = atomic_exchange(&unflushed_key_time, 0);
+	if (key_time != 0)
+	{
+		profiler_record(PROFILE_KEY_TO_FLUSH, key_time, profiler_get_time() - key_time);
+	}
+}
+
+uint64_t profiler_get_time()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint64_t profiler_get_count(int zone)
+{
+	uint64_t count = 0;
+	for (ProfileThreadData *data = atomic_load(&thread_list); data != NULL; data = data->next)
+	{
+		for (size_t i = 0; i < BUCKET_COUNT; i++)
+		{
+			count += atomic_load_explicit(&data->counts[zone][i], memory_order_relaxed);
+		}
+	}
+	return count;
+}
+
+uint64_t profiler_get_percentile(int zone, double p)
+{
+	uint64_t counts[BUCKET_COUNT] = {0};
+	uint64_t total = 0;
+	for (ProfileThreadData *data = atomic_load(&thread_list); data != NULL; data = data->next)
+	{
+		for (size_t i = 0; i < BUCKET_COUNT; i++)
+		{
+			counts[i] += atomic_load_explicit(&data->counts[zone][i], memory_order_relaxed);
+		}
+	}
+	for (size_t i = 0; i < BUCKET_COUNT; i++)
+	{
+		total += counts[i];
+	}
+	if (total == 0)
+	{
+		return 0;
+	}
+	uint64_t target = (uint64_t)(p * (total - 1));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < BUCKET_COUNT; i++)
+	{
+		seen += counts[i];
+		if (seen > target)
+		{
+			return profiler_get_bucket_value(i);
+		}
+	}
+	return profiler_get_bucket_value(BUCKET_COUNT - 1);
+}
+
+void profiler_format_overlay(char *buf, size_t size)
+{
+#ifdef PROFILING
+	size_t used = snprintf(buf, size, "p50/p99 us:");
+	for (int zone = 0; zone < PROFILE_ZONE_COUNT && used < size; zone++)
+	{
+		used += snprintf(buf + used, size - used, " %s %" PRIu64 "/%" PRIu64, zone_names[zone],
+				profiler_get_percentile(zone, 0.50) / 1000, profiler_get_percentile(zone, 0.99) / 1000);
+	}
+#else
+	snprintf(buf, size, "Profiling is disabled, build with -DPROFILING");
+#endif
+}
+
+void profiler_write_trace(const char *filename)
+{
+	FILE *fp = fopen(filename, "w");
+	if (fp == NULL)
+	{
+		return;
+	}
+	uint64_t base_time = UINT64_MAX;
+	for (ProfileThreadData *data = atomic_load(&thread_list); data != NULL; data = data->next)
+	{
+		uint64_t event_count = atomic_load(&data->event_count);
+		uint64_t first = event_count > TRACE_EVENT_COUNT ? event_count - TRACE_EVENT_COUNT : 0;
+		if (first < event_count && data->events[first % TRACE_EVENT_COUNT].start < base_time)
+		{
+			base_time = data->events[first % TRACE_EVENT_COUNT].start;
+		}
+	}
+	// Chrome's trace viewer ignores the keys it doesn't know, so the histograms can live in the same file
+	fprintf(fp, "{\"traceEvents\":[");
+	profiler_write_events(fp, base_time);
+	fprintf(fp, "],\n\"histograms\":{");
+	profiler_write_histograms(fp);
+	fprintf(fp, "}}\n");
+	fclose(fp);
+}
+
+void profiler_write_events(FILE *fp, uint64_t base_time)
+{
+	bool first_event = true;
+	for (ProfileThreadData *data = atomic_load(&thread_list); data != NULL; data = data->next)
+	{
+		uint64_t event_count = atomic_load(&data->event_count);
+		uint64_t first = event_count > TRACE_EVENT_COUNT ? event_count - TRACE_EVENT_COUNT : 0;
+		for (uint64_t i = first; i < event_count; i++)
+		{
+			const ProfileEvent *event = &data->events[i % TRACE_EVENT_COUNT];
+			fprintf(fp, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+					first_event ? "" : ",", zone_names[event->zone], data->thread_id,
+					(event->start - base_time) / 1000.0, event->duration / 1000.0);
+			first_event = false;
+		}
+	}
+}
+
+void profiler_write_histograms(FILE *fp)
+{
+	for (int zone = 0; zone < PROFILE_ZONE_COUNT; zone++)
+	{
+		fprintf(fp, "%s\n\"%s\":{\"count\":%" PRIu64 ",\"p50_ns\":%" PRIu64 ",\"p90_ns\":%" PRIu64 ",\"p99_ns\":%" PRIu64 ",\"max_ns\":%" PRIu64 "}",
+				zone == 0 ? "" : ",", zone_names[zone], profiler_get_count(zone),
+				profiler_get_percentile(zone, 0.50), profiler_get_percentile(zone, 0.90),
+				profiler_get_percentile(zone, 0.99), profiler_get_percentile(zone, 1.00));
+	}
+}
+
+void profiler_shutdown()
+{
+	// The other threads have to be done recording by now, their buffers go with the list
+	ProfileThreadData *data = atomic_exchange(&thread_list, NULL);
+	while (data != NULL)
+	{
+		ProfileThreadData *next = data->next;
+		free(data);
+		data = next;
+	}
+	thread_data = NULL;
+	atomic_store(&thread_count, 0);
+}
+
+ProfileThreadData *profiler_get_thread_data()
+{
+	if (thread_data != NULL)
+	{
+		return thread_data;
+	}
+	thread_data = calloc(1, sizeof(ProfileThreadData));
+	thread_data->thread_id = atomic_fetch_add(&thread_count, 1);
+	// Threads only ever get pushed to the front of the list, so readers can walk it without locking
+	ProfileThreadData *head = atomic_load(&thread_list);
+	do
+	{
+		thread_data->next = head;
+	} while (!atomic_compare_exchange_weak(&thread_list, &head, thread_data));
+	return thread_data;
+}
+
+size_t profiler_get_bucket(uint64_t duration)
+{
+	if (duration < BUCKET_SUB_COUNT)
+	{
+		return duration;
+	}
+	int msb = 63 - __builtin_clzll(duration);
+	size_t sub_bucket = (duration >> (msb - BUCKET_SUB_BITS)) & (BUCKET_SUB_COUNT - 1);
+	return (msb - BUCKET_SUB_BITS + 1) * BUCKET_SUB_COUNT + sub_bucket;
+}
+
+uint64_t profiler_get_bucket_value(size_t bucket)
+{
+	if (bucket < BUCKET_SUB_COUNT)
+	{
+		return bucket;
+	}
+	int msb = bucket / BUCKET_SUB_COUNT + BUCKET_SUB_BITS - 1;
+	uint64_t sub_bucket = bucket % BUCKET_SUB_COUNT;
+	return (BUCKET_SUB_COUNT + sub_bucket) << (msb - BUCKET_SUB_BITS);
+}
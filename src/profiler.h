@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include "definitions.h"
+
+#define PROFILE_READ_KEY     0
+#define PROFILE_KEYPRESS     1
+#define PROFILE_LAYOUT       2
+#define PROFILE_RENDER       3
+#define PROFILE_FLUSH        4
+#define PROFILE_KEY_TO_FLUSH 5
+#define PROFILE_ZONE_COUNT   6
+
+#define PROFILE_OUTPUT_FILE "text-editor-profile.json"
+
+typedef struct
+{
+	int zone;
+	uint64_t start;
+} ProfileTimer;
+
+#ifdef PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Times the rest of the enclosing block
+#define PROFILE_SCOPE(zone) ProfileTimer PROFILE_CONCAT(profile_timer_, __LINE__) __attribute__((cleanup(profiler_end_timer))) = profiler_start_timer(zone)
+#define PROFILE_KEY_READ() profiler_mark_key_read()
+#define PROFILE_FRAME_FLUSHED() profiler_mark_frame_flushed()
+#else
+#define PROFILE_SCOPE(...) {}
+#define PROFILE_KEY_READ() {}
+#define PROFILE_FRAME_FLUSHED() {}
+#endif
+
+ProfileTimer profiler_start_timer(int zone);
+void profiler_end_timer(ProfileTimer *timer);
+void profiler_record(int zone, uint64_t start, uint64_t duration);
+void profiler_mark_key_read();
+void profiler_mark_frame_flushed();
+
+uint64_t profiler_get_time();
+uint64_t profiler_get_percentile(int zone, double p);
+uint64_t profiler_get_count(int zone);
+
+void profiler_format_overlay(char *buf, size_t size);
+void profiler_write_trace(const char *filename);
+void profiler_shutdown();
@@ -0,0 +1,13 @@
+#include <libgen.h>
+#include <limits.h>
+#include <stdio.h>
+#include "sidecar.h"
+
+void sidecar_get_path(const char *filename, const char *suffix, char *path, size_t path_size)
+{
+	// dirname and basename may modify their argument
+	char dir[PATH_MAX], base[PATH_MAX];
+	snprintf(dir, sizeof(dir), "%s", filename);
+	snprintf(base, sizeof(base), "%s", filename);
+	snprintf(path, path_size, "%s/.%s%s", dirname(dir), basename(base), suffix);
+}
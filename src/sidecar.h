@@ -0,0 +1,5 @@
+#pragma once
+#include <stdlib.h>
+
+// The hidden file next to filename that keeps data about it, like .<name><suffix> in the same directory
+void sidecar_get_path(const char *filename, const char *suffix, char *path, size_t path_size);
@@ -0,0 +1,560 @@
+/* Includes */
+#include <string.h>
+#include "allocator.h"
+#include "error_handling.h"
+#include "snapshot.h"
+
+/* Definitions */
+struct SnapNode
+{
+	size_t ref_count;       // Changed atomically, snapshots let go of their nodes on any thread
+	size_t line_count;
+	int height;             // 0 for a chunk
+	bool pinned;            // The chunk holds references to its lines
+	SnapNode *left;
+	SnapNode *right;
+	DynamicBuffer *lines[]; // Only chunks have lines
+};
+
+/* Private Function Declarations */
+SnapNode *snap_create_chunk(size_t count, DynamicBuffer *const *lines);
+SnapNode *snap_create_inner(SnapNode *left, SnapNode *right);
+SnapNode *snap_build_chunks(size_t count, DynamicBuffer *const *lines, size_t chunk_count);
+size_t snap_get_node_size(const SnapNode *node);
+void snap_free_node(SnapNode *node);
+SnapNode *snap_retain(SnapNode *node);
+void snap_release(SnapNode *node, ColdStore *cold);
+void snap_release_live(SnapNode *node, ColdStore *cold);
+void snap_pin(SnapNode *node, ColdStore *cold);
+bool snap_is_owned(const SnapNode *node);
+SnapNode *snap_own(SnapNode *node, ColdStore *cold);
+void snap_take_children(SnapNode *node, ColdStore *cold, SnapNode **left, SnapNode **right);
+SnapNode *snap_touch_node(SnapNode *node, ColdStore *cold, size_t row, size_t end);
+SnapNode *snap_set_lines(SnapNode *node, ColdStore *cold, size_t row, size_t end, DynamicBuffer *const *lines);
+SnapNode *snap_resize_chunk(SnapNode *node, ColdStore *cold, size_t row, size_t old_count, size_t new_count, DynamicBuffer *const *lines);
+const SnapNode *snap_find_chunk(const SnapNode *node, size_t row, size_t *chunk_row);
+void snap_split(SnapNode *node, ColdStore *cold, size_t row, SnapNode **left, SnapNode **right);
+SnapNode *snap_join(SnapNode *left, SnapNode *right, ColdStore *cold);
+SnapNode *snap_balance(SnapNode *node, ColdStore *cold);
+SnapNode *snap_rotate_left(SnapNode *node, ColdStore *cold);
+SnapNode *snap_rotate_right(SnapNode *node, ColdStore *cold);
+void snap_update(SnapNode *node);
+
+// A live tree of the lines, it borrows their handles
+SnapNode *snap_build(size_t count, DynamicBuffer *const *lines)
+{
+	if (count == 0)
+	{
+		return NULL;
+	}
+	return snap_build_chunks(count, lines, (count + SNAP_CHUNK_LINES - 1) / SNAP_CHUNK_LINES);
+}
+
+// Copies the chunks of the rows for the live tree when snapshots hold them, called before the lines are changed in
+// place or destroyed
+void snap_touch(SnapNode **root, ColdStore *cold, size_t row, size_t count)
+{
+	tassert(*root != NULL && row + count <= (*root)->line_count, "snap_touch: rows are out of range");
+
+	if (count > 0)
+	{
+		*root = snap_touch_node(*root, cold, row, row + count);
+	}
+}
+
+// Puts new_count rows in place of old_count rows at row, lines are all the lines after the change. Changes within a
+// chunk only copy the path to it, any other change builds the chunks it's in again
+void snap_replace(SnapNode **root, ColdStore *cold, size_t row, size_t old_count, size_t new_count, DynamicBuffer *const *lines)
+{
+	size_t line_count = *root != NULL ? (*root)->line_count : 0;
+	tassert(row + old_count <= line_count, "snap_replace: rows are out of range");
+
+	if (old_count == new_count)
+	{
+		if (new_count > 0)
+		{
+			*root = snap_set_lines(*root, cold, row, row + new_count, lines + row);
+		}
+		return;
+	}
+	size_t start = 0;
+	size_t end = 0;
+	if (*root != NULL)
+	{
+		const SnapNode *chunk = snap_find_chunk(*root, row, &start);
+		end = start + chunk->line_count;
+		size_t new_size = chunk->line_count - old_count + new_count;
+		bool fits = row + old_count <= end && 0 < new_size && new_size <= SNAP_CHUNK_LINES
+			&& (new_size >= SNAP_CHUNK_LINES / 2 || (*root)->height == 0);
+		if (fits)
+		{
+			*root = snap_resize_chunk(*root, cold, row, old_count, new_count, lines + row);
+			return;
+		}
+		if (row + old_count > end)
+		{
+			size_t last_row;
+			chunk = snap_find_chunk(*root, row + old_count - 1, &last_row);
+			end = last_row + chunk->line_count;
+		}
+		// A chunk next to them joins chunks that would be less than half full
+		if (end - start - old_count + new_count < SNAP_CHUNK_LINES / 2)
+		{
+			if (end < line_count)
+			{
+				size_t next_row;
+				end += snap_find_chunk(*root, end, &next_row)->line_count;
+			}
+			else if (start > 0)
+			{
+				snap_find_chunk(*root, start - 1, &start);
+			}
+		}
+	}
+	SnapNode *left, *rest, *middle, *right;
+	snap_split(*root, cold, start, &left, &rest);
+	snap_split(rest, cold, end - start, &middle, &right);
+	snap_release_live(middle, cold);
+	SnapNode *center = snap_build(end - start - old_count + new_count, lines + start);
+	*root = snap_join(snap_join(left, center, cold), right, cold);
+}
+
+// The live tree goes away, what snapshots still hold of it is pinned
+void snap_drop(SnapNode *root, ColdStore *cold)
+{
+	snap_release_live(root, cold);
+}
+
+Snapshot *snap_create(SnapNode *root, ColdStore *cold, size_t change_count)
+{
+	Snapshot *obj = mem_alloc(MEM_SNAPSHOT, sizeof(Snapshot));
+	mem_add_used(MEM_SNAPSHOT, sizeof(Snapshot));
+	obj->root = root != NULL ? snap_retain(root) : NULL;
+	obj->cold = cold;
+	obj->change_count = change_count;
+	obj->chunk = NULL;
+	obj->chunk_row = 0;
+	cold_init_reader(&obj->reader);
+	return obj;
+}
+
+// The same lines for another thread
+Snapshot *snap_share(const Snapshot *obj)
+{
+	return snap_create(obj->root, obj->cold, obj->change_count);
+}
+
+void snap_destroy(Snapshot *obj)
+{
+	tassert(obj, "snap_destroy: obj is NULL");
+
+	snap_release(obj->root, obj->cold);
+	cold_destroy_reader(&obj->reader);
+	mem_add_used(MEM_SNAPSHOT, -(long long)sizeof(Snapshot));
+	mem_free(MEM_SNAPSHOT, obj, sizeof(Snapshot));
+}
+
+size_t snap_get_line_count(const Snapshot *obj)
+{
+	return obj->root != NULL ? obj->root->line_count : 0;
+}
+
+// Valid until the next call, reading lines in order finds every chunk once
+const char *snap_get_line_text(Snapshot *obj, size_t row, size_t *size)
+{
+	tassert(row < snap_get_line_count(obj), "snap_get_line_text: row is out of range");
+
+	if (obj->chunk == NULL || row < obj->chunk_row || row >= obj->chunk_row + obj->chunk->line_count)
+	{
+		obj->chunk = snap_find_chunk(obj->root, row, &obj->chunk_row);
+	}
+	const DynamicBuffer *line = obj->chunk->lines[row - obj->chunk_row];
+	if (cold_is_slot(line))
+	{
+		return cold_read_line_text(obj->cold, line, &obj->reader, size);
+	}
+	*size = dbuf_get_size(line);
+	return dbuf_get_with_nulc(line, 0);
+}
+
+SnapNode *snap_create_chunk(size_t count, DynamicBuffer *const *lines)
+{
+	size_t size = sizeof(SnapNode) + count * sizeof(DynamicBuffer *);
+	SnapNode *node = mem_alloc(MEM_SNAPSHOT, size);
+	mem_add_used(MEM_SNAPSHOT, size);
+	node->ref_count = 1;
+	node->line_count = count;
+	node->height = 0;
+	node->pinned = false;
+	node->left = NULL;
+	node->right = NULL;
+	memcpy(node->lines, lines, count * sizeof(DynamicBuffer *));
+	return node;
+}
+
+// Takes the references to left and right
+SnapNode *snap_create_inner(SnapNode *left, SnapNode *right)
+{
+	SnapNode *node = mem_alloc(MEM_SNAPSHOT, sizeof(SnapNode));
+	mem_add_used(MEM_SNAPSHOT, sizeof(SnapNode));
+	node->ref_count = 1;
+	node->pinned = false;
+	node->left = left;
+	node->right = right;
+	snap_update(node);
+	return node;
+}
+
+// The lines are spread evenly over the chunks, the halves of every node are within one chunk of each other
+SnapNode *snap_build_chunks(size_t count, DynamicBuffer *const *lines, size_t chunk_count)
+{
+	if (chunk_count == 1)
+	{
+		return snap_create_chunk(count, lines);
+	}
+	size_t left_chunks = chunk_count / 2;
+	size_t left_count = count * left_chunks / chunk_count;
+	SnapNode *left = snap_build_chunks(left_count, lines, left_chunks);
+	SnapNode *right = snap_build_chunks(count - left_count, lines + left_count, chunk_count - left_chunks);
+	return snap_create_inner(left, right);
+}
+
+size_t snap_get_node_size(const SnapNode *node)
+{
+	return sizeof(SnapNode) + (node->height == 0 ? node->line_count * sizeof(DynamicBuffer *) : 0);
+}
+
+void snap_free_node(SnapNode *node)
+{
+	size_t size = snap_get_node_size(node);
+	mem_add_used(MEM_SNAPSHOT, -(long long)size);
+	mem_free(MEM_SNAPSHOT, node, size);
+}
+
+SnapNode *snap_retain(SnapNode *node)
+{
+	__atomic_add_fetch(&node->ref_count, 1, __ATOMIC_RELAXED);
+	return node;
+}
+
+// Lets go of a reference to a node that isn't in the live tree, or whose children stay in it
+void snap_release(SnapNode *node, ColdStore *cold)
+{
+	if (node == NULL || __atomic_sub_fetch(&node->ref_count, 1, __ATOMIC_ACQ_REL) > 0)
+	{
+		return;
+	}
+	if (node->height > 0)
+	{
+		snap_release(node->left, cold);
+		snap_release(node->right, cold);
+	}
+	for (size_t i = 0; i < node->line_count && node->height == 0 && node->pinned; i++)
+	{
+		if (cold_is_slot(node->lines[i]))
+		{
+			cold_unpin(cold, node->lines[i]);
+		}
+		else
+		{
+			dbuf_destroy(node->lines[i]);
+		}
+	}
+	snap_free_node(node);
+}
+
+// Lets go of a subtree that leaves the live tree. Only the snapshots can hold it from then on, so it's pinned when
+// they do. The lines of chunks that only the live tree held aren't looked at, they may be gone already
+void snap_release_live(SnapNode *node, ColdStore *cold)
+{
+	if (node == NULL)
+	{
+		return;
+	}
+	if (!snap_is_owned(node))
+	{
+		snap_pin(node, cold);
+		snap_release(node, cold);
+		return;
+	}
+	if (node->height > 0)
+	{
+		snap_release_live(node->left, cold);
+		snap_release_live(node->right, cold);
+	}
+	snap_free_node(node);
+}
+
+void snap_pin(SnapNode *node, ColdStore *cold)
+{
+	if (node->height > 0)
+	{
+		snap_pin(node->left, cold);
+		snap_pin(node->right, cold);
+		return;
+	}
+	tassert(!node->pinned, "snap_pin: the chunk isn't in the live tree");
+
+	for (size_t i = 0; i < node->line_count; i++)
+	{
+		if (cold_is_slot(node->lines[i]))
+		{
+			cold_pin(cold, node->lines[i]);
+		}
+		else
+		{
+			dbuf_share(node->lines[i]);
+		}
+	}
+	node->pinned = true;
+}
+
+// Only snapshots take references to nodes of the live tree, and only on the owner's thread, so a node it alone holds
+// stays that way
+bool snap_is_owned(const SnapNode *node)
+{
+	return __atomic_load_n(&node->ref_count, __ATOMIC_ACQUIRE) == 1;
+}
+
+// A node of the live tree that can be changed in place, a copy of it when snapshots hold it too
+SnapNode *snap_own(SnapNode *node, ColdStore *cold)
+{
+	if (snap_is_owned(node))
+	{
+		return node;
+	}
+	SnapNode *copy;
+	if (node->height == 0)
+	{
+		copy = snap_create_chunk(node->line_count, node->lines);
+		snap_pin(node, cold);
+	}
+	else
+	{
+		copy = snap_create_inner(snap_retain(node->left), snap_retain(node->right));
+	}
+	snap_release(node, cold);
+	return copy;
+}
+
+// Takes the node apart, its children stay in the live tree
+void snap_take_children(SnapNode *node, ColdStore *cold, SnapNode **left, SnapNode **right)
+{
+	if (snap_is_owned(node))
+	{
+		*left = node->left;
+		*right = node->right;
+		snap_free_node(node);
+		return;
+	}
+	*left = snap_retain(node->left);
+	*right = snap_retain(node->right);
+	snap_release(node, cold);
+}
+
+SnapNode *snap_touch_node(SnapNode *node, ColdStore *cold, size_t row, size_t end)
+{
+	node = snap_own(node, cold);
+	if (node->height == 0)
+	{
+		return node;
+	}
+	size_t left_count = node->left->line_count;
+	if (row < left_count)
+	{
+		node->left = snap_touch_node(node->left, cold, row, end < left_count ? end : left_count);
+	}
+	if (end > left_count)
+	{
+		node->right = snap_touch_node(node->right, cold, (row > left_count ? row : left_count) - left_count, end - left_count);
+	}
+	return node;
+}
+
+// lines are the lines from row on
+SnapNode *snap_set_lines(SnapNode *node, ColdStore *cold, size_t row, size_t end, DynamicBuffer *const *lines)
+{
+	node = snap_own(node, cold);
+	if (node->height == 0)
+	{
+		memcpy(node->lines + row, lines, (end - row) * sizeof(DynamicBuffer *));
+		return node;
+	}
+	size_t left_count = node->left->line_count;
+	if (row < left_count)
+	{
+		node->left = snap_set_lines(node->left, cold, row, end < left_count ? end : left_count, lines);
+	}
+	if (end > left_count)
+	{
+		size_t right_row = row > left_count ? row : left_count;
+		node->right = snap_set_lines(node->right, cold, right_row - left_count, end - left_count, lines + (right_row - row));
+	}
+	return node;
+}
+
+// The rows are in one chunk, which stays between half full and full. lines are the lines from row on
+SnapNode *snap_resize_chunk(SnapNode *node, ColdStore *cold, size_t row, size_t old_count, size_t new_count, DynamicBuffer *const *lines)
+{
+	node = snap_own(node, cold);
+	if (node->height > 0)
+	{
+		size_t left_count = node->left->line_count;
+		if (row < left_count)
+		{
+			node->left = snap_resize_chunk(node->left, cold, row, old_count, new_count, lines);
+		}
+		else
+		{
+			node->right = snap_resize_chunk(node->right, cold, row - left_count, old_count, new_count, lines);
+		}
+		snap_update(node);
+		return node;
+	}
+	size_t old_size = snap_get_node_size(node);
+	size_t tail = node->line_count - row - old_count;
+	if (new_count < old_count)
+	{
+		memmove(node->lines + row + new_count, node->lines + row + old_count, tail * sizeof(DynamicBuffer *));
+	}
+	node->line_count = node->line_count - old_count + new_count;
+	node = mem_realloc(MEM_SNAPSHOT, node, old_size, snap_get_node_size(node));
+	mem_add_used(MEM_SNAPSHOT, (long long)snap_get_node_size(node) - (long long)old_size);
+	if (new_count > old_count)
+	{
+		memmove(node->lines + row + new_count, node->lines + row + old_count, tail * sizeof(DynamicBuffer *));
+	}
+	memcpy(node->lines + row, lines, new_count * sizeof(DynamicBuffer *));
+	return node;
+}
+
+// The chunk row is in, the last chunk for the row after the last line
+const SnapNode *snap_find_chunk(const SnapNode *node, size_t row, size_t *chunk_row)
+{
+	*chunk_row = 0;
+	while (node->height > 0)
+	{
+		size_t left_count = node->left->line_count;
+		if (row < left_count)
+		{
+			node = node->left;
+		}
+		else
+		{
+			row -= left_count;
+			*chunk_row += left_count;
+			node = node->right;
+		}
+	}
+	return node;
+}
+
+// Splits the live tree at the start of a chunk, the nodes on the way are copied when they are shared
+void snap_split(SnapNode *node, ColdStore *cold, size_t row, SnapNode **left, SnapNode **right)
+{
+	if (node == NULL || row == 0)
+	{
+		*left = NULL;
+		*right = node;
+		return;
+	}
+	if (row == node->line_count)
+	{
+		*left = node;
+		*right = NULL;
+		return;
+	}
+	tassert(node->height > 0, "snap_split: row isn't at the start of a chunk");
+
+	size_t left_count = node->left->line_count;
+	SnapNode *node_left, *node_right;
+	snap_take_children(node, cold, &node_left, &node_right);
+	if (row < left_count)
+	{
+		SnapNode *rest;
+		snap_split(node_left, cold, row, left, &rest);
+		*right = snap_join(rest, node_right, cold);
+	}
+	else
+	{
+		SnapNode *rest;
+		snap_split(node_right, cold, row - left_count, &rest, right);
+		*left = snap_join(node_left, rest, cold);
+	}
+}
+
+// Joins two live trees, the taller one takes the other in along its edge
+SnapNode *snap_join(SnapNode *left, SnapNode *right, ColdStore *cold)
+{
+	if (left == NULL)
+	{
+		return right;
+	}
+	if (right == NULL)
+	{
+		return left;
+	}
+	if (left->height > right->height + 1)
+	{
+		left = snap_own(left, cold);
+		left->right = snap_join(left->right, right, cold);
+		return snap_balance(left, cold);
+	}
+	if (right->height > left->height + 1)
+	{
+		right = snap_own(right, cold);
+		right->left = snap_join(left, right->left, cold);
+		return snap_balance(right, cold);
+	}
+	return snap_create_inner(left, right);
+}
+
+// The node is owned, its halves differ in height by two at most
+SnapNode *snap_balance(SnapNode *node, ColdStore *cold)
+{
+	snap_update(node);
+	int difference = node->left->height - node->right->height;
+	if (difference > 1)
+	{
+		if (node->left->left->height < node->left->right->height)
+		{
+			node->left = snap_rotate_left(snap_own(node->left, cold), cold);
+		}
+		return snap_rotate_right(node, cold);
+	}
+	if (difference < -1)
+	{
+		if (node->right->right->height < node->right->left->height)
+		{
+			node->right = snap_rotate_right(snap_own(node->right, cold), cold);
+		}
+		return snap_rotate_left(node, cold);
+	}
+	return node;
+}
+
+SnapNode *snap_rotate_left(SnapNode *node, ColdStore *cold)
+{
+	SnapNode *pivot = snap_own(node->right, cold);
+	node->right = pivot->left;
+	snap_update(node);
+	pivot->left = node;
+	snap_update(pivot);
+	return pivot;
+}
+
+SnapNode *snap_rotate_right(SnapNode *node, ColdStore *cold)
+{
+	SnapNode *pivot = snap_own(node->left, cold);
+	node->left = pivot->right;
+	snap_update(node);
+	pivot->right = node;
+	snap_update(pivot);
+	return pivot;
+}
+
+void snap_update(SnapNode *node)
+{
+	node->line_count = node->left->line_count + node->right->line_count;
+	node->height = 1 + (node->left->height > node->right->height ? node->left->height : node->right->height);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <stdbool.h>
+#include <stdlib.h>
+#include "cold_store.h"
+#include "dynamic_buffer.h"
+
+#define SNAP_CHUNK_LINES 64 // Most lines in a chunk, chunks are kept at least half full
+
+typedef struct SnapNode SnapNode;
+
+/*
+ * The lines of a FileData as a persistent tree. Its leaves are chunks of line handles and its
+ * inner nodes are kept balanced by height. Nodes are shared between versions, so a change only
+ * copies the path down to the chunks it changes, and a snapshot is a reference to a root:
+ *
+ *   live:      R' ---+           R: root when the snapshot was taken
+ *             /  \   |           R': root after a line of chunk C changed
+ *           A'    B  |           Only R', A' and C' were made by the change,
+ *          /  \      |           B and D are in both versions
+ *        C'    D     |
+ *   snapshot:  R -> A -> C, D and B
+ *
+ * The live tree, the one the FileData keeps in step with its lines, borrows the handles of the
+ * line array. A chunk that leaves the live tree while a snapshot still holds it is pinned: it
+ * takes a reference to each of its lines, or pins the cold block of each compressed one, so its
+ * lines stay as they were for the snapshots. Lines are only changed in place after the rows
+ * were touched, which copies the chunks they are in for the live tree first.
+ *
+ * Nodes are never changed once they are shared, and their reference counts are atomic, so a
+ * snapshot can be read and let go of on any thread while the owner goes on changing the lines.
+ * A Snapshot is read by one thread at a time, snap_share gives another thread its own.
+ */
+typedef struct
+{
+	SnapNode *root;         // NULL when there are no lines
+	ColdStore *cold;        // Of the FileData, which has to outlive snapshots with compressed lines
+	size_t change_count;    // Of the FileData when the snapshot was taken
+	const SnapNode *chunk;  // Chunk of the last line read, lines are mostly read in order
+	size_t chunk_row;
+	ColdReader reader;
+} Snapshot;
+
+SnapNode *snap_build(size_t count, DynamicBuffer *const *lines);
+void snap_touch(SnapNode **root, ColdStore *cold, size_t row, size_t count);
+void snap_replace(SnapNode **root, ColdStore *cold, size_t row, size_t old_count, size_t new_count, DynamicBuffer *const *lines);
+void snap_drop(SnapNode *root, ColdStore *cold);
+
+Snapshot *snap_create(SnapNode *root, ColdStore *cold, size_t change_count);
+Snapshot *snap_share(const Snapshot *obj);
+void snap_destroy(Snapshot *obj);
+
+size_t snap_get_line_count(const Snapshot *obj);
+const char *snap_get_line_text(Snapshot *obj, size_t row, size_t *size);
@@ -0,0 +1,80 @@
+#pragma once
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "allocator.h"
+#include "error_handling.h"
+
+/*
+ * Generates a fixed size ring of T named Name for exactly one producer thread and one
+ * consumer thread, with functions prefixed by prefix:
+ *
+ *     DEFINE_SPSC_RING(KeyRing, kring, int)
+ *
+ * Neither side takes a lock: the producer only writes tail and the consumer only writes
+ * head, each publishes its side with a release store. The two are on their own cache lines
+ * so the threads don't keep taking the line from each other. Pushing to a full ring and
+ * popping from an empty one fail instead of waiting.
+ */
+
+#define SPSC_CACHE_LINE 64
+
+#define DEFINE_SPSC_RING(Name, prefix, T)                                                                     \
+typedef struct                                                                                                \
+{                                                                                                             \
+	alignas(SPSC_CACHE_LINE) atomic_size_t head; /* Next item to pop, written by the consumer */               \
+	alignas(SPSC_CACHE_LINE) atomic_size_t tail; /* Next place to push to, written by the producer */          \
+	alignas(SPSC_CACHE_LINE) size_t capacity;    /* A power of two, so indices wrap with a mask */             \
+	int mem_category;                                                                                         \
+	T *items;                                                                                                 \
+} Name;                                                                                                       \
+                                                                                                              \
+static inline Name *prefix##_create(int mem_category, size_t capacity)                                        \
+{                                                                                                             \
+	tassert(capacity > 0 && (capacity & (capacity - 1)) == 0, #prefix "_create: capacity isn't a power of two"); \
+                                                                                                              \
+	Name *obj = (Name *)mem_alloc(mem_category, sizeof(Name));                                                \
+	mem_add_used(mem_category, sizeof(Name) + capacity * sizeof(T));                                          \
+	atomic_init(&obj->head, 0);                                                                               \
+	atomic_init(&obj->tail, 0);                                                                               \
+	obj->capacity = capacity;                                                                                 \
+	obj->mem_category = mem_category;                                                                         \
+	obj->items = (T *)mem_alloc(mem_category, capacity * sizeof(T));                                          \
+	return obj;                                                                                               \
+}                                                                                                             \
+                                                                                                              \
+static inline void prefix##_destroy(Name *obj)                                                                \
+{                                                                                                             \
+	tassert(obj, #prefix "_destroy: obj is NULL");                                                            \
+                                                                                                              \
+	mem_add_used(obj->mem_category, -(long long)(sizeof(Name) + obj->capacity * sizeof(T)));                  \
+	mem_free(obj->mem_category, obj->items, obj->capacity * sizeof(T));                                       \
+	mem_free(obj->mem_category, obj, sizeof(Name));                                                           \
+}                                                                                                             \
+                                                                                                              \
+/* Producer side only, false when the ring is full */                                                         \
+static inline bool prefix##_push(Name *obj, T item)                                                           \
+{                                                                                                             \
+	size_t tail = atomic_load_explicit(&obj->tail, memory_order_relaxed);                                     \
+	if (tail - atomic_load_explicit(&obj->head, memory_order_acquire) == obj->capacity)                       \
+	{                                                                                                         \
+		return false;                                                                                         \
+	}                                                                                                         \
+	obj->items[tail & (obj->capacity - 1)] = item;                                                            \
+	atomic_store_explicit(&obj->tail, tail + 1, memory_order_release);                                        \
+	return true;                                                                                              \
+}                                                                                                             \
+                                                                                                              \
+/* Consumer side only, false when the ring is empty */                                                        \
+static inline bool prefix##_pop(Name *obj, T *item)                                                           \
+{                                                                                                             \
+	size_t head = atomic_load_explicit(&obj->head, memory_order_relaxed);                                     \
+	if (head == atomic_load_explicit(&obj->tail, memory_order_acquire))                                       \
+	{                                                                                                         \
+		return false;                                                                                         \
+	}                                                                                                         \
+	*item = obj->items[head & (obj->capacity - 1)];                                                           \
+	atomic_store_explicit(&obj->head, head + 1, memory_order_release);                                        \
+	return true;                                                                                              \
+}
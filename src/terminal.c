@@ -1,16 +1,25 @@
 /* Includes */
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <termios.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <sys/ioctl.h>
+#include "allocator.h"
 #include "definitions.h"
 #include "error_handling.h"
 #include "dynamic_buffer.h"
 #include "terminal.h"
 
+/* Definitions */
+#define TERMINAL_READ_TIMEOUT_MS 100 // Like VTIME, a read without a key returns NUL after this long
+
 /* Global Data */
 struct termios original_attributes;
 static vec2 window_size;
+static int resize_pipe[2] = {-1, -1}; // The SIGWINCH handler writes here, so a read waiting for a key wakes up
 static vec2 current_cursor_position;
 static DynamicBuffer *dbuf;
 
@@ -21,37 +30,86 @@ void editor_add_reveal_cursor_to_buffer(DynamicBuffer *buf);
 void update_cursor_position();
 
 int terminal_read_ANSI_sequence();
+int terminal_read_ANSI_tilde_sequence(char code);
+int terminal_read_ANSI_modified_sequence();
 
 void print_delicate();
 
+int  terminal_wait_key(int timeout_ms);
+int  terminal_read_resize();
+vec2 terminal_query_window_size();
+void terminal_handle_resize(int signal);
+void terminal_watch_resizes();
+
 void restore_terminal_behaviour();
 void setup_terminal_behaviour();
 
 
 void terminal_init()
 {
-	dbuf = dbuf_create();
+	dbuf = dbuf_create(MEM_TERMINAL);
 	setup_terminal_behaviour();
-	struct winsize ws;
-	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0)
-	{
-		throw_up("get_window_size, ioctl failed");
-	}
-	window_size = (vec2) { .x = ws.ws_col, .y = ws.ws_row };
+	window_size = terminal_query_window_size();
 	current_cursor_position = (vec2) {.x = 0, .y = 0};
+	terminal_watch_resizes();
 }
 
 void terminal_terminate()
 {
+	// Headless runs never initialize the terminal, but errors still end up here
+	if (dbuf == NULL)
+	{
+		return;
+	}
 	dbuf_destroy(dbuf);
+	dbuf = NULL;
+	signal(SIGWINCH, SIG_DFL);
+	close(resize_pipe[0]);
+	close(resize_pipe[1]);
+	resize_pipe[0] = resize_pipe[1] = -1;
 	restore_terminal_behaviour();
 }
 
+// The size when the terminal was set up or when the last resize was read
 vec2 get_window_size()
 {
 	return window_size;
 }
 
+vec2 terminal_query_window_size()
+{
+	struct winsize ws;
+	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0)
+	{
+		throw_up("get_window_size, ioctl failed");
+	}
+	return (vec2) { .x = ws.ws_col, .y = ws.ws_row };
+}
+
+// Both ends don't block, a storm of signals fills the pipe at most and they are all read as one resize
+void terminal_watch_resizes()
+{
+	handle_error(pipe(resize_pipe), "terminal_watch_resizes: pipe failed");
+	for (int i = 0; i < 2; i++)
+	{
+		fcntl(resize_pipe[i], F_SETFL, fcntl(resize_pipe[i], F_GETFL) | O_NONBLOCK);
+		fcntl(resize_pipe[i], F_SETFD, FD_CLOEXEC);
+	}
+	struct sigaction action = {0};
+	action.sa_handler = terminal_handle_resize;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	handle_error(sigaction(SIGWINCH, &action, NULL), "terminal_watch_resizes: sigaction failed");
+}
+
+void terminal_handle_resize(int signal)
+{
+	int saved_errno = errno;
+	char c = 1;
+	write(resize_pipe[1], &c, 1);
+	errno = saved_errno;
+}
+
 void setup_terminal_behaviour()
 {
 	if (tcgetattr(STDIN_FILENO, &original_attributes) == TERMIOS_ERROR) 
@@ -91,19 +149,57 @@ void terminal_clear_screen()
 	dbuf_adds(dbuf, 3, "\x1b[H");
 }
 
+// Rows are drawn in place and clear what was left of them, so the rows that didn't change don't have to be sent
 void terminal_render_row(int row_id, size_t size, const char *row)
 {
+	dbuf_adds(dbuf, 2, "\x1b[");
+	dbuf_addi(dbuf, row_id + 1);
+	dbuf_adds(dbuf, 3, ";1H");
 	dbuf_adds(dbuf, size, row);
-	if (row_id < window_size.y - 1)
-	{
-		dbuf_adds(dbuf, 2, "\r\n");
-	}
+	dbuf_adds(dbuf, 3, "\x1b[K");
 }
 
 int terminal_read_key()
 {
+	return terminal_wait_key(TERMINAL_READ_TIMEOUT_MS);
+}
+
+// The read waits for a key for a tenth of a second, a key that's already there is read right away
+int terminal_poll_key()
+{
+	return terminal_wait_key(0);
+}
+
+// A resize is read like a key, it's a RESIZE_KEY with the new size
+int terminal_wait_key(int timeout_ms)
+{
+	struct pollfd inputs[2] = {{.fd = STDIN_FILENO, .events = POLLIN}, {.fd = resize_pipe[0], .events = POLLIN}};
+	int ready = poll(inputs, 2, timeout_ms);
+	if (ready == -1 && errno != EINTR)
+	{
+		throw_up("terminal_wait_key: poll failed");
+	}
+	if (ready <= 0)
+	{
+		return NUL;
+	}
+	if (inputs[1].revents & POLLIN)
+	{
+		int resize = terminal_read_resize();
+		if (resize != NUL)
+		{
+			return resize;
+		}
+	}
+	if (!(inputs[0].revents & POLLIN))
+	{
+		return NUL;
+	}
 	char c = NUL;
-	handle_error(read(STDIN_FILENO, &c, 1), "read failed");
+	if (read(STDIN_FILENO, &c, 1) == -1 && errno != EINTR && errno != EAGAIN)
+	{
+		throw_up("read failed");
+	}
 	if (c == '\x1b') 
 	{
 		return terminal_read_ANSI_sequence();
@@ -111,6 +207,19 @@ int terminal_read_key()
 	return c;
 }
 
+// Every signal that came since the last read is taken at once, NUL when the size didn't change after all
+int terminal_read_resize()
+{
+	char signals[64];
+	while (read(resize_pipe[0], signals, sizeof(signals)) > 0);
+	vec2 size = terminal_query_window_size();
+	if (size.x == window_size.x && size.y == window_size.y)
+	{
+		return NUL;
+	}
+	window_size = size;
+	return MAKE_RESIZE_KEY(size.x, size.y);
+}
 
 int terminal_read_ANSI_sequence()
 {
@@ -127,6 +236,10 @@ int terminal_read_ANSI_sequence()
 	{
 		return '\x1b';
 	}
+	if (seq[1] >= '0' && seq[1] <= '9')
+	{
+		return terminal_read_ANSI_tilde_sequence(seq[1]);
+	}
 	switch (seq[1]) 
 	{
 		case 'A': return ARROW_UP;
@@ -137,6 +250,58 @@ int terminal_read_ANSI_sequence()
 	return '\x1b';
 }
 
+int terminal_read_ANSI_tilde_sequence(char code)
+{
+	char end;
+	if (read(STDIN_FILENO, &end, 1) != 1)
+	{
+		return '\x1b';
+	}
+	if (code == '1' && end == ';')
+	{
+		return terminal_read_ANSI_modified_sequence();
+	}
+	if (end != '~')
+	{
+		return '\x1b';
+	}
+	switch (code)
+	{
+		case '5': return PAGE_UP;
+		case '6': return PAGE_DOWN;
+	}
+	return '\x1b';
+}
+
+// "\x1b[1;<modifier><key>", shift arrows and Alt+Up/Down are used
+int terminal_read_ANSI_modified_sequence()
+{
+	char seq[2];
+	if (read(STDIN_FILENO, &seq[0], 1) != 1 || read(STDIN_FILENO, &seq[1], 1) != 1)
+	{
+		return '\x1b';
+	}
+	if (seq[0] == '2')
+	{
+		switch (seq[1])
+		{
+			case 'A': return SHIFT_ARROW_UP;
+			case 'B': return SHIFT_ARROW_DOWN;
+			case 'C': return SHIFT_ARROW_RIGHT;
+			case 'D': return SHIFT_ARROW_LEFT;
+		}
+	}
+	if (seq[0] == '3')
+	{
+		switch (seq[1])
+		{
+			case 'A': return ALT_ARROW_UP;
+			case 'B': return ALT_ARROW_DOWN;
+		}
+	}
+	return '\x1b';
+}
+
 void terminal_flush_output()
 {
 	handle_error(write(STDIN_FILENO, dbuf_getc(dbuf, 0), dbuf_get_size(dbuf)), "terminal_flush_output: write failed");
@@ -0,0 +1,195 @@
+#pragma once
+#include <stdlib.h>
+#include <string.h>
+#include "allocator.h"
+#include "definitions.h"
+#include "error_handling.h"
+
+/*
+ * Generates a growable array of T named Name, with functions prefixed by prefix:
+ *
+ *     DEFINE_TYPED_ARRAY(LineArray, larr, DynamicBuffer*)
+ *
+ * Unlike DynamicArray the element size is known at compile time, so element access is a
+ * plain load and copies don't go through memcpy. Bounds are only checked when
+ * CHECKED_CONTAINERS is defined (tests turn it on), allocation failures are always checked.
+ * The reserved elements are counted as used, when the array is created or grows, so adding
+ * and removing elements never touches the shared counters.
+ */
+
+#ifdef CHECKED_CONTAINERS
+#define TARR_CHECK(cond, msg) tassert(cond, msg)
+#else
+#define TARR_CHECK(cond, msg) ((void)0)
+#endif
+
+#define TARR_INITIAL_RESERVED 64
+
+// Swaps the first left units of base with the right units after them, only the smaller side is copied aside
+static inline void tarr_rotate(void *base, size_t left, size_t right, size_t unit_size, int mem_category)
+{
+	char *bytes = (char *)base;
+	size_t tmp_size = (left < right ? left : right) * unit_size;
+	char *tmp = (char *)mem_alloc(mem_category, tmp_size);
+	if (left <= right)
+	{
+		memcpy(tmp, bytes, tmp_size);
+		memmove(bytes, bytes + left * unit_size, right * unit_size);
+		memcpy(bytes + right * unit_size, tmp, tmp_size);
+	}
+	else
+	{
+		memcpy(tmp, bytes + left * unit_size, tmp_size);
+		memmove(bytes + right * unit_size, bytes, left * unit_size);
+		memcpy(bytes, tmp, tmp_size);
+	}
+	mem_free(mem_category, tmp, tmp_size);
+}
+
+#define DEFINE_TYPED_ARRAY(Name, prefix, T)                                                                   \
+typedef struct                                                                                                \
+{                                                                                                             \
+	int mem_category;                                                                                         \
+	size_t length;                                                                                            \
+	size_t reserved_length;                                                                                   \
+	T *arr;                                                                                                   \
+} Name;                                                                                                       \
+                                                                                                              \
+static inline Name *prefix##_create(int mem_category)                                                         \
+{                                                                                                             \
+	Name *obj = (Name *)mem_alloc(mem_category, sizeof(Name));                                                \
+	obj->mem_category = mem_category;                                                                         \
+	obj->length = 0;                                                                                          \
+	obj->reserved_length = TARR_INITIAL_RESERVED;                                                             \
+	mem_add_used(mem_category, sizeof(Name) + obj->reserved_length * sizeof(T));                              \
+	obj->arr = (T *)mem_alloc(mem_category, obj->reserved_length * sizeof(T));                                \
+	return obj;                                                                                               \
+}                                                                                                             \
+                                                                                                              \
+static inline void prefix##_destroy(Name *obj)                                                                \
+{                                                                                                             \
+	tassert(obj, #prefix "_destroy: obj is NULL");                                                            \
+                                                                                                              \
+	mem_add_used(obj->mem_category, -(long long)(obj->reserved_length * sizeof(T) + sizeof(Name)));           \
+	mem_free(obj->mem_category, obj->arr, obj->reserved_length * sizeof(T));                                  \
+	mem_free(obj->mem_category, obj, sizeof(Name));                                                           \
+}                                                                                                             \
+                                                                                                              \
+static inline void prefix##_reserve(Name *obj, size_t length)                                                 \
+{                                                                                                             \
+	if (length <= obj->reserved_length)                                                                       \
+	{                                                                                                         \
+		return;                                                                                               \
+	}                                                                                                         \
+	size_t old_reserved_length = obj->reserved_length;                                                        \
+	while (obj->reserved_length < length)                                                                     \
+	{                                                                                                         \
+		obj->reserved_length <<= 1;                                                                           \
+	}                                                                                                         \
+	obj->arr = (T *)mem_realloc(obj->mem_category, obj->arr, old_reserved_length * sizeof(T),                 \
+			obj->reserved_length * sizeof(T));                                                                \
+	mem_add_used(obj->mem_category, (obj->reserved_length - old_reserved_length) * sizeof(T));                \
+}                                                                                                             \
+                                                                                                              \
+static FORCE_INLINE size_t prefix##_get_size(const Name *obj)                                                 \
+{                                                                                                             \
+	return obj->length;                                                                                       \
+}                                                                                                             \
+                                                                                                              \
+static FORCE_INLINE T prefix##_get(const Name *obj, size_t i)                                                 \
+{                                                                                                             \
+	TARR_CHECK(i < obj->length, #prefix "_get: index out of range");                                          \
+	return obj->arr[i];                                                                                       \
+}                                                                                                             \
+                                                                                                              \
+static FORCE_INLINE T *prefix##_get_ptr(Name *obj, size_t i)                                                  \
+{                                                                                                             \
+	TARR_CHECK(i < obj->length, #prefix "_get_ptr: index out of range");                                      \
+	return &obj->arr[i];                                                                                      \
+}                                                                                                             \
+                                                                                                              \
+static FORCE_INLINE T const *prefix##_getc(const Name *obj, size_t i)                                         \
+{                                                                                                             \
+	TARR_CHECK(i < obj->length, #prefix "_getc: index out of range");                                         \
+	return &obj->arr[i];                                                                                      \
+}                                                                                                             \
+                                                                                                              \
+static FORCE_INLINE void prefix##_set(Name *obj, size_t i, T val)                                             \
+{                                                                                                             \
+	TARR_CHECK(i < obj->length, #prefix "_set: index out of range");                                          \
+	obj->arr[i] = val;                                                                                        \
+}                                                                                                             \
+                                                                                                              \
+static FORCE_INLINE void prefix##_add(Name *obj, T val)                                                       \
+{                                                                                                             \
+	if (obj->length == obj->reserved_length)                                                                  \
+	{                                                                                                         \
+		prefix##_reserve(obj, obj->length + 1);                                                               \
+	}                                                                                                         \
+	obj->arr[obj->length++] = val;                                                                            \
+}                                                                                                             \
+                                                                                                              \
+static inline void prefix##_add_multiple(Name *obj, size_t count, T const *vals)                              \
+{                                                                                                             \
+	prefix##_reserve(obj, obj->length + count);                                                               \
+	memcpy(&obj->arr[obj->length], vals, count * sizeof(T));                                                  \
+	obj->length += count;                                                                                     \
+}                                                                                                             \
+                                                                                                              \
+static inline void prefix##_insert_to(Name *obj, size_t pos, T val)                                           \
+{                                                                                                             \
+	TARR_CHECK(pos <= obj->length, #prefix "_insert_to: position out of range");                              \
+	prefix##_reserve(obj, obj->length + 1);                                                                   \
+	memmove(&obj->arr[pos + 1], &obj->arr[pos], (obj->length - pos) * sizeof(T));                             \
+	obj->arr[pos] = val;                                                                                      \
+	obj->length++;                                                                                            \
+}                                                                                                             \
+                                                                                                              \
+static inline void prefix##_insert_multiple(Name *obj, size_t pos, size_t count, T const *vals)               \
+{                                                                                                             \
+	TARR_CHECK(pos <= obj->length, #prefix "_insert_multiple: position out of range");                        \
+	prefix##_reserve(obj, obj->length + count);                                                               \
+	memmove(&obj->arr[pos + count], &obj->arr[pos], (obj->length - pos) * sizeof(T));                         \
+	memcpy(&obj->arr[pos], vals, count * sizeof(T));                                                          \
+	obj->length += count;                                                                                     \
+}                                                                                                             \
+                                                                                                              \
+static inline void prefix##_remove_multiple(Name *obj, size_t pos, size_t count)                              \
+{                                                                                                             \
+	TARR_CHECK(pos + count <= obj->length, #prefix "_remove_multiple: range out of range");                   \
+	memmove(&obj->arr[pos], &obj->arr[pos + count], (obj->length - pos - count) * sizeof(T));                 \
+	obj->length -= count;                                                                                     \
+}                                                                                                             \
+                                                                                                              \
+/* Moves count elements from pos so that they start at to, the elements in between shift over */              \
+static inline void prefix##_move_multiple(Name *obj, size_t pos, size_t count, size_t to)                     \
+{                                                                                                             \
+	TARR_CHECK(pos + count <= obj->length && to + count <= obj->length,                                       \
+			#prefix "_move_multiple: range out of range");                                                    \
+	if (pos == to || count == 0)                                                                              \
+	{                                                                                                         \
+		return;                                                                                               \
+	}                                                                                                         \
+	size_t low = pos < to ? pos : to;                                                                         \
+	size_t high = (pos < to ? to : pos) + count;                                                              \
+	size_t left = to < pos ? pos - to : count;                                                                \
+	tarr_rotate(&obj->arr[low], left, high - low - left, sizeof(T), obj->mem_category);                       \
+}                                                                                                             \
+                                                                                                              \
+static inline void prefix##_remove(Name *obj, size_t pos)                                                     \
+{                                                                                                             \
+	TARR_CHECK(pos < obj->length, #prefix "_remove: position out of range");                                  \
+	memmove(&obj->arr[pos], &obj->arr[pos + 1], (obj->length - pos - 1) * sizeof(T));                         \
+	obj->length--;                                                                                            \
+}                                                                                                             \
+                                                                                                              \
+static FORCE_INLINE void prefix##_pop(Name *obj)                                                              \
+{                                                                                                             \
+	TARR_CHECK(obj->length > 0, #prefix "_pop: array is empty");                                              \
+	obj->length--;                                                                                            \
+}                                                                                                             \
+                                                                                                              \
+static inline void prefix##_clear(Name *obj)                                                                  \
+{                                                                                                             \
+	obj->length = 0;                                                                                          \
+}
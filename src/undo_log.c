@@ -0,0 +1,407 @@
+/* Includes */
+#include <string.h>
+#include "allocator.h"
+#include "error_handling.h"
+#include "undo_log.h"
+
+/* Definitions */
+#define COMPACT_MIN_EVICTED 64
+
+/* Private Function Declarations */
+void ulog_record(UndoLog *obj, int type, vec2 start, vec2 end, size_t size, const char *text);
+bool ulog_try_coalesce(UndoLog *obj, int type, vec2 start, vec2 end, size_t size, const char *text);
+void ulog_drop_redo(UndoLog *obj);
+void ulog_enforce_budget(UndoLog *obj);
+void ulog_compact(UndoLog *obj);
+size_t ulog_get_dead_bytes(const UndoLog *obj);
+size_t ulog_get_dead_lines(const UndoLog *obj);
+void ulog_release_lines(UndoLog *obj, size_t start, size_t end);
+bool ulog_positions_equal(vec2 a, vec2 b);
+
+UndoLog *ulog_create(size_t budget)
+{
+	UndoLog *obj = mem_alloc(MEM_UNDO, sizeof(UndoLog));
+	mem_add_used(MEM_UNDO, sizeof(UndoLog));
+	obj->arena = carr_create(MEM_UNDO);
+	obj->lines = larr_create(MEM_UNDO);
+	obj->entries = uearr_create(MEM_UNDO);
+	obj->budget = budget;
+	obj->first = 0;
+	obj->next_group = 0;
+	obj->group_depth = 0;
+	obj->dropping = false;
+	ulog_clear(obj);
+	return obj;
+}
+
+void ulog_destroy(UndoLog *obj)
+{
+	tassert(obj, "ulog_destroy: obj is NULL");
+
+	ulog_clear(obj);
+	carr_destroy(obj->arena);
+	larr_destroy(obj->lines);
+	uearr_destroy(obj->entries);
+	mem_add_used(MEM_UNDO, -(long long)sizeof(UndoLog));
+	mem_free(MEM_UNDO, obj, sizeof(UndoLog));
+}
+
+void ulog_clear(UndoLog *obj)
+{
+	tassert(obj, "ulog_clear: obj is NULL");
+
+	ulog_release_lines(obj, ulog_get_dead_lines(obj), larr_get_size(obj->lines));
+	larr_clear(obj->lines);
+	carr_clear(obj->arena);
+	uearr_clear(obj->entries);
+	obj->first = 0;
+	obj->current = 0;
+	obj->sealed = true;
+}
+
+// For an edit that won't be recorded, the older history can't be undone without it. Inside a group the rest of the group
+// isn't recorded either, and the history is cleared when the group ends, so an undo never replays part of a group
+void ulog_drop_history(UndoLog *obj)
+{
+	tassert(obj, "ulog_drop_history: obj is NULL");
+
+	if (obj->group_depth > 0)
+	{
+		obj->dropping = true;
+		return;
+	}
+	ulog_clear(obj);
+}
+
+void ulog_record_insert(UndoLog *obj, vec2 start, vec2 end, size_t size, const char *text)
+{
+	ulog_record(obj, UNDO_INSERT, start, end, size, text);
+}
+
+void ulog_record_delete(UndoLog *obj, vec2 start, vec2 end, size_t size, const char *text)
+{
+	ulog_record(obj, UNDO_DELETE, start, end, size, text);
+}
+
+void ulog_record_move(UndoLog *obj, size_t row, size_t count, size_t to)
+{
+	tassert(obj, "ulog_record_move: obj is NULL");
+	tassert(obj->group_depth == 0, "ulog_record_move: moves can't be grouped");
+
+	if (count == 0 || row == to || obj->dropping)
+	{
+		return;
+	}
+	ulog_drop_redo(obj);
+	UndoEntry entry =
+	{
+		.type = UNDO_MOVE_LINES,
+		.start = {.x = 0, .y = row},
+		.end = {.x = 0, .y = to},
+		.group = obj->group_depth > 0 ? obj->open_group : obj->next_group++,
+		.text_offset = carr_get_size(obj->arena),
+		.text_size = 0,
+		.line_offset = larr_get_size(obj->lines),
+		.line_count = count,
+	};
+	uearr_add(obj->entries, entry);
+	obj->current++;
+	obj->sealed = true;
+	ulog_enforce_budget(obj);
+}
+
+// Takes a reference to each line, the lines must be handles and not compressed slots
+void ulog_record_lines(UndoLog *obj, int type, size_t row, size_t count, DynamicBuffer *const *lines)
+{
+	tassert(obj, "ulog_record_lines: obj is NULL");
+	tassert(type == UNDO_INSERT_LINES || type == UNDO_DELETE_LINES, "ulog_record_lines: not a line entry");
+
+	if (count == 0 || obj->dropping)
+	{
+		return;
+	}
+	ulog_drop_redo(obj);
+	UndoEntry entry =
+	{
+		.type = type,
+		.start = {.x = 0, .y = row},
+		.end = {.x = 0, .y = row + count},
+		.group = obj->group_depth > 0 ? obj->open_group : obj->next_group++,
+		.text_offset = carr_get_size(obj->arena),
+		.text_size = 0,
+		.line_offset = larr_get_size(obj->lines),
+		.line_count = count,
+	};
+	for (size_t i = 0; i < count; i++)
+	{
+		larr_add(obj->lines, dbuf_share(lines[i]));
+	}
+	uearr_add(obj->entries, entry);
+	obj->current++;
+	obj->sealed = true;
+	ulog_enforce_budget(obj);
+}
+
+void ulog_seal(UndoLog *obj)
+{
+	obj->sealed = true;
+}
+
+void ulog_begin_group(UndoLog *obj)
+{
+	if (obj->group_depth++ == 0)
+	{
+		obj->open_group = obj->next_group++;
+		obj->sealed = true;
+	}
+}
+
+void ulog_end_group(UndoLog *obj)
+{
+	tassert(obj->group_depth > 0, "ulog_end_group: no group is open");
+
+	if (--obj->group_depth == 0)
+	{
+		obj->sealed = true;
+		if (obj->dropping)
+		{
+			obj->dropping = false;
+			ulog_clear(obj);
+		}
+	}
+}
+
+size_t ulog_undo(UndoLog *obj, const UndoEntry **entries)
+{
+	tassert(obj->group_depth == 0, "ulog_undo: a group is still open");
+
+	if (obj->current == obj->first)
+	{
+		return 0;
+	}
+	size_t group = uearr_get(obj->entries, obj->current - 1).group;
+	size_t start = obj->current - 1;
+	while (start > obj->first && uearr_get(obj->entries, start - 1).group == group)
+	{
+		start--;
+	}
+	size_t count = obj->current - start;
+	*entries = uearr_getc(obj->entries, start);
+	obj->current = start;
+	obj->sealed = true;
+	return count;
+}
+
+size_t ulog_redo(UndoLog *obj, const UndoEntry **entries)
+{
+	tassert(obj->group_depth == 0, "ulog_redo: a group is still open");
+
+	size_t length = uearr_get_size(obj->entries);
+	if (obj->current == length)
+	{
+		return 0;
+	}
+	size_t group = uearr_get(obj->entries, obj->current).group;
+	size_t end = obj->current + 1;
+	while (end < length && uearr_get(obj->entries, end).group == group)
+	{
+		end++;
+	}
+	size_t count = end - obj->current;
+	*entries = uearr_getc(obj->entries, obj->current);
+	obj->current = end;
+	obj->sealed = true;
+	return count;
+}
+
+const char *ulog_get_text(const UndoLog *obj, const UndoEntry *entry)
+{
+	return obj->arena->arr + entry->text_offset;
+}
+
+DynamicBuffer *const *ulog_get_lines(const UndoLog *obj, const UndoEntry *entry)
+{
+	return obj->lines->arr + entry->line_offset;
+}
+
+void ulog_set_budget(UndoLog *obj, size_t budget)
+{
+	obj->budget = budget;
+	ulog_enforce_budget(obj);
+}
+
+size_t ulog_get_memory_usage(const UndoLog *obj)
+{
+	size_t live_entries = uearr_get_size(obj->entries) - obj->first;
+	size_t live_lines = larr_get_size(obj->lines) - ulog_get_dead_lines(obj);
+	return carr_get_size(obj->arena) - ulog_get_dead_bytes(obj) + live_lines * sizeof(DynamicBuffer *) + live_entries * sizeof(UndoEntry);
+}
+
+size_t ulog_get_undo_count(const UndoLog *obj)
+{
+	return obj->current - obj->first;
+}
+
+size_t ulog_get_redo_count(const UndoLog *obj)
+{
+	return uearr_get_size(obj->entries) - obj->current;
+}
+
+void ulog_record(UndoLog *obj, int type, vec2 start, vec2 end, size_t size, const char *text)
+{
+	tassert(obj, "ulog_record: obj is NULL");
+
+	if (size == 0 || obj->dropping)
+	{
+		return;
+	}
+	if (size > obj->budget)
+	{
+		// It would be evicted right away
+		ulog_drop_history(obj);
+		return;
+	}
+	// A new edit makes the undone history unreachable
+	ulog_drop_redo(obj);
+	if (!ulog_try_coalesce(obj, type, start, end, size, text))
+	{
+		UndoEntry entry =
+		{
+			.type = type,
+			.start = start,
+			.end = end,
+			.group = obj->group_depth > 0 ? obj->open_group : obj->next_group++,
+			.text_offset = carr_get_size(obj->arena),
+			.text_size = size,
+			.line_offset = larr_get_size(obj->lines),
+		};
+		carr_add_multiple(obj->arena, size, text);
+		uearr_add(obj->entries, entry);
+		obj->current++;
+	}
+	// Line breaks end the entry, so that undoing typing goes back one line at a time
+	obj->sealed = start.y != end.y;
+	ulog_enforce_budget(obj);
+}
+
+bool ulog_try_coalesce(UndoLog *obj, int type, vec2 start, vec2 end, size_t size, const char *text)
+{
+	if (obj->sealed || obj->current == obj->first || start.y != end.y)
+	{
+		return false;
+	}
+	UndoEntry *last = uearr_get_ptr(obj->entries, obj->current - 1);
+	if (last->type != type)
+	{
+		return false;
+	}
+	// Since the last entry is also the newest, its text is at the end of the arena
+	if (type == UNDO_INSERT && ulog_positions_equal(last->end, start))
+	{
+		carr_add_multiple(obj->arena, size, text);
+		last->end = end;
+	}
+	else if (type == UNDO_DELETE && ulog_positions_equal(last->start, end))
+	{
+		// Backspacing, the deleted text comes before the text of the entry
+		carr_insert_multiple(obj->arena, last->text_offset, size, text);
+		last->start = start;
+	}
+	else if (type == UNDO_DELETE && ulog_positions_equal(last->start, start))
+	{
+		// Deleting forward, the cursor stays in place and the text piles up after it
+		carr_add_multiple(obj->arena, size, text);
+		last->end.x += end.x - start.x;
+	}
+	else
+	{
+		return false;
+	}
+	last->text_size += size;
+	return true;
+}
+
+void ulog_drop_redo(UndoLog *obj)
+{
+	size_t length = uearr_get_size(obj->entries);
+	if (obj->current == length)
+	{
+		return;
+	}
+	size_t text_end = uearr_get(obj->entries, obj->current).text_offset;
+	carr_remove_multiple(obj->arena, text_end, carr_get_size(obj->arena) - text_end);
+	size_t lines_end = uearr_get(obj->entries, obj->current).line_offset;
+	ulog_release_lines(obj, lines_end, larr_get_size(obj->lines));
+	larr_remove_multiple(obj->lines, lines_end, larr_get_size(obj->lines) - lines_end);
+	uearr_remove_multiple(obj->entries, obj->current, length - obj->current);
+}
+
+void ulog_enforce_budget(UndoLog *obj)
+{
+	// Whole groups are evicted from the oldest end, an undo never stops halfway through a group
+	size_t evicted_lines = ulog_get_dead_lines(obj);
+	while (ulog_get_memory_usage(obj) > obj->budget && obj->first < obj->current)
+	{
+		size_t group = uearr_get(obj->entries, obj->first).group;
+		while (obj->first < obj->current && uearr_get(obj->entries, obj->first).group == group)
+		{
+			obj->first++;
+		}
+		// Evicted lines are let go of right away, their handles stay in place until the log is compacted
+		size_t lines_end = obj->first < uearr_get_size(obj->entries) ? uearr_get(obj->entries, obj->first).line_offset : larr_get_size(obj->lines);
+		ulog_release_lines(obj, evicted_lines, lines_end);
+		evicted_lines = lines_end;
+	}
+	if (obj->first >= COMPACT_MIN_EVICTED && obj->first * 2 >= uearr_get_size(obj->entries))
+	{
+		ulog_compact(obj);
+	}
+}
+
+void ulog_compact(UndoLog *obj)
+{
+	size_t dead_bytes = ulog_get_dead_bytes(obj);
+	size_t dead_lines = ulog_get_dead_lines(obj);
+	carr_remove_multiple(obj->arena, 0, dead_bytes);
+	larr_remove_multiple(obj->lines, 0, dead_lines);
+	uearr_remove_multiple(obj->entries, 0, obj->first);
+	for (size_t i = 0; i < uearr_get_size(obj->entries); i++)
+	{
+		UndoEntry *entry = uearr_get_ptr(obj->entries, i);
+		entry->text_offset -= dead_bytes;
+		entry->line_offset -= dead_lines;
+	}
+	obj->current -= obj->first;
+	obj->first = 0;
+}
+
+size_t ulog_get_dead_bytes(const UndoLog *obj)
+{
+	if (obj->first == uearr_get_size(obj->entries))
+	{
+		return carr_get_size(obj->arena);
+	}
+	return uearr_get(obj->entries, obj->first).text_offset;
+}
+
+size_t ulog_get_dead_lines(const UndoLog *obj)
+{
+	if (obj->first == uearr_get_size(obj->entries))
+	{
+		return larr_get_size(obj->lines);
+	}
+	return uearr_get(obj->entries, obj->first).line_offset;
+}
+
+void ulog_release_lines(UndoLog *obj, size_t start, size_t end)
+{
+	for (size_t i = start; i < end; i++)
+	{
+		dbuf_destroy(larr_get(obj->lines, i));
+	}
+}
+
+bool ulog_positions_equal(vec2 a, vec2 b)
+{
+	return a.x == b.x && a.y == b.y;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <stdbool.h>
+#include <stdlib.h>
+#include "definitions.h"
+#include "dynamic_buffer.h"
+#include "typed_array.h"
+
+#define UNDO_INSERT 0
+#define UNDO_DELETE 1
+#define UNDO_MOVE_LINES 2 // Has no text, start.y is the first moved line and end.y where it went
+#define UNDO_INSERT_LINES 3 // Has no text, start.y is the first row and the lines are handles shared with the file
+#define UNDO_DELETE_LINES 4
+
+#define UNDO_DEFAULT_BUDGET (16 << 20)
+
+typedef struct
+{
+	int type;
+	vec2 start;
+	vec2 end;           // Position right after the text while it is in the file
+	size_t group;       // Entries of the same group are undone and redone together
+	size_t text_offset; // Offset of the text in the arena
+	size_t text_size;
+	size_t line_offset; // Offset of the handles in lines
+	size_t line_count;  // Only used by UNDO_MOVE_LINES and the line entries
+} UndoEntry;
+
+DEFINE_TYPED_ARRAY(UndoEntryArray, uearr, UndoEntry)
+
+/*
+ * Append-only log of inserted and deleted text. Texts live back to back in one arena, in
+ * entry order, so dropping the redo tail or the oldest history only moves offsets.
+ * Whole lines are kept the same way as handles, the bytes of a line are never copied.
+ * Entries [first, current) can be undone and [current, length) can be redone.
+ */
+typedef struct
+{
+	CharArray *arena;
+	LineArray *lines;   // One reference to each line of the line entries, released when they are dropped
+	UndoEntryArray *entries;
+	size_t first;
+	size_t current;
+	size_t budget;      // Arena, handle and entry bytes kept before the oldest groups are evicted
+	size_t next_group;
+	size_t open_group;
+	int group_depth;
+	bool sealed;        // When set the next edit starts a new entry instead of extending the last one
+	bool dropping;      // An edit of the open group can't be undone, the history is cleared when the group ends
+} UndoLog;
+
+UndoLog *ulog_create(size_t budget);
+void ulog_destroy(UndoLog *obj);
+void ulog_clear(UndoLog *obj);
+void ulog_drop_history(UndoLog *obj);
+
+void ulog_record_insert(UndoLog *obj, vec2 start, vec2 end, size_t size, const char *text);
+void ulog_record_delete(UndoLog *obj, vec2 start, vec2 end, size_t size, const char *text);
+void ulog_record_move(UndoLog *obj, size_t row, size_t count, size_t to);
+void ulog_record_lines(UndoLog *obj, int type, size_t row, size_t count, DynamicBuffer *const *lines);
+void ulog_seal(UndoLog *obj);
+void ulog_begin_group(UndoLog *obj);
+void ulog_end_group(UndoLog *obj);
+
+size_t ulog_undo(UndoLog *obj, const UndoEntry **entries);
+size_t ulog_redo(UndoLog *obj, const UndoEntry **entries);
+const char *ulog_get_text(const UndoLog *obj, const UndoEntry *entry);
+DynamicBuffer *const *ulog_get_lines(const UndoLog *obj, const UndoEntry *entry);
+
+void ulog_set_budget(UndoLog *obj, size_t budget);
+size_t ulog_get_memory_usage(const UndoLog *obj);
+size_t ulog_get_undo_count(const UndoLog *obj);
+size_t ulog_get_redo_count(const UndoLog *obj);
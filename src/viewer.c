@@ -0,0 +1,226 @@
+/* Includes */
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include "allocator.h"
+#include "error_handling.h"
+#include "file_view.h"
+#include "viewer.h"
+
+/* Definitions */
+#define MX_VIEWER_GOTO_TEXT_LENGTH 32
+#define MX_VIEWER_BAR_LENGTH       (PATH_MAX + 64)
+
+struct _viewer
+{
+	FileView *file_view;
+	char filename[PATH_MAX];
+	vec2 window_size;    // Without the prompt row
+	size_t top;          // Where the first row of the screen starts
+	bool going_to;       // The go to prompt is open
+	char goto_text[MX_VIEWER_GOTO_TEXT_LENGTH];
+	size_t goto_text_index;
+	bool redraw;         // Nothing is sent while nothing changed
+	IO_Interface io_interface;
+};
+
+/* Private Function Declarations */
+void viewer_scroll(Viewer *obj, int change);
+void viewer_resize(Viewer *obj, vec2 window_size);
+int viewer_process_goto_key(Viewer *obj, int c);
+void viewer_go_to(Viewer *obj);
+void viewer_render_bar(const Viewer *obj);
+
+// NULL when the file can't be opened
+Viewer *viewer_create(const char *filename, vec2 window_size, IO_Interface io_interface)
+{
+	FileView *file_view = fview_open(filename);
+	if (file_view == NULL)
+	{
+		return NULL;
+	}
+	Viewer *obj = mem_alloc(MEM_OTHER, sizeof(Viewer));
+	mem_add_used(MEM_OTHER, sizeof(Viewer));
+	obj->file_view = file_view;
+	snprintf(obj->filename, sizeof(obj->filename), "%s", filename);
+	obj->window_size = window_size;
+	obj->window_size.y--;
+	obj->top = 0;
+	obj->going_to = false;
+	obj->goto_text_index = 0;
+	obj->redraw = true;
+	obj->io_interface = io_interface;
+	return obj;
+}
+
+void viewer_destroy(Viewer *obj)
+{
+	tassert(obj, "viewer_destroy: obj is NULL");
+
+	fview_close(obj->file_view);
+	mem_add_used(MEM_OTHER, -(long long)sizeof(Viewer));
+	mem_free(MEM_OTHER, obj, sizeof(Viewer));
+}
+
+int viewer_process_tick(Viewer *obj)
+{
+	int c = obj->io_interface.read_key();
+	if (IS_RESIZE_KEY(c))
+	{
+		viewer_resize(obj, GET_RESIZE_KEY_SIZE(c));
+		return TEXT_EDITOR_SUCCESSFUL_READ;
+	}
+	if (obj->going_to)
+	{
+		return viewer_process_goto_key(obj, c);
+	}
+	switch (c)
+	{
+		case QUIT_KEY:
+			return TEXT_EDITOR_EOF;
+		case ARROW_UP:
+			viewer_scroll(obj, -1);
+			break;
+		case ARROW_DOWN:
+			viewer_scroll(obj, 1);
+			break;
+		case PAGE_UP:
+			viewer_scroll(obj, -obj->window_size.y);
+			break;
+		case PAGE_DOWN:
+			viewer_scroll(obj, obj->window_size.y);
+			break;
+		case GOTO_KEY:
+			obj->going_to = true;
+			obj->redraw = true;
+			break;
+	}
+	return TEXT_EDITOR_SUCCESSFUL_READ;
+}
+
+// The top row is moved back to the start of the row of the new width it's in, scrolling up counts on rows starting
+// at multiples of the width from their line start
+void viewer_resize(Viewer *obj, vec2 window_size)
+{
+	obj->window_size.x = window_size.x > 1 ? window_size.x : 1;
+	obj->window_size.y = window_size.y > 2 ? window_size.y - 1 : 1;
+	size_t line_start = fview_get_line_start(obj->file_view, obj->top);
+	obj->top = line_start + (obj->top - line_start) / obj->window_size.x * obj->window_size.x;
+	obj->io_interface.clear_screen();
+	obj->redraw = true;
+}
+
+// Scrolling stops with the last row at the top, like scrolling to the end in the editor
+void viewer_scroll(Viewer *obj, int change)
+{
+	size_t top = obj->top;
+	for (; change > 0 && fview_get_next_row(obj->file_view, &obj->top, obj->window_size.x); change--);
+	for (; change < 0 && fview_get_previous_row(obj->file_view, &obj->top, obj->window_size.x); change++);
+	obj->redraw |= obj->top != top;
+}
+
+int viewer_process_goto_key(Viewer *obj, int c)
+{
+	obj->redraw |= c != NUL;
+	switch (c)
+	{
+		case QUIT_KEY:
+			return TEXT_EDITOR_EOF;
+		case CTRL('X'):
+		case ESCAPE_KEY:
+			obj->going_to = false;
+			obj->goto_text_index = 0;
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case BACKSPACE:
+			if (obj->goto_text_index > 0)
+			{
+				obj->goto_text_index--;
+			}
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+		case CARRIAGE_RETURN:
+			viewer_go_to(obj);
+			obj->going_to = false;
+			obj->goto_text_index = 0;
+			return TEXT_EDITOR_SUCCESSFUL_READ;
+	}
+	if ((isdigit(c) || c == '%') && obj->goto_text_index < MX_VIEWER_GOTO_TEXT_LENGTH)
+	{
+		obj->goto_text[obj->goto_text_index++] = c;
+	}
+	return TEXT_EDITOR_SUCCESSFUL_READ;
+}
+
+// Percentages are taken over the bytes, the wrapped rows aren't known without reading the whole file
+void viewer_go_to(Viewer *obj)
+{
+	if (obj->goto_text_index == 0)
+	{
+		return;
+	}
+	size_t value = 0;
+	for (size_t i = 0; i < obj->goto_text_index && isdigit(obj->goto_text[i]); i++)
+	{
+		value = value * 10 + (obj->goto_text[i] - '0');
+	}
+	const FileView *file_view = obj->file_view;
+	if (obj->goto_text[obj->goto_text_index - 1] == '%')
+	{
+		size_t offset = value >= 100 || file_view->size == 0 ? file_view->size : file_view->size / 100 * value + file_view->size % 100 * value / 100;
+		// The line break that ends the file doesn't start a line
+		offset = offset > 0 && offset == file_view->size ? offset - 1 : offset;
+		obj->top = fview_get_line_start(file_view, offset);
+		return;
+	}
+	// Lines are 1-indexed for the user
+	obj->top = fview_find_line(obj->file_view, value > 0 ? value - 1 : 0);
+}
+
+void viewer_render_screen(Viewer *obj)
+{
+	if (!obj->redraw)
+	{
+		return;
+	}
+	obj->redraw = false;
+	obj->io_interface.hide_cursor();
+	// Rows are sent straight from the mapping
+	const FileView *file_view = obj->file_view;
+	size_t width = obj->window_size.x;
+	size_t offset = obj->top;
+	bool has_row = true;
+	for (int row = 0; row < obj->window_size.y; row++)
+	{
+		if (!has_row)
+		{
+			obj->io_interface.render_row(row, 1, "~");
+			continue;
+		}
+		size_t row_size = fview_get_row_size(file_view, offset, width);
+		obj->io_interface.render_row(row, row_size, row_size > 0 ? file_view->data + offset : "");
+		has_row = fview_get_next_row(file_view, &offset, width);
+	}
+	viewer_render_bar(obj);
+	if (obj->going_to)
+	{
+		obj->io_interface.reveal_cursor();
+	}
+	obj->io_interface.flush_output();
+}
+
+void viewer_render_bar(const Viewer *obj)
+{
+	char bar[MX_VIEWER_BAR_LENGTH];
+	int bar_size;
+	if (obj->going_to)
+	{
+		bar_size = snprintf(bar, sizeof(bar), "Go to line (or N%%): %.*s", (int)obj->goto_text_index, obj->goto_text);
+		obj->io_interface.set_cursor_position(bar_size, obj->window_size.y);
+	}
+	else
+	{
+		size_t size = obj->file_view->size;
+		bar_size = snprintf(bar, sizeof(bar), "%s (read only) %zu%%", obj->filename, size == 0 ? 100 : obj->top * 100 / size);
+	}
+	bar_size = bar_size < (int)sizeof(bar) ? bar_size : (int)sizeof(bar) - 1;
+	obj->io_interface.render_row(obj->window_size.y, bar_size < obj->window_size.x ? bar_size : obj->window_size.x, bar);
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "definitions.h"
+#include "editor.h"
+
+/*
+ * Shows a file that's only read straight from its mapping, see FileView. Opening takes the same
+ * time for any file size, and nothing is kept per line. It scrolls and goes to lines like the
+ * editor, but there is no cursor and nothing to edit.
+ */
+typedef struct _viewer Viewer;
+
+Viewer *viewer_create(const char *filename, vec2 window_size, IO_Interface io_interface);
+void viewer_destroy(Viewer *obj);
+
+int viewer_process_tick(Viewer *obj);
+void viewer_render_screen(Viewer *obj);
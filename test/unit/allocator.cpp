@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include <string>
+
+extern "C"
+{
+#include "allocator.h"
+#include "dynamic_array.h"
+}
+
+TEST(Allocator, CountsEachCategoryOnItsOwn)
+{
+	size_t search_before = mem_get_current(MEM_SEARCH);
+	size_t render_before = mem_get_current(MEM_RENDER);
+	void *ptr = mem_alloc(MEM_SEARCH, 100);
+	ASSERT_EQ(mem_get_current(MEM_SEARCH) - search_before, 100u);
+	ptr = mem_realloc(MEM_SEARCH, ptr, 100, 300);
+	ASSERT_EQ(mem_get_current(MEM_SEARCH) - search_before, 300u);
+	ptr = mem_realloc(MEM_SEARCH, ptr, 300, 50);
+	ASSERT_EQ(mem_get_current(MEM_SEARCH) - search_before, 50u);
+	// The peak remembers the largest the category got
+	ASSERT_GE(mem_get_peak(MEM_SEARCH), search_before + 300);
+	mem_free(MEM_SEARCH, ptr, 50);
+	ASSERT_EQ(mem_get_current(MEM_SEARCH), search_before);
+	ASSERT_EQ(mem_get_current(MEM_RENDER), render_before);
+}
+
+TEST(Allocator, DynamicArraysCountTheirElementsAsUsed)
+{
+	size_t current_before = mem_get_current(MEM_RENDER);
+	size_t used_before = mem_get_used(MEM_RENDER);
+	size_t search_before = mem_get_current(MEM_SEARCH);
+	DynamicArray *arr = darr_create(sizeof(int), MEM_RENDER);
+	int values[10] = {};
+	darr_add_multiple(arr, 10, values);
+	darr_pop(arr);
+	// What's reserved is allocated, only the elements are used
+	ASSERT_EQ(mem_get_current(MEM_RENDER) - current_before, sizeof(DynamicArray) + 64 * sizeof(int));
+	ASSERT_EQ(mem_get_used(MEM_RENDER) - used_before, sizeof(DynamicArray) + 9 * sizeof(int));
+	ASSERT_EQ(mem_get_current(MEM_SEARCH), search_before);
+	darr_destroy(arr);
+	ASSERT_EQ(mem_get_current(MEM_RENDER), current_before);
+	ASSERT_EQ(mem_get_used(MEM_RENDER), used_before);
+}
+
+TEST(Allocator, ReportListsTheCategoriesThatWereUsed)
+{
+	char report[512];
+	mem_format_report(report, sizeof(report));
+	ASSERT_EQ(std::string(report).find("snapshot"), std::string::npos);
+	void *ptr = mem_alloc(MEM_SNAPSHOT, 1024);
+	mem_add_used(MEM_SNAPSHOT, 256);
+	mem_format_report(report, sizeof(report));
+	ASSERT_NE(std::string(report).find("snapshot 1.0K (75% slack)"), std::string::npos);
+	mem_add_used(MEM_SNAPSHOT, -256);
+	mem_free(MEM_SNAPSHOT, ptr, 1024);
+	// Freed categories stay in the report at their current size
+	mem_format_report(report, sizeof(report));
+	ASSERT_NE(std::string(report).find("snapshot 0B (0% slack)"), std::string::npos);
+}
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C"
+{
+#include "batch.h"
+#include "definitions.h"
+}
+#include "test_helpers.h"
+
+TEST(Batch, AppliesTheScriptToEveryFile)
+{
+	// Prefixes the first two lines with "- " and quits, the keys after the quit are never applied
+	std::vector<int> keys = {'-', ' ', ARROW_LEFT, ARROW_LEFT, ARROW_DOWN, '-', ' ', QUIT_KEY, 'x'};
+	std::string script = "text-editor-trace 1\nfile 0 0\nwindow 80 25\n";
+	for (int key : keys)
+	{
+		script += "0 " + std::to_string(key) + "\n";
+	}
+	std::string script_path = make_temp_file(script);
+	std::vector<std::string> paths;
+	for (int i = 0; i < 16; i++)
+	{
+		paths.push_back(make_temp_file("a" + std::to_string(i) + "\nb\nc\n"));
+	}
+	std::vector<char *> filenames;
+	for (std::string &path : paths)
+	{
+		filenames.push_back(&path[0]);
+	}
+
+	BatchReport report;
+	ASSERT_TRUE(batch_run(script_path.c_str(), filenames.size(), filenames.data(), 3, &report));
+	EXPECT_EQ(report.file_count, paths.size());
+	EXPECT_EQ(report.thread_count, 3u);
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		EXPECT_EQ(read_file(paths[i]), "- a" + std::to_string(i) + "\n- b\nc\n");
+		unlink(paths[i].c_str());
+	}
+	unlink(script_path.c_str());
+}
+
+TEST(Batch, FilesThatCantBeReadAreCountedAndSkipped)
+{
+	std::string script_path = make_temp_file("text-editor-trace 1\nfile 0 0\nwindow 80 25\n0 " + std::to_string('x') + "\n");
+	std::string path = make_temp_file("a\n");
+	char missing[] = "/tmp/text-editor-batch-missing";
+	char directory[] = "/tmp/text-editor-batch-directory";
+	mkdir(directory, 0700);
+	char *filenames[] = {missing, &path[0], directory};
+
+	BatchReport report;
+	ASSERT_TRUE(batch_run(script_path.c_str(), 3, filenames, 2, &report));
+	EXPECT_EQ(report.file_count, 3u);
+	EXPECT_EQ(report.failed_count, 2u);
+	EXPECT_EQ(read_file(path), "xa\n");
+	EXPECT_NE(access(missing, F_OK), 0);
+	struct stat st;
+	ASSERT_EQ(stat(directory, &st), 0);
+	EXPECT_TRUE(S_ISDIR(st.st_mode));
+	rmdir(directory);
+	unlink(path.c_str());
+	unlink(script_path.c_str());
+}
+
+TEST(Batch, MissingScriptFails)
+{
+	char filename[] = "/tmp/text-editor-batch-never-created";
+	char *filenames[] = {filename};
+	BatchReport report;
+	EXPECT_FALSE(batch_run("/tmp/text-editor-batch-no-script", 1, filenames, 1, &report));
+	EXPECT_NE(access(filename, F_OK), 0);
+}
@@ -2,12 +2,13 @@
 #include <limits.h>
 
 extern "C" {
+#include "../../src/allocator.h"
 #include "../../src/dynamic_buffer.h"
 }
 
 // Test dbuf_create
 TEST(DynamicBufferTest, Create) {
-	DynamicBuffer *dbuf = dbuf_create();
+	DynamicBuffer *dbuf = dbuf_create(MEM_OTHER);
 	ASSERT_NE(dbuf, nullptr);
 	ASSERT_EQ(dbuf->size, 0);
 	ASSERT_EQ(dbuf->reserved, 64); // Assuming INITIAL_RESERVED is 64
@@ -17,14 +18,14 @@ TEST(DynamicBufferTest, Create) {
 
 // Test dbuf_destroy
 TEST(DynamicBufferTest, Destroy) {
-	DynamicBuffer *dbuf = dbuf_create();
+	DynamicBuffer *dbuf = dbuf_create(MEM_OTHER);
 	dbuf_destroy(dbuf);
 	// No assertions here, just ensuring no segfault
 }
 
 // Test dbuf_addc
 TEST(DynamicBufferTest, AddChar) {
-	DynamicBuffer *dbuf = dbuf_create();
+	DynamicBuffer *dbuf = dbuf_create(MEM_OTHER);
 	dbuf_addc(dbuf, 'A');
 	ASSERT_EQ(dbuf->size, 1);
 	ASSERT_STREQ(dbuf->buf, "A");
@@ -32,7 +33,7 @@ TEST(DynamicBufferTest, AddChar) {
 }
 
 TEST(DynamicBufferTest, AddMultipleChars) {
-	DynamicBuffer *dbuf = dbuf_create();
+	DynamicBuffer *dbuf = dbuf_create(MEM_OTHER);
 	dbuf_addc(dbuf, 'H');
 	dbuf_addc(dbuf, 'i');
 	ASSERT_EQ(dbuf->size, 2);
@@ -41,7 +42,7 @@ TEST(DynamicBufferTest, AddMultipleChars) {
 }
 
 TEST(DynamicBufferTest, AddCharRealloc) {
-	DynamicBuffer *dbuf = dbuf_create();
+	DynamicBuffer *dbuf = dbuf_create(MEM_OTHER);
 	for (size_t i = 0; i < 100; ++i) {
 		dbuf_addc(dbuf, 'x');
 	}
@@ -52,7 +53,7 @@ TEST(DynamicBufferTest, AddCharRealloc) {
 
 // Test dbuf_adds
 TEST(DynamicBufferTest, AddString) {
-	DynamicBuffer *dbuf = dbuf_create();
+	DynamicBuffer *dbuf = dbuf_create(MEM_OTHER);
 	dbuf_adds(dbuf, 5, "Hello");
 	ASSERT_EQ(dbuf->size, 5);
 	ASSERT_STREQ(dbuf->buf, "Hello");
@@ -60,7 +61,7 @@ TEST(DynamicBufferTest, AddString) {
 }
 
 TEST(DynamicBufferTest, AddStringRealloc) {
-	DynamicBuffer *dbuf = dbuf_create();
+	DynamicBuffer *dbuf = dbuf_create(MEM_OTHER);
 	dbuf_adds(dbuf, 70, "This is a long string that will cause the buffer to reallocate.");
 	ASSERT_EQ(dbuf->size, 70);
 	ASSERT_EQ(dbuf->reserved, 128); // Assuming reserved doubled after 64
@@ -70,7 +71,7 @@ TEST(DynamicBufferTest, AddStringRealloc) {
 
 // Test dbuf_addi
 TEST(DynamicBufferTest, AddIntegerPositive) {
-	DynamicBuffer *dbuf = dbuf_create();
+	DynamicBuffer *dbuf = dbuf_create(MEM_OTHER);
 	dbuf_addi(dbuf, 12345);
 	ASSERT_EQ(dbuf->size, 5);
 	ASSERT_STREQ(dbuf->buf, "12345");
@@ -78,7 +79,7 @@ TEST(DynamicBufferTest, AddIntegerPositive) {
 }
 
 TEST(DynamicBufferTest, AddIntegerNegative) {
-	DynamicBuffer *dbuf = dbuf_create();
+	DynamicBuffer *dbuf = dbuf_create(MEM_OTHER);
 	dbuf_addi(dbuf, -6789);
 	ASSERT_EQ(dbuf->size, 5);
 	ASSERT_STREQ(dbuf->buf, "-6789");
@@ -86,7 +87,7 @@ TEST(DynamicBufferTest, AddIntegerNegative) {
 }
 
 TEST(DynamicBufferTest, AddIntegerZero) {
-	DynamicBuffer *dbuf = dbuf_create();
+	DynamicBuffer *dbuf = dbuf_create(MEM_OTHER);
 	dbuf_addi(dbuf, 0);
 	ASSERT_EQ(dbuf->size, 1);
 	ASSERT_STREQ(dbuf->buf, "0");
@@ -95,7 +96,7 @@ TEST(DynamicBufferTest, AddIntegerZero) {
 
 // Test dbuf_clear
 TEST(DynamicBufferTest, Clear) {
-	DynamicBuffer *dbuf = dbuf_create();
+	DynamicBuffer *dbuf = dbuf_create(MEM_OTHER);
 	dbuf_adds(dbuf, 5, "Hello");
 	ASSERT_EQ(dbuf->size, 5);
 	dbuf_clear(dbuf);
@@ -106,7 +107,7 @@ TEST(DynamicBufferTest, Clear) {
 
 // Test edge cases
 TEST(DynamicBufferTest, AddEmptyString) {
-	DynamicBuffer *dbuf = dbuf_create();
+	DynamicBuffer *dbuf = dbuf_create(MEM_OTHER);
 	dbuf_adds(dbuf, 0, "");
 	ASSERT_EQ(dbuf->size, 0);
 	ASSERT_STREQ(dbuf->buf, "");
@@ -115,7 +116,7 @@ TEST(DynamicBufferTest, AddEmptyString) {
 
 
 TEST(DynamicBufferTest, AddIntegerMinValue) {
-	DynamicBuffer *dbuf = dbuf_create();
+	DynamicBuffer *dbuf = dbuf_create(MEM_OTHER);
 	dbuf_addi(dbuf, INT_MIN);
 	ASSERT_STREQ(dbuf->buf, "-2147483648");
 	dbuf_destroy(dbuf);
@@ -123,7 +124,7 @@ TEST(DynamicBufferTest, AddIntegerMinValue) {
 
 
 TEST(DynamicBufferTest, AddNullTerminator) {
-	DynamicBuffer *dbuf = dbuf_create();
+	DynamicBuffer *dbuf = dbuf_create(MEM_OTHER);
 	dbuf_addc(dbuf, 'A');
 	dbuf_addc(dbuf, '\0'); // Assuming dbuf_addc should throw an error
 	ASSERT_EQ(dbuf->size, 1);
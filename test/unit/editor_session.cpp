@@ -0,0 +1,302 @@
+#include <gtest/gtest.h>
+#include <climits>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C"
+{
+#include "definitions.h"
+#include "editor.h"
+#include "headless_io.h"
+#include "journal.h"
+#include "sidecar.h"
+}
+#include "test_helpers.h"
+
+static const vec2 window_size = {40, 10};
+
+TEST(EditorSession, SaveThatFailsKeepsTheFileAndItsJournal)
+{
+	std::string path = make_temp_file("one\n");
+	ASSERT_EQ(chmod(path.c_str(), 0640), 0);
+	Editor *editor = editor_create(window_size, headless_io_null_interface());
+	editor_read_file(editor, path.c_str());
+	editor_enable_journal(editor);
+	std::vector<int> keys = {'x'};
+	editor_apply_keys(editor, keys.size(), keys.data());
+	char journal_path[PATH_MAX];
+	jrnl_get_path(path.c_str(), journal_path, sizeof(journal_path));
+	// The file is written next to itself first, a directory in the way makes that fail
+	char temp_path[PATH_MAX];
+	sidecar_get_path(path.c_str(), ".tmp", temp_path, sizeof(temp_path));
+	ASSERT_EQ(mkdir(temp_path, 0700), 0);
+	ASSERT_FALSE(editor_save_all(editor));
+	ASSERT_EQ(read_file(path), "one\n");
+	ASSERT_EQ(access(journal_path, F_OK), 0);
+	// The next save replaces the file, which keeps its permissions, and lets go of the journal
+	ASSERT_EQ(rmdir(temp_path), 0);
+	ASSERT_TRUE(editor_save_all(editor));
+	ASSERT_EQ(read_file(path), "xone\n");
+	ASSERT_NE(access(journal_path, F_OK), 0);
+	ASSERT_NE(access(temp_path, F_OK), 0);
+	struct stat state;
+	ASSERT_EQ(stat(path.c_str(), &state), 0);
+	ASSERT_EQ(state.st_mode & 07777, 0640u);
+	editor_destroy(editor);
+	unlink(path.c_str());
+}
+
+TEST(EditorSession, ChangesOnDiskAreMergedWithTheEdits)
+{
+	std::string path = make_temp_file("one\ntwo\nthree\nfour\nfive\n");
+	Editor *editor = editor_create(window_size, headless_io_null_interface());
+	editor_enable_file_watch(editor);
+	editor_read_file(editor, path.c_str());
+	editor_enable_journal(editor);
+	std::vector<int> keys = {'x'};
+	editor_apply_keys(editor, keys.size(), keys.data());
+	// The file is changed far from the edit, the change is taken in and the edit stays
+	std::ofstream(path) << "one\ntwo\nthree\nfour\nFIVE\nsix\n";
+	for (int tick = 0; tick < 3; tick++)
+	{
+		editor_process_tick(editor);
+	}
+	std::string merged = "xone\ntwo\nthree\nfour\nFIVE\nsix\n";
+	std::string copy_path = make_temp_file("");
+	editor_write_file(editor, copy_path.c_str());
+	ASSERT_EQ(read_file(copy_path), merged);
+	// The journal starts from the new file, a crash now recovers the edit on top of it
+	editor_destroy(editor);
+	editor = editor_create(window_size, headless_io_null_interface());
+	editor_read_file(editor, path.c_str());
+	ASSERT_GT(editor_enable_journal(editor), 0u);
+	ASSERT_EQ(read_file(path), merged);
+	ASSERT_TRUE(editor_save_all(editor));
+	editor_destroy(editor);
+	unlink(path.c_str());
+	unlink(copy_path.c_str());
+}
+
+TEST(EditorSession, ChangeOnDiskThatOverlapsAnEditIsntSavedOver)
+{
+	std::string path = make_temp_file("one\ntwo\n");
+	Editor *editor = editor_create(window_size, headless_io_null_interface());
+	editor_enable_file_watch(editor);
+	editor_read_file(editor, path.c_str());
+	editor_enable_journal(editor);
+	std::vector<int> keys = {'x'};
+	editor_apply_keys(editor, keys.size(), keys.data());
+	std::ofstream(path) << "ONE\ntwo\n";
+	for (int tick = 0; tick < 3; tick++)
+	{
+		editor_process_tick(editor);
+	}
+	// Both versions of the line are kept, the buffer's goes next to the file
+	ASSERT_FALSE(editor_save_all(editor));
+	ASSERT_EQ(read_file(path), "ONE\ntwo\n");
+	std::string conflict_path = path + CONFLICT_SUFFIX;
+	ASSERT_EQ(read_file(conflict_path), "xone\ntwo\n");
+	char journal_path[PATH_MAX];
+	jrnl_get_path(path.c_str(), journal_path, sizeof(journal_path));
+	ASSERT_NE(access(journal_path, F_OK), 0);
+	editor_destroy(editor);
+	unlink(path.c_str());
+	unlink(conflict_path.c_str());
+}
+
+TEST(EditorSession, MatchesFollowTheEditsMadeAfterTheSearch)
+{
+	std::string path = make_temp_file("abc\nabc\nx\nabc\n");
+	Editor *editor = editor_create(window_size, headless_io_null_interface());
+	headless_io_reset();
+	editor_read_file(editor, path.c_str());
+	// The second match is on a line that's deleted, the line typed on gets a match and the last one moves up
+	std::vector<int> keys = {CTRL('f'), 'a', 'b', 'c', CARRIAGE_RETURN, CTRL('X'), ARROW_DOWN, DELETE_LINES_KEY, 'a', 'b', 'c',
+		CTRL('f'), ADD_CURSORS_KEY, '-'};
+	headless_io_feed_keys(keys.size(), keys.data());
+	while (headless_io_get_pending_key_count() > 0)
+	{
+		editor_process_tick(editor);
+	}
+	editor_write_file(editor, path.c_str());
+	editor_destroy(editor);
+	ASSERT_EQ(read_file(path), "-abc\n-abcx\n-abc\n");
+	unlink(path.c_str());
+}
+
+TEST(EditorSession, EditorGoesToAPercentageOfTheRowsAtTheNewWidth)
+{
+	// 100 lines of 5 rows and 500 of one at a width of 20, so half of the rows are before line 100
+	std::string content;
+	for (int i = 0; i < 600; i++)
+	{
+		content += i < 100 ? std::string(100, 'a') + "\n" : "b\n";
+	}
+	std::string path = make_temp_file(content);
+	IO_Interface io_interface = headless_io_recording_interface();
+	headless_io_reset();
+	Editor *editor = editor_create(window_size, io_interface);
+	editor_read_file(editor, path.c_str());
+	// The line is taken right after the resize, before the other lines were laid out in the background
+	std::vector<int> keys = {MAKE_RESIZE_KEY(20, 10), GOTO_KEY, '5', '0', '%', CARRIAGE_RETURN, 'X'};
+	headless_io_feed_keys(keys.size(), keys.data());
+	while (headless_io_get_pending_key_count() > 0)
+	{
+		editor_process_tick(editor);
+		editor_render_screen(editor);
+	}
+	editor_write_file(editor, path.c_str());
+	editor_destroy(editor);
+	std::string expected = content;
+	expected.insert(100 * 101, "X");
+	ASSERT_EQ(read_file(path), expected);
+	unlink(path.c_str());
+}
+
+TEST(EditorSession, StatusLineIsDrawnOnItsOwnWhenOnlyItChanges)
+{
+	std::string path = make_temp_file("one two\nthree\n");
+	IO_Interface io_interface = headless_io_recording_interface();
+	headless_io_reset();
+	Editor *editor = editor_create((vec2) {80, 10}, io_interface);
+	editor_read_file(editor, path.c_str());
+	std::vector<int> keys = {ARROW_DOWN};
+	headless_io_feed_keys(keys.size(), keys.data());
+	editor_process_tick(editor);
+	editor_render_screen(editor);
+	// The bytes are counted as the file is written, with a line break after every line
+	ASSERT_NE(std::string(headless_io_get_last_frame()).find("\x1b[10;1H" + path + "  2:1  2 lines  3 words  14 bytes\x1b[K"), std::string::npos);
+	// Moving the cursor only changes the status line
+	keys = {ARROW_RIGHT};
+	headless_io_feed_keys(keys.size(), keys.data());
+	editor_process_tick(editor);
+	editor_render_screen(editor);
+	std::string last_frame = headless_io_get_last_frame();
+	ASSERT_NE(last_frame.find("\x1b[10;1H" + path + "  2:2  2 lines  3 words  14 bytes"), std::string::npos);
+	ASSERT_EQ(last_frame.find(";1H"), last_frame.rfind(";1H"));
+	// Edits change the counts by what they added
+	keys = {'x', ' '};
+	headless_io_feed_keys(keys.size(), keys.data());
+	while (headless_io_get_pending_key_count() > 0)
+	{
+		editor_process_tick(editor);
+	}
+	editor_render_screen(editor);
+	last_frame = headless_io_get_last_frame();
+	ASSERT_NE(last_frame.find("\x1b[2;1Htx hree"), std::string::npos);
+	ASSERT_NE(last_frame.find("\x1b[10;1H" + path + " [+]  2:4  2 lines  4 words  16 bytes"), std::string::npos);
+	editor_render_screen(editor);
+	ASSERT_EQ(std::string(headless_io_get_last_frame()).find(";1H"), std::string::npos);
+	editor_destroy(editor);
+	unlink(path.c_str());
+}
+
+TEST(EditorSession, KeysTypedDuringAReplayAreKept)
+{
+	std::string path = make_temp_file("");
+	IO_Interface io_interface = headless_io_recording_interface();
+	headless_io_reset();
+	Editor *editor = editor_create(window_size, io_interface);
+	editor_read_file(editor, path.c_str());
+	// The replay would take minutes, it's polled for a cancel after a while and finds the keys typed meanwhile
+	std::vector<int> keys = {MACRO_RECORD_KEY, 'a', BACKSPACE, MACRO_RECORD_KEY, MACRO_REPLAY_KEY};
+	for (char digit : std::string("100000000"))
+	{
+		keys.push_back(digit);
+	}
+	// The key after the cancel waits for the keys typed before it
+	std::vector<int> typed = {CARRIAGE_RETURN, 'y', 'z', ESCAPE_KEY, '!'};
+	keys.insert(keys.end(), typed.begin(), typed.end());
+	headless_io_feed_keys(keys.size(), keys.data());
+	while (headless_io_get_pending_key_count() > 0)
+	{
+		editor_process_tick(editor);
+	}
+	editor_write_file(editor, path.c_str());
+	editor_destroy(editor);
+	ASSERT_EQ(read_file(path), "yz!\n");
+	unlink(path.c_str());
+}
+
+TEST(EditorSession, BuffersAreReadWhenShownAndDroppedUnlessModified)
+{
+	// More files than stay loaded, so going through all of them drops the ones shown first
+	std::vector<std::string> paths;
+	for (int i = 0; i < 10; i++)
+	{
+		paths.push_back(make_temp_file("file " + std::to_string(i) + "\n"));
+	}
+	std::string out_path = make_temp_file("");
+	Editor *editor = editor_create(window_size, headless_io_null_interface());
+	editor_read_file(editor, paths[0].c_str());
+	for (int i = 1; i < 10; i++)
+	{
+		ASSERT_TRUE(editor_open_file(editor, paths[i].c_str()));
+	}
+	// Nothing was read from the files that weren't shown yet
+	std::ofstream(paths[5]) << "changed 5\n";
+	std::vector<int> keys = {'x'};
+	for (int i = 0; i < 9; i++)
+	{
+		keys.push_back(NEXT_BUFFER_KEY);
+	}
+	editor_apply_keys(editor, keys.size(), keys.data());
+	// The modified buffer stayed loaded with its edit, the first unmodified one was dropped and is read again
+	std::ofstream(paths[1]) << "changed 1\n";
+	std::vector<std::pair<int, std::string>> expected = {{1, "xfile 0\n"}, {1, "changed 1\n"}, {4, "changed 5\n"}};
+	for (const std::pair<int, std::string> &step : expected)
+	{
+		keys.assign(step.first, NEXT_BUFFER_KEY);
+		editor_apply_keys(editor, keys.size(), keys.data());
+		editor_write_file(editor, out_path.c_str());
+		ASSERT_EQ(read_file(out_path), step.second);
+	}
+	editor_destroy(editor);
+	for (const std::string &path : paths)
+	{
+		unlink(path.c_str());
+	}
+	unlink(out_path.c_str());
+}
+
+TEST(EditorSession, RecordedMacroIsReplayedTheNumberOfTimesTyped)
+{
+	std::string path = make_temp_file("a\nb\nc\nd\ne\nf\ng\n");
+	Editor *editor = editor_create(window_size, headless_io_null_interface());
+	headless_io_reset();
+	editor_read_file(editor, path.c_str());
+	// Prefixes the line and goes to the next one, the count is edited before it's replayed and is once without one
+	std::vector<int> keys = {MACRO_RECORD_KEY, '-', ' ', ARROW_LEFT, ARROW_LEFT, ARROW_DOWN, MACRO_RECORD_KEY,
+		MACRO_REPLAY_KEY, '3', BACKSPACE, '4', CARRIAGE_RETURN, MACRO_REPLAY_KEY, CARRIAGE_RETURN,
+		MACRO_REPLAY_KEY, '9', ESCAPE_KEY, 'x'};
+	headless_io_feed_keys(keys.size(), keys.data());
+	while (headless_io_get_pending_key_count() > 0)
+	{
+		editor_process_tick(editor);
+	}
+	editor_write_file(editor, path.c_str());
+	editor_destroy(editor);
+	ASSERT_EQ(read_file(path), "- a\n- b\n- c\n- d\n- e\n- f\nxg\n");
+	unlink(path.c_str());
+}
+
+TEST(EditorSession, OpeningTheReplayPromptEndsTheRecording)
+{
+	std::string path = make_temp_file("");
+	Editor *editor = editor_create(window_size, headless_io_null_interface());
+	headless_io_reset();
+	editor_read_file(editor, path.c_str());
+	std::vector<int> keys = {MACRO_RECORD_KEY, 'a', 'b', MACRO_REPLAY_KEY, '2', CARRIAGE_RETURN, 'c'};
+	headless_io_feed_keys(keys.size(), keys.data());
+	while (headless_io_get_pending_key_count() > 0)
+	{
+		editor_process_tick(editor);
+	}
+	editor_write_file(editor, path.c_str());
+	editor_destroy(editor);
+	ASSERT_EQ(read_file(path), "abababc\n");
+	unlink(path.c_str());
+}
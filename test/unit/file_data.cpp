@@ -0,0 +1,830 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C"
+{
+#include "file_data.h"
+}
+#include "test_helpers.h"
+
+static void assert_layout_matches(const FileData *file_data, size_t width = 10)
+{
+	size_t total = 0;
+	for (size_t i = 0; i < fdata_get_line_count(file_data); i++)
+	{
+		size_t line_size = fdata_get_line_size(file_data, i);
+		ASSERT_EQ(fdata_get_visual_rows_before(file_data, width, i), total);
+		ASSERT_EQ(fdata_get_visual_row_count(file_data, width, i), line_size == 0 ? 1 : (line_size + width - 1) / width);
+		total += fdata_get_visual_row_count(file_data, width, i);
+	}
+	ASSERT_EQ(fdata_get_total_visual_rows(file_data, width), total);
+}
+
+static void assert_stats_match(const FileData *file_data)
+{
+	std::string text = get_text(file_data);
+	std::istringstream words(text);
+	size_t word_count = 0;
+	for (std::string word; words >> word; word_count++);
+	ASSERT_EQ(fdata_get_byte_count(file_data), text.size());
+	ASSERT_EQ(fdata_get_word_count(file_data), word_count);
+}
+
+class FileDataTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		fdata_init(&file_data, 10);
+		fdata_add_line(&file_data, dbuf_create(MEM_LINES));
+	}
+
+	void TearDown() override
+	{
+		fdata_destroy(&file_data);
+	}
+
+	FileData file_data;
+};
+
+TEST_F(FileDataTest, InsertTextWithLineBreaks)
+{
+	vec2 end = fdata_insert_text(&file_data, (vec2) {0, 0}, 11, "hello world");
+	ASSERT_EQ(end.x, 11);
+	end = fdata_insert_text(&file_data, (vec2) {5, 0}, 9, "\none\ntwo ");
+	ASSERT_EQ(end.x, 4);
+	ASSERT_EQ(end.y, 2);
+	ASSERT_EQ(get_text(&file_data), "hello\none\ntwo  world");
+	assert_layout_matches(&file_data);
+}
+
+TEST_F(FileDataTest, DeleteRangeAcrossLines)
+{
+	fdata_insert_text(&file_data, (vec2) {0, 0}, 16, "abc\ndefgh\nij\nklm");
+	fdata_delete_range(&file_data, (vec2) {1, 0}, (vec2) {1, 2});
+	ASSERT_EQ(get_text(&file_data), "aj\nklm");
+	assert_layout_matches(&file_data);
+}
+
+TEST_F(FileDataTest, TypingCoalescesIntoOneUndo)
+{
+	vec2 cursor = {0, 0};
+	for (char c : std::string("typing"))
+	{
+		cursor = fdata_insert_text(&file_data, cursor, 1, &c);
+	}
+	ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), "");
+	ASSERT_EQ(cursor.x, 0);
+	ASSERT_FALSE(fdata_undo(&file_data, &cursor));
+	ASSERT_TRUE(fdata_redo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), "typing");
+	ASSERT_EQ(cursor.x, 6);
+}
+
+TEST_F(FileDataTest, BackspacesCoalesceIntoOneUndo)
+{
+	vec2 cursor = fdata_insert_text(&file_data, (vec2) {0, 0}, 9, "one\ntwo33");
+	fdata_seal_undo(&file_data);
+	for (int i = 0; i < 2; i++)
+	{
+		vec2 start = {cursor.x - 1, cursor.y};
+		fdata_delete_range(&file_data, start, cursor);
+		cursor = start;
+	}
+	ASSERT_EQ(get_text(&file_data), "one\ntwo");
+	ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), "one\ntwo33");
+	ASSERT_EQ(cursor.x, 5);
+	ASSERT_EQ(cursor.y, 1);
+}
+
+TEST_F(FileDataTest, GroupsUndoTogether)
+{
+	fdata_insert_text(&file_data, (vec2) {0, 0}, 11, "a b a b a b");
+	fdata_begin_undo_group(&file_data);
+	for (int x = 8; x >= 0; x -= 4)
+	{
+		fdata_delete_range(&file_data, (vec2) {x, 0}, (vec2) {x + 1, 0});
+		fdata_insert_text(&file_data, (vec2) {x, 0}, 3, "xyz");
+	}
+	fdata_end_undo_group(&file_data);
+	ASSERT_EQ(get_text(&file_data), "xyz b xyz b xyz b");
+	vec2 cursor;
+	ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), "a b a b a b");
+	ASSERT_TRUE(fdata_redo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), "xyz b xyz b xyz b");
+}
+
+TEST_F(FileDataTest, BudgetEvictsOldestHistory)
+{
+	ulog_set_budget(file_data.undo_log, 4 * (sizeof(UndoEntry) + 2));
+	vec2 cursor = {0, 0};
+	for (int i = 0; i < 100; i++)
+	{
+		cursor = fdata_insert_text(&file_data, cursor, 2, "x\n");
+		ASSERT_LE(ulog_get_memory_usage(file_data.undo_log), 4 * (sizeof(UndoEntry) + 2));
+	}
+	size_t undo_count = 0;
+	while (fdata_undo(&file_data, &cursor))
+	{
+		undo_count++;
+	}
+	ASSERT_EQ(undo_count, 4u);
+	ASSERT_EQ(fdata_get_line_count(&file_data), 97u);
+}
+
+TEST_F(FileDataTest, RandomEditsUndoAndRedoToEveryVersion)
+{
+	srand(11);
+	std::string text;
+	std::vector<std::string> versions = {text};
+	const char *alphabet = "ab\ncdefghijklmnopq\n";
+	for (int step = 0; step < 300; step++)
+	{
+		fdata_seal_undo(&file_data);
+		if (text.empty() || rand() % 2 == 0)
+		{
+			size_t offset = rand() % (text.size() + 1);
+			std::string inserted;
+			for (int i = rand() % 25; i >= 0; i--)
+			{
+				inserted += alphabet[rand() % strlen(alphabet)];
+			}
+			fdata_insert_text(&file_data, get_position(text, offset), inserted.size(), inserted.c_str());
+			text.insert(offset, inserted);
+		}
+		else
+		{
+			size_t start = rand() % text.size();
+			size_t end = start + 1 + rand() % std::min<size_t>(30, text.size() - start);
+			fdata_delete_range(&file_data, get_position(text, start), get_position(text, end));
+			text.erase(start, end - start);
+		}
+		ASSERT_EQ(get_text(&file_data), text);
+		versions.push_back(text);
+	}
+	assert_layout_matches(&file_data);
+	vec2 cursor;
+	for (size_t i = versions.size() - 1; i > 0; i--)
+	{
+		ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+		ASSERT_EQ(get_text(&file_data), versions[i-1]);
+	}
+	ASSERT_FALSE(fdata_undo(&file_data, &cursor));
+	for (size_t i = 1; i < versions.size(); i++)
+	{
+		ASSERT_TRUE(fdata_redo(&file_data, &cursor));
+		ASSERT_EQ(get_text(&file_data), versions[i]);
+	}
+	assert_layout_matches(&file_data);
+}
+
+TEST_F(FileDataTest, StatisticsFollowEveryKindOfEdit)
+{
+	srand(31);
+	std::string text;
+	const char *alphabet = "ab \tc\nd  e\n";
+	for (int step = 0; step < 400; step++)
+	{
+		size_t line_count = fdata_get_line_count(&file_data);
+		switch (rand() % 6)
+		{
+		case 0:
+		{
+			size_t offset = rand() % (text.size() + 1);
+			std::string inserted;
+			for (int i = rand() % 40; i >= 0; i--)
+			{
+				inserted += alphabet[rand() % strlen(alphabet)];
+			}
+			fdata_insert_text(&file_data, get_position(text, offset), inserted.size(), inserted.c_str());
+			break;
+		}
+		case 1:
+		{
+			if (text.empty())
+			{
+				break;
+			}
+			size_t start = rand() % text.size();
+			size_t end = start + 1 + rand() % std::min<size_t>(30, text.size() - start);
+			fdata_delete_range(&file_data, get_position(text, start), get_position(text, end));
+			break;
+		}
+		case 2:
+		{
+			size_t row = rand() % line_count;
+			fdata_remove_lines(&file_data, row, 1 + rand() % std::min<size_t>(5, line_count - row), NULL);
+			break;
+		}
+		case 3:
+		{
+			DynamicBuffer *line = dbuf_create(MEM_LINES);
+			dbuf_adds(line, 10, " two words");
+			fdata_insert_lines(&file_data, rand() % (line_count + 1), 1, &line);
+			break;
+		}
+		case 4:
+		{
+			size_t count = 1 + rand() % std::min<size_t>(5, line_count);
+			fdata_move_lines(&file_data, rand() % (line_count - count + 1), count, rand() % (line_count - count + 1));
+			break;
+		}
+		default:
+		{
+			vec2 cursor;
+			fdata_undo(&file_data, &cursor);
+			break;
+		}
+		}
+		text = get_text(&file_data);
+		assert_stats_match(&file_data);
+	}
+	bool line_open = true;
+	fdata_append_lines(&file_data, 15, "tail\nmore  text", &line_open);
+	assert_stats_match(&file_data);
+	fdata_remove_lines(&file_data, 0, fdata_get_line_count(&file_data), NULL);
+	ASSERT_EQ(fdata_get_byte_count(&file_data), 0u);
+	ASSERT_EQ(fdata_get_word_count(&file_data), 0u);
+}
+
+TEST_F(FileDataTest, RandomBatchesUndoAndRedoAsOneStep)
+{
+	srand(23);
+	std::string text = "first line\nsecond\n\nfourth line here\nfifth";
+	fdata_insert_text(&file_data, (vec2) {0, 0}, text.size(), text.c_str());
+	const char *alphabet = "xy\nz";
+	for (int step = 0; step < 200; step++)
+	{
+		// Random sorted, non overlapping ranges with random replacements
+		std::vector<size_t> bounds;
+		for (int i = rand() % 8; i >= 0; i--)
+		{
+			bounds.push_back(rand() % (text.size() + 1));
+			bounds.push_back(rand() % (text.size() + 1));
+		}
+		std::sort(bounds.begin(), bounds.end());
+		std::vector<std::string> replacements(bounds.size() / 2);
+		std::vector<Splice> splices;
+		for (size_t i = 0; i < replacements.size(); i++)
+		{
+			for (int j = rand() % 4; j > 0; j--)
+			{
+				replacements[i] += alphabet[rand() % 4];
+			}
+			splices.push_back((Splice) {get_position(text, bounds[2*i]), get_position(text, bounds[2*i+1]), replacements[i].size(), replacements[i].c_str()});
+		}
+		std::string expected = text;
+		for (size_t i = replacements.size(); i > 0; i--)
+		{
+			expected.replace(bounds[2*i-2], bounds[2*i-1] - bounds[2*i-2], replacements[i-1]);
+		}
+		std::vector<vec2> ends(splices.size());
+		fdata_apply_splices(&file_data, splices.size(), splices.data(), ends.data());
+		ASSERT_EQ(get_text(&file_data), expected);
+		// Every end is right after its replacement, shifted by the replacements before it
+		long long shift = 0;
+		for (size_t i = 0; i < splices.size(); i++)
+		{
+			vec2 end = get_position(expected, bounds[2*i] + shift + replacements[i].size());
+			ASSERT_EQ(ends[i].x, end.x);
+			ASSERT_EQ(ends[i].y, end.y);
+			shift += (long long)replacements[i].size() - (long long)(bounds[2*i+1] - bounds[2*i]);
+		}
+		assert_layout_matches(&file_data);
+		vec2 cursor;
+		ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+		ASSERT_EQ(get_text(&file_data), text);
+		ASSERT_TRUE(fdata_redo(&file_data, &cursor));
+		ASSERT_EQ(get_text(&file_data), expected);
+		assert_layout_matches(&file_data);
+		text = expected;
+	}
+}
+
+TEST_F(FileDataTest, LineCommandsKeepHandlesAndUndo)
+{
+	fdata_insert_text(&file_data, (vec2) {0, 0}, 23, "zero\none\ntwo\nthree\nfour");
+	const DynamicBuffer *one = fdata_get_line(&file_data, 1);
+	const DynamicBuffer *two = fdata_get_line(&file_data, 2);
+
+	fdata_move_lines(&file_data, 1, 2, 3);
+	ASSERT_EQ(get_text(&file_data), "zero\nthree\nfour\none\ntwo");
+	ASSERT_EQ(fdata_get_line(&file_data, 3), one);
+	ASSERT_EQ(fdata_get_line(&file_data, 4), two);
+	assert_layout_matches(&file_data);
+
+	LineArray *cut = larr_create(MEM_LINES);
+	fdata_remove_lines(&file_data, 3, 2, cut);
+	ASSERT_EQ(get_text(&file_data), "zero\nthree\nfour");
+	ASSERT_EQ(larr_get(cut, 0), one);
+	fdata_insert_lines(&file_data, 0, 2, cut->arr);
+	ASSERT_EQ(get_text(&file_data), "one\ntwo\nzero\nthree\nfour");
+	ASSERT_EQ(fdata_get_line(&file_data, 0), one);
+	larr_destroy(cut);
+	assert_layout_matches(&file_data);
+
+	vec2 cursor;
+	std::vector<std::string> versions = {"zero\nthree\nfour", "zero\nthree\nfour\none\ntwo", "zero\none\ntwo\nthree\nfour"};
+	for (const std::string &version : versions)
+	{
+		ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+		ASSERT_EQ(get_text(&file_data), version);
+		assert_layout_matches(&file_data);
+	}
+	ASSERT_TRUE(fdata_redo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), versions[1]);
+}
+
+TEST_F(FileDataTest, RemovingEveryLineLeavesAnEmptyLine)
+{
+	fdata_insert_text(&file_data, (vec2) {0, 0}, 6, "a\nbb\nc");
+	fdata_remove_lines(&file_data, 0, 3, NULL);
+	ASSERT_EQ(fdata_get_line_count(&file_data), 1u);
+	ASSERT_EQ(get_text(&file_data), "");
+	vec2 cursor;
+	ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), "a\nbb\nc");
+	ASSERT_TRUE(fdata_redo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), "");
+}
+
+TEST_F(FileDataTest, ChangedRowsAreKeptFromTheBottomOfTheFile)
+{
+	fdata_insert_text(&file_data, (vec2) {0, 0}, 9, "a\nb\nc\nd\ne");
+	size_t since = file_data.change_count;
+	RowChange change;
+	ASSERT_TRUE(fdata_get_changed_rows(&file_data, since, &change));
+	ASSERT_EQ(change.start, SIZE_MAX);
+	fdata_insert_text(&file_data, (vec2) {1, 3}, 4, "\nx\ny");
+	fdata_insert_text(&file_data, (vec2) {0, 1}, 1, "!");
+	ASSERT_EQ(get_text(&file_data), "a\n!b\nc\nd\nx\ny\ne");
+	// From the second row to the one before the last, which is where it was before the changes
+	ASSERT_TRUE(fdata_get_changed_rows(&file_data, since, &change));
+	ASSERT_EQ(change.start, 1u);
+	ASSERT_EQ(change.tail, 1u);
+	for (int i = 0; i < FILE_DATA_CHANGE_HISTORY; i++)
+	{
+		fdata_insert_text(&file_data, (vec2) {0, 0}, 1, "!");
+	}
+	ASSERT_FALSE(fdata_get_changed_rows(&file_data, since, &change));
+}
+
+TEST_F(FileDataTest, LayoutsOfEveryWidthFollowEditsAndDamageOnlyChangedRows)
+{
+	fdata_insert_text(&file_data, (vec2) {0, 0}, 39, "a line that wraps\nshort\nanother long line\nz");
+	size_t widths[] = {10, 4, 4, 7};
+	fdata_set_layout_widths(&file_data, 4, widths);
+	fdata_clear_damage(&file_data);
+	fdata_insert_text(&file_data, (vec2) {2, 1}, 3, "ort");
+	ASSERT_TRUE(fdata_is_row_damaged(&file_data, 1));
+	ASSERT_FALSE(fdata_is_row_damaged(&file_data, 0));
+	ASSERT_FALSE(fdata_is_row_damaged(&file_data, 2));
+	// A new line moves every row below it
+	fdata_insert_text(&file_data, (vec2) {0, 2}, 1, "\n");
+	ASSERT_FALSE(fdata_is_row_damaged(&file_data, 0));
+	ASSERT_TRUE(fdata_is_row_damaged(&file_data, 4));
+	fdata_move_lines(&file_data, 0, 1, 3);
+	fdata_delete_range(&file_data, (vec2) {3, 0}, (vec2) {5, 2});
+	for (size_t width : {10, 4, 7})
+	{
+		assert_layout_matches(&file_data, width);
+	}
+	// Widths that aren't shown anymore are dropped, a new one takes a dropped layout and is laid out again on demand
+	size_t new_widths[] = {3};
+	fdata_set_layout_widths(&file_data, 1, new_widths);
+	ASSERT_FALSE(fdata_is_laid_out(&file_data));
+	fdata_lay_out_rows(&file_data, 1, 2);
+	ASSERT_FALSE(fdata_lay_out_more(&file_data, 1));
+	ASSERT_TRUE(fdata_lay_out_more(&file_data, SIZE_MAX));
+	assert_layout_matches(&file_data, 3);
+	ASSERT_EQ(lyarr_get_size(file_data.layouts), 1u);
+}
+
+TEST_F(FileDataTest, PatchingLinesOnlyReplacesTheChangedBlocks)
+{
+	std::string text;
+	for (int i = 0; i < 300; i++)
+	{
+		text += "line " + std::to_string(i) + (i % 7 == 0 ? "\n\n" : "\n");
+	}
+	text.pop_back();
+	fdata_insert_text(&file_data, (vec2) {0, 0}, text.size(), text.c_str());
+	const DynamicBuffer *kept = fdata_get_line(&file_data, 200);
+	std::string patched = text;
+	patched.replace(patched.find("line 10\n"), 8, "changed\n");
+	patched.insert(patched.find("line 100\n"), "new\nnew\n\n");
+	patched.erase(patched.find("line 150\n"), patched.find("line 153\n") - patched.find("line 150\n"));
+	// The last line break of a file doesn't make a line
+	patched += "\n";
+
+	HunkArray *hunks = harr_create(MEM_OTHER);
+	fdata_patch_lines(&file_data, patched.size(), patched.c_str(), hunks);
+	patched.pop_back();
+	ASSERT_EQ(get_text(&file_data), patched);
+	ASSERT_EQ(harr_get_size(hunks), 3u);
+	ASSERT_EQ(harr_get(hunks, 0).old_count, 1u);
+	ASSERT_EQ(harr_get(hunks, 0).new_count, 1u);
+	ASSERT_EQ(harr_get(hunks, 1).old_count, 0u);
+	ASSERT_EQ(harr_get(hunks, 1).new_count, 3u);
+	ASSERT_EQ(harr_get(hunks, 2).new_count, 0u);
+	// Lines that are the same are the same handles, wherever they moved to
+	size_t kept_row = fdata_map_row(hunks, 200);
+	ASSERT_EQ(fdata_get_line(&file_data, kept_row), kept);
+	ASSERT_EQ(kept_row, 200u);
+	ASSERT_EQ(fdata_map_row(hunks, 5), 5u);
+	ASSERT_EQ(fdata_map_row(hunks, harr_get(hunks, 0).row), harr_get(hunks, 0).new_row);
+	assert_layout_matches(&file_data);
+
+	// The whole patch is a single undo
+	vec2 cursor;
+	ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), text);
+	harr_destroy(hunks);
+}
+
+TEST_F(FileDataTest, PatchingRandomLinesEndsWithTheNewText)
+{
+	srand(5);
+	HunkArray *hunks = harr_create(MEM_OTHER);
+	std::vector<std::string> lines = {""};
+	for (int step = 0; step < 200; step++)
+	{
+		// Few distinct lines, so there are lots of lines that are the same in other places
+		std::vector<std::string> new_lines = lines;
+		for (int i = rand() % 4; i >= 0; i--)
+		{
+			size_t row = rand() % (new_lines.size() + 1);
+			if (rand() % 3 == 0 && row < new_lines.size())
+			{
+				new_lines.erase(new_lines.begin() + row, new_lines.begin() + std::min(new_lines.size(), row + 1 + rand() % 80));
+				continue;
+			}
+			for (int j = rand() % (rand() % 5 == 0 ? 150 : 3); j >= 0; j--)
+			{
+				new_lines.insert(new_lines.begin() + row, std::string(rand() % 3, 'a' + rand() % 3));
+			}
+		}
+		// A file always has a line
+		if (new_lines.empty())
+		{
+			new_lines.push_back("");
+		}
+		std::string text;
+		for (const std::string &line : new_lines)
+		{
+			text += line + "\n";
+		}
+		fdata_patch_lines(&file_data, text.size(), text.c_str(), hunks);
+		ASSERT_EQ(get_text(&file_data) + "\n", text);
+		ASSERT_EQ(fdata_get_line_count(&file_data), new_lines.size());
+		lines = new_lines;
+	}
+	assert_layout_matches(&file_data);
+	harr_destroy(hunks);
+}
+
+TEST_F(FileDataTest, MergingTakesInTheChangesThatDontOverlapEdits)
+{
+	std::vector<std::string> lines;
+	for (int i = 0; i < 20; i++)
+	{
+		lines.push_back("line " + std::to_string(i));
+	}
+	auto join = [](const std::vector<std::string> &lines)
+	{
+		std::string text;
+		for (const std::string &line : lines)
+		{
+			text += line + "\n";
+		}
+		return text;
+	};
+	std::string text = join(lines);
+	text.pop_back();
+	fdata_insert_text(&file_data, (vec2) {0, 0}, text.size(), text.c_str());
+	// Like a file that was just read, the edits from here on are the buffer's own
+	file_data.modified = false;
+	fdata_keep_base(&file_data);
+	auto replace_line = [&](int row, const std::string &line)
+	{
+		fdata_delete_range(&file_data, (vec2) {0, row}, (vec2) {(int)fdata_get_line_size(&file_data, row), row});
+		fdata_insert_text(&file_data, (vec2) {0, row}, line.size(), line.c_str());
+	};
+	replace_line(2, "mine 2");
+	replace_line(15, "same 15");
+	fdata_remove_lines(&file_data, 10, 1, NULL);
+
+	std::vector<std::string> disk_lines = lines;
+	disk_lines[2] = "theirs 2";
+	disk_lines[5] = "theirs 5";
+	disk_lines[15] = "same 15";
+	disk_lines.insert(disk_lines.begin() + 12, "new");
+	std::string disk_text = join(disk_lines);
+	HunkArray *hunks = harr_create(MEM_OTHER);
+	HunkArray *own_hunks = harr_create(MEM_OTHER);
+	// The same change on both sides is kept once, line 2 was changed on both in different ways
+	ASSERT_EQ(fdata_merge_lines(&file_data, disk_text.size(), disk_text.c_str(), hunks, own_hunks), 1u);
+	std::vector<std::string> merged = disk_lines;
+	merged[2] = "mine 2";
+	merged.erase(merged.begin() + 10);
+	std::string merged_text = join(merged);
+	merged_text.pop_back();
+	ASSERT_EQ(get_text(&file_data), merged_text);
+	// The changes that were taken in are where their lines are in the buffer, the rows after the removed line moved up
+	ASSERT_EQ(harr_get_size(hunks), 2u);
+	ASSERT_EQ(harr_get(hunks, 0).row, 5u);
+	ASSERT_EQ(harr_get(hunks, 1).row, 11u);
+	ASSERT_EQ(harr_get(hunks, 1).new_count, 1u);
+	ASSERT_EQ(fdata_map_row(hunks, 13), 14u);
+	// What's left are the buffer's own changes to the new text
+	ASSERT_EQ(harr_get_size(own_hunks), 2u);
+	ASSERT_EQ(harr_get(own_hunks, 0).row, 2u);
+	ASSERT_EQ(harr_get(own_hunks, 1).row, 10u);
+	ASSERT_EQ(harr_get(own_hunks, 1).new_count, 0u);
+	assert_layout_matches(&file_data);
+
+	// The text is the base of the next merge
+	disk_lines[0] = "first";
+	disk_text = join(disk_lines);
+	ASSERT_EQ(fdata_merge_lines(&file_data, disk_text.size(), disk_text.c_str(), hunks, own_hunks), 0u);
+	merged[0] = "first";
+	merged_text = join(merged);
+	merged_text.pop_back();
+	ASSERT_EQ(get_text(&file_data), merged_text);
+	harr_destroy(hunks);
+	harr_destroy(own_hunks);
+}
+
+TEST_F(FileDataTest, AppendingChunksOfAFileTakesInItsLines)
+{
+	srand(9);
+	std::string text;
+	for (int i = 0; i < 500; i++)
+	{
+		text += std::string(rand() % 25, 'a' + i % 26) + "\n";
+	}
+	// Chunks end anywhere, also in the middle of a line or right after a line break
+	bool line_open = true;
+	for (size_t offset = 0; offset < text.size();)
+	{
+		size_t size = std::min(text.size() - offset, (size_t)(rand() % 60));
+		fdata_clear_damage(&file_data);
+		size_t last_row = fdata_get_line_count(&file_data) - 1;
+		fdata_append_lines(&file_data, size, text.c_str() + offset, &line_open);
+		offset += size;
+		ASSERT_EQ(get_text(&file_data) + (line_open ? "" : "\n"), text.substr(0, offset));
+		if (last_row > 0)
+		{
+			ASSERT_FALSE(fdata_is_row_damaged(&file_data, last_row - 1));
+		}
+	}
+	ASSERT_FALSE(line_open);
+	ASSERT_EQ(fdata_get_line_count(&file_data), 500u);
+	assert_layout_matches(&file_data);
+	// The lines are the file's, not edits
+	ASSERT_FALSE(file_data.modified);
+	vec2 cursor_pos;
+	ASSERT_FALSE(fdata_undo(&file_data, &cursor_pos));
+}
+
+TEST_F(FileDataTest, ColdLinesReadLikeLinesAndAreThawedByEdits)
+{
+	srand(11);
+	std::string text;
+	for (int i = 0; i < 4000; i++)
+	{
+		text += "12:" + std::to_string(i % 60) + " worker-" + std::to_string(rand() % 4) + " took " + std::to_string(rand() % 900) + "ms\n";
+	}
+	bool line_open = true;
+	fdata_append_lines(&file_data, text.size(), text.c_str(), &line_open);
+	text.pop_back();
+	// Only lines far from the kept row and the last line are compressed
+	size_t keep_row = 0;
+	ASSERT_TRUE(fdata_compress_cold_lines(&file_data, 1, &keep_row, SIZE_MAX));
+	auto is_cold = [&](size_t row) { return cold_is_slot(larr_get(file_data.lines, row)); };
+	ASSERT_FALSE(is_cold(COLD_KEEP_DISTANCE - 1));
+	ASSERT_TRUE(is_cold(2000));
+	ASSERT_FALSE(is_cold(fdata_get_line_count(&file_data) - 1));
+	ASSERT_EQ(get_text(&file_data), text);
+	std::string streamed;
+	for (size_t i = 0; i < fdata_get_line_count(&file_data); i++)
+	{
+		size_t size;
+		const char *line = fdata_get_line_text(&file_data, i, &size);
+		streamed += std::string(line, size) + (i + 1 < fdata_get_line_count(&file_data) ? "\n" : "");
+	}
+	ASSERT_EQ(streamed, text);
+	assert_layout_matches(&file_data);
+
+	// An edit thaws the blocks it touches, the lines around it stay compressed
+	std::string original = text;
+	vec2 pos = get_position(text, text.find('\n', text.size() / 2) + 3);
+	fdata_insert_text(&file_data, pos, 4, "a\nb\n");
+	text.insert(text.find('\n', text.size() / 2) + 3, "a\nb\n");
+	ASSERT_FALSE(is_cold(pos.y));
+	ASSERT_TRUE(is_cold(pos.y + 2 * COLD_BLOCK_LINES + 2));
+	ASSERT_EQ(get_text(&file_data), text);
+	fdata_remove_lines(&file_data, 2500, 300, NULL);
+	ASSERT_EQ(fdata_get_line_count(&file_data), 4002u - 300);
+	assert_layout_matches(&file_data);
+	vec2 cursor;
+	ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), text);
+	ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), original);
+}
+
+static std::string join_pieces(const LineArray *pieces)
+{
+	std::string text;
+	for (size_t i = 0; i < larr_get_size(pieces); i++)
+	{
+		if (i > 0)
+		{
+			text += '\n';
+		}
+		text += dbuf_get_with_nulc(larr_get(pieces, i), 0);
+	}
+	return text;
+}
+
+static void destroy_pieces(LineArray *pieces)
+{
+	for (size_t i = 0; i < larr_get_size(pieces); i++)
+	{
+		dbuf_destroy(larr_get(pieces, i));
+	}
+	larr_destroy(pieces);
+}
+
+TEST_F(FileDataTest, SharedRangesAreCopiedOnWrite)
+{
+	fdata_insert_text(&file_data, (vec2) {0, 0}, 18, "alpha\nbeta\ngamma\nd");
+	LineArray *pieces = larr_create(MEM_LINES);
+	fdata_share_range(&file_data, (vec2) {2, 0}, (vec2) {3, 2}, pieces);
+	ASSERT_EQ(join_pieces(pieces), "pha\nbeta\ngam");
+	// Whole lines aren't copied
+	ASSERT_EQ(larr_get(pieces, 1), fdata_get_line(&file_data, 1));
+
+	fdata_insert_text(&file_data, (vec2) {4, 1}, 1, "!");
+	ASSERT_EQ(get_text(&file_data), "alpha\nbeta!\ngamma\nd");
+	ASSERT_EQ(join_pieces(pieces), "pha\nbeta\ngam");
+
+	vec2 end = fdata_insert_pieces(&file_data, (vec2) {1, 3}, larr_get_size(pieces), pieces->arr);
+	ASSERT_EQ(end.x, 3);
+	ASSERT_EQ(end.y, 5);
+	ASSERT_EQ(get_text(&file_data), "alpha\nbeta!\ngamma\ndpha\nbeta\ngam");
+	ASSERT_EQ(fdata_get_line(&file_data, 4), larr_get(pieces, 1));
+	assert_layout_matches(&file_data);
+
+	// Writing to a pasted line leaves the clipboard alone
+	fdata_delete_range(&file_data, (vec2) {0, 4}, (vec2) {2, 4});
+	ASSERT_EQ(join_pieces(pieces), "pha\nbeta\ngam");
+	destroy_pieces(pieces);
+
+	vec2 cursor;
+	ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+	ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), "alpha\nbeta!\ngamma\nd");
+	ASSERT_TRUE(fdata_redo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), "alpha\nbeta!\ngamma\ndpha\nbeta\ngam");
+}
+
+TEST_F(FileDataTest, UndoKeepsLinesItDoesntCopy)
+{
+	// Less than the lines, the edits below still fit since only the partial lines at their ends are copied
+	ulog_set_budget(file_data.undo_log, 12 * 1024);
+	fdata_insert_text(&file_data, (vec2) {0, 0}, 4, "abc\n");
+	std::string line(4096, 'x');
+	DynamicBuffer *lines[8];
+	for (DynamicBuffer *&new_line : lines)
+	{
+		new_line = dbuf_create(MEM_LINES);
+		dbuf_adds(new_line, line.size(), line.c_str());
+	}
+	fdata_insert_lines(&file_data, 1, 8, lines);
+	std::string text = get_text(&file_data);
+	const DynamicBuffer *third = fdata_get_line(&file_data, 3);
+
+	fdata_delete_range(&file_data, (vec2) {1, 0}, (vec2) {2, 8});
+	ASSERT_EQ(get_text(&file_data), "a" + line.substr(2) + "\n");
+	vec2 cursor;
+	ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), text);
+	// The deleted lines come back as the lines they were
+	ASSERT_EQ(fdata_get_line(&file_data, 3), third);
+	assert_layout_matches(&file_data);
+
+	LineArray *pieces = larr_create(MEM_LINES);
+	fdata_share_range(&file_data, (vec2) {0, 1}, (vec2) {4096, 8}, pieces);
+	fdata_insert_pieces(&file_data, (vec2) {3, 0}, larr_get_size(pieces), pieces->arr);
+	std::string pasted = get_text(&file_data);
+	ASSERT_EQ(fdata_get_line(&file_data, 1), larr_get(pieces, 1));
+	destroy_pieces(pieces);
+	ASSERT_LE(ulog_get_memory_usage(file_data.undo_log), 12u * 1024);
+
+	ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), text);
+	ASSERT_TRUE(fdata_redo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), pasted);
+	assert_layout_matches(&file_data);
+	for (int i = 0; i < 3; i++)
+	{
+		ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+	}
+	ASSERT_EQ(get_text(&file_data), "");
+	ASSERT_FALSE(fdata_undo(&file_data, &cursor));
+}
+
+TEST_F(FileDataTest, EditsBiggerThanTheBudgetClearHistory)
+{
+	ulog_set_budget(file_data.undo_log, 8);
+	fdata_insert_text(&file_data, (vec2) {0, 0}, 3, "abc");
+	fdata_insert_text(&file_data, (vec2) {3, 0}, 16, "\nsome long text\n");
+	ASSERT_EQ(ulog_get_undo_count(file_data.undo_log), 0u);
+	ASSERT_EQ(ulog_get_memory_usage(file_data.undo_log), 0u);
+	fdata_delete_range(&file_data, (vec2) {0, 0}, (vec2) {0, 2});
+	ASSERT_EQ(get_text(&file_data), "");
+	ASSERT_EQ(ulog_get_undo_count(file_data.undo_log), 0u);
+}
+
+TEST_F(FileDataTest, GroupWithAnEditBiggerThanTheBudgetIsDropped)
+{
+	ulog_set_budget(file_data.undo_log, 2 * sizeof(UndoEntry));
+	std::string big(3 * sizeof(UndoEntry), '-');
+	fdata_insert_text(&file_data, (vec2) {0, 0}, 3, "abc");
+	fdata_begin_undo_group(&file_data);
+	fdata_insert_text(&file_data, (vec2) {0, 0}, 1, "x");
+	fdata_insert_text(&file_data, (vec2) {1, 0}, big.size(), big.c_str());
+	fdata_insert_text(&file_data, (vec2) {(int)big.size() + 1, 0}, 1, "y");
+	fdata_end_undo_group(&file_data);
+	std::string text = "x" + big + "yabc";
+	ASSERT_EQ(get_text(&file_data), text);
+	// Undoing only the edits after the big one would leave text that never was
+	vec2 cursor;
+	ASSERT_FALSE(fdata_undo(&file_data, &cursor));
+	fdata_insert_text(&file_data, (vec2) {0, 0}, 1, "z");
+	ASSERT_TRUE(fdata_undo(&file_data, &cursor));
+	ASSERT_EQ(get_text(&file_data), text);
+}
+
+TEST_F(FileDataTest, JournalReplaysEveryKindOfEdit)
+{
+	char path[] = "/tmp/text-editor-journal-XXXXXX";
+	close(mkstemp(path));
+	file_data.journal = jrnl_open(path, 1, 2);
+	vec2 cursor = fdata_insert_text(&file_data, (vec2) {0, 0}, 23, "zero\none\ntwo\nthree\nfour");
+	fdata_delete_range(&file_data, (vec2) {1, 0}, (vec2) {2, 1});
+	Splice splices[] = {{{0, 0}, {1, 0}, 2, "Z\n"}, {{0, 1}, {2, 1}, 0, NULL}};
+	vec2 ends[2];
+	fdata_apply_splices(&file_data, 2, splices, ends);
+	fdata_move_lines(&file_data, 0, 1, 2);
+	LineArray *pieces = larr_create(MEM_LINES);
+	fdata_share_range(&file_data, (vec2) {0, 0}, (vec2) {2, 1}, pieces);
+	fdata_insert_pieces(&file_data, (vec2) {1, 0}, larr_get_size(pieces), pieces->arr);
+	fdata_remove_lines(&file_data, 1, 2, pieces);
+	fdata_insert_lines(&file_data, 0, 2, larr_getc(pieces, larr_get_size(pieces) - 2));
+	larr_remove_multiple(pieces, larr_get_size(pieces) - 2, 2);
+	for (size_t i = 0; i < larr_get_size(pieces); i++)
+	{
+		dbuf_destroy(larr_get(pieces, i));
+	}
+	larr_destroy(pieces);
+	fdata_undo(&file_data, &cursor);
+	fdata_undo(&file_data, &cursor);
+	fdata_redo(&file_data, &cursor);
+	jrnl_close(file_data.journal);
+	file_data.journal = NULL;
+
+	FileData replayed;
+	fdata_init(&replayed, 10);
+	fdata_add_line(&replayed, dbuf_create(MEM_LINES));
+	JournalReader reader;
+	ASSERT_FALSE(jrnl_load(&reader, path, 1, 3));
+	ASSERT_TRUE(jrnl_load(&reader, path, 1, 2));
+	size_t record_count = fdata_replay_journal(&replayed, &reader);
+	jrnl_unload(&reader);
+	ASSERT_EQ(get_text(&replayed), get_text(&file_data));
+	assert_layout_matches(&replayed);
+	fdata_destroy(&replayed);
+
+	// A record cut off by a crash is dropped with everything after it
+	struct stat st;
+	stat(path, &st);
+	truncate(path, st.st_size - 1);
+	fdata_init(&replayed, 10);
+	fdata_add_line(&replayed, dbuf_create(MEM_LINES));
+	ASSERT_TRUE(jrnl_load(&reader, path, 1, 2));
+	ASSERT_EQ(fdata_replay_journal(&replayed, &reader), record_count - 1);
+	jrnl_unload(&reader);
+	fdata_destroy(&replayed);
+	unlink(path);
+}
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+extern "C"
+{
+#include "definitions.h"
+#include "file_view.h"
+#include "headless_io.h"
+#include "viewer.h"
+}
+#include "test_helpers.h"
+
+// Where every row starts when the lines are wrapped like the editor wraps them
+static std::vector<size_t> get_row_starts(const std::string &text, size_t width, std::vector<size_t> *line_starts)
+{
+	std::vector<size_t> rows;
+	size_t start = 0;
+	do
+	{
+		size_t end = text.find('\n', start);
+		end = end == std::string::npos ? text.size() : end;
+		line_starts->push_back(start);
+		for (size_t row = start; row == start || row < end; row += width)
+		{
+			rows.push_back(row);
+		}
+		start = end + 1;
+	} while (start < text.size());
+	return rows;
+}
+
+TEST(FileView, RowsMatchTheWrappedLinesInBothDirections)
+{
+	srand(3);
+	std::string text;
+	for (int i = 0; i < 3000; i++)
+	{
+		// Lines that fill their rows exactly and empty lines are the edge cases
+		int kind = rand() % 4;
+		size_t size = kind == 0 ? 0 : kind == 1 ? 8 * (1 + rand() % 3) : rand() % 30;
+		text += std::string(size, 'a' + i % 26) + "\n";
+	}
+	text += "no line break at the end";
+	std::string path = make_temp_file(text);
+	FileView *file_view = fview_open(path.c_str());
+	ASSERT_NE(file_view, nullptr);
+	// Lines before the first checkpoint don't need the index
+	std::vector<size_t> first_line_starts;
+	get_row_starts(text, 8, &first_line_starts);
+	ASSERT_EQ(fview_find_line(file_view, 10), first_line_starts[10]);
+	ASSERT_EQ(oarr_get_size(file_view->checkpoints), 1u);
+	for (size_t width : {8, 13})
+	{
+		std::vector<size_t> line_starts;
+		std::vector<size_t> rows = get_row_starts(text, width, &line_starts);
+		size_t offset = 0;
+		for (size_t i = 0; i < rows.size(); i++)
+		{
+			ASSERT_EQ(offset, rows[i]);
+			size_t end = text.find('\n', offset);
+			end = end == std::string::npos ? text.size() : end;
+			ASSERT_EQ(fview_get_row_size(file_view, offset, width), std::min(width, end - offset));
+			ASSERT_EQ(fview_get_next_row(file_view, &offset, width), i + 1 < rows.size());
+		}
+		for (size_t i = rows.size(); i-- > 0;)
+		{
+			ASSERT_EQ(offset, rows[i]);
+			ASSERT_EQ(fview_get_previous_row(file_view, &offset, width), i > 0);
+		}
+		// Lines past the end go to the last line
+		for (size_t line = 0; line < line_starts.size() + 5; line += 1 + rand() % 50)
+		{
+			ASSERT_EQ(fview_find_line(file_view, line), line_starts[std::min(line, line_starts.size() - 1)]);
+		}
+	}
+	// A line far past the end makes the index reach the end, with a checkpoint for every FILE_VIEW_CHECKPOINT_LINES lines
+	ASSERT_FALSE(file_view->indexed);
+	ASSERT_EQ(fview_find_line(file_view, 1000000), text.rfind('\n') + 1);
+	ASSERT_TRUE(file_view->indexed);
+	ASSERT_EQ(oarr_get_size(file_view->checkpoints), 3u);
+	fview_close(file_view);
+	unlink(path.c_str());
+}
+
+TEST(FileView, EmptyFileIsOneEmptyRow)
+{
+	std::string path = make_temp_file("");
+	FileView *file_view = fview_open(path.c_str());
+	ASSERT_NE(file_view, nullptr);
+	size_t offset = 0;
+	ASSERT_EQ(fview_get_row_size(file_view, offset, 10), 0u);
+	ASSERT_FALSE(fview_get_next_row(file_view, &offset, 10));
+	ASSERT_FALSE(fview_get_previous_row(file_view, &offset, 10));
+	ASSERT_EQ(fview_find_line(file_view, 7), 0u);
+	fview_close(file_view);
+	unlink(path.c_str());
+	ASSERT_EQ(fview_open(path.c_str()), nullptr);
+}
+
+TEST(FileView, ScrollingUpAfterAResizeStaysInTheFile)
+{
+	std::string path = make_temp_file(std::string(100, 'a') + std::string(100, 'b') + "\nnext");
+	// The top row starts 80 bytes into the line, which isn't a row of the new width
+	std::vector<int> keys = {ARROW_DOWN, MAKE_RESIZE_KEY(100, 10), ARROW_UP, ARROW_UP, QUIT_KEY};
+	IO_Interface io_interface = headless_io_recording_interface();
+	headless_io_reset();
+	headless_io_feed_keys(keys.size(), keys.data());
+	Viewer *viewer = viewer_create(path.c_str(), (vec2) {80, 10}, io_interface);
+	ASSERT_NE(viewer, nullptr);
+	while (viewer_process_tick(viewer) == TEXT_EDITOR_SUCCESSFUL_READ)
+	{
+		viewer_render_screen(viewer);
+	}
+	viewer_destroy(viewer);
+	std::string last_frame = headless_io_get_last_frame();
+	ASSERT_NE(last_frame.find("\x1b[1;1H" + std::string(100, 'a') + "\x1b[K\x1b[2;1H" + std::string(100, 'b')), std::string::npos);
+	unlink(path.c_str());
+}
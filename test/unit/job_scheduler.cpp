@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+extern "C"
+{
+#include "definitions.h"
+#include "editor.h"
+#include "headless_io.h"
+#include "job_scheduler.h"
+}
+#include "test_helpers.h"
+
+static const vec2 window_size = {40, 10};
+
+// Counts up to step_count, one step at a time, and logs what happens to it
+struct CountingJob
+{
+	int name;
+	int steps_done;
+	int step_count;
+	int publish_count;
+	std::vector<std::string> *log;
+};
+
+static bool count_step(void *state)
+{
+	CountingJob *job = (CountingJob *)state;
+	job->log->push_back("step " + std::to_string(job->name));
+	return ++job->steps_done == job->step_count;
+}
+
+static void count_publish(void *state)
+{
+	CountingJob *job = (CountingJob *)state;
+	job->publish_count++;
+	job->log->push_back("publish " + std::to_string(job->name));
+}
+
+static void count_destroy(void *state)
+{
+	CountingJob *job = (CountingJob *)state;
+	job->log->push_back("destroy " + std::to_string(job->name));
+}
+
+static Job make_job(CountingJob *state, int priority, bool cancel_on_input)
+{
+	Job job = {};
+	job.priority = priority;
+	job.cancel_on_input = cancel_on_input;
+	job.state = state;
+	job.step = count_step;
+	job.publish = count_publish;
+	job.destroy = count_destroy;
+	return job;
+}
+
+TEST(JobScheduler, HigherPriorityRunsFirst)
+{
+	std::vector<std::string> log;
+	CountingJob low = {1, 0, 2, 0, &log};
+	CountingJob high = {2, 0, 2, 0, &log};
+	JobScheduler *scheduler = jsched_create();
+	jsched_submit(scheduler, make_job(&low, JOB_PRIORITY_LOW, false));
+	jsched_submit(scheduler, make_job(&high, JOB_PRIORITY_HIGH, false));
+	ASSERT_FALSE(jsched_run(scheduler, UINT64_MAX));
+	std::vector<std::string> expected = {
+		"step 2", "step 2", "publish 2", "destroy 2",
+		"step 1", "step 1", "publish 1", "destroy 1",
+	};
+	ASSERT_EQ(log, expected);
+	jsched_destroy(scheduler);
+}
+
+TEST(JobScheduler, JobResumesWhereTheLastSliceStopped)
+{
+	std::vector<std::string> log;
+	CountingJob job = {1, 0, 5, 0, &log};
+	JobScheduler *scheduler = jsched_create();
+	size_t id = jsched_submit(scheduler, make_job(&job, JOB_PRIORITY_NORMAL, false));
+	// A slice runs one step at least, however small its budget is
+	for (int i = 1; i < 5; i++)
+	{
+		ASSERT_TRUE(jsched_run(scheduler, 0));
+		ASSERT_EQ(job.steps_done, i);
+		ASSERT_EQ(job.publish_count, 0);
+		ASSERT_TRUE(jsched_is_running(scheduler, id));
+	}
+	ASSERT_FALSE(jsched_run(scheduler, 0));
+	ASSERT_EQ(job.publish_count, 1);
+	ASSERT_FALSE(jsched_is_running(scheduler, id));
+	jsched_destroy(scheduler);
+}
+
+TEST(JobScheduler, InputOnlyCancelsJobsThatAskForIt)
+{
+	std::vector<std::string> log;
+	CountingJob stale = {1, 0, 3, 0, &log};
+	CountingJob kept = {2, 0, 3, 0, &log};
+	JobScheduler *scheduler = jsched_create();
+	size_t stale_id = jsched_submit(scheduler, make_job(&stale, JOB_PRIORITY_HIGH, true));
+	size_t kept_id = jsched_submit(scheduler, make_job(&kept, JOB_PRIORITY_LOW, false));
+	jsched_run(scheduler, 0);
+	jsched_note_input(scheduler);
+	ASSERT_FALSE(jsched_is_running(scheduler, stale_id));
+	ASSERT_TRUE(jsched_is_running(scheduler, kept_id));
+	ASSERT_FALSE(jsched_run(scheduler, UINT64_MAX));
+	ASSERT_EQ(stale.publish_count, 0);
+	ASSERT_EQ(kept.publish_count, 1);
+	std::vector<std::string> expected = {
+		"step 1", "destroy 1",
+		"step 2", "step 2", "step 2", "publish 2", "destroy 2",
+	};
+	ASSERT_EQ(log, expected);
+	jsched_destroy(scheduler);
+}
+
+TEST(JobScheduler, FinishRunsOneJobAndCancelIsSafeAfterIt)
+{
+	std::vector<std::string> log;
+	CountingJob first = {1, 0, 3, 0, &log};
+	CountingJob second = {2, 0, 3, 0, &log};
+	JobScheduler *scheduler = jsched_create();
+	size_t first_id = jsched_submit(scheduler, make_job(&first, JOB_PRIORITY_NORMAL, false));
+	size_t second_id = jsched_submit(scheduler, make_job(&second, JOB_PRIORITY_NORMAL, false));
+	jsched_finish(scheduler, second_id);
+	ASSERT_EQ(second.publish_count, 1);
+	ASSERT_EQ(first.steps_done, 0);
+	jsched_finish(scheduler, second_id);
+	jsched_cancel(scheduler, second_id);
+	ASSERT_EQ(second.publish_count, 1);
+	// Jobs left over are destroyed without being published
+	jsched_destroy(scheduler);
+	ASSERT_EQ(first.publish_count, 0);
+	ASSERT_EQ(log.back(), "destroy 1");
+	ASSERT_NE(first_id, second_id);
+}
+
+TEST(JobScheduler, EditorSearchMovesTheCursorOnceItsDone)
+{
+	std::string content;
+	for (int i = 0; i < 100000; i++)
+	{
+		content += i == 70000 ? "a needle\n" : "line " + std::to_string(i) + "\n";
+	}
+	std::string path = make_temp_file(content);
+	IO_Interface io_interface = headless_io_recording_interface();
+	headless_io_reset();
+	Editor *editor = editor_create(window_size, io_interface);
+	editor_read_file(editor, path.c_str());
+	std::vector<int> keys = {CTRL('f'), 'n', 'e', 'e', 'd', 'l', 'e', CARRIAGE_RETURN};
+	headless_io_feed_keys(keys.size(), keys.data());
+	// The search bar says it's searching until the matches are in, the bar shows the text as it's typed too
+	std::string last_frame;
+	for (int tick = 0; tick < 1000 && (headless_io_get_pending_key_count() > 0 || last_frame.find("Search: needle") == std::string::npos); tick++)
+	{
+		editor_process_tick(editor);
+		editor_render_screen(editor);
+		last_frame = headless_io_get_last_frame();
+	}
+	ASSERT_NE(last_frame.find("Search: needle"), std::string::npos);
+	std::vector<int> edit = {CTRL('X'), 'X'};
+	headless_io_feed_keys(edit.size(), edit.data());
+	while (headless_io_get_pending_key_count() > 0)
+	{
+		editor_process_tick(editor);
+	}
+	editor_write_file(editor, path.c_str());
+	editor_destroy(editor);
+	std::string expected = content;
+	expected.insert(expected.find("needle"), "X");
+	ASSERT_EQ(read_file(path), expected);
+	unlink(path.c_str());
+}
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+extern "C"
+{
+#include "definitions.h"
+#include "editor.h"
+#include "hashing.h"
+#include "headless_io.h"
+#include "key_trace.h"
+}
+#include "test_helpers.h"
+
+static const vec2 window_size = {40, 10};
+
+static std::string run_keys(IO_Interface io_interface, const std::string &path, const std::vector<int> &keys)
+{
+	headless_io_reset();
+	Editor *editor = editor_create(window_size, io_interface);
+	editor_read_file(editor, path.c_str());
+	headless_io_feed_keys(keys.size(), keys.data());
+	while (headless_io_get_pending_key_count() > 0)
+	{
+		editor_process_tick(editor);
+	}
+	editor_write_file(editor, path.c_str());
+	editor_destroy(editor);
+	return read_file(path);
+}
+
+TEST(KeyTrace, ReplayingARecordedTraceMakesTheSameEdits)
+{
+	const std::string content = "one\ntwo\nthree\n";
+	std::string path = make_temp_file(content);
+	std::string trace_path = make_temp_file("");
+	std::vector<int> keys = {ARROW_DOWN, 'x', ARROW_RIGHT, BACKSPACE, CARRIAGE_RETURN, 'y'};
+	IO_Interface io_interface = ktrace_start_recording(headless_io_null_interface(), trace_path.c_str(), path.c_str(), window_size);
+	std::string recorded = run_keys(io_interface, path, keys);
+	ktrace_stop_recording();
+	ASSERT_EQ(recorded, "one\nx\nywo\nthree\n");
+
+	KeyTrace *trace = ktrace_load(trace_path.c_str());
+	ASSERT_NE(trace, nullptr);
+	// The trace is of the file as it was before the edits
+	std::string replay_path = make_temp_file(content);
+	size_t file_size;
+	EXPECT_EQ(trace->file_hash, hash_file(replay_path.c_str(), &file_size));
+	EXPECT_EQ(trace->file_size, content.size());
+	EXPECT_EQ(trace->window_size.x, window_size.x);
+	EXPECT_EQ(trace->window_size.y, window_size.y);
+	std::vector<int> traced_keys;
+	uint64_t last_time = 0;
+	for (size_t i = 0; i < darr_get_size(trace->events); i++)
+	{
+		const KeyTraceEvent *event = (const KeyTraceEvent *)darr_getc(trace->events, i);
+		EXPECT_GE(event->time, last_time);
+		last_time = event->time;
+		traced_keys.push_back(event->key);
+	}
+	ASSERT_EQ(traced_keys, keys);
+	ASSERT_EQ(run_keys(headless_io_null_interface(), replay_path, traced_keys), recorded);
+	ktrace_destroy(trace);
+	unlink(path.c_str());
+	unlink(replay_path.c_str());
+	unlink(trace_path.c_str());
+}
+
+TEST(KeyTrace, TracesWithoutTheHeaderArentLoaded)
+{
+	std::string trace_path = make_temp_file("file 0 0\nwindow 80 25\n0 120\n");
+	ASSERT_EQ(ktrace_load(trace_path.c_str()), nullptr);
+	ASSERT_EQ(ktrace_load("/tmp/text-editor-missing-trace"), nullptr);
+	unlink(trace_path.c_str());
+}
@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C"
+{
+#include "layout_tree.h"
+}
+
+static size_t rows_for_size(size_t size, size_t width)
+{
+	return size == 0 ? 1 : 1 + (size - 1) / width;
+}
+
+static void assert_matches(const LayoutTree *tree, const std::vector<size_t> &sizes, size_t width)
+{
+	ASSERT_EQ(ltree_get_size(tree), sizes.size());
+	size_t prefix = 0;
+	for (size_t i = 0; i < sizes.size(); i++)
+	{
+		ASSERT_EQ(ltree_get_rows_before(tree, i), prefix);
+		ASSERT_EQ(ltree_get_line_rows(tree, i), rows_for_size(sizes[i], width));
+		for (size_t j = 0; j < rows_for_size(sizes[i], width); j++)
+		{
+			ASSERT_EQ(ltree_find_line(tree, prefix + j), i);
+		}
+		prefix += rows_for_size(sizes[i], width);
+	}
+	ASSERT_EQ(ltree_get_total_rows(tree), prefix);
+}
+
+TEST(ltree_get_rows_for_size, normal_checks)
+{
+	LayoutTree *tree = ltree_create(10);
+	ASSERT_EQ(ltree_get_rows_for_size(tree, 0), 1);
+	ASSERT_EQ(ltree_get_rows_for_size(tree, 1), 1);
+	ASSERT_EQ(ltree_get_rows_for_size(tree, 10), 1);
+	ASSERT_EQ(ltree_get_rows_for_size(tree, 11), 2);
+	ASSERT_EQ(ltree_get_rows_for_size(tree, 20), 2);
+	ASSERT_EQ(ltree_get_rows_for_size(tree, 21), 3);
+	ltree_destroy(tree);
+}
+
+TEST(ltree_add_line, prefix_sums)
+{
+	LayoutTree *tree = ltree_create(10);
+	std::vector<size_t> sizes;
+	for (size_t i = 0; i < 300; i++)
+	{
+		sizes.push_back(i % 37);
+		ltree_add_line(tree, i % 37);
+	}
+	assert_matches(tree, sizes, 10);
+	ltree_destroy(tree);
+}
+
+TEST(ltree_find_line, past_the_end_returns_last_line)
+{
+	LayoutTree *tree = ltree_create(10);
+	ltree_add_line(tree, 5);
+	ltree_add_line(tree, 25);
+	ASSERT_EQ(ltree_find_line(tree, 4), 1);
+	ASSERT_EQ(ltree_find_line(tree, 100), 1);
+	ltree_destroy(tree);
+}
+
+TEST(ltree, random_edits_match_brute_force)
+{
+	LayoutTree *tree = ltree_create(8);
+	std::vector<size_t> sizes;
+	srand(42);
+	for (int i = 0; i < 2000; i++)
+	{
+		int op = rand() % 4;
+		size_t size = rand() % 50;
+		if (op == 0 || sizes.empty())
+		{
+			sizes.push_back(size);
+			ltree_add_line(tree, size);
+		}
+		else if (op == 1)
+		{
+			size_t pos = rand() % (sizes.size() + 1);
+			sizes.insert(sizes.begin() + pos, size);
+			ltree_insert_line(tree, pos, size);
+		}
+		else if (op == 2)
+		{
+			size_t pos = rand() % sizes.size();
+			sizes.erase(sizes.begin() + pos);
+			ltree_remove_line(tree, pos);
+		}
+		else
+		{
+			size_t pos = rand() % sizes.size();
+			sizes[pos] = size;
+			ltree_update_line(tree, pos, size);
+		}
+		if (i % 100 == 0)
+		{
+			assert_matches(tree, sizes, 8);
+		}
+	}
+	assert_matches(tree, sizes, 8);
+	ltree_destroy(tree);
+}
+
+TEST(ltree_move_lines, random_moves_match_brute_force)
+{
+	LayoutTree *tree = ltree_create(8);
+	std::vector<size_t> sizes;
+	srand(7);
+	for (size_t i = 0; i < 517; i++)
+	{
+		// Mostly single row lines, so both the point updates and the rebuild get used
+		sizes.push_back(rand() % 10 == 0 ? rand() % 50 : rand() % 8);
+		ltree_add_line(tree, sizes.back());
+	}
+	for (int i = 0; i < 300; i++)
+	{
+		size_t count = rand() % 2 == 0 ? 1 + rand() % 3 : rand() % sizes.size();
+		size_t pos = rand() % (sizes.size() - count + 1);
+		size_t to = rand() % (sizes.size() - count + 1);
+		std::vector<size_t> block(sizes.begin() + pos, sizes.begin() + pos + count);
+		sizes.erase(sizes.begin() + pos, sizes.begin() + pos + count);
+		sizes.insert(sizes.begin() + to, block.begin(), block.end());
+		ltree_move_lines(tree, pos, count, to);
+		assert_matches(tree, sizes, 8);
+	}
+	ltree_destroy(tree);
+}
+
+TEST(ltree_set_width, exact_lines_stay_exact_through_edits)
+{
+	LayoutTree *tree = ltree_create(8);
+	std::vector<size_t> sizes;
+	srand(3);
+	for (size_t i = 0; i < 700; i++)
+	{
+		sizes.push_back(rand() % 60);
+		ltree_add_line(tree, sizes.back());
+	}
+	size_t total = ltree_get_total_rows(tree);
+	ltree_set_width(tree, 13);
+	// The rows at the old width are kept until the lines are laid out again
+	ASSERT_EQ(ltree_get_exact_length(tree), 0u);
+	ASSERT_EQ(ltree_get_total_rows(tree), total);
+	for (int i = 0; i < 400; i++)
+	{
+		size_t pos = rand() % sizes.size();
+		switch (rand() % 4)
+		{
+		case 0:
+			sizes.insert(sizes.begin() + pos, rand() % 60);
+			ltree_insert_line(tree, pos, sizes[pos]);
+			break;
+		case 1:
+			sizes.erase(sizes.begin() + pos);
+			ltree_remove_line(tree, pos);
+			break;
+		case 2:
+		{
+			size_t count = 1 + rand() % (sizes.size() - pos);
+			size_t to = rand() % (sizes.size() - count + 1);
+			std::vector<size_t> block(sizes.begin() + pos, sizes.begin() + pos + count);
+			sizes.erase(sizes.begin() + pos, sizes.begin() + pos + count);
+			sizes.insert(sizes.begin() + to, block.begin(), block.end());
+			ltree_move_lines(tree, pos, count, to);
+			break;
+		}
+		default:
+		{
+			size_t row = ltree_get_exact_length(tree);
+			size_t count = std::min<size_t>(rand() % 20, sizes.size() - row);
+			ltree_update_lines(tree, row, count, sizes.data() + row);
+			break;
+		}
+		}
+		for (size_t j = 0; j < ltree_get_exact_length(tree); j++)
+		{
+			ASSERT_EQ(ltree_get_line_rows(tree, j), rows_for_size(sizes[j], 13));
+		}
+	}
+	ltree_update_lines(tree, 0, sizes.size(), sizes.data());
+	ASSERT_EQ(ltree_get_exact_length(tree), sizes.size());
+	assert_matches(tree, sizes, 13);
+	ltree_destroy(tree);
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+extern "C"
+{
+#include "allocator.h"
+#include "editor.h"
+#include "hashing.h"
+#include "headless_io.h"
+#include "line_cache.h"
+}
+#include "test_helpers.h"
+
+// The text in memory that a FileData can take over, like the editor reads it
+static char *copy_text(const std::string &text)
+{
+	char *copy = (char *)mem_alloc(MEM_COLD, text.size());
+	memcpy(copy, text.data(), text.size());
+	return copy;
+}
+
+TEST(LineCache, MappedLinesReadLikeTheFileUntilTheyAreAdopted)
+{
+	srand(5);
+	std::string text;
+	for (int i = 0; i < 3000; i++)
+	{
+		text += std::string(rand() % 3 == 0 ? 0 : rand() % 70, 'a' + i % 26) + "\n";
+	}
+	text += "no line break at the end";
+	std::string path = make_temp_file(text);
+	FileData file_data;
+	fdata_init(&file_data, 10);
+	bool line_open = true;
+	fdata_append_lines(&file_data, text.size(), text.c_str(), &line_open);
+	size_t file_size;
+	uint64_t file_hash = hash_file_state(path.c_str(), &file_size);
+	ASSERT_EQ(file_size, text.size());
+	std::string cache_path = path + ".lines";
+	ASSERT_TRUE(lcache_write(cache_path.c_str(), file_hash, file_size, &file_data));
+
+	// The cache only applies to the state it was written for
+	LineCache cache;
+	ASSERT_FALSE(lcache_load(&cache, cache_path.c_str(), file_hash + 1, file_size));
+	ASSERT_FALSE(lcache_load(&cache, cache_path.c_str(), file_hash, file_size + 1));
+	ASSERT_TRUE(lcache_load(&cache, cache_path.c_str(), file_hash, file_size));
+	ASSERT_EQ(cache.line_count, fdata_get_line_count(&file_data));
+
+	FileData mapped;
+	fdata_init(&mapped, 10);
+	char *file_text = copy_text(text);
+	ASSERT_FALSE(fdata_map_lines(&mapped, file_text, file_size - 1, cache.line_count, cache.line_sizes, cache.line_words));
+	ASSERT_TRUE(fdata_map_lines(&mapped, file_text, file_size, cache.line_count, cache.line_sizes, cache.line_words));
+	lcache_unload(&cache);
+	ASSERT_EQ(get_text(&mapped), text);
+	ASSERT_EQ(fdata_get_total_visual_rows(&mapped, 10), fdata_get_total_visual_rows(&file_data, 10));
+	ASSERT_STREQ(dbuf_get_with_nulc(fdata_get_line(&mapped, 2999), 0), dbuf_get_with_nulc(fdata_get_line(&file_data, 2999), 0));
+	// The statistics are added up from the cached counts, without reading the file
+	ASSERT_EQ(fdata_get_byte_count(&mapped), text.size());
+	ASSERT_EQ(fdata_get_word_count(&mapped), fdata_get_word_count(&file_data));
+
+	// Edits thaw the lines they touch, the rest are adopted and the text is freed with the last of them
+	fdata_insert_text(&mapped, (vec2) {0, 1500}, 4, "a\nb\n");
+	fdata_insert_text(&file_data, (vec2) {0, 1500}, 4, "a\nb\n");
+	ASSERT_EQ(get_text(&mapped), get_text(&file_data));
+	ASSERT_EQ(fdata_get_word_count(&mapped), fdata_get_word_count(&file_data));
+	size_t keep_row = 0;
+	while (fdata_compress_cold_lines(&mapped, 1, &keep_row, 4 * COLD_BLOCK_LINES) && mapped.cold->map != NULL);
+	ASSERT_EQ(mapped.cold->map, nullptr);
+	ASSERT_EQ(get_text(&mapped), get_text(&file_data));
+	fdata_destroy(&mapped);
+	fdata_destroy(&file_data);
+	unlink(cache_path.c_str());
+	unlink(path.c_str());
+}
+
+TEST(LineCache, ReopenedFileKeepsItsLinesWhenItsTruncated)
+{
+	std::string text;
+	while (text.size() < LINE_CACHE_MIN_SIZE)
+	{
+		text += std::string(99, 'a' + text.size() % 26) + "\n";
+	}
+	std::string path = make_temp_file(text);
+	Editor *editor = editor_create((vec2) {80, 24}, headless_io_null_interface());
+	editor_read_file(editor, path.c_str());
+	editor_destroy(editor);
+	// Opened from the cache this time, the lines are in the cold store until they are adopted
+	size_t cold_used = mem_get_used(MEM_COLD);
+	editor = editor_create((vec2) {80, 24}, headless_io_null_interface());
+	editor_read_file(editor, path.c_str());
+	ASSERT_GE(mem_get_used(MEM_COLD), cold_used + text.size());
+	// Another process cuts the file off before any line was looked at
+	ASSERT_EQ(truncate(path.c_str(), 0), 0);
+	std::string copy_path = path + ".copy";
+	editor_write_file(editor, copy_path.c_str());
+	editor_destroy(editor);
+	ASSERT_EQ(read_file(copy_path), text);
+	char cache_path[PATH_MAX];
+	lcache_get_path(path.c_str(), cache_path, sizeof(cache_path));
+	unlink(cache_path);
+	unlink(copy_path.c_str());
+	unlink(path.c_str());
+}
+
+TEST(LineCache, PathIsHiddenNextToTheFile)
+{
+	char path[PATH_MAX];
+	lcache_get_path("/tmp/logs/app.log", path, sizeof(path));
+	ASSERT_STREQ(path, "/tmp/logs/.app.log.lines");
+	lcache_get_path("app.log", path, sizeof(path));
+	ASSERT_STREQ(path, "./.app.log.lines");
+}
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+extern "C"
+{
+#include "definitions.h"
+#include "editor.h"
+#include "headless_io.h"
+#include "pipeline.h"
+}
+#include "test_helpers.h"
+
+static const vec2 window_size = {40, 10};
+
+TEST(Pipeline, EditorGetsEveryKeyInOrder)
+{
+	// Keys are read on the input thread while the editor thread handles them
+	std::vector<int> keys;
+	for (int i = 0; i < 2000; i++)
+	{
+		keys.push_back(i % 50 == 49 ? CARRIAGE_RETURN : 'a' + i % 26);
+	}
+	keys.push_back(QUIT_KEY);
+	IO_Interface output = headless_io_recording_interface();
+	headless_io_reset();
+	headless_io_feed_keys(keys.size(), keys.data());
+	std::string path = make_temp_file("");
+	pline_start(window_size, output);
+	Editor *editor = editor_create(window_size, pline_get_interface());
+	editor_read_file(editor, path.c_str());
+	editor_clear_screen(editor);
+	while (editor_process_tick(editor) == TEXT_EDITOR_SUCCESSFUL_READ)
+	{
+		editor_render_screen(editor);
+	}
+	editor_write_file(editor, path.c_str());
+	pline_stop();
+	editor_destroy(editor);
+	std::string expected;
+	for (size_t i = 0; i + 1 < keys.size(); i++)
+	{
+		expected += keys[i] == CARRIAGE_RETURN ? '\n' : (char)keys[i];
+	}
+	ASSERT_EQ(read_file(path), expected + "\n");
+	ASSERT_GT(pline_get_drawn_frame_count(), 0u);
+	ASSERT_LE(pline_get_drawn_frame_count(), pline_get_published_frame_count());
+	unlink(path.c_str());
+}
+
+TEST(Pipeline, RendererSkipsToTheNewestFrameWithoutLosingRows)
+{
+	IO_Interface output = headless_io_recording_interface();
+	headless_io_reset();
+	pline_start(window_size, output);
+	IO_Interface io_interface = pline_get_interface();
+	// Row 0 only changes in the first frame, it's drawn even if that frame is dropped
+	io_interface.render_row(0, 5, "first");
+	for (int i = 0; i < 5000; i++)
+	{
+		std::string row = "frame " + std::to_string(i);
+		io_interface.render_row(1, row.size(), row.c_str());
+		io_interface.flush_output();
+	}
+	// The last frame is published before the pipeline stops, even when the renderer was behind
+	pline_stop();
+	ASSERT_LE(pline_get_published_frame_count(), 5000u);
+	ASSERT_LE(pline_get_drawn_frame_count(), pline_get_published_frame_count());
+	std::string last_frame = headless_io_get_last_frame();
+	ASSERT_NE(last_frame.find("frame 4999"), std::string::npos);
+	ASSERT_EQ(last_frame.find("first"), std::string::npos);
+	ASSERT_GE(headless_io_get_total_output_size(), 5u);
+}
+
+TEST(Pipeline, HighlightedRowsKeepTheirWidthAndTurnReverseVideoOff)
+{
+	IO_Interface output = headless_io_recording_interface();
+	headless_io_reset();
+	pline_start(window_size, output);
+	IO_Interface io_interface = pline_get_interface();
+	// A full width selection, its escape sequences take no columns
+	std::string selected = "\x1b[7m" + std::string(window_size.x, 'a') + "\x1b[27m";
+	io_interface.render_row(0, selected.size(), selected.c_str());
+	// Cut inside the selection, it's still turned off before the line clear
+	std::string cut = "bb\x1b[7m" + std::string(window_size.x, 'c') + "\x1b[27mdd";
+	io_interface.render_row(1, cut.size(), cut.c_str());
+	// Never turned off by the row
+	std::string open = "\x1b[7m" + std::string(window_size.x + 5, 'e');
+	io_interface.render_row(2, open.size(), open.c_str());
+	io_interface.flush_output();
+	pline_stop();
+	std::string last_frame = headless_io_get_last_frame();
+	ASSERT_NE(last_frame.find("\x1b[1;1H" + selected + "\x1b[K"), std::string::npos);
+	ASSERT_NE(last_frame.find("\x1b[2;1Hbb\x1b[7m" + std::string(window_size.x - 2, 'c') + "\x1b[27m\x1b[K"), std::string::npos);
+	ASSERT_NE(last_frame.find("\x1b[3;1H\x1b[7m" + std::string(window_size.x, 'e') + "\x1b[m\x1b[K"), std::string::npos);
+}
+
+TEST(Pipeline, ResizesAreDrawnAtTheNewSize)
+{
+	std::string content(50, 'a');
+	for (int i = 1; i < 100; i++)
+	{
+		content += "\nline " + std::to_string(i);
+	}
+	std::string path = make_temp_file(content);
+	std::vector<int> keys(50, ARROW_DOWN);
+	// A drag resizes the window many times before it stops
+	for (int width = 39; width > 20; width--)
+	{
+		keys.push_back(MAKE_RESIZE_KEY(width, 8 + width % 5));
+	}
+	keys.push_back(MAKE_RESIZE_KEY(20, 6));
+	keys.push_back(QUIT_KEY);
+	IO_Interface output = headless_io_recording_interface();
+	headless_io_reset();
+	headless_io_feed_keys(keys.size(), keys.data());
+	pline_start(window_size, output);
+	Editor *editor = editor_create(window_size, pline_get_interface());
+	editor_read_file(editor, path.c_str());
+	while (editor_process_tick(editor) == TEXT_EDITOR_SUCCESSFUL_READ)
+	{
+		editor_render_screen(editor);
+	}
+	pline_stop();
+	editor_destroy(editor);
+	// The frame of the new size is drawn in full after a clear, the cursor line is still shown
+	std::string last_frame = headless_io_get_last_frame();
+	ASSERT_NE(last_frame.find("\x1b[2J"), std::string::npos);
+	ASSERT_NE(last_frame.find("\x1b[5;1Hline 50"), std::string::npos);
+	ASSERT_EQ(last_frame.find("\x1b[7;1H"), std::string::npos);
+	ASSERT_EQ(headless_io_get_cursor_position().y, 4);
+	unlink(path.c_str());
+}
@@ -0,0 +1,220 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+extern "C"
+{
+#include "file_data.h"
+#include "snapshot.h"
+}
+#include "test_helpers.h"
+
+static std::string get_text(Snapshot *snapshot)
+{
+	std::string text;
+	for (size_t i = 0; i < snap_get_line_count(snapshot); i++)
+	{
+		size_t size;
+		const char *line = snap_get_line_text(snapshot, i, &size);
+		text += (i > 0 ? "\n" : "") + std::string(line, size);
+	}
+	return text;
+}
+
+static std::string make_log(int line_count)
+{
+	std::string text;
+	for (int i = 0; i < line_count; i++)
+	{
+		text += "12:" + std::to_string(i % 60) + " worker-" + std::to_string(rand() % 4) + " took " + std::to_string(rand() % 900) + "ms\n";
+	}
+	return text;
+}
+
+class SnapshotTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		fdata_init(&file_data, 10);
+	}
+
+	void TearDown() override
+	{
+		for (auto &taken : snapshots)
+		{
+			snap_destroy(taken.second);
+		}
+		fdata_destroy(&file_data);
+	}
+
+	void take_snapshot()
+	{
+		snapshots.emplace_back(get_text(&file_data), fdata_take_snapshot(&file_data));
+	}
+
+	void assert_snapshots_unchanged()
+	{
+		for (auto &taken : snapshots)
+		{
+			ASSERT_EQ(get_text(taken.second), taken.first);
+		}
+	}
+
+	FileData file_data;
+	std::vector<std::pair<std::string, Snapshot *>> snapshots;
+};
+
+TEST_F(SnapshotTest, RandomEditsLeaveEverySnapshotAsItWas)
+{
+	srand(11);
+	std::string text = make_log(3000);
+	bool line_open = true;
+	fdata_append_lines(&file_data, text.size(), text.c_str(), &line_open);
+	text.pop_back();
+	take_snapshot();
+	const char *alphabet = "ab\ncdefghijklmnopq\n";
+	for (int step = 0; step < 400; step++)
+	{
+		size_t line_count = fdata_get_line_count(&file_data);
+		switch (rand() % 5)
+		{
+		case 0:
+		{
+			size_t offset = rand() % (text.size() + 1);
+			std::string inserted;
+			for (int i = rand() % (rand() % 8 == 0 ? 2000 : 25); i >= 0; i--)
+			{
+				inserted += alphabet[rand() % strlen(alphabet)];
+			}
+			fdata_insert_text(&file_data, get_position(text, offset), inserted.size(), inserted.c_str());
+			text.insert(offset, inserted);
+			break;
+		}
+		case 1:
+		{
+			if (text.empty())
+			{
+				break;
+			}
+			size_t start = rand() % text.size();
+			size_t end = start + 1 + rand() % std::min<size_t>(rand() % 8 == 0 ? 5000 : 30, text.size() - start);
+			fdata_delete_range(&file_data, get_position(text, start), get_position(text, end));
+			text.erase(start, end - start);
+			break;
+		}
+		case 2:
+		{
+			size_t row = rand() % line_count;
+			size_t count = 1 + rand() % std::min<size_t>(200, line_count - row);
+			fdata_remove_lines(&file_data, row, count, NULL);
+			break;
+		}
+		case 3:
+		{
+			size_t row = rand() % (line_count + 1);
+			std::vector<DynamicBuffer *> lines(1 + rand() % 150);
+			for (size_t i = 0; i < lines.size(); i++)
+			{
+				lines[i] = dbuf_create(MEM_LINES);
+				dbuf_adds(lines[i], 5, "added");
+			}
+			fdata_insert_lines(&file_data, row, lines.size(), lines.data());
+			break;
+		}
+		default:
+		{
+			size_t count = 1 + rand() % std::min<size_t>(100, line_count);
+			size_t row = rand() % (line_count - count + 1);
+			fdata_move_lines(&file_data, row, count, rand() % (line_count - count + 1));
+			break;
+		}
+		}
+		text = get_text(&file_data);
+		if (step % 10 == 0)
+		{
+			take_snapshot();
+		}
+		if (step % 50 == 0)
+		{
+			assert_snapshots_unchanged();
+		}
+	}
+	take_snapshot();
+	assert_snapshots_unchanged();
+	// The snapshots that are let go of don't change the ones that are left
+	for (size_t i = 0; i < snapshots.size(); i += 2)
+	{
+		snap_destroy(snapshots[i].second);
+		snapshots[i].second = fdata_take_snapshot(&file_data);
+		snapshots[i].first = text;
+	}
+	vec2 cursor;
+	while (fdata_undo(&file_data, &cursor));
+	assert_snapshots_unchanged();
+}
+
+TEST_F(SnapshotTest, CompressedLinesStayReadableAfterTheyAreThawed)
+{
+	srand(7);
+	std::string text = make_log(8000);
+	bool line_open = true;
+	fdata_append_lines(&file_data, text.size(), text.c_str(), &line_open);
+	take_snapshot();
+	size_t keep_row = 0;
+	ASSERT_TRUE(fdata_compress_cold_lines(&file_data, 1, &keep_row, SIZE_MAX));
+	ASSERT_TRUE(cold_is_slot(larr_get(file_data.lines, 4000)));
+	take_snapshot();
+	// Every edit thaws the blocks around it, the snapshots still read the compressed lines
+	for (size_t row = 2000; row < 7000; row += 500)
+	{
+		fdata_insert_text(&file_data, (vec2) {0, (int)row}, 4, "a\nb\n");
+		fdata_remove_lines(&file_data, row + 100, 3, NULL);
+	}
+	take_snapshot();
+	assert_snapshots_unchanged();
+	snap_destroy(snapshots[1].second);
+	snapshots.erase(snapshots.begin() + 1);
+	ASSERT_TRUE(fdata_compress_cold_lines(&file_data, 1, &keep_row, SIZE_MAX));
+	fdata_insert_text(&file_data, (vec2) {0, 5000}, 1, "\n");
+	assert_snapshots_unchanged();
+	Snapshot *last = fdata_take_snapshot(&file_data);
+	ASSERT_EQ(get_text(last), get_text(&file_data));
+	snap_destroy(last);
+}
+
+TEST_F(SnapshotTest, AnotherThreadReadsTheSnapshotWhileTheLinesChange)
+{
+	srand(5);
+	std::string text = make_log(20000);
+	bool line_open = true;
+	fdata_append_lines(&file_data, text.size(), text.c_str(), &line_open);
+	std::string expected = get_text(&file_data);
+	Snapshot *taken = fdata_take_snapshot(&file_data);
+	Snapshot *shared = snap_share(taken);
+	snap_destroy(taken);
+	bool unchanged = true;
+	std::thread reader([&]() {
+		for (int i = 0; i < 5; i++)
+		{
+			unchanged &= get_text(shared) == expected;
+		}
+		snap_destroy(shared);
+	});
+	for (int step = 0; step < 3000; step++)
+	{
+		size_t row = rand() % fdata_get_line_count(&file_data);
+		if (step % 3 == 0)
+		{
+			fdata_remove_lines(&file_data, row, 1, NULL);
+		}
+		else
+		{
+			fdata_insert_text(&file_data, (vec2) {0, (int)row}, 6, "edit\n!");
+		}
+	}
+	reader.join();
+	ASSERT_TRUE(unchanged);
+}
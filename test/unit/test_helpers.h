@@ -0,0 +1,59 @@
+#pragma once
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+extern "C"
+{
+#include "file_data.h"
+}
+
+// Helpers shared by the test files, every test executable includes the ones it needs
+
+static inline std::string make_temp_file(const std::string &content)
+{
+	char path[] = "/tmp/text-editor-test-XXXXXX";
+	int fd = mkstemp(path);
+	close(fd);
+	std::ofstream(path) << content;
+	return path;
+}
+
+static inline std::string read_file(const std::string &path)
+{
+	std::stringstream text;
+	text << std::ifstream(path).rdbuf();
+	return text.str();
+}
+
+static inline std::string get_text(const FileData *file_data)
+{
+	std::string text;
+	for (size_t i = 0; i < fdata_get_line_count(file_data); i++)
+	{
+		size_t size;
+		const char *line = fdata_get_line_text(file_data, i, &size);
+		text += (i > 0 ? "\n" : "") + std::string(line, size);
+	}
+	return text;
+}
+
+// Where the character at offset of text is in the lines of text
+static inline vec2 get_position(const std::string &text, size_t offset)
+{
+	vec2 pos = {0, 0};
+	for (size_t i = 0; i < offset; i++)
+	{
+		if (text[i] == '\n')
+		{
+			pos.y++;
+			pos.x = 0;
+		}
+		else
+		{
+			pos.x++;
+		}
+	}
+	return pos;
+}
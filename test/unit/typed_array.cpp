@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C"
+{
+#include "typed_array.h"
+}
+
+DEFINE_TYPED_ARRAY(IntArray, iarr, int)
+
+TEST(TypedArrayTest, AddAndGet)
+{
+	IntArray *arr = iarr_create(MEM_OTHER);
+	for (int i = 0; i < 1000; i++)
+	{
+		iarr_add(arr, i * 3);
+	}
+	ASSERT_EQ(iarr_get_size(arr), 1000u);
+	for (int i = 0; i < 1000; i++)
+	{
+		ASSERT_EQ(iarr_get(arr, i), i * 3);
+	}
+	iarr_destroy(arr);
+}
+
+TEST(TypedArrayTest, InsertAndRemoveMatchVector)
+{
+	IntArray *arr = iarr_create(MEM_OTHER);
+	std::vector<int> expected;
+	srand(7);
+	for (int i = 0; i < 2000; i++)
+	{
+		if (expected.empty() || rand() % 3 != 0)
+		{
+			size_t pos = rand() % (expected.size() + 1);
+			iarr_insert_to(arr, pos, i);
+			expected.insert(expected.begin() + pos, i);
+		}
+		else
+		{
+			size_t pos = rand() % expected.size();
+			iarr_remove(arr, pos);
+			expected.erase(expected.begin() + pos);
+		}
+	}
+	ASSERT_EQ(iarr_get_size(arr), expected.size());
+	for (size_t i = 0; i < expected.size(); i++)
+	{
+		ASSERT_EQ(iarr_get(arr, i), expected[i]);
+	}
+	iarr_destroy(arr);
+}
+
+TEST(TypedArrayTest, MoveMultipleMatchesVector)
+{
+	IntArray *arr = iarr_create(MEM_OTHER);
+	std::vector<int> expected;
+	for (int i = 0; i < 100; i++)
+	{
+		iarr_add(arr, i);
+		expected.push_back(i);
+	}
+	srand(11);
+	for (int i = 0; i < 500; i++)
+	{
+		size_t count = rand() % 40;
+		size_t pos = rand() % (expected.size() - count + 1);
+		size_t to = rand() % (expected.size() - count + 1);
+		std::vector<int> block(expected.begin() + pos, expected.begin() + pos + count);
+		expected.erase(expected.begin() + pos, expected.begin() + pos + count);
+		expected.insert(expected.begin() + to, block.begin(), block.end());
+		iarr_move_multiple(arr, pos, count, to);
+		ASSERT_EQ(std::vector<int>(arr->arr, arr->arr + arr->length), expected);
+	}
+	iarr_destroy(arr);
+}
+
+TEST(TypedArrayTest, AccountsReservedBytes)
+{
+	size_t used_before = mem_get_used(MEM_OTHER);
+	IntArray *arr = iarr_create(MEM_OTHER);
+	size_t reserved = sizeof(IntArray) + TARR_INITIAL_RESERVED * sizeof(int);
+	ASSERT_EQ(mem_get_used(MEM_OTHER) - used_before, reserved);
+	int values[TARR_INITIAL_RESERVED + 1] = {};
+	iarr_add_multiple(arr, 4, values);
+	iarr_pop(arr);
+	ASSERT_EQ(mem_get_used(MEM_OTHER) - used_before, reserved);
+	// Only growing the array changes the count
+	iarr_add_multiple(arr, TARR_INITIAL_RESERVED + 1, values);
+	reserved += TARR_INITIAL_RESERVED * sizeof(int);
+	ASSERT_EQ(mem_get_used(MEM_OTHER) - used_before, reserved);
+	iarr_clear(arr);
+	ASSERT_EQ(mem_get_used(MEM_OTHER) - used_before, reserved);
+	iarr_destroy(arr);
+	ASSERT_EQ(mem_get_used(MEM_OTHER), used_before);
+}
+
+TEST(TypedArrayDeathTest, CheckedBuildCatchesOutOfRange)
+{
+	IntArray *arr = iarr_create(MEM_OTHER);
+	iarr_add(arr, 1);
+	ASSERT_DEATH(iarr_get(arr, 1), "iarr_get: index out of range");
+	ASSERT_DEATH(iarr_remove(arr, 1), "iarr_remove: position out of range");
+	iarr_pop(arr);
+	ASSERT_DEATH(iarr_pop(arr), "iarr_pop: array is empty");
+	iarr_destroy(arr);
+}
@@ -0,0 +1,107 @@
+/*  Includes */
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "allocator.h"
+#include "definitions.h"
+#include "dynamic_array.h"
+#include "editor.h"
+#include "hashing.h"
+#include "headless_io.h"
+#include "key_trace.h"
+
+#define SLOWEST_TICK_COUNT 10
+
+typedef struct
+{
+	size_t index;
+	int key;
+	const char *operation;
+	uint64_t latency;
+} TickLatency;
+
+uint64_t get_time_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int compare_latency(const void *a, const void *b)
+{
+	uint64_t x = ((const TickLatency *)a)->latency;
+	uint64_t y = ((const TickLatency *)b)->latency;
+	return (x < y) - (x > y);
+}
+
+uint64_t get_percentile(const DynamicArray *sorted_ticks, double p)
+{
+	size_t index = (size_t)((1 - p) * (darr_get_size(sorted_ticks) - 1));
+	return ((const TickLatency *)darr_getc(sorted_ticks, index))->latency;
+}
+
+void print_report(DynamicArray *ticks)
+{
+	if (darr_get_size(ticks) == 0)
+	{
+		printf("The trace has no keys\n");
+		return;
+	}
+	// Slowest first
+	qsort(ticks->arr, darr_get_size(ticks), sizeof(TickLatency), compare_latency);
+	printf("keys: %zu\n", darr_get_size(ticks));
+	printf("p50:  %.1f us\n", get_percentile(ticks, 0.50) / 1000.0);
+	printf("p99:  %.1f us\n", get_percentile(ticks, 0.99) / 1000.0);
+	printf("max:  %.1f us\n", get_percentile(ticks, 1.00) / 1000.0);
+	printf("\nslowest ticks:\n");
+	for (size_t i = 0; i < darr_get_size(ticks) && i < SLOWEST_TICK_COUNT; i++)
+	{
+		const TickLatency *tick = darr_getc(ticks, i);
+		printf("  #%-8zu %10.1f us  key %-5d %s\n", tick->index, tick->latency / 1000.0, tick->key, tick->operation);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 3)
+	{
+		printf("Usage: %s <trace file> <file>\n", argv[0]);
+		return 1;
+	}
+	KeyTrace *trace = ktrace_load(argv[1]);
+	if (trace == NULL)
+	{
+		printf("Couldn't read the trace %s\n", argv[1]);
+		return 1;
+	}
+	size_t file_size;
+	uint64_t file_hash = hash_file(argv[2], &file_size);
+	if (file_hash != trace->file_hash || file_size != trace->file_size)
+	{
+		printf("Warning: %s isn't the file the trace was recorded on, latencies might not be comparable\n", argv[2]);
+	}
+	Editor *editor = editor_create(trace->window_size, headless_io_recording_interface());
+	editor_read_file(editor, argv[2]);
+	DynamicArray *ticks = darr_create(sizeof(TickLatency), MEM_OTHER);
+	for (size_t i = 0; i < darr_get_size(trace->events); i++)
+	{
+		const KeyTraceEvent *event = darr_getc(trace->events, i);
+		TickLatency tick = { .index = i, .key = event->key, .operation = editor_get_key_operation(editor, event->key) };
+		headless_io_feed_keys(1, &event->key);
+		uint64_t start = get_time_ns();
+		int res = editor_process_tick(editor);
+		editor_render_screen(editor);
+		tick.latency = get_time_ns() - start;
+		darr_add_single(ticks, &tick);
+		if (res != TEXT_EDITOR_SUCCESSFUL_READ)
+		{
+			break;
+		}
+	}
+	print_report(ticks);
+	darr_destroy(ticks);
+	editor_destroy(editor);
+	ktrace_destroy(trace);
+	return 0;
+}